@@ -22,6 +22,9 @@
 
 #include "gskcairoblurprivate.h"
 
+#include "gskrendernodeprivate.h"
+#include "gskroundedrectprivate.h"
+
 #include <math.h>
 #include <string.h>
 
@@ -218,6 +221,540 @@ _boxblur (guchar      *buffer,
   g_free (flipped_buffer);
 }
 
+/* The vectorized kernels below work on "lanes": n_lanes independent
+ * bytes that are blurred along the same direction in parallel. For the
+ * vertical pass the lanes are adjacent bytes of a row, so a strip of
+ * columns can be copied out of the image row by row. For the horizontal
+ * pass a strip of rows is transposed into a small tile first, so each
+ * tile row holds one pixel column of the strip. Both strips are small
+ * enough to stay in cache, unlike flipping the whole buffer.
+ *
+ * Each lane gets the same sliding window treatment as blur_xspan(),
+ * including the rounding of the division, so all kernels produce
+ * identical results. The window sums are kept in 16 bits, which limits
+ * the vectorized kernels to box filters of at most MAX_LANES_FILTER_SIZE.
+ */
+#define MAX_LANES_FILTER_SIZE 256
+
+/* Pixel columns transposed per block, see gather_rows() */
+#define TRANSPOSE_BLOCK_SIZE 64
+
+typedef void (* BlurLanesFunc) (const guchar *src,
+                                guchar       *dst,
+                                int           n,
+                                int           d,
+                                int           shift);
+
+typedef struct {
+  const char    *name;
+  int            n_lanes;
+  BlurLanesFunc  blur_lanes;
+} BlurKernel;
+
+static inline int
+get_lanes_offset (int d,
+                  int shift)
+{
+  if (d % 2 == 1)
+    return d / 2;
+  else
+    return (d - shift) / 2;
+}
+
+static void
+blur_lanes_c (const guchar *src,
+              guchar       *dst,
+              int           n,
+              int           d,
+              int           shift)
+{
+  int offset = get_lanes_offset (d, shift);
+  int sum[4] = { 0, };
+  int i, l;
+
+  for (i = -d + offset; i < n + offset; i++)
+    {
+      for (l = 0; l < 4; l++)
+        {
+          if (i >= 0 && i < n)
+            sum[l] += src[i * 4 + l];
+
+          if (i >= offset)
+            {
+              if (i >= d)
+                sum[l] -= src[(i - d) * 4 + l];
+
+              dst[(i - offset) * 4 + l] = (sum[l] + d / 2) / d;
+            }
+        }
+    }
+}
+
+#if defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || G_GNUC_CHECK_VERSION (4, 9))
+#define HAVE_BLUR_SSE2 1
+#define HAVE_BLUR_AVX2 1
+#include <immintrin.h>
+
+/* Divides 8 unsigned 16-bit lanes by d. Float division is exact here:
+ * both operands are below 2^16, so a non-integral quotient is always
+ * more than half an ulp away from the next integer.
+ */
+static inline __m128i
+div_epu16_sse2 (__m128i x,
+                __m128  d)
+{
+  __m128i zero = _mm_setzero_si128 ();
+  __m128i lo, hi;
+
+  lo = _mm_cvttps_epi32 (_mm_div_ps (_mm_cvtepi32_ps (_mm_unpacklo_epi16 (x, zero)), d));
+  hi = _mm_cvttps_epi32 (_mm_div_ps (_mm_cvtepi32_ps (_mm_unpackhi_epi16 (x, zero)), d));
+
+  return _mm_packs_epi32 (lo, hi);
+}
+
+static void
+blur_lanes_sse2 (const guchar *src,
+                 guchar       *dst,
+                 int           n,
+                 int           d,
+                 int           shift)
+{
+  int offset = get_lanes_offset (d, shift);
+  __m128i zero = _mm_setzero_si128 ();
+  __m128i half = _mm_set1_epi16 (d / 2);
+  __m128 divisor = _mm_set1_ps (d);
+  __m128i sum_lo = zero;
+  __m128i sum_hi = zero;
+  int i;
+
+  for (i = -d + offset; i < n + offset; i++)
+    {
+      if (i >= 0 && i < n)
+        {
+          __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i * 16));
+          sum_lo = _mm_add_epi16 (sum_lo, _mm_unpacklo_epi8 (v, zero));
+          sum_hi = _mm_add_epi16 (sum_hi, _mm_unpackhi_epi8 (v, zero));
+        }
+
+      if (i >= offset)
+        {
+          __m128i lo, hi;
+
+          if (i >= d)
+            {
+              __m128i v = _mm_loadu_si128 ((const __m128i *) (src + (i - d) * 16));
+              sum_lo = _mm_sub_epi16 (sum_lo, _mm_unpacklo_epi8 (v, zero));
+              sum_hi = _mm_sub_epi16 (sum_hi, _mm_unpackhi_epi8 (v, zero));
+            }
+
+          lo = div_epu16_sse2 (_mm_add_epi16 (sum_lo, half), divisor);
+          hi = div_epu16_sse2 (_mm_add_epi16 (sum_hi, half), divisor);
+          _mm_storeu_si128 ((__m128i *) (dst + (i - offset) * 16), _mm_packus_epi16 (lo, hi));
+        }
+    }
+}
+
+/* The AVX2 unpack and pack instructions work within 128-bit halves,
+ * but since every unpack is undone by the matching pack, the lane
+ * order comes out unchanged.
+ */
+__attribute__((target ("avx2"))) static inline __m256i
+div_epu16_avx2 (__m256i x,
+                __m256  d)
+{
+  __m256i zero = _mm256_setzero_si256 ();
+  __m256i lo, hi;
+
+  lo = _mm256_cvttps_epi32 (_mm256_div_ps (_mm256_cvtepi32_ps (_mm256_unpacklo_epi16 (x, zero)), d));
+  hi = _mm256_cvttps_epi32 (_mm256_div_ps (_mm256_cvtepi32_ps (_mm256_unpackhi_epi16 (x, zero)), d));
+
+  return _mm256_packs_epi32 (lo, hi);
+}
+
+__attribute__((target ("avx2"))) static void
+blur_lanes_avx2 (const guchar *src,
+                 guchar       *dst,
+                 int           n,
+                 int           d,
+                 int           shift)
+{
+  int offset = get_lanes_offset (d, shift);
+  __m256i zero = _mm256_setzero_si256 ();
+  __m256i half = _mm256_set1_epi16 (d / 2);
+  __m256 divisor = _mm256_set1_ps (d);
+  __m256i sum_lo = zero;
+  __m256i sum_hi = zero;
+  int i;
+
+  for (i = -d + offset; i < n + offset; i++)
+    {
+      if (i >= 0 && i < n)
+        {
+          __m256i v = _mm256_loadu_si256 ((const __m256i *) (src + i * 32));
+          sum_lo = _mm256_add_epi16 (sum_lo, _mm256_unpacklo_epi8 (v, zero));
+          sum_hi = _mm256_add_epi16 (sum_hi, _mm256_unpackhi_epi8 (v, zero));
+        }
+
+      if (i >= offset)
+        {
+          __m256i lo, hi;
+
+          if (i >= d)
+            {
+              __m256i v = _mm256_loadu_si256 ((const __m256i *) (src + (i - d) * 32));
+              sum_lo = _mm256_sub_epi16 (sum_lo, _mm256_unpacklo_epi8 (v, zero));
+              sum_hi = _mm256_sub_epi16 (sum_hi, _mm256_unpackhi_epi8 (v, zero));
+            }
+
+          lo = div_epu16_avx2 (_mm256_add_epi16 (sum_lo, half), divisor);
+          hi = div_epu16_avx2 (_mm256_add_epi16 (sum_hi, half), divisor);
+          _mm256_storeu_si256 ((__m256i *) (dst + (i - offset) * 32), _mm256_packus_epi16 (lo, hi));
+        }
+    }
+}
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define HAVE_BLUR_NEON 1
+#include <arm_neon.h>
+
+static inline uint16x8_t
+div_u16_neon (uint16x8_t  x,
+              float32x4_t d)
+{
+  uint32x4_t lo, hi;
+
+  lo = vcvtq_u32_f32 (vdivq_f32 (vcvtq_f32_u32 (vmovl_u16 (vget_low_u16 (x))), d));
+  hi = vcvtq_u32_f32 (vdivq_f32 (vcvtq_f32_u32 (vmovl_u16 (vget_high_u16 (x))), d));
+
+  return vcombine_u16 (vmovn_u32 (lo), vmovn_u32 (hi));
+}
+
+static void
+blur_lanes_neon (const guchar *src,
+                 guchar       *dst,
+                 int           n,
+                 int           d,
+                 int           shift)
+{
+  int offset = get_lanes_offset (d, shift);
+  uint16x8_t half = vdupq_n_u16 (d / 2);
+  float32x4_t divisor = vdupq_n_f32 (d);
+  uint16x8_t sum_lo = vdupq_n_u16 (0);
+  uint16x8_t sum_hi = vdupq_n_u16 (0);
+  int i;
+
+  for (i = -d + offset; i < n + offset; i++)
+    {
+      if (i >= 0 && i < n)
+        {
+          uint8x16_t v = vld1q_u8 (src + i * 16);
+          sum_lo = vaddw_u8 (sum_lo, vget_low_u8 (v));
+          sum_hi = vaddw_u8 (sum_hi, vget_high_u8 (v));
+        }
+
+      if (i >= offset)
+        {
+          uint16x8_t lo, hi;
+
+          if (i >= d)
+            {
+              uint8x16_t v = vld1q_u8 (src + (i - d) * 16);
+              sum_lo = vsubw_u8 (sum_lo, vget_low_u8 (v));
+              sum_hi = vsubw_u8 (sum_hi, vget_high_u8 (v));
+            }
+
+          lo = div_u16_neon (vaddq_u16 (sum_lo, half), divisor);
+          hi = div_u16_neon (vaddq_u16 (sum_hi, half), divisor);
+          vst1q_u8 (dst + (i - offset) * 16, vcombine_u8 (vqmovn_u16 (lo), vqmovn_u16 (hi)));
+        }
+    }
+}
+#endif
+
+static const BlurKernel blur_kernels[GSK_BLUR_KERNEL_N_KERNELS] = {
+  [GSK_BLUR_KERNEL_SCALAR] = { "scalar", 4, blur_lanes_c },
+#ifdef HAVE_BLUR_SSE2
+  [GSK_BLUR_KERNEL_SSE2] = { "sse2", 16, blur_lanes_sse2 },
+#else
+  [GSK_BLUR_KERNEL_SSE2] = { "sse2", 0, NULL },
+#endif
+#ifdef HAVE_BLUR_AVX2
+  [GSK_BLUR_KERNEL_AVX2] = { "avx2", 32, blur_lanes_avx2 },
+#else
+  [GSK_BLUR_KERNEL_AVX2] = { "avx2", 0, NULL },
+#endif
+#ifdef HAVE_BLUR_NEON
+  [GSK_BLUR_KERNEL_NEON] = { "neon", 16, blur_lanes_neon },
+#else
+  [GSK_BLUR_KERNEL_NEON] = { "neon", 0, NULL },
+#endif
+};
+
+/* Copies n_lanes bytes starting at column @x of every row into @tile */
+static void
+gather_columns (guchar       *tile,
+                const guchar *buffer,
+                int           stride,
+                int           height,
+                int           x,
+                int           n_lanes,
+                int           n_valid)
+{
+  int y;
+
+  for (y = 0; y < height; y++)
+    memcpy (tile + y * n_lanes, buffer + y * stride + x, n_valid);
+}
+
+static void
+scatter_columns (const guchar *tile,
+                 guchar       *buffer,
+                 int           stride,
+                 int           height,
+                 int           x,
+                 int           n_lanes,
+                 int           n_valid)
+{
+  int y;
+
+  for (y = 0; y < height; y++)
+    memcpy (buffer + y * stride + x, tile + y * n_lanes, n_valid);
+}
+
+/* Transposes the rows starting at row @y into @tile, so that tile row x
+ * holds pixel x of each row. This is done in blocks of pixel columns so
+ * that both the rows being read and the tile being written stay in cache.
+ */
+static void
+gather_rows (guchar       *tile,
+             const guchar *buffer,
+             int           stride,
+             int           width,
+             int           bpp,
+             int           y,
+             int           n_lanes,
+             int           n_valid)
+{
+  int rows = n_valid / bpp;
+  int x0, x, r;
+
+  for (x0 = 0; x0 < width; x0 += TRANSPOSE_BLOCK_SIZE)
+    {
+      int max_x = MIN (x0 + TRANSPOSE_BLOCK_SIZE, width);
+
+      for (r = 0; r < rows; r++)
+        {
+          const guchar *row = buffer + (y + r) * stride;
+
+          if (bpp == 4)
+            for (x = x0; x < max_x; x++)
+              memcpy (tile + x * n_lanes + r * 4, row + x * 4, 4);
+          else
+            for (x = x0; x < max_x; x++)
+              tile[x * n_lanes + r] = row[x];
+        }
+    }
+}
+
+static void
+scatter_rows (const guchar *tile,
+              guchar       *buffer,
+              int           stride,
+              int           width,
+              int           bpp,
+              int           y,
+              int           n_lanes,
+              int           n_valid)
+{
+  int rows = n_valid / bpp;
+  int x0, x, r;
+
+  for (x0 = 0; x0 < width; x0 += TRANSPOSE_BLOCK_SIZE)
+    {
+      int max_x = MIN (x0 + TRANSPOSE_BLOCK_SIZE, width);
+
+      for (r = 0; r < rows; r++)
+        {
+          guchar *row = buffer + (y + r) * stride;
+
+          if (bpp == 4)
+            for (x = x0; x < max_x; x++)
+              memcpy (row + x * 4, tile + x * n_lanes + r * 4, 4);
+          else
+            for (x = x0; x < max_x; x++)
+              row[x] = tile[x * n_lanes + r];
+        }
+    }
+}
+
+/* Runs the three box blur passes over a tile of n lanes wide rows,
+ * leaving the result in @tmp.
+ */
+static void
+blur_tile (const BlurKernel *kernel,
+           guchar           *tile,
+           guchar           *tmp,
+           int               n,
+           int               d)
+{
+  /* See blur_rows() for why even sizes need different shifts */
+  if (d % 2 == 1)
+    {
+      kernel->blur_lanes (tile, tmp, n, d, 0);
+      kernel->blur_lanes (tmp, tile, n, d, 0);
+      kernel->blur_lanes (tile, tmp, n, d, 0);
+    }
+  else
+    {
+      kernel->blur_lanes (tile, tmp, n, d, 1);
+      kernel->blur_lanes (tmp, tile, n, d, -1);
+      kernel->blur_lanes (tile, tmp, n, d + 1, 0);
+    }
+}
+
+static void
+_boxblur_lanes (const BlurKernel *kernel,
+                guchar           *buffer,
+                int               width,
+                int               height,
+                int               stride,
+                int               bpp,
+                int               radius,
+                GskBlurFlags      flags)
+{
+  int n_lanes = kernel->n_lanes;
+  int d = get_box_filter_size (radius);
+  guchar *tile, *tmp;
+  int i;
+
+  tile = g_malloc0 (MAX (width, height) * n_lanes);
+  tmp = g_malloc (MAX (width, height) * n_lanes);
+
+  if (flags & GSK_BLUR_Y)
+    {
+      int row_bytes = width * bpp;
+
+      for (i = 0; i < row_bytes; i += n_lanes)
+        {
+          int n_valid = MIN (n_lanes, row_bytes - i);
+
+          gather_columns (tile, buffer, stride, height, i, n_lanes, n_valid);
+          blur_tile (kernel, tile, tmp, height, d);
+          scatter_columns (tmp, buffer, stride, height, i, n_lanes, n_valid);
+        }
+    }
+
+  if (flags & GSK_BLUR_X)
+    {
+      int rows_per_tile = n_lanes / bpp;
+
+      for (i = 0; i < height; i += rows_per_tile)
+        {
+          int n_valid = MIN (rows_per_tile, height - i) * bpp;
+
+          gather_rows (tile, buffer, stride, width, bpp, i, n_lanes, n_valid);
+          blur_tile (kernel, tile, tmp, width, d);
+          scatter_rows (tmp, buffer, stride, width, bpp, i, n_lanes, n_valid);
+        }
+    }
+
+  g_free (tile);
+  g_free (tmp);
+}
+
+/*<private>
+ * gsk_cairo_blur_kernel_is_supported:
+ * @kernel: a #GskBlurKernel
+ *
+ * Checks whether @kernel was compiled in and can run on this CPU.
+ *
+ * Returns: %TRUE if @kernel can be passed to
+ *   gsk_cairo_blur_surface_with_kernel()
+ */
+gboolean
+gsk_cairo_blur_kernel_is_supported (GskBlurKernel kernel)
+{
+  switch (kernel)
+    {
+    case GSK_BLUR_KERNEL_SCALAR:
+      return TRUE;
+
+#ifdef HAVE_BLUR_SSE2
+    case GSK_BLUR_KERNEL_SSE2:
+      return TRUE;
+#endif
+
+#ifdef HAVE_BLUR_AVX2
+    case GSK_BLUR_KERNEL_AVX2:
+      __builtin_cpu_init ();
+      return __builtin_cpu_supports ("avx2");
+#endif
+
+#ifdef HAVE_BLUR_NEON
+    case GSK_BLUR_KERNEL_NEON:
+      return TRUE;
+#endif
+
+    default:
+      return FALSE;
+    }
+}
+
+/*<private>
+ * gsk_cairo_blur_kernel_get_name:
+ * @kernel: a #GskBlurKernel
+ *
+ * Returns: a short name for @kernel, for use in debug output
+ */
+const char *
+gsk_cairo_blur_kernel_get_name (GskBlurKernel kernel)
+{
+  g_return_val_if_fail (kernel < GSK_BLUR_KERNEL_N_KERNELS, NULL);
+
+  return blur_kernels[kernel].name;
+}
+
+/*<private>
+ * gsk_cairo_blur_get_default_kernel:
+ *
+ * Picks the fastest kernel supported on this CPU. The choice is made
+ * once and used by gsk_cairo_blur_surface() from then on.
+ *
+ * Returns: the #GskBlurKernel to use
+ */
+GskBlurKernel
+gsk_cairo_blur_get_default_kernel (void)
+{
+  static gsize default_kernel = 0;
+
+  if (g_once_init_enter (&default_kernel))
+    {
+      static const GskBlurKernel preferred[] = {
+        GSK_BLUR_KERNEL_AVX2,
+        GSK_BLUR_KERNEL_SSE2,
+        GSK_BLUR_KERNEL_NEON,
+      };
+      GskBlurKernel kernel = GSK_BLUR_KERNEL_SCALAR;
+      guint i;
+
+      for (i = 0; i < G_N_ELEMENTS (preferred); i++)
+        {
+          if (gsk_cairo_blur_kernel_is_supported (preferred[i]))
+            {
+              kernel = preferred[i];
+              break;
+            }
+        }
+
+      /* Store kernel + 1, since 0 means "not initialized yet" */
+      g_once_init_leave (&default_kernel, kernel + 1);
+    }
+
+  return default_kernel - 1;
+}
+
 /*
  * _gsk_cairo_blur_surface:
  * @surface: a cairo image surface.
@@ -230,11 +767,40 @@ gsk_cairo_blur_surface (cairo_surface_t* surface,
                         double           radius_d,
                         GskBlurFlags     flags)
 {
+  gsk_cairo_blur_surface_with_kernel (surface, radius_d, flags,
+                                      gsk_cairo_blur_get_default_kernel ());
+}
+
+/*<private>
+ * gsk_cairo_blur_surface_with_kernel:
+ * @surface: a cairo image surface in A8 or ARGB32 format
+ * @radius: the blur radius
+ * @flags: the directions to blur in
+ * @kernel: a supported #GskBlurKernel
+ *
+ * Like gsk_cairo_blur_surface(), but with an explicitly chosen kernel.
+ * All kernels produce identical results; this exists for benchmarking
+ * and testing them against each other.
+ *
+ * Radii too large for the 16-bit sums of the vectorized kernels are
+ * handled by the scalar kernel.
+ */
+void
+gsk_cairo_blur_surface_with_kernel (cairo_surface_t *surface,
+                                    double           radius_d,
+                                    GskBlurFlags     flags,
+                                    GskBlurKernel    kernel)
+{
+  cairo_format_t format;
   int radius = radius_d;
+  int bpp;
 
   g_return_if_fail (surface != NULL);
   g_return_if_fail (cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_IMAGE);
-  g_return_if_fail (cairo_image_surface_get_format (surface) == CAIRO_FORMAT_A8);
+  g_return_if_fail (gsk_cairo_blur_kernel_is_supported (kernel));
+
+  format = cairo_image_surface_get_format (surface);
+  g_return_if_fail (format == CAIRO_FORMAT_A8 || format == CAIRO_FORMAT_ARGB32);
 
   /* The code doesn't actually do any blurring for radius 1, as it
    * ends up with box filter size 1 */
@@ -247,10 +813,24 @@ gsk_cairo_blur_surface (cairo_surface_t* surface,
   /* Before we mess with the surface, execute any pending drawing. */
   cairo_surface_flush (surface);
 
-  _boxblur (cairo_image_surface_get_data (surface),
-            cairo_image_surface_get_stride (surface),
-            cairo_image_surface_get_height (surface),
-            radius, flags);
+  if (get_box_filter_size (radius) >= MAX_LANES_FILTER_SIZE)
+    kernel = GSK_BLUR_KERNEL_SCALAR;
+
+  /* Premultiplied ARGB32 is blurred per channel, just like A8 */
+  bpp = format == CAIRO_FORMAT_ARGB32 ? 4 : 1;
+
+  if (kernel == GSK_BLUR_KERNEL_SCALAR && bpp == 1)
+    _boxblur (cairo_image_surface_get_data (surface),
+              cairo_image_surface_get_stride (surface),
+              cairo_image_surface_get_height (surface),
+              radius, flags);
+  else
+    _boxblur_lanes (&blur_kernels[kernel],
+                    cairo_image_surface_get_data (surface),
+                    cairo_image_surface_get_stride (surface) / bpp,
+                    cairo_image_surface_get_height (surface),
+                    cairo_image_surface_get_stride (surface),
+                    bpp, radius, flags);
 
   /* Inform cairo we altered the surface contents. */
   cairo_surface_mark_dirty (surface);
@@ -336,6 +916,7 @@ gsk_cairo_blur_start_drawing (cairo_t         *cr,
 
   blur_cr = cairo_create (surface);
   cairo_set_user_data (blur_cr, &original_cr_key, cairo_reference (cr), (cairo_destroy_func_t) cairo_destroy);
+  gsk_render_node_copy_draw_data (cr, blur_cr);
 
   if (cairo_has_current_point (cr))
     {
@@ -398,3 +979,317 @@ gsk_cairo_blur_finish_drawing (cairo_t         *cr,
   return original_cr;
 }
 
+
+/* Blurred rounded rectangles are drawn as nine slices of the blurred
+ * mask of the smallest rectangle with the same corners. The masks are
+ * shared by everything in the process that draws shadows, and dropped
+ * all at once when they use too much memory.
+ */
+#define MAX_BOX_MASK_CACHE_SIZE (4 * 1024 * 1024)
+
+typedef struct {
+  graphene_size_t corner[4];
+  float radius;
+  double scale;
+  gboolean inverted;
+} BoxMaskKey;
+
+typedef struct {
+  BoxMaskKey key;
+  cairo_surface_t *surface;
+} BoxMask;
+
+/* The cache is shared by all threads drawing with cairo, see
+ * gsk_cairo_renderer_draw_tiled()
+ */
+G_LOCK_DEFINE_STATIC (box_mask_cache);
+static GHashTable *box_mask_cache = NULL;
+static gsize box_mask_cache_size = 0;
+
+static guint
+box_mask_hash (gconstpointer data)
+{
+  const BoxMaskKey *key = data;
+  guint hash;
+  int i;
+
+  hash = ((guint) key->radius << 24) ^ ((guint) key->scale << 20) ^ key->inverted;
+  for (i = 0; i < 4; i++)
+    hash ^= ((guint) (key->corner[i].width * 4) << (i * 4)) ^
+            ((guint) (key->corner[i].height * 4) << (i * 4 + 2));
+
+  return hash;
+}
+
+static gboolean
+box_mask_equal (gconstpointer a,
+                gconstpointer b)
+{
+  const BoxMaskKey *key_a = a;
+  const BoxMaskKey *key_b = b;
+  int i;
+
+  if (key_a->radius != key_b->radius ||
+      key_a->scale != key_b->scale ||
+      key_a->inverted != key_b->inverted)
+    return FALSE;
+
+  for (i = 0; i < 4; i++)
+    {
+      if (key_a->corner[i].width != key_b->corner[i].width ||
+          key_a->corner[i].height != key_b->corner[i].height)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+box_mask_free (gpointer data)
+{
+  BoxMask *mask = data;
+
+  cairo_surface_destroy (mask->surface);
+  g_slice_free (BoxMask, mask);
+}
+
+static cairo_surface_t *
+box_mask_create (const BoxMaskKey *key,
+                 int               clip_radius,
+                 int               width,
+                 int               height)
+{
+  cairo_surface_t *surface;
+  GskRoundedRect box;
+  cairo_t *cr;
+  int i;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_A8,
+                                        ceil ((width + 2 * clip_radius) * key->scale),
+                                        ceil ((height + 2 * clip_radius) * key->scale));
+  cairo_surface_set_device_scale (surface, key->scale, key->scale);
+
+  cr = cairo_create (surface);
+  gsk_rounded_rect_init (&box,
+                         &GRAPHENE_RECT_INIT (clip_radius, clip_radius, width, height),
+                         &key->corner[GSK_CORNER_TOP_LEFT],
+                         &key->corner[GSK_CORNER_TOP_RIGHT],
+                         &key->corner[GSK_CORNER_BOTTOM_RIGHT],
+                         &key->corner[GSK_CORNER_BOTTOM_LEFT]);
+  gsk_rounded_rect_path (&box, cr);
+  cairo_fill (cr);
+  cairo_destroy (cr);
+
+  gsk_cairo_blur_surface (surface, key->radius * key->scale, GSK_BLUR_X | GSK_BLUR_Y);
+
+  if (key->inverted)
+    {
+      guchar *data = cairo_image_surface_get_data (surface);
+      int stride = cairo_image_surface_get_stride (surface);
+
+      cairo_surface_flush (surface);
+      for (i = 0; i < stride * cairo_image_surface_get_height (surface); i++)
+        data[i] = 255 - data[i];
+      cairo_surface_mark_dirty (surface);
+    }
+
+  return surface;
+}
+
+static void
+mask_slice (cairo_t         *cr,
+            cairo_surface_t *surface,
+            double           src_x,
+            double           src_y,
+            double           src_width,
+            double           src_height,
+            double           x,
+            double           y,
+            double           x1,
+            double           y1,
+            double           x2,
+            double           y2)
+{
+  cairo_surface_t *slice;
+  cairo_pattern_t *pattern;
+  cairo_matrix_t matrix;
+
+  if (x2 <= x1 || y2 <= y1)
+    return;
+
+  slice = cairo_surface_create_for_rectangle (surface, src_x, src_y, src_width, src_height);
+  pattern = cairo_pattern_create_for_surface (slice);
+  cairo_pattern_set_extend (pattern, CAIRO_EXTEND_PAD);
+  cairo_matrix_init_translate (&matrix, -x, -y);
+  cairo_pattern_set_matrix (pattern, &matrix);
+
+  cairo_save (cr);
+  cairo_rectangle (cr, x1, y1, x2 - x1, y2 - y1);
+  cairo_clip (cr);
+  cairo_mask (cr, pattern);
+  cairo_restore (cr);
+
+  cairo_pattern_destroy (pattern);
+  cairo_surface_destroy (slice);
+}
+
+/*<private>
+ * gsk_cairo_blur_fill_rounded_rect:
+ * @cr: a cairo context
+ * @rect: the rectangle to fill
+ * @radius: the blur radius
+ * @color: the color to fill with
+ * @inverted: %TRUE to fill everything but @rect, like inset shadows do
+ *
+ * Fills @rect blurred by @radius, or the area outside of it, using
+ * cached blurred masks, so that the cost of drawing a shadow doesn't
+ * depend on its size.
+ *
+ * The slices only work if the sides of @rect are long enough to have
+ * a part that is not affected by the corners; if they are not, nothing
+ * is drawn and the caller has to blur @rect itself.
+ *
+ * Returns: %TRUE if @rect was drawn
+ */
+gboolean
+gsk_cairo_blur_fill_rounded_rect (cairo_t              *cr,
+                                  const GskRoundedRect *rect,
+                                  float                 radius,
+                                  const GdkRGBA        *color,
+                                  gboolean              inverted)
+{
+  BoxMaskKey key;
+  BoxMask *mask;
+  cairo_surface_t *mask_surface = NULL;
+  int clip_radius, left, right, top, bottom;
+  double x0, y0, x3, y3;
+  double xs[4], ys[4], src_xs[4], src_ys[4];
+  int i, j;
+
+  clip_radius = gsk_cairo_blur_compute_pixels (radius);
+
+  left = ceil (MAX (rect->corner[GSK_CORNER_TOP_LEFT].width, rect->corner[GSK_CORNER_BOTTOM_LEFT].width));
+  right = ceil (MAX (rect->corner[GSK_CORNER_TOP_RIGHT].width, rect->corner[GSK_CORNER_BOTTOM_RIGHT].width));
+  top = ceil (MAX (rect->corner[GSK_CORNER_TOP_LEFT].height, rect->corner[GSK_CORNER_TOP_RIGHT].height));
+  bottom = ceil (MAX (rect->corner[GSK_CORNER_BOTTOM_LEFT].height, rect->corner[GSK_CORNER_BOTTOM_RIGHT].height));
+
+  /* The middle slices need to be out of reach of the blurred corners */
+  if (rect->bounds.size.width < left + right + 2 * clip_radius ||
+      rect->bounds.size.height < top + bottom + 2 * clip_radius)
+    return FALSE;
+
+  memset (&key, 0, sizeof (key));
+  for (i = 0; i < 4; i++)
+    key.corner[i] = rect->corner[i];
+  key.radius = radius;
+  key.scale = 1;
+  cairo_surface_get_device_scale (cairo_get_target (cr), &key.scale, NULL);
+  key.inverted = inverted;
+
+  /* The mask is referenced while drawing, since another thread may
+   * clear the cache in the meantime. It is blurred outside the lock;
+   * if two threads race to create the same mask, the first one wins.
+   */
+  G_LOCK (box_mask_cache);
+
+  if (box_mask_cache == NULL)
+    box_mask_cache = g_hash_table_new_full (box_mask_hash, box_mask_equal, NULL, box_mask_free);
+
+  mask = g_hash_table_lookup (box_mask_cache, &key);
+  if (mask != NULL)
+    mask_surface = cairo_surface_reference (mask->surface);
+
+  G_UNLOCK (box_mask_cache);
+
+  if (mask_surface == NULL)
+    {
+      gsize size;
+
+      mask_surface = box_mask_create (&key,
+                                      clip_radius,
+                                      left + right + 2 * clip_radius + 1,
+                                      top + bottom + 2 * clip_radius + 1);
+      size = cairo_image_surface_get_stride (mask_surface) *
+             cairo_image_surface_get_height (mask_surface);
+
+      G_LOCK (box_mask_cache);
+
+      if (!g_hash_table_contains (box_mask_cache, &key))
+        {
+          mask = g_slice_new (BoxMask);
+          mask->key = key;
+          mask->surface = cairo_surface_reference (mask_surface);
+
+          box_mask_cache_size += size;
+          if (box_mask_cache_size > MAX_BOX_MASK_CACHE_SIZE)
+            {
+              g_hash_table_remove_all (box_mask_cache);
+              box_mask_cache_size = size;
+            }
+
+          g_hash_table_add (box_mask_cache, mask);
+        }
+
+      G_UNLOCK (box_mask_cache);
+    }
+
+  /* The slices of the mask: the corners with the full reach of the blur
+   * on both sides, and a single row and column in the middle
+   */
+  x0 = rect->bounds.origin.x - clip_radius;
+  y0 = rect->bounds.origin.y - clip_radius;
+  x3 = rect->bounds.origin.x + rect->bounds.size.width + clip_radius;
+  y3 = rect->bounds.origin.y + rect->bounds.size.height + clip_radius;
+
+  src_xs[0] = 0;
+  src_xs[1] = left + 2 * clip_radius;
+  src_xs[2] = src_xs[1] + 1;
+  src_xs[3] = src_xs[2] + right + 2 * clip_radius;
+  src_ys[0] = 0;
+  src_ys[1] = top + 2 * clip_radius;
+  src_ys[2] = src_ys[1] + 1;
+  src_ys[3] = src_ys[2] + bottom + 2 * clip_radius;
+
+  /* Slices meet on whole pixels, so that no pixel is drawn twice */
+  xs[0] = floor (x0);
+  xs[1] = round (x0 + src_xs[1]);
+  xs[2] = round (x3 - (src_xs[3] - src_xs[2]));
+  xs[3] = ceil (x3);
+  ys[0] = floor (y0);
+  ys[1] = round (y0 + src_ys[1]);
+  ys[2] = round (y3 - (src_ys[3] - src_ys[2]));
+  ys[3] = ceil (y3);
+
+  gdk_cairo_set_source_rgba (cr, color);
+
+  for (j = 0; j < 3; j++)
+    {
+      for (i = 0; i < 3; i++)
+        {
+          mask_slice (cr, mask_surface,
+                      src_xs[i], src_ys[j],
+                      src_xs[i + 1] - src_xs[i], src_ys[j + 1] - src_ys[j],
+                      i < 2 ? x0 + src_xs[i] : x3 - (src_xs[3] - src_xs[2]),
+                      j < 2 ? y0 + src_ys[j] : y3 - (src_ys[3] - src_ys[2]),
+                      xs[i], ys[j], xs[i + 1], ys[j + 1]);
+        }
+    }
+
+  if (inverted)
+    {
+      double x1c, y1c, x2c, y2c;
+
+      /* Everything outside of the reach of the blur is covered */
+      cairo_save (cr);
+      cairo_clip_extents (cr, &x1c, &y1c, &x2c, &y2c);
+      cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
+      cairo_rectangle (cr, x1c, y1c, x2c - x1c, y2c - y1c);
+      cairo_rectangle (cr, xs[0], ys[0], xs[3] - xs[0], ys[3] - ys[0]);
+      cairo_fill (cr);
+      cairo_restore (cr);
+    }
+
+  cairo_surface_destroy (mask_surface);
+
+  return TRUE;
+}
@@ -27,6 +27,8 @@
 #include <gdk/gdk.h>
 #include <cairo.h>
 
+#include "gskroundedrect.h"
+
 G_BEGIN_DECLS
 
 typedef enum {
@@ -36,9 +38,24 @@ typedef enum {
   GSK_BLUR_REPEAT = 1<<2
 } GskBlurFlags;
 
+typedef enum {
+  GSK_BLUR_KERNEL_SCALAR,
+  GSK_BLUR_KERNEL_SSE2,
+  GSK_BLUR_KERNEL_AVX2,
+  GSK_BLUR_KERNEL_NEON,
+  GSK_BLUR_KERNEL_N_KERNELS
+} GskBlurKernel;
+
 void            gsk_cairo_blur_surface          (cairo_surface_t *surface,
                                                  double           radius,
 						 GskBlurFlags     flags);
+void            gsk_cairo_blur_surface_with_kernel (cairo_surface_t *surface,
+                                                    double           radius,
+                                                    GskBlurFlags     flags,
+                                                    GskBlurKernel    kernel);
+gboolean        gsk_cairo_blur_kernel_is_supported (GskBlurKernel    kernel);
+const char *    gsk_cairo_blur_kernel_get_name  (GskBlurKernel    kernel);
+GskBlurKernel   gsk_cairo_blur_get_default_kernel (void);
 int             gsk_cairo_blur_compute_pixels   (double           radius);
 
 cairo_t *       gsk_cairo_blur_start_drawing    (cairo_t         *cr,
@@ -49,6 +66,12 @@ cairo_t *       gsk_cairo_blur_finish_drawing   (cairo_t         *cr,
                                                  const GdkRGBA   *color,
                                                  GskBlurFlags     blur_flags);
 
+gboolean        gsk_cairo_blur_fill_rounded_rect (cairo_t              *cr,
+                                                  const GskRoundedRect *rect,
+                                                  float                 radius,
+                                                  const GdkRGBA        *color,
+                                                  gboolean              inverted);
+
 G_END_DECLS
 
 #endif /* _GSK_CAIRO_BLUR_H */
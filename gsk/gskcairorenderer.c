@@ -7,18 +7,55 @@
 #include "gskrendernodeprivate.h"
 #include "gsktextureprivate.h"
 
+#include <math.h>
+#include <pango/pangocairo.h>
+
+/* Size of the tiles drawn in parallel, in device units */
+#define TILE_SIZE 256
+
 #ifdef G_ENABLE_DEBUG
+typedef struct {
+  GQuark tiles;
+} ProfileCounters;
+
 typedef struct {
   GQuark cpu_time;
   GQuark gpu_time;
 } ProfileTimers;
 #endif
 
+typedef struct {
+  GskRenderNode *root;
+  cairo_matrix_t ctm;
+  cairo_surface_t *surface;
+  int x, y;
+
+  /* The surfaces of the textures, downloaded once for all the tiles */
+  GHashTable *texture_surfaces;
+  /* The scaled fonts of the text nodes, looked up on the main thread */
+  GHashTable *scaled_fonts;
+  /* Set if the frame surface starts with the contents of the target */
+  gboolean copy_target;
+
+  GMutex lock;
+  GCond cond;
+  guint n_pending;
+} GskCairoFrame;
+
+typedef struct {
+  GskCairoFrame *frame;
+  cairo_rectangle_int_t area;
+} GskCairoTile;
+
 struct _GskCairoRenderer
 {
   GskRenderer parent_instance;
 
+  /* Draws tiles; NULL if everything is drawn on the calling thread */
+  GThreadPool *tile_pool;
+
 #ifdef G_ENABLE_DEBUG
+  ProfileCounters profile_counters;
   ProfileTimers profile_timers;
 #endif
 };
@@ -30,18 +67,335 @@ struct _GskCairoRendererClass
 
 G_DEFINE_TYPE (GskCairoRenderer, gsk_cairo_renderer, GSK_TYPE_RENDERER)
 
+static void gsk_cairo_renderer_draw_tile (gpointer data,
+                                          gpointer user_data);
+
 static gboolean
 gsk_cairo_renderer_realize (GskRenderer  *renderer,
                             GdkWindow    *window,
                             GError      **error)
 {
+  GskCairoRenderer *self = GSK_CAIRO_RENDERER (renderer);
+  guint n_processors = g_get_num_processors ();
+
+  if (n_processors > 1 && !GSK_RENDER_MODE_CHECK (SERIAL))
+    {
+      self->tile_pool = g_thread_pool_new (gsk_cairo_renderer_draw_tile,
+                                           NULL,
+                                           n_processors,
+                                           FALSE,
+                                           NULL);
+    }
+
   return TRUE;
 }
 
 static void
 gsk_cairo_renderer_unrealize (GskRenderer *renderer)
 {
+  GskCairoRenderer *self = GSK_CAIRO_RENDERER (renderer);
+
+  if (self->tile_pool)
+    {
+      g_thread_pool_free (self->tile_pool, FALSE, TRUE);
+      self->tile_pool = NULL;
+    }
+}
+
+/* Checks the requirements for drawing @node from several threads,
+ * as documented for gsk_render_node_draw(): the nodes themselves are
+ * immutable, but the surfaces of cairo nodes must be image surfaces.
+ * Other surface types may change internal state when used as a source.
+ *
+ * Textures are downloaded here, so the tiles don't convert them again,
+ * the scaled fonts of text nodes are looked up here, so the tiles don't
+ * have to call into pango, and blend nodes make the tiles start from
+ * the contents of the target, like they would when drawing directly.
+ */
+static gboolean
+gsk_cairo_renderer_prepare_threaded (GskCairoFrame *frame,
+                                     GskRenderNode *node)
+{
+  cairo_surface_t *surface;
+  GskTexture *texture;
+  PangoFont *font;
+  guint i;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_TEXTURE_NODE:
+      texture = gsk_texture_node_get_texture (node);
+      surface = g_hash_table_lookup (frame->texture_surfaces, texture);
+      if (surface == NULL)
+        {
+          surface = gsk_texture_download_surface (texture);
+          g_hash_table_insert (frame->texture_surfaces, texture, surface);
+        }
+      return cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_IMAGE;
+
+    case GSK_TEXT_NODE:
+      font = gsk_text_node_peek_font (node);
+      if (PANGO_IS_CAIRO_FONT (font) &&
+          !g_hash_table_contains (frame->scaled_fonts, font))
+        {
+          cairo_scaled_font_t *scaled_font;
+
+          /* Text nodes without a scaled font are drawn through pango */
+          scaled_font = pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (font));
+          if (scaled_font != NULL)
+            g_hash_table_insert (frame->scaled_fonts, font, cairo_scaled_font_reference (scaled_font));
+        }
+      return TRUE;
+
+    case GSK_CAIRO_NODE:
+      surface = gsk_cairo_node_get_surface (node);
+      return surface == NULL ||
+             cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_IMAGE;
+
+    case GSK_CONTAINER_NODE:
+      for (i = 0; i < gsk_container_node_get_n_children (node); i++)
+        {
+          if (!gsk_cairo_renderer_prepare_threaded (frame, gsk_container_node_get_child (node, i)))
+            return FALSE;
+        }
+      return TRUE;
+
+    case GSK_TRANSFORM_NODE:
+      return gsk_cairo_renderer_prepare_threaded (frame, gsk_transform_node_get_child (node));
+
+    case GSK_OPACITY_NODE:
+      return gsk_cairo_renderer_prepare_threaded (frame, gsk_opacity_node_get_child (node));
+
+    case GSK_COLOR_MATRIX_NODE:
+      return gsk_cairo_renderer_prepare_threaded (frame, gsk_color_matrix_node_get_child (node));
+
+    case GSK_REPEAT_NODE:
+      return gsk_cairo_renderer_prepare_threaded (frame, gsk_repeat_node_get_child (node));
+
+    case GSK_CLIP_NODE:
+      return gsk_cairo_renderer_prepare_threaded (frame, gsk_clip_node_get_child (node));
+
+    case GSK_ROUNDED_CLIP_NODE:
+      return gsk_cairo_renderer_prepare_threaded (frame, gsk_rounded_clip_node_get_child (node));
+
+    case GSK_SHADOW_NODE:
+      return gsk_cairo_renderer_prepare_threaded (frame, gsk_shadow_node_get_child (node));
+
+    case GSK_BLEND_NODE:
+      frame->copy_target = TRUE;
+      return gsk_cairo_renderer_prepare_threaded (frame, gsk_blend_node_get_bottom_child (node)) &&
+             gsk_cairo_renderer_prepare_threaded (frame, gsk_blend_node_get_top_child (node));
+
+    case GSK_CROSS_FADE_NODE:
+      return gsk_cairo_renderer_prepare_threaded (frame, gsk_cross_fade_node_get_start_child (node)) &&
+             gsk_cairo_renderer_prepare_threaded (frame, gsk_cross_fade_node_get_end_child (node));
+
+    case GSK_NOT_A_RENDER_NODE:
+    case GSK_COLOR_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_BORDER_NODE:
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+    default:
+      return TRUE;
+    }
+}
+
+/* Runs in the tile pool. Each tile draws into its own part of the
+ * frame's image surface; the parts do not overlap.
+ */
+static void
+gsk_cairo_renderer_draw_tile (gpointer data,
+                              gpointer user_data)
+{
+  GskCairoTile *tile = data;
+  GskCairoFrame *frame = tile->frame;
+  cairo_surface_t *surface;
+  double x_scale, y_scale;
+  int stride;
+  cairo_t *cr;
+
+  cairo_surface_get_device_scale (frame->surface, &x_scale, &y_scale);
+  stride = cairo_image_surface_get_stride (frame->surface);
+
+  surface = cairo_image_surface_create_for_data (cairo_image_surface_get_data (frame->surface)
+                                                 + (int) ((tile->area.y - frame->y) * y_scale) * stride
+                                                 + (int) ((tile->area.x - frame->x) * x_scale) * 4,
+                                                 CAIRO_FORMAT_ARGB32,
+                                                 tile->area.width * x_scale,
+                                                 tile->area.height * y_scale,
+                                                 stride);
+  cairo_surface_set_device_scale (surface, x_scale, y_scale);
+
+  cr = cairo_create (surface);
+  cairo_set_user_data (cr, &gsk_texture_node_surfaces_key, frame->texture_surfaces, NULL);
+  cairo_set_user_data (cr, &gsk_text_node_scaled_fonts_key, frame->scaled_fonts, NULL);
+  cairo_translate (cr, - tile->area.x, - tile->area.y);
+  cairo_transform (cr, &frame->ctm);
+
+  gsk_render_node_draw (frame->root, cr);
+
+  cairo_destroy (cr);
+  cairo_surface_finish (surface);
+  cairo_surface_destroy (surface);
+
+  g_mutex_lock (&frame->lock);
+  frame->n_pending--;
+  if (frame->n_pending == 0)
+    g_cond_signal (&frame->cond);
+  g_mutex_unlock (&frame->lock);
+}
+
+/* Splits the area to redraw into tiles, draws them on the tile pool
+ * and composites the result onto @cr. The tiles are aligned to device
+ * pixels, so this only works if @cr is not scaled or rotated.
+ *
+ * Returns: %FALSE if the node has to be drawn directly
+ */
+static gboolean
+gsk_cairo_renderer_draw_tiled (GskCairoRenderer *self,
+                               cairo_t          *cr,
+                               GskRenderNode    *root)
+{
+  GskCairoFrame frame;
+  GskCairoTile *tiles;
+  cairo_rectangle_int_t extents;
+  double x1, y1, x2, y2;
+  double x_scale, y_scale;
+  guint n_tiles, i;
+  int x, y;
+
+  if (self->tile_pool == NULL)
+    return FALSE;
+
+  cairo_get_matrix (cr, &frame.ctm);
+  if (frame.ctm.xx != 1.0 || frame.ctm.yy != 1.0 ||
+      frame.ctm.xy != 0.0 || frame.ctm.yx != 0.0)
+    return FALSE;
+
+  cairo_surface_get_device_scale (cairo_get_group_target (cr), &x_scale, &y_scale);
+  if (x_scale != floor (x_scale) || y_scale != floor (y_scale))
+    return FALSE;
+
+  /* Only draw the parts of the clip that the root node covers */
+  cairo_save (cr);
+  cairo_rectangle (cr,
+                   root->bounds.origin.x, root->bounds.origin.y,
+                   root->bounds.size.width, root->bounds.size.height);
+  cairo_clip (cr);
+  cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+  cairo_restore (cr);
+
+  cairo_user_to_device (cr, &x1, &y1);
+  cairo_user_to_device (cr, &x2, &y2);
+  extents.x = floor (x1);
+  extents.y = floor (y1);
+  extents.width = ceil (x2) - extents.x;
+  extents.height = ceil (y2) - extents.y;
+
+  if (extents.width <= 0 || extents.height <= 0)
+    return TRUE;
+
+  /* Not worth the overhead */
+  if (extents.width <= TILE_SIZE && extents.height <= TILE_SIZE)
+    return FALSE;
+
+  frame.texture_surfaces = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) cairo_surface_destroy);
+  frame.scaled_fonts = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) cairo_scaled_font_destroy);
+  frame.copy_target = FALSE;
+  if (!gsk_cairo_renderer_prepare_threaded (&frame, root))
+    {
+      GSK_NOTE (CAIRO, g_print ("Node tree contains non-image surfaces, not drawing in tiles\n"));
+      g_hash_table_unref (frame.texture_surfaces);
+      g_hash_table_unref (frame.scaled_fonts);
+      return FALSE;
+    }
 
+  frame.root = root;
+  frame.x = extents.x;
+  frame.y = extents.y;
+  frame.surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                              extents.width * x_scale,
+                                              extents.height * y_scale);
+  cairo_surface_set_device_scale (frame.surface, x_scale, y_scale);
+  if (cairo_surface_status (frame.surface))
+    {
+      cairo_surface_destroy (frame.surface);
+      g_hash_table_unref (frame.texture_surfaces);
+      g_hash_table_unref (frame.scaled_fonts);
+      return FALSE;
+    }
+
+  /* The tiles draw over what is already there, so blending sees the
+   * same contents as when drawing directly
+   */
+  if (frame.copy_target)
+    {
+      cairo_t *copy_cr = cairo_create (frame.surface);
+
+      cairo_set_operator (copy_cr, CAIRO_OPERATOR_SOURCE);
+      cairo_set_source_surface (copy_cr, cairo_get_group_target (cr), - frame.x, - frame.y);
+      cairo_paint (copy_cr);
+      cairo_destroy (copy_cr);
+    }
+
+  cairo_surface_flush (frame.surface);
+  g_mutex_init (&frame.lock);
+  g_cond_init (&frame.cond);
+
+  n_tiles = ((extents.width + TILE_SIZE - 1) / TILE_SIZE) *
+            ((extents.height + TILE_SIZE - 1) / TILE_SIZE);
+  tiles = g_new (GskCairoTile, n_tiles);
+  frame.n_pending = n_tiles;
+
+  i = 0;
+  for (y = extents.y; y < extents.y + extents.height; y += TILE_SIZE)
+    for (x = extents.x; x < extents.x + extents.width; x += TILE_SIZE)
+      {
+        tiles[i].frame = &frame;
+        tiles[i].area.x = x;
+        tiles[i].area.y = y;
+        tiles[i].area.width = MIN (TILE_SIZE, extents.x + extents.width - x);
+        tiles[i].area.height = MIN (TILE_SIZE, extents.y + extents.height - y);
+
+        g_thread_pool_push (self->tile_pool, &tiles[i], NULL);
+        i++;
+      }
+
+  g_mutex_lock (&frame.lock);
+  while (frame.n_pending > 0)
+    g_cond_wait (&frame.cond, &frame.lock);
+  g_mutex_unlock (&frame.lock);
+
+  cairo_surface_mark_dirty (frame.surface);
+
+  cairo_save (cr);
+  cairo_identity_matrix (cr);
+  if (frame.copy_target)
+    {
+      cairo_rectangle (cr, extents.x, extents.y, extents.width, extents.height);
+      cairo_clip (cr);
+      cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+    }
+  cairo_set_source_surface (cr, frame.surface, frame.x, frame.y);
+  cairo_paint (cr);
+  cairo_restore (cr);
+
+#ifdef G_ENABLE_DEBUG
+  gsk_profiler_counter_set (gsk_renderer_get_profiler (GSK_RENDERER (self)),
+                            self->profile_counters.tiles,
+                            n_tiles);
+#endif
+
+  g_free (tiles);
+  g_hash_table_unref (frame.texture_surfaces);
+  g_hash_table_unref (frame.scaled_fonts);
+  g_mutex_clear (&frame.lock);
+  g_cond_clear (&frame.cond);
+  cairo_surface_destroy (frame.surface);
+
+  return TRUE;
 }
 
 static void
@@ -60,7 +414,8 @@ gsk_cairo_renderer_do_render (GskRenderer   *renderer,
   gsk_profiler_timer_begin (profiler, self->profile_timers.cpu_time);
 #endif
 
-  gsk_render_node_draw (root, cr);
+  if (!gsk_cairo_renderer_draw_tiled (GSK_CAIRO_RENDERER (renderer), cr, root))
+    gsk_render_node_draw (root, cr);
 
 #ifdef G_ENABLE_DEBUG
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
@@ -143,6 +498,8 @@ gsk_cairo_renderer_init (GskCairoRenderer *self)
 #ifdef G_ENABLE_DEBUG
   GskProfiler *profiler = gsk_renderer_get_profiler (GSK_RENDERER (self));
 
+  self->profile_counters.tiles = gsk_profiler_add_counter (profiler, "tiles", "Tiles drawn in parallel", TRUE);
+
   self->profile_timers.cpu_time = gsk_profiler_add_timer (profiler, "cpu-time", "CPU time", FALSE, TRUE);
 #endif
 }
@@ -10,7 +10,8 @@ static const GDebugKey gsk_debug_keys[] = {
   { "transforms", GSK_DEBUG_TRANSFORMS },
   { "surface", GSK_DEBUG_SURFACE },
   { "vulkan", GSK_DEBUG_VULKAN },
-  { "fallback", GSK_DEBUG_FALLBACK }
+  { "fallback", GSK_DEBUG_FALLBACK },
+  { "glyph-cache", GSK_DEBUG_GLYPH_CACHE }
 };
 #endif
 
@@ -20,7 +21,8 @@ static const GDebugKey gsk_rendering_keys[] = {
   { "sync", GSK_RENDERING_MODE_SYNC },
   { "full-redraw", GSK_RENDERING_MODE_FULL_REDRAW},
   { "staging-image", GSK_RENDERING_MODE_STAGING_IMAGE },
-  { "staging-buffer", GSK_RENDERING_MODE_STAGING_BUFFER }
+  { "staging-buffer", GSK_RENDERING_MODE_STAGING_BUFFER },
+  { "serial", GSK_RENDERING_MODE_SERIAL }
 };
 
 gboolean
@@ -14,7 +14,8 @@ typedef enum {
   GSK_DEBUG_TRANSFORMS  = 1 << 5,
   GSK_DEBUG_SURFACE     = 1 << 6,
   GSK_DEBUG_VULKAN      = 1 << 7,
-  GSK_DEBUG_FALLBACK    = 1 << 8
+  GSK_DEBUG_FALLBACK    = 1 << 8,
+  GSK_DEBUG_GLYPH_CACHE = 1 << 9
 } GskDebugFlags;
 
 typedef enum {
@@ -23,7 +24,8 @@ typedef enum {
   GSK_RENDERING_MODE_SYNC           = 1 << 2,
   GSK_RENDERING_MODE_FULL_REDRAW    = 1 << 3,
   GSK_RENDERING_MODE_STAGING_IMAGE  = 1 << 4,
-  GSK_RENDERING_MODE_STAGING_BUFFER = 1 << 5
+  GSK_RENDERING_MODE_STAGING_BUFFER = 1 << 5,
+  GSK_RENDERING_MODE_SERIAL         = 1 << 6
 } GskRenderingMode;
 
 gboolean gsk_check_debug_flags (GskDebugFlags flags);
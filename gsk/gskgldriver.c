@@ -8,6 +8,32 @@
 #include <gdk/gdk.h>
 #include <epoxy/gl.h>
 
+/* Textures up to ATLAS_MAX_TEXTURE_SIZE pixels in both directions are
+ * packed into shared pages of ATLAS_PAGE_SIZE pixels
+ */
+#define ATLAS_PAGE_SIZE         1024
+#define ATLAS_MAX_TEXTURE_SIZE  128
+#define ATLAS_MAX_PAGES         4
+
+/* Each texture in the atlas is surrounded by a border replicating its
+ * edges, so that linear filtering does not sample the neighbours
+ */
+#define ATLAS_PADDING           1
+
+/* Texture data is uploaded through a ring of pixel buffers, so that the
+ * GPU can copy the pixels while we keep building the frame. Each rendered
+ * frame uses one buffer of the ring, from gsk_gl_driver_begin_upload_frame()
+ * on, and all its uploads are placed one after the other in it, so the CPU
+ * waits for the GPU at most once per frame, when reusing the buffer of
+ * three frames ago. Buffers grow to fit the uploads of a frame, up to
+ * UPLOAD_BUFFER_MAX_SIZE; a single upload that is bigger goes directly
+ * from client memory.
+ */
+#define N_UPLOAD_BUFFERS        3
+#define UPLOAD_BUFFER_MIN_SIZE  (1024 * 1024)
+#define UPLOAD_BUFFER_MAX_SIZE  (64 * 1024 * 1024)
+#define UPLOAD_ALIGNMENT        64
+
 typedef struct {
   GLuint texture_id;
   int width;
@@ -17,8 +43,35 @@ typedef struct {
   GArray *fbos;
   GskTexture *user;
   gboolean in_use : 1;
+  gboolean permanent : 1;
 } Texture;
 
+typedef struct _AtlasPage AtlasPage;
+
+/* A row of the page, filled from left to right */
+typedef struct {
+  int y;
+  int height;
+  int x;
+} AtlasShelf;
+
+typedef struct {
+  AtlasPage *page;
+  GskTexture *user;
+  /* The area of the page, including the padding */
+  cairo_rectangle_int_t area;
+  guint64 last_used;
+} AtlasEntry;
+
+struct _AtlasPage {
+  Texture *texture;
+  GArray *shelves;
+  GPtrArray *entries;
+  int used_area;
+  int next_shelf_y;
+  gboolean needs_compaction : 1;
+};
+
 typedef struct {
   GLuint vao_id;
   GLuint buffer_id;
@@ -26,7 +79,9 @@ typedef struct {
   GLuint uv_id;
   GskQuadVertex *quads;
   int n_quads;
+  gsize buffer_size;
   gboolean in_use : 1;
+  gboolean stream : 1;
 } Vao;
 
 typedef struct {
@@ -34,6 +89,31 @@ typedef struct {
   GLuint depth_stencil_id;
 } Fbo;
 
+typedef struct {
+  GLuint buffer_id;
+  gsize size;
+  /* The persistent mapping of the buffer, if any */
+  guchar *data;
+  /* The end of the uploads of the current frame */
+  gsize used;
+  /* Whether the buffer was used since the frame started */
+  gboolean in_use;
+  /* Signaled once the GPU is done reading the uploads of the last
+   * frame that used the buffer
+   */
+  GLsync fence;
+} UploadBuffer;
+
+typedef enum {
+  UPLOAD_MODE_UNKNOWN,
+  /* Straight from client memory */
+  UPLOAD_MODE_DIRECT,
+  /* Through buffers mapped for each upload */
+  UPLOAD_MODE_MAP,
+  /* Through buffers that stay mapped (GL 4.4 or ARB_buffer_storage) */
+  UPLOAD_MODE_PERSISTENT
+} UploadMode;
+
 struct _GskGLDriver
 {
   GObject parent_instance;
@@ -45,6 +125,21 @@ struct _GskGLDriver
   GHashTable *textures;
   GHashTable *vaos;
 
+  Vao *stream_vao;
+
+  GPtrArray *atlas_pages;
+
+  /* Used to find the least recently used atlas entries; counts the
+   * rendered frames, not the begin_frame()/end_frame() pairs */
+  guint64 frame_counter;
+
+  /* The amount of texture data uploaded since the last collection */
+  gsize uploaded_bytes;
+
+  UploadBuffer upload_buffers[N_UPLOAD_BUFFERS];
+  guint current_upload_buffer;
+  UploadMode upload_mode;
+
   Texture *bound_source_texture;
   Texture *bound_mask_texture;
   Vao *bound_vao;
@@ -96,6 +191,66 @@ fbo_clear (gpointer data)
   glDeleteFramebuffers (1, &f->fbo_id);
 }
 
+static void
+atlas_entry_free (AtlasEntry *entry)
+{
+  g_slice_free (AtlasEntry, entry);
+}
+
+/* Called when the GskTexture is finalized, or evicted from the atlas */
+static void
+atlas_entry_release (gpointer data)
+{
+  AtlasEntry *entry = data;
+  AtlasPage *page = entry->page;
+
+  if (page != NULL)
+    {
+      guint i;
+
+      page->used_area -= entry->area.width * entry->area.height;
+
+      /* Give the space back to the shelf, if the entry is the last one */
+      for (i = 0; i < page->shelves->len; i++)
+        {
+          AtlasShelf *shelf = &g_array_index (page->shelves, AtlasShelf, i);
+
+          if (shelf->y == entry->area.y &&
+              shelf->x == entry->area.x + entry->area.width)
+            {
+              shelf->x = entry->area.x;
+              break;
+            }
+        }
+
+      g_ptr_array_remove_fast (page->entries, entry);
+    }
+
+  atlas_entry_free (entry);
+}
+
+static void
+atlas_page_free (gpointer data)
+{
+  AtlasPage *page = data;
+  guint i;
+
+  /* The entries are freed by the GskTextures; we don't want them
+   * to access the page while it is being destroyed
+   */
+  for (i = 0; i < page->entries->len; i++)
+    {
+      AtlasEntry *entry = g_ptr_array_index (page->entries, i);
+
+      entry->page = NULL;
+      gsk_texture_clear_render_data (entry->user);
+    }
+
+  g_ptr_array_unref (page->entries);
+  g_array_unref (page->shelves);
+  g_slice_free (AtlasPage, page);
+}
+
 static Vao *
 vao_new (void)
 {
@@ -113,15 +268,38 @@ vao_free (gpointer data)
   g_slice_free (Vao, v);
 }
 
+static void
+upload_buffer_clear (UploadBuffer *buffer)
+{
+  if (buffer->fence != NULL)
+    glDeleteSync (buffer->fence);
+
+  if (buffer->buffer_id != 0)
+    glDeleteBuffers (1, &buffer->buffer_id);
+
+  buffer->buffer_id = 0;
+  buffer->size = 0;
+  buffer->data = NULL;
+  buffer->used = 0;
+  buffer->fence = NULL;
+}
+
 static void
 gsk_gl_driver_finalize (GObject *gobject)
 {
   GskGLDriver *self = GSK_GL_DRIVER (gobject);
+  guint i;
 
   gdk_gl_context_make_current (self->gl_context);
 
+  /* The pages reference textures in the textures table */
+  g_clear_pointer (&self->atlas_pages, g_ptr_array_unref);
   g_clear_pointer (&self->textures, g_hash_table_unref);
   g_clear_pointer (&self->vaos, g_hash_table_unref);
+  self->stream_vao = NULL;
+
+  for (i = 0; i < N_UPLOAD_BUFFERS; i++)
+    upload_buffer_clear (&self->upload_buffers[i]);
 
   if (self->gl_context == gdk_gl_context_get_current ())
     gdk_gl_context_clear_current ();
@@ -191,6 +369,7 @@ gsk_gl_driver_init (GskGLDriver *self)
 {
   self->textures = g_hash_table_new_full (NULL, NULL, NULL, texture_free);
   self->vaos = g_hash_table_new_full (NULL, NULL, NULL, vao_free);
+  self->atlas_pages = g_ptr_array_new_with_free_func (atlas_page_free);
 
   self->max_texture_size = -1;
 }
@@ -205,6 +384,28 @@ gsk_gl_driver_new (GdkGLContext *context)
                        NULL);
 }
 
+/**
+ * gsk_gl_driver_begin_upload_frame:
+ * @driver: a #GskGLDriver
+ *
+ * Starts a new rendered frame. A frame may be built in several
+ * gsk_gl_driver_begin_frame()/gsk_gl_driver_end_frame() sections;
+ * this must be called once before the first of them, so that the
+ * uploads of the frame go into the next buffer of the ring, and the
+ * atlas entries used anywhere in the frame are known to be in use.
+ */
+void
+gsk_gl_driver_begin_upload_frame (GskGLDriver *driver)
+{
+  g_return_if_fail (GSK_IS_GL_DRIVER (driver));
+  g_return_if_fail (!driver->in_frame);
+
+  driver->frame_counter += 1;
+
+  driver->current_upload_buffer = (driver->current_upload_buffer + 1) % N_UPLOAD_BUFFERS;
+  driver->upload_buffers[driver->current_upload_buffer].in_use = FALSE;
+}
+
 void
 gsk_gl_driver_begin_frame (GskGLDriver *driver)
 {
@@ -251,6 +452,20 @@ gsk_gl_driver_end_frame (GskGLDriver *driver)
 
   driver->default_fbo.fbo_id = 0;
 
+  /* One fence covers all the uploads of the frame so far; the fence of
+   * an earlier section of the same frame is replaced by the new one
+   */
+  {
+    UploadBuffer *buffer = &driver->upload_buffers[driver->current_upload_buffer];
+
+    if (buffer->in_use && driver->upload_mode == UPLOAD_MODE_PERSISTENT)
+      {
+        if (buffer->fence != NULL)
+          glDeleteSync (buffer->fence);
+        buffer->fence = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      }
+  }
+
   GSK_NOTE (OPENGL,
             g_print ("*** Frame end: textures=%d, vaos=%d\n",
                      g_hash_table_size (driver->textures),
@@ -259,31 +474,48 @@ gsk_gl_driver_end_frame (GskGLDriver *driver)
   driver->in_frame = FALSE;
 }
 
+static void atlas_page_compact (GskGLDriver *driver,
+                                AtlasPage   *page);
+static void gsk_gl_driver_set_texture_parameters (GskGLDriver *driver,
+                                                  int          min_filter,
+                                                  int          mag_filter);
+
 int
 gsk_gl_driver_collect_textures (GskGLDriver *driver)
 {
   GHashTableIter iter;
   gpointer value_p = NULL;
   int old_size;
+  guint i;
 
   g_return_val_if_fail (GSK_IS_GL_DRIVER (driver), 0);
   g_return_val_if_fail (!driver->in_frame, 0);
 
   old_size = g_hash_table_size (driver->textures);
 
+  driver->uploaded_bytes = 0;
+
+  for (i = 0; i < driver->atlas_pages->len; i++)
+    {
+      AtlasPage *page = g_ptr_array_index (driver->atlas_pages, i);
+
+      if (page->needs_compaction)
+        atlas_page_compact (driver, page);
+    }
+
   g_hash_table_iter_init (&iter, driver->textures);
   while (g_hash_table_iter_next (&iter, NULL, &value_p))
     {
       Texture *t = value_p;
 
-      if (t->user)
+      if (t->user || t->permanent)
         continue;
 
+      /* Textures used in the last frame are kept around, together
+       * with their render targets, so they can be recycled
+       */
       if (t->in_use)
-        {
-          t->in_use = FALSE;
-          g_clear_pointer (&t->fbos, g_array_unref);
-        }
+        t->in_use = FALSE;
       else
         g_hash_table_iter_remove (&iter);
     }
@@ -308,6 +540,10 @@ gsk_gl_driver_collect_vaos (GskGLDriver *driver)
     {
       Vao *v = value_p;
 
+      /* The streaming VAO is reused across frames */
+      if (v->stream)
+        continue;
+
       if (v->in_use)
         v->in_use = FALSE;
       else
@@ -331,6 +567,34 @@ gsk_gl_driver_get_max_texture_size (GskGLDriver *driver)
   return driver->max_texture_size;
 }
 
+void
+gsk_gl_driver_get_stats (GskGLDriver      *driver,
+                         GskGLDriverStats *stats)
+{
+  guint i;
+
+  g_return_if_fail (GSK_IS_GL_DRIVER (driver));
+  g_return_if_fail (stats != NULL);
+
+  stats->n_atlas_pages = driver->atlas_pages->len;
+  stats->n_atlas_textures = 0;
+  stats->atlas_occupancy = 0;
+  stats->uploaded_bytes = driver->uploaded_bytes;
+
+  if (driver->atlas_pages->len == 0)
+    return;
+
+  for (i = 0; i < driver->atlas_pages->len; i++)
+    {
+      AtlasPage *page = g_ptr_array_index (driver->atlas_pages, i);
+
+      stats->n_atlas_textures += page->entries->len;
+      stats->atlas_occupancy += page->used_area / (ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE / 100.0);
+    }
+
+  stats->atlas_occupancy /= driver->atlas_pages->len;
+}
+
 static Texture *
 gsk_gl_driver_get_texture (GskGLDriver *driver,
                            int          texture_id)
@@ -380,6 +644,9 @@ find_texture_by_size (GHashTable *textures,
     {
       Texture *t = value_p;
 
+      if (t->in_use || t->user != NULL || t->permanent)
+        continue;
+
       if (t->width == width && t->height == height)
         return t;
     }
@@ -407,7 +674,7 @@ create_texture (GskGLDriver *driver,
     }
 
   t = find_texture_by_size (driver->textures, width, height);
-  if (t != NULL && !t->in_use && t->user == NULL)
+  if (t != NULL)
     {
       GSK_NOTE (OPENGL, g_print ("Reusing Texture(%d) for size %dx%d\n",
                                  t->texture_id, t->width, t->height));
@@ -437,26 +704,635 @@ gsk_gl_driver_release_texture (gpointer data)
   t->user = NULL;
 }
 
+static AtlasPage *
+atlas_page_new (GskGLDriver *driver,
+                int          filter)
+{
+  AtlasPage *page;
+  guint texture_id;
+  Texture *t;
+
+  glGenTextures (1, &texture_id);
+
+  t = texture_new ();
+  t->texture_id = texture_id;
+  t->width = ATLAS_PAGE_SIZE;
+  t->height = ATLAS_PAGE_SIZE;
+  t->min_filter = filter;
+  t->mag_filter = filter;
+  t->in_use = TRUE;
+  t->permanent = TRUE;
+  g_hash_table_insert (driver->textures, GINT_TO_POINTER (texture_id), t);
+
+  gsk_gl_driver_bind_source_texture (driver, texture_id);
+  gsk_gl_driver_init_texture_empty (driver, texture_id);
+  driver->bound_source_texture = NULL;
+
+  page = g_slice_new0 (AtlasPage);
+  page->texture = t;
+  page->shelves = g_array_new (FALSE, FALSE, sizeof (AtlasShelf));
+  page->entries = g_ptr_array_new ();
+
+  g_ptr_array_add (driver->atlas_pages, page);
+
+  GSK_NOTE (OPENGL, g_print ("Created atlas page %d (filter: %s)\n",
+                             texture_id, filter == GL_NEAREST ? "nearest" : "linear"));
+
+  return page;
+}
+
+/* Allocates an area of the page using the shelf packing algorithm */
+static gboolean
+atlas_page_allocate (AtlasPage             *page,
+                     int                    width,
+                     int                    height,
+                     cairo_rectangle_int_t *area)
+{
+  AtlasShelf *best = NULL;
+  guint i;
+
+  for (i = 0; i < page->shelves->len; i++)
+    {
+      AtlasShelf *shelf = &g_array_index (page->shelves, AtlasShelf, i);
+
+      /* Avoid wasting too much space in taller shelves */
+      if (shelf->height < height || shelf->height > height * 3 / 2 + 1)
+        continue;
+
+      if (ATLAS_PAGE_SIZE - shelf->x < width)
+        continue;
+
+      if (best == NULL || shelf->height < best->height)
+        best = shelf;
+    }
+
+  if (best == NULL)
+    {
+      AtlasShelf shelf;
+
+      if (page->next_shelf_y + height > ATLAS_PAGE_SIZE)
+        return FALSE;
+
+      shelf.y = page->next_shelf_y;
+      shelf.height = height;
+      shelf.x = 0;
+      g_array_append_val (page->shelves, shelf);
+
+      page->next_shelf_y += height;
+      best = &g_array_index (page->shelves, AtlasShelf, page->shelves->len - 1);
+    }
+
+  area->x = best->x;
+  area->y = best->y;
+  area->width = width;
+  area->height = height;
+
+  best->x += width;
+  page->used_area += width * height;
+
+  return TRUE;
+}
+
+static UploadMode
+gsk_gl_driver_get_upload_mode (GskGLDriver *driver)
+{
+  if (driver->upload_mode == UPLOAD_MODE_UNKNOWN)
+    {
+      int major, minor, version;
+
+      gdk_gl_context_get_version (driver->gl_context, &major, &minor);
+      version = major * 10 + minor;
+
+      /* GLES cannot upload BGRA data, and mapping buffer ranges
+       * needs GL 3.0
+       */
+      if (gdk_gl_context_get_use_es (driver->gl_context) || version < 30)
+        driver->upload_mode = UPLOAD_MODE_DIRECT;
+      else if (version >= 44 || epoxy_has_gl_extension ("GL_ARB_buffer_storage"))
+        driver->upload_mode = UPLOAD_MODE_PERSISTENT;
+      else
+        driver->upload_mode = UPLOAD_MODE_MAP;
+
+      GSK_NOTE (OPENGL, g_print ("Texture uploads: %s\n",
+                                 driver->upload_mode == UPLOAD_MODE_PERSISTENT ? "persistently mapped buffers" :
+                                 driver->upload_mode == UPLOAD_MODE_MAP ? "mapped buffers" :
+                                 "client memory"));
+    }
+
+  return driver->upload_mode;
+}
+
+/* Creates the storage of @buffer, of at least @size bytes, and binds it
+ * to GL_PIXEL_UNPACK_BUFFER
+ */
+static void
+upload_buffer_create (UploadBuffer *buffer,
+                      UploadMode    mode,
+                      gsize         size)
+{
+  gsize new_size = CLAMP (MAX (size, buffer->size * 2),
+                          UPLOAD_BUFFER_MIN_SIZE,
+                          UPLOAD_BUFFER_MAX_SIZE);
+
+  /* The GPU keeps the old storage alive until it is done with it */
+  upload_buffer_clear (buffer);
+
+  glGenBuffers (1, &buffer->buffer_id);
+  glBindBuffer (GL_PIXEL_UNPACK_BUFFER, buffer->buffer_id);
+  buffer->size = new_size;
+
+  if (mode == UPLOAD_MODE_PERSISTENT)
+    {
+      GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+      glBufferStorage (GL_PIXEL_UNPACK_BUFFER, new_size, NULL, flags);
+      buffer->data = glMapBufferRange (GL_PIXEL_UNPACK_BUFFER, 0, new_size, flags);
+    }
+  else
+    {
+      glBufferData (GL_PIXEL_UNPACK_BUFFER, new_size, NULL, GL_STREAM_DRAW);
+    }
+}
+
+/* Binds @buffer to GL_PIXEL_UNPACK_BUFFER, reserves @size bytes after
+ * the previous uploads of the frame, and returns the memory the pixels
+ * should be written to, and their offset into the buffer in @offset
+ */
+static guchar *
+upload_buffer_map (UploadBuffer *buffer,
+                   UploadMode    mode,
+                   gsize         size,
+                   gsize        *offset)
+{
+  if (!buffer->in_use)
+    {
+      /* The first upload of the rendered frame: the last frame that
+       * used the buffer was three frames ago, so this is usually long
+       * done
+       */
+      if (buffer->fence != NULL)
+        {
+          glClientWaitSync (buffer->fence, GL_SYNC_FLUSH_COMMANDS_BIT, G_MAXUINT64);
+          glDeleteSync (buffer->fence);
+          buffer->fence = NULL;
+        }
+
+      buffer->in_use = TRUE;
+      buffer->used = 0;
+
+      if (buffer->buffer_id != 0)
+        {
+          glBindBuffer (GL_PIXEL_UNPACK_BUFFER, buffer->buffer_id);
+
+          /* Orphan the storage the GPU may still be reading from */
+          if (mode == UPLOAD_MODE_MAP)
+            glBufferData (GL_PIXEL_UNPACK_BUFFER, buffer->size, NULL, GL_STREAM_DRAW);
+        }
+    }
+  else
+    {
+      glBindBuffer (GL_PIXEL_UNPACK_BUFFER, buffer->buffer_id);
+    }
+
+  *offset = (buffer->used + UPLOAD_ALIGNMENT - 1) & ~(gsize) (UPLOAD_ALIGNMENT - 1);
+
+  /* Start over in new storage if the frame's uploads don't fit */
+  if (buffer->buffer_id == 0 || *offset + size > buffer->size)
+    {
+      upload_buffer_create (buffer, mode, *offset + size);
+      *offset = 0;
+    }
+
+  buffer->used = *offset + size;
+
+  if (mode == UPLOAD_MODE_PERSISTENT)
+    return buffer->data ? buffer->data + *offset : NULL;
+
+  /* The other uploads of the frame use different parts of the buffer */
+  return glMapBufferRange (GL_PIXEL_UNPACK_BUFFER, *offset, size,
+                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+/* Uploads the first @width x @height pixels of @surface to the bound
+ * texture, at @x, @y if @sub_image is set, or as the whole texture
+ * otherwise. The pixels go through the upload buffer of the frame, so
+ * the call does not wait for the GPU to copy them.
+ *
+ * Returns: %FALSE if the surface cannot go through the ring, in which
+ *   case nothing was uploaded
+ */
+static gboolean
+gsk_gl_driver_upload_surface (GskGLDriver     *driver,
+                              cairo_surface_t *surface,
+                              gboolean         sub_image,
+                              int              x,
+                              int              y,
+                              int              width,
+                              int              height)
+{
+  UploadMode mode = gsk_gl_driver_get_upload_mode (driver);
+  UploadBuffer *buffer;
+  guchar *data;
+  int stride;
+  gsize size, offset;
+
+  /* Uploads outside of frames would not be covered by a fence */
+  if (mode == UPLOAD_MODE_DIRECT || !driver->in_frame)
+    return FALSE;
+
+  if (cairo_surface_get_type (surface) != CAIRO_SURFACE_TYPE_IMAGE ||
+      cairo_image_surface_get_format (surface) != CAIRO_FORMAT_ARGB32 ||
+      cairo_image_surface_get_width (surface) < width ||
+      cairo_image_surface_get_height (surface) < height)
+    return FALSE;
+
+  stride = cairo_image_surface_get_stride (surface);
+  size = (gsize) stride * height;
+  if (size > UPLOAD_BUFFER_MAX_SIZE)
+    return FALSE;
+
+  buffer = &driver->upload_buffers[driver->current_upload_buffer];
+  data = upload_buffer_map (buffer, mode, size, &offset);
+  if (data == NULL)
+    {
+      glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+      return FALSE;
+    }
+
+  cairo_surface_flush (surface);
+  memcpy (data, cairo_image_surface_get_data (surface), size);
+
+  if (mode == UPLOAD_MODE_MAP)
+    glUnmapBuffer (GL_PIXEL_UNPACK_BUFFER);
+
+  /* With a pixel buffer bound, the data pointer is an offset into it */
+  glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+  glPixelStorei (GL_UNPACK_ROW_LENGTH, stride / 4);
+  if (sub_image)
+    glTexSubImage2D (GL_TEXTURE_2D, 0, x, y, width, height,
+                     GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, GSIZE_TO_POINTER (offset));
+  else
+    glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+                  GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, GSIZE_TO_POINTER (offset));
+  glPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
+
+  glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+
+  return TRUE;
+}
+
+static void
+atlas_entry_upload (GskGLDriver *driver,
+                    AtlasEntry  *entry)
+{
+  cairo_surface_t *surface, *padded;
+  cairo_t *cr;
+
+  surface = gsk_texture_download_surface (entry->user);
+
+  /* Extend the edges of the texture into the padding */
+  padded = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                       entry->area.width,
+                                       entry->area.height);
+  cr = cairo_create (padded);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface (cr, surface, ATLAS_PADDING, ATLAS_PADDING);
+  cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+  cairo_surface_flush (padded);
+
+  /* Entries are also uploaded outside of frames, when compacting pages */
+  glActiveTexture (GL_TEXTURE0);
+  glBindTexture (GL_TEXTURE_2D, entry->page->texture->texture_id);
+  driver->bound_source_texture = entry->page->texture;
+
+  if (!gsk_gl_driver_upload_surface (driver, padded, TRUE,
+                                     entry->area.x, entry->area.y,
+                                     entry->area.width, entry->area.height))
+    {
+      glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+      glPixelStorei (GL_UNPACK_ROW_LENGTH, cairo_image_surface_get_stride (padded) / 4);
+      glTexSubImage2D (GL_TEXTURE_2D, 0,
+                       entry->area.x, entry->area.y,
+                       entry->area.width, entry->area.height,
+                       GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+                       cairo_image_surface_get_data (padded));
+      glPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
+    }
+
+  driver->uploaded_bytes += entry->area.width * entry->area.height * 4;
+
+  cairo_surface_destroy (padded);
+  cairo_surface_destroy (surface);
+}
+
+static int
+compare_entry_height (gconstpointer a,
+                      gconstpointer b)
+{
+  const AtlasEntry *entry_a = *(const AtlasEntry **) a;
+  const AtlasEntry *entry_b = *(const AtlasEntry **) b;
+
+  return entry_b->area.height - entry_a->area.height;
+}
+
+static int
+compare_entry_last_used (gconstpointer a,
+                         gconstpointer b)
+{
+  const AtlasEntry *entry_a = *(const AtlasEntry **) a;
+  const AtlasEntry *entry_b = *(const AtlasEntry **) b;
+
+  if (entry_a->last_used < entry_b->last_used)
+    return -1;
+  if (entry_a->last_used > entry_b->last_used)
+    return 1;
+
+  return 0;
+}
+
+/* Repacks the entries of the page, to reclaim the space lost to
+ * released entries; the moved entries are uploaded again, so this
+ * must not happen while render items reference the page
+ */
+static void
+atlas_page_compact (GskGLDriver *driver,
+                    AtlasPage   *page)
+{
+  GPtrArray *entries;
+  guint i;
+
+  GSK_NOTE (OPENGL, g_print ("Compacting atlas page %d (%d entries, %d%% used)\n",
+                             page->texture->texture_id,
+                             page->entries->len,
+                             page->used_area * 100 / (ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE)));
+
+  entries = page->entries;
+  page->entries = g_ptr_array_new ();
+  g_array_set_size (page->shelves, 0);
+  page->next_shelf_y = 0;
+  page->used_area = 0;
+
+  /* Packing the tallest entries first wastes less space */
+  g_ptr_array_sort (entries, compare_entry_height);
+
+  for (i = 0; i < entries->len; i++)
+    {
+      AtlasEntry *entry = g_ptr_array_index (entries, i);
+      cairo_rectangle_int_t area;
+
+      if (atlas_page_allocate (page, entry->area.width, entry->area.height, &area))
+        {
+          g_ptr_array_add (page->entries, entry);
+
+          if (area.x != entry->area.x || area.y != entry->area.y)
+            {
+              entry->area = area;
+              atlas_entry_upload (driver, entry);
+            }
+        }
+      else
+        {
+          /* Drop the entry; the texture will be uploaded again the
+           * next time it is used
+           */
+          entry->page = NULL;
+          gsk_texture_clear_render_data (entry->user);
+        }
+    }
+
+  g_ptr_array_unref (entries);
+
+  page->needs_compaction = FALSE;
+}
+
+/* Evicts the least recently used entries of the page that are not used
+ * in the current frame, until @area can be reclaimed by compacting it;
+ * the entries of the current frame are never moved or evicted
+ */
+static void
+atlas_page_evict (GskGLDriver *driver,
+                  AtlasPage   *page,
+                  int          area)
+{
+  GPtrArray *entries;
+  guint i;
+
+  entries = g_ptr_array_sized_new (page->entries->len);
+  for (i = 0; i < page->entries->len; i++)
+    g_ptr_array_add (entries, g_ptr_array_index (page->entries, i));
+
+  g_ptr_array_sort (entries, compare_entry_last_used);
+
+  for (i = 0; i < entries->len; i++)
+    {
+      AtlasEntry *entry = g_ptr_array_index (entries, i);
+
+      if (ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE - page->used_area >= area)
+        break;
+
+      if (entry->last_used == driver->frame_counter)
+        break;
+
+      GSK_NOTE (OPENGL, g_print ("Evicting %dx%d texture from atlas page %d\n",
+                                 entry->area.width, entry->area.height,
+                                 page->texture->texture_id));
+
+      gsk_texture_clear_render_data (entry->user);
+    }
+
+  g_ptr_array_unref (entries);
+}
+
+static AtlasEntry *
+atlas_add_texture (GskGLDriver *driver,
+                   GskTexture  *texture,
+                   int          filter)
+{
+  int width = gsk_texture_get_width (texture) + 2 * ATLAS_PADDING;
+  int height = gsk_texture_get_height (texture) + 2 * ATLAS_PADDING;
+  AtlasPage *page = NULL;
+  AtlasEntry *entry;
+  cairo_rectangle_int_t area;
+  guint i;
+
+  for (i = 0; i < driver->atlas_pages->len; i++)
+    {
+      AtlasPage *p = g_ptr_array_index (driver->atlas_pages, i);
+
+      if (p->texture->min_filter == filter &&
+          atlas_page_allocate (p, width, height, &area))
+        {
+          page = p;
+          break;
+        }
+    }
+
+  if (page == NULL && driver->atlas_pages->len < ATLAS_MAX_PAGES)
+    {
+      page = atlas_page_new (driver, filter);
+      if (!atlas_page_allocate (page, width, height, &area))
+        g_assert_not_reached ();
+    }
+
+  /* Evict the least recently used entries; the space they leave behind
+   * is reclaimed when the page is compacted, after the frame
+   */
+  for (i = 0; page == NULL && i < driver->atlas_pages->len; i++)
+    {
+      AtlasPage *p = g_ptr_array_index (driver->atlas_pages, i);
+
+      if (p->texture->min_filter != filter)
+        continue;
+
+      atlas_page_evict (driver, p, 2 * width * height);
+
+      if (atlas_page_allocate (p, width, height, &area))
+        page = p;
+      else if (ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE - p->used_area >= 2 * width * height)
+        p->needs_compaction = TRUE;
+    }
+
+  if (page == NULL)
+    return NULL;
+
+  entry = g_slice_new0 (AtlasEntry);
+  entry->page = page;
+  entry->user = texture;
+  entry->area = area;
+  entry->last_used = driver->frame_counter;
+  g_ptr_array_add (page->entries, entry);
+
+  if (!gsk_texture_set_render_data (texture, &driver->atlas_pages, entry, atlas_entry_release))
+    {
+      /* The texture is used by another renderer */
+      atlas_entry_release (entry);
+      return NULL;
+    }
+
+  atlas_entry_upload (driver, entry);
+
+  return entry;
+}
+
+static void
+atlas_entry_get_texture_area (const AtlasEntry *entry,
+                              graphene_rect_t  *texture_area)
+{
+  graphene_rect_init (texture_area,
+                      (float) (entry->area.x + ATLAS_PADDING) / ATLAS_PAGE_SIZE,
+                      (float) (entry->area.y + ATLAS_PADDING) / ATLAS_PAGE_SIZE,
+                      (float) (entry->area.width - 2 * ATLAS_PADDING) / ATLAS_PAGE_SIZE,
+                      (float) (entry->area.height - 2 * ATLAS_PADDING) / ATLAS_PAGE_SIZE);
+}
+
+static gboolean
+gsk_gl_driver_can_use_atlas (GskGLDriver *driver,
+                             GskTexture  *texture,
+                             int          min_filter,
+                             int          mag_filter)
+{
+  /* GLES does not support uploading BGRA sub-images with a row length */
+  if (gdk_gl_context_get_use_es (driver->gl_context))
+    return FALSE;
+
+  if (driver->max_texture_size < ATLAS_PAGE_SIZE)
+    return FALSE;
+
+  /* Mipmaps would mix the neighbouring textures */
+  if (min_filter != mag_filter ||
+      (min_filter != GL_NEAREST && min_filter != GL_LINEAR))
+    return FALSE;
+
+  return gsk_texture_get_width (texture) <= ATLAS_MAX_TEXTURE_SIZE &&
+         gsk_texture_get_height (texture) <= ATLAS_MAX_TEXTURE_SIZE;
+}
+
+/**
+ * gsk_gl_driver_get_texture_for_texture:
+ * @driver: a #GskGLDriver
+ * @texture: a #GskTexture
+ * @min_filter: the minification filter
+ * @mag_filter: the magnification filter
+ * @texture_area: (out): return location for the area of the GL texture
+ *   holding the contents of @texture, in normalized coordinates
+ *
+ * Retrieves the GL texture holding the contents of @texture, uploading
+ * them if needed. Small textures are packed into shared atlas pages.
+ *
+ * Returns: the id of the GL texture
+ */
 int
-gsk_gl_driver_get_texture_for_texture (GskGLDriver *driver,
-                                       GskTexture  *texture,
-                                       int          min_filter,
-                                       int          mag_filter)
+gsk_gl_driver_get_texture_for_texture (GskGLDriver     *driver,
+                                       GskTexture      *texture,
+                                       int              min_filter,
+                                       int              mag_filter,
+                                       graphene_rect_t *texture_area)
 {
+  AtlasEntry *entry;
   Texture *t;
   cairo_surface_t *surface;
 
   g_return_val_if_fail (GSK_IS_GL_DRIVER (driver), -1);
   g_return_val_if_fail (GSK_IS_TEXTURE (texture), -1);
+  g_return_val_if_fail (texture_area != NULL, -1);
+
+  entry = gsk_texture_get_render_data (texture, &driver->atlas_pages);
+  if (entry != NULL)
+    {
+      /* The area of an entry that is used by the current frame can't
+       * be given back, so the texture keeps the filter of its page
+       * until the next frame; otherwise it moves to where it is
+       * cached with the new filter
+       */
+      if (entry->page->texture->min_filter == min_filter ||
+          entry->last_used == driver->frame_counter)
+        {
+          entry->last_used = driver->frame_counter;
+          atlas_entry_get_texture_area (entry, texture_area);
+          return entry->page->texture->texture_id;
+        }
+
+      gsk_texture_clear_render_data (texture);
+      entry = NULL;
+    }
 
+  if (entry == NULL && gsk_gl_driver_can_use_atlas (driver, texture, min_filter, mag_filter))
+    {
+      entry = atlas_add_texture (driver, texture, min_filter);
+      if (entry != NULL)
+        {
+          atlas_entry_get_texture_area (entry, texture_area);
+          return entry->page->texture->texture_id;
+        }
+    }
+
+  graphene_rect_init (texture_area, 0, 0, 1, 1);
+
+  /* Textures that are not in the atlas are uploaded once, and kept
+   * for as long as the GskTexture is alive
+   */
   t = gsk_texture_get_render_data (texture, driver);
 
   if (t)
     {
-      if (t->min_filter == min_filter && t->mag_filter == mag_filter)
-        return t->texture_id;
+      if (t->min_filter != min_filter || t->mag_filter != mag_filter)
+        {
+          /* The pixels are already there, only the sampling changes */
+          gsk_gl_driver_bind_source_texture (driver, t->texture_id);
+          gsk_gl_driver_set_texture_parameters (driver, min_filter, mag_filter);
+
+          if (min_filter != GL_NEAREST && t->min_filter == GL_NEAREST)
+            glGenerateMipmap (GL_TEXTURE_2D);
+
+          t->min_filter = min_filter;
+          t->mag_filter = mag_filter;
+        }
+
+      return t->texture_id;
     }
-  
+
   t = create_texture (driver, gsk_texture_get_width (texture), gsk_texture_get_height (texture));
 
   if (gsk_texture_set_render_data (texture, driver, t, gsk_gl_driver_release_texture))
@@ -586,6 +1462,102 @@ gsk_gl_driver_create_vao_for_quad (GskGLDriver   *driver,
   return vao_id;
 }
 
+/*
+ * gsk_gl_driver_create_vao_for_vertices:
+ * @driver: a #GskGLDriver
+ * @position_id: the location of the position attribute
+ * @uv_id: the location of the UV attribute
+ * @n_vertices: the number of vertices
+ * @vertices: (array length=n_vertices): the vertices to upload
+ *
+ * Uploads all the vertices of a frame into a single streaming vertex
+ * buffer, owned by the driver and reused across frames.
+ *
+ * Returns: the id of the VAO holding the vertices
+ */
+int
+gsk_gl_driver_create_vao_for_vertices (GskGLDriver         *driver,
+                                       int                  position_id,
+                                       int                  uv_id,
+                                       int                  n_vertices,
+                                       const GskQuadVertex *vertices)
+{
+  Vao *v;
+  gsize size;
+
+  g_return_val_if_fail (GSK_IS_GL_DRIVER (driver), -1);
+  g_return_val_if_fail (driver->in_frame, -1);
+
+  v = driver->stream_vao;
+  if (v == NULL || v->position_id != position_id || v->uv_id != uv_id)
+    {
+      if (v != NULL)
+        {
+          if (driver->bound_vao == v)
+            driver->bound_vao = NULL;
+
+          g_hash_table_remove (driver->vaos, GINT_TO_POINTER (v->vao_id));
+        }
+
+      v = vao_new ();
+      v->position_id = position_id;
+      v->uv_id = uv_id;
+      v->stream = TRUE;
+
+      glGenVertexArrays (1, &v->vao_id);
+      glBindVertexArray (v->vao_id);
+
+      glGenBuffers (1, &v->buffer_id);
+      glBindBuffer (GL_ARRAY_BUFFER, v->buffer_id);
+
+      glEnableVertexAttribArray (position_id);
+      glVertexAttribPointer (position_id, 2, GL_FLOAT, GL_FALSE,
+                             sizeof (GskQuadVertex),
+                             (void *) G_STRUCT_OFFSET (GskQuadVertex, position));
+
+      glEnableVertexAttribArray (uv_id);
+      glVertexAttribPointer (uv_id, 2, GL_FLOAT, GL_FALSE,
+                             sizeof (GskQuadVertex),
+                             (void *) G_STRUCT_OFFSET (GskQuadVertex, uv));
+
+      g_hash_table_insert (driver->vaos, GINT_TO_POINTER (v->vao_id), v);
+      driver->stream_vao = v;
+
+      GSK_NOTE (OPENGL, g_print ("New streaming VAO(%d)\n", v->vao_id));
+    }
+  else
+    {
+      glBindVertexArray (v->vao_id);
+      glBindBuffer (GL_ARRAY_BUFFER, v->buffer_id);
+    }
+
+  size = sizeof (GskQuadVertex) * n_vertices;
+
+  if (size > v->buffer_size)
+    v->buffer_size = MAX (size, v->buffer_size * 2);
+
+  /* Orphan the previous storage, so that the driver does not need
+   * to wait for the previous frame to be done with it
+   */
+  glBufferData (GL_ARRAY_BUFFER, v->buffer_size, NULL, GL_STREAM_DRAW);
+
+  glBufferSubData (GL_ARRAY_BUFFER, 0, size, vertices);
+
+  glBindBuffer (GL_ARRAY_BUFFER, 0);
+  glBindVertexArray (0);
+
+  /* We unbound the VAO behind the driver's back */
+  driver->bound_vao = NULL;
+
+  v->n_quads = n_vertices;
+  v->in_use = TRUE;
+
+  GSK_NOTE (OPENGL, g_print ("Uploaded %d vertices (%" G_GSIZE_FORMAT " bytes) to VAO(%d)\n",
+                             n_vertices, size, v->vao_id));
+
+  return v->vao_id;
+}
+
 int
 gsk_gl_driver_create_render_target (GskGLDriver *driver,
                                     int          texture_id,
@@ -603,6 +1575,21 @@ gsk_gl_driver_create_render_target (GskGLDriver *driver,
   if (t == NULL)
     return -1;
 
+  /* Recycle the render target of a reused texture */
+  if (t->fbos != NULL && t->fbos->len > 0)
+    {
+      Fbo *old = &g_array_index (t->fbos, Fbo, 0);
+
+      if ((old->depth_stencil_id != 0) == (add_depth_buffer || add_stencil_buffer))
+        {
+          GSK_NOTE (OPENGL, g_print ("Reusing FBO(%d) for texture %d\n",
+                                     old->fbo_id, t->texture_id));
+          return old->fbo_id;
+        }
+
+      g_array_set_size (t->fbos, 0);
+    }
+
   if (t->fbos == NULL)
     {
       t->fbos = g_array_new (FALSE, FALSE, sizeof (Fbo));
@@ -698,20 +1685,20 @@ gsk_gl_driver_bind_mask_texture (GskGLDriver *driver,
     }
 }
 
-void
+gboolean
 gsk_gl_driver_bind_vao (GskGLDriver *driver,
                         int          vao_id)
 {
   Vao *v;
 
-  g_return_if_fail (GSK_IS_GL_DRIVER (driver));
-  g_return_if_fail (driver->in_frame);
+  g_return_val_if_fail (GSK_IS_GL_DRIVER (driver), FALSE);
+  g_return_val_if_fail (driver->in_frame, FALSE);
 
   v = gsk_gl_driver_get_vao (driver, vao_id);
   if (v == NULL)
     {
       g_critical ("No VAO %d found.", vao_id);
-      return;
+      return FALSE;
     }
 
   if (driver->bound_vao != v)
@@ -722,7 +1709,11 @@ gsk_gl_driver_bind_vao (GskGLDriver *driver,
       glEnableVertexAttribArray (v->uv_id);
 
       driver->bound_vao = v;
+
+      return TRUE;
     }
+
+  return FALSE;
 }
 
 gboolean
@@ -777,6 +1768,9 @@ gsk_gl_driver_destroy_vao (GskGLDriver *driver,
 {
   g_return_if_fail (GSK_IS_GL_DRIVER (driver));
 
+  if (driver->stream_vao != NULL && driver->stream_vao->vao_id == vao_id)
+    driver->stream_vao = NULL;
+
   g_hash_table_remove (driver->vaos, GINT_TO_POINTER (vao_id));
 }
 
@@ -849,7 +1843,10 @@ gsk_gl_driver_init_texture_with_surface (GskGLDriver     *driver,
 
   gsk_gl_driver_set_texture_parameters (driver, min_filter, mag_filter);
 
-  gdk_cairo_surface_upload_to_gl (surface, GL_TEXTURE_2D, t->width, t->height, NULL);
+  if (!gsk_gl_driver_upload_surface (driver, surface, FALSE, 0, 0, t->width, t->height))
+    gdk_cairo_surface_upload_to_gl (surface, GL_TEXTURE_2D, t->width, t->height, NULL);
+
+  driver->uploaded_bytes += t->width * t->height * 4;
 
   t->min_filter = min_filter;
   t->mag_filter = mag_filter;
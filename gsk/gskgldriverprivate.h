@@ -18,17 +18,30 @@ typedef struct {
   float uv[2];
 } GskQuadVertex;
 
+typedef struct {
+  int n_atlas_pages;
+  int n_atlas_textures;
+  /* In percent of the area of the atlas pages */
+  int atlas_occupancy;
+  /* Since the last call to gsk_gl_driver_collect_textures() */
+  gsize uploaded_bytes;
+} GskGLDriverStats;
+
 GskGLDriver *   gsk_gl_driver_new                       (GdkGLContext    *context);
 
 int             gsk_gl_driver_get_max_texture_size      (GskGLDriver     *driver);
+void            gsk_gl_driver_get_stats                 (GskGLDriver     *driver,
+                                                         GskGLDriverStats *stats);
 
+void            gsk_gl_driver_begin_upload_frame        (GskGLDriver     *driver);
 void            gsk_gl_driver_begin_frame               (GskGLDriver     *driver);
 void            gsk_gl_driver_end_frame                 (GskGLDriver     *driver);
 
 int             gsk_gl_driver_get_texture_for_texture   (GskGLDriver     *driver,
                                                          GskTexture      *texture,
                                                          int              min_filter,
-                                                         int              mag_filter);
+                                                         int              mag_filter,
+                                                         graphene_rect_t *texture_area);
 int             gsk_gl_driver_create_texture            (GskGLDriver     *driver,
                                                          int              width,
                                                          int              height);
@@ -37,6 +50,11 @@ int             gsk_gl_driver_create_vao_for_quad       (GskGLDriver     *driver
                                                          int              uv_id,
                                                          int              n_vertices,
                                                          GskQuadVertex   *vertices);
+int             gsk_gl_driver_create_vao_for_vertices   (GskGLDriver     *driver,
+                                                         int              position_id,
+                                                         int              uv_id,
+                                                         int              n_vertices,
+                                                         const GskQuadVertex *vertices);
 int             gsk_gl_driver_create_render_target      (GskGLDriver     *driver,
                                                          int              texture_id,
                                                          gboolean         add_depth_buffer,
@@ -46,7 +64,7 @@ void            gsk_gl_driver_bind_source_texture       (GskGLDriver     *driver
                                                          int              texture_id);
 void            gsk_gl_driver_bind_mask_texture         (GskGLDriver     *driver,
                                                          int              texture_id);
-void            gsk_gl_driver_bind_vao                  (GskGLDriver     *driver,
+gboolean        gsk_gl_driver_bind_vao                  (GskGLDriver     *driver,
                                                          int              vao_id);
 gboolean        gsk_gl_driver_bind_render_target        (GskGLDriver     *driver,
                                                          int              texture_id);
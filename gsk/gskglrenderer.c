@@ -6,9 +6,11 @@
 #include "gskenums.h"
 #include "gskgldriverprivate.h"
 #include "gskglprofilerprivate.h"
+#include "gskglyphcacheprivate.h"
 #include "gskprofilerprivate.h"
 #include "gskrendererprivate.h"
 #include "gskrendernodeprivate.h"
+#include "gskroundedrectprivate.h"
 #include "gskshaderbuilderprivate.h"
 #include "gsktextureprivate.h"
 
@@ -21,6 +23,12 @@
 #define SHADER_VERSION_GL3_LEGACY       130
 #define SHADER_VERSION_GL3              150
 
+#define ORTHO_NEAR_PLANE        -10000
+#define ORTHO_FAR_PLANE          10000
+
+/* Keep in sync with linear_gradient.fs.glsl */
+#define MAX_GRADIENT_STOPS              8
+
 typedef struct {
   int id;
   /* Common locations (gl_common)*/
@@ -31,18 +39,61 @@ typedef struct {
   int position_location;
   int alpha_location;
   int blendMode_location;
+  int clip_location;
+  int clip_corner_widths_location;
+  int clip_corner_heights_location;
 
   /* Shader-specific locations */
   union {
     struct {
       int color_location;
     };
+    struct {
+      int color_stops_location;
+      int color_offsets_location;
+      int n_color_stops_location;
+      int start_point_location;
+      int end_point_location;
+      int repeating_location;
+    } linear_gradient;
+    struct {
+      int outline_location;
+      int corner_widths_location;
+      int corner_heights_location;
+      int widths_location;
+      int colors_location;
+    } border;
+    struct {
+      int outline_location;
+      int corner_widths_location;
+      int corner_heights_location;
+      int color_location;
+      int offset_location;
+      int spread_location;
+      int blur_radius_location;
+    } shadow;
+    struct {
+      int color_matrix_location;
+      int color_offset_location;
+    } color_matrix;
+    struct {
+      int progress_location;
+    } cross_fade;
   };
 } Program;
 
+/* The clip is a rounded rectangle in the coordinate space of the
+ * nodes it applies to
+ */
+typedef struct {
+  GskRoundedRect rect;
+  gboolean is_set;
+} Clip;
+
 typedef struct {
   int render_target_id;
-  int vao_id;
+  int vertex_offset;
+  int vertex_count;
   int buffer_id;
   int texture_id;
   int program_id;
@@ -50,9 +101,31 @@ typedef struct {
   Program *program;
 } RenderData;
 
+/* An offscreen pass: the items are rendered into the render target
+ * of texture_id, which is then used as a source when compositing
+ * the item that owns the pass
+ */
+typedef struct {
+  int texture_id;
+  int width;
+  int height;
+
+  GArray *children;
+} Offscreen;
+
+#define MAX_OFFSCREENS  2
+
 enum {
   MODE_COLOR = 1,
   MODE_TEXTURE,
+  MODE_LINEAR_GRADIENT,
+  MODE_BORDER,
+  MODE_INSET_SHADOW,
+  MODE_OUTSET_SHADOW,
+  MODE_COLOR_MATRIX,
+  MODE_BLEND,
+  MODE_CROSS_FADE,
+  MODE_TEXT,
   N_MODES
 };
 
@@ -78,16 +151,57 @@ typedef struct {
     struct {
       int a,b;
     } texture_data;
+    struct {
+      /* Premultiplied */
+      float color_stops[4 * MAX_GRADIENT_STOPS];
+      float color_offsets[MAX_GRADIENT_STOPS];
+      int n_color_stops;
+      float start_point[2];
+      float end_point[2];
+      gboolean repeating;
+    } linear_gradient_data;
+    struct {
+      float outline[12];
+      float widths[4];
+      /* Premultiplied */
+      float colors[4 * 4];
+    } border_data;
+    struct {
+      float outline[12];
+      /* Premultiplied */
+      float color[4];
+      float offset[2];
+      float spread;
+      float blur_radius;
+    } shadow_data;
+    struct {
+      float matrix[16];
+      float offset[4];
+    } color_matrix_data;
+    struct {
+      float progress;
+    } cross_fade_data;
+    struct {
+      /* The glyph cache page; its texture is resolved once all
+       * the glyphs of the frame are in the cache
+       */
+      guint page;
+      /* Tints the glyphs with the text color */
+      float color_matrix[16];
+    } text_data;
   };
 
   const char *name;
 
   GskBlendMode blend_mode;
 
+  Clip clip;
+
   RenderData render_data;
-  RenderData *parent_data;
 
-  GArray *children;
+  /* The offscreen passes used as sources by this item */
+  Offscreen offscreens[MAX_OFFSCREENS];
+  int n_offscreens;
 } RenderItem;
 
 
@@ -98,6 +212,9 @@ enum {
   MASK,
   ALPHA,
   BLEND_MODE,
+  CLIP,
+  CLIP_CORNER_WIDTHS,
+  CLIP_CORNER_HEIGHTS,
   N_UNIFORMS
 };
 
@@ -111,6 +228,13 @@ enum {
 typedef struct {
   GQuark frames;
   GQuark draw_calls;
+  GQuark vao_binds;
+  GQuark merged_items;
+  GQuark offscreens;
+  GQuark atlas_pages;
+  GQuark atlas_occupancy;
+  GQuark upload_bytes;
+  GQuark culled_nodes;
 } ProfileCounters;
 
 typedef struct {
@@ -124,7 +248,7 @@ typedef enum {
   RENDER_SCISSOR
 } RenderMode;
 
-#define NUM_PROGRAMS 3
+#define NUM_PROGRAMS 9
 
 struct _GskGLRenderer
 {
@@ -150,6 +274,12 @@ struct _GskGLRenderer
       Program blend_program;
       Program blit_program;
       Program color_program;
+      Program linear_gradient_program;
+      Program border_program;
+      Program inset_shadow_program;
+      Program outset_shadow_program;
+      Program color_matrix_program;
+      Program cross_fade_program;
     };
     struct {
       Program programs[NUM_PROGRAMS];
@@ -158,6 +288,25 @@ struct _GskGLRenderer
 
   GArray *render_items;
 
+  /* The clip of the node being converted to render items */
+  Clip clip;
+
+  /* The render target that the node being converted to render items
+   * draws into, and the size of the render target currently bound
+   */
+  int render_target_id;
+  int render_target_width;
+  int render_target_height;
+
+  /* The vertices of all the render items in a frame; they are uploaded
+   * in a single streaming buffer, bound to vao_id
+   */
+  GArray *vertices;
+  int vao_id;
+
+  /* The rasterized glyphs of the text nodes */
+  GskGlyphCache *glyph_cache;
+
 #ifdef G_ENABLE_DEBUG
   ProfileCounters profile_counters;
   ProfileTimers profile_timers;
@@ -165,6 +314,11 @@ struct _GskGLRenderer
 
   RenderMode render_mode;
 
+  /* The extents of the area being redrawn, in window coordinates;
+   * only used with RENDER_SCISSOR
+   */
+  graphene_rect_t damage_bounds;
+
   gboolean has_buffers : 1;
 };
 
@@ -182,6 +336,7 @@ gsk_gl_renderer_dispose (GObject *gobject)
 
   g_clear_object (&self->gl_context);
   g_clear_pointer (&self->render_items, g_array_unref);
+  g_clear_pointer (&self->vertices, g_array_unref);
 
   G_OBJECT_CLASS (gsk_gl_renderer_parent_class)->dispose (gobject);
 }
@@ -247,6 +402,12 @@ init_common_locations (GskGLRenderer *self,
     gsk_shader_builder_get_uniform_location (self->shader_builder, prog->id, self->uniforms[ALPHA]);
   prog->blendMode_location =
     gsk_shader_builder_get_uniform_location (self->shader_builder, prog->id, self->uniforms[BLEND_MODE]);
+  prog->clip_location =
+    gsk_shader_builder_get_uniform_location (self->shader_builder, prog->id, self->uniforms[CLIP]);
+  prog->clip_corner_widths_location =
+    gsk_shader_builder_get_uniform_location (self->shader_builder, prog->id, self->uniforms[CLIP_CORNER_WIDTHS]);
+  prog->clip_corner_heights_location =
+    gsk_shader_builder_get_uniform_location (self->shader_builder, prog->id, self->uniforms[CLIP_CORNER_HEIGHTS]);
 
   prog->position_location =
     gsk_shader_builder_get_attribute_location (self->shader_builder, prog->id, self->attributes[POSITION]);
@@ -254,13 +415,43 @@ init_common_locations (GskGLRenderer *self,
     gsk_shader_builder_get_attribute_location (self->shader_builder, prog->id, self->attributes[UV]);
 }
 
+static void
+init_shadow_locations (Program *prog)
+{
+  prog->shadow.outline_location = glGetUniformLocation (prog->id, "uOutline");
+  prog->shadow.corner_widths_location = glGetUniformLocation (prog->id, "uCornerWidths");
+  prog->shadow.corner_heights_location = glGetUniformLocation (prog->id, "uCornerHeights");
+  prog->shadow.color_location = glGetUniformLocation (prog->id, "uColor");
+  prog->shadow.offset_location = glGetUniformLocation (prog->id, "uOffset");
+  prog->shadow.spread_location = glGetUniformLocation (prog->id, "uSpread");
+  prog->shadow.blur_radius_location = glGetUniformLocation (prog->id, "uBlurRadius");
+}
+
 static gboolean
 gsk_gl_renderer_create_programs (GskGLRenderer  *self,
                                  GError        **error)
 {
+  static const struct {
+    const char *name;
+    const char *vs;
+    const char *fs;
+  } program_definitions[] = {
+    { "blend", "blend.vs.glsl", "blend.fs.glsl" },
+    { "blit", "blit.vs.glsl", "blit.fs.glsl" },
+    { "color", "color.vs.glsl", "color.fs.glsl" },
+    { "linear gradient", "blit.vs.glsl", "linear_gradient.fs.glsl" },
+    { "border", "blit.vs.glsl", "border.fs.glsl" },
+    { "inset shadow", "blit.vs.glsl", "inset_shadow.fs.glsl" },
+    { "outset shadow", "blit.vs.glsl", "outset_shadow.fs.glsl" },
+    { "color matrix", "blit.vs.glsl", "color_matrix.fs.glsl" },
+    { "cross fade", "blit.vs.glsl", "cross_fade.fs.glsl" },
+  };
   GskShaderBuilder *builder;
   GError *shader_error = NULL;
   gboolean res = FALSE;
+  int i;
+
+  G_STATIC_ASSERT (G_N_ELEMENTS (program_definitions) == NUM_PROGRAMS);
 
   builder = gsk_shader_builder_new ();
 
@@ -271,7 +462,10 @@ gsk_gl_renderer_create_programs (GskGLRenderer  *self,
   self->uniforms[MASK] = gsk_shader_builder_add_uniform (builder, "uMask");
   self->uniforms[ALPHA] = gsk_shader_builder_add_uniform (builder, "uAlpha");
   self->uniforms[BLEND_MODE] = gsk_shader_builder_add_uniform (builder, "uBlendMode");
-  
+  self->uniforms[CLIP] = gsk_shader_builder_add_uniform (builder, "uClip");
+  self->uniforms[CLIP_CORNER_WIDTHS] = gsk_shader_builder_add_uniform (builder, "uClipCornerWidths");
+  self->uniforms[CLIP_CORNER_HEIGHTS] = gsk_shader_builder_add_uniform (builder, "uClipCornerHeights");
+
   self->attributes[POSITION] = gsk_shader_builder_add_attribute (builder, "aPosition");
   self->attributes[UV] = gsk_shader_builder_add_attribute (builder, "aUv");
 
@@ -304,6 +498,10 @@ gsk_gl_renderer_create_programs (GskGLRenderer  *self,
       gsk_shader_builder_add_define (builder, "GSK_GL3", "1");
     }
 
+  /* Shared by all the fragment shaders */
+  gsk_shader_builder_add_fragment_include (builder, "rounded_rect.fs.glsl");
+  gsk_shader_builder_add_fragment_include (builder, "clip.fs.glsl");
+
 #ifdef G_ENABLE_DEBUG
   if (GSK_RENDER_MODE_CHECK (SHADERS))
     gsk_shader_builder_add_define (builder, "GSK_DEBUG", "1");
@@ -313,46 +511,64 @@ gsk_gl_renderer_create_programs (GskGLRenderer  *self,
    */
   self->shader_builder = builder;
 
-  self->blend_program.id = 
-    gsk_shader_builder_create_program (builder, "blend.vs.glsl", "blend.fs.glsl", &shader_error);
-  if (shader_error != NULL)
+  for (i = 0; i < NUM_PROGRAMS; i++)
     {
-      g_propagate_prefixed_error (error,
-                                  shader_error,
-                                  "Unable to create 'blend' program: ");
-      g_object_unref (builder);
-      goto out;
-    }
-  init_common_locations (self, &self->blend_program);
+      Program *prog = &self->programs[i];
 
-  self->blit_program.id =
-    gsk_shader_builder_create_program (builder, "blit.vs.glsl", "blit.fs.glsl", &shader_error);
-  if (shader_error != NULL)
-    {
-      g_propagate_prefixed_error (error,
-                                  shader_error,
-                                  "Unable to create 'blit' program: ");
-      g_object_unref (builder);
-      goto out;
-    }
-  init_common_locations (self, &self->blit_program);
+      prog->id = gsk_shader_builder_create_program (builder,
+                                                    program_definitions[i].vs,
+                                                    program_definitions[i].fs,
+                                                    &shader_error);
+      if (shader_error != NULL)
+        {
+          g_propagate_prefixed_error (error,
+                                      shader_error,
+                                      "Unable to create '%s' program: ",
+                                      program_definitions[i].name);
+          g_clear_object (&self->shader_builder);
+          goto out;
+        }
 
-  self->color_program.id =
-    gsk_shader_builder_create_program (builder, "color.vs.glsl", "color.fs.glsl", &shader_error);
-  if (shader_error != NULL)
-    {
-      g_propagate_prefixed_error (error,
-                                  shader_error,
-                                  "Unable to create 'color' program: ");
-      g_object_unref (builder);
-      goto out;
+      init_common_locations (self, prog);
     }
-  init_common_locations (self, &self->color_program);
-  self->color_program.color_location = gsk_shader_builder_get_uniform_location (self->shader_builder,
-                                                                                self->color_program.id,
-                                                                                g_quark_from_string("uColor"));
-  self->color_program.color_location = glGetUniformLocation(self->color_program.id, "uColor");
-  g_assert(self->color_program.color_location >= 0);
+
+  self->color_program.color_location = glGetUniformLocation (self->color_program.id, "uColor");
+  g_assert (self->color_program.color_location >= 0);
+
+  self->linear_gradient_program.linear_gradient.color_stops_location =
+    glGetUniformLocation (self->linear_gradient_program.id, "uColorStops");
+  self->linear_gradient_program.linear_gradient.color_offsets_location =
+    glGetUniformLocation (self->linear_gradient_program.id, "uColorOffsets");
+  self->linear_gradient_program.linear_gradient.n_color_stops_location =
+    glGetUniformLocation (self->linear_gradient_program.id, "uNumColorStops");
+  self->linear_gradient_program.linear_gradient.start_point_location =
+    glGetUniformLocation (self->linear_gradient_program.id, "uStartPoint");
+  self->linear_gradient_program.linear_gradient.end_point_location =
+    glGetUniformLocation (self->linear_gradient_program.id, "uEndPoint");
+  self->linear_gradient_program.linear_gradient.repeating_location =
+    glGetUniformLocation (self->linear_gradient_program.id, "uRepeating");
+
+  self->border_program.border.outline_location =
+    glGetUniformLocation (self->border_program.id, "uOutline");
+  self->border_program.border.corner_widths_location =
+    glGetUniformLocation (self->border_program.id, "uCornerWidths");
+  self->border_program.border.corner_heights_location =
+    glGetUniformLocation (self->border_program.id, "uCornerHeights");
+  self->border_program.border.widths_location =
+    glGetUniformLocation (self->border_program.id, "uWidths");
+  self->border_program.border.colors_location =
+    glGetUniformLocation (self->border_program.id, "uColors");
+
+  init_shadow_locations (&self->inset_shadow_program);
+  init_shadow_locations (&self->outset_shadow_program);
+
+  self->color_matrix_program.color_matrix.color_matrix_location =
+    glGetUniformLocation (self->color_matrix_program.id, "uColorMatrix");
+  self->color_matrix_program.color_matrix.color_offset_location =
+    glGetUniformLocation (self->color_matrix_program.id, "uColorOffset");
+
+  self->cross_fade_program.cross_fade.progress_location =
+    glGetUniformLocation (self->cross_fade_program.id, "uProgress");
 
   res = TRUE;
 
@@ -391,6 +607,7 @@ gsk_gl_renderer_realize (GskRenderer  *renderer,
   g_assert (self->gl_driver == NULL);
   self->gl_driver = gsk_gl_driver_new (self->gl_context);
   self->gl_profiler = gsk_gl_profiler_new (self->gl_context);
+  self->glyph_cache = gsk_glyph_cache_new ();
 
   GSK_NOTE (OPENGL, g_print ("Creating buffers and programs\n"));
   if (!gsk_gl_renderer_create_programs (self, error))
@@ -412,11 +629,14 @@ gsk_gl_renderer_unrealize (GskRenderer *renderer)
   /* We don't need to iterate to destroy the associated GL resources,
    * as they will be dropped when we finalize the GskGLDriver
    */
-  g_clear_pointer (&self->render_items, g_array_unref);
+  g_array_set_size (self->render_items, 0);
+  g_array_set_size (self->vertices, 0);
+  self->vao_id = 0;
 
   gsk_gl_renderer_destroy_buffers (self);
   gsk_gl_renderer_destroy_programs (self);
 
+  g_clear_pointer (&self->glyph_cache, gsk_glyph_cache_free);
   g_clear_object (&self->gl_profiler);
   g_clear_object (&self->gl_driver);
 
@@ -483,6 +703,9 @@ gsk_gl_renderer_resize_viewport (GskGLRenderer         *self,
                              scale_factor));
 
   glViewport (0, 0, width, height);
+
+  self->render_target_width = width;
+  self->render_target_height = height;
 }
 
 static void
@@ -504,28 +727,108 @@ gsk_gl_renderer_update_frustum (GskGLRenderer           *self,
 
 #define N_VERTICES      6
 
+static void render_item_batches (GskGLRenderer *self,
+                                 GArray        *items);
+
 static void
-render_item (GskGLRenderer *self,
-             RenderItem    *item)
+gsk_gl_renderer_bind_vao (GskGLRenderer *self)
 {
-  float mvp[16];
-  float opacity;
+  if (gsk_gl_driver_bind_vao (self->gl_driver, self->vao_id))
+    {
+#ifdef G_ENABLE_DEBUG
+      gsk_profiler_counter_inc (gsk_renderer_get_profiler (GSK_RENDERER (self)),
+                                self->profile_counters.vao_binds);
+#endif
+    }
+}
 
-  if (item->children != NULL)
+/* Renders the offscreen passes of @item, and then binds back the
+ * render target that @item draws into
+ */
+static void
+render_item_offscreens (GskGLRenderer *self,
+                        RenderItem    *item)
+{
+  int width = self->render_target_width;
+  int height = self->render_target_height;
+  int i;
+
+  /* The scissor rectangle is in window coordinates */
+  if (self->render_mode == RENDER_SCISSOR)
+    glDisable (GL_SCISSOR_TEST);
+
+  for (i = 0; i < item->n_offscreens; i++)
     {
-      if (gsk_gl_driver_bind_render_target (self->gl_driver, item->render_data.render_target_id))
-        {
-          glViewport (0, 0, item->size.width, item->size.height);
+      const Offscreen *offscreen = &item->offscreens[i];
 
-          glClearColor (0.0, 0.0, 0.0, 0.0);
-          glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-        }
+      gsk_gl_driver_bind_render_target (self->gl_driver, offscreen->texture_id);
+
+      glViewport (0, 0, offscreen->width, offscreen->height);
+      self->render_target_width = offscreen->width;
+      self->render_target_height = offscreen->height;
+
+      glClearColor (0.0, 0.0, 0.0, 0.0);
+      glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+      render_item_batches (self, offscreen->children);
+
+#ifdef G_ENABLE_DEBUG
+      gsk_profiler_counter_inc (gsk_renderer_get_profiler (GSK_RENDERER (self)),
+                                self->profile_counters.offscreens);
+#endif
+    }
+
+  gsk_gl_driver_bind_render_target (self->gl_driver, item->render_data.render_target_id);
+
+  glViewport (0, 0, width, height);
+  self->render_target_width = width;
+  self->render_target_height = height;
+
+  if (self->render_mode == RENDER_SCISSOR)
+    glEnable (GL_SCISSOR_TEST);
+}
+
+static void
+set_clip_uniforms (const Program *program,
+                   const Clip    *clip)
+{
+  float rect[12];
+
+  /* A negative width disables the clip in the shader */
+  if (!clip->is_set)
+    {
+      glUniform4f (program->clip_location, 0.f, 0.f, -1.f, -1.f);
+      return;
     }
 
-  gsk_gl_driver_bind_vao (self->gl_driver, item->render_data.vao_id);
+  gsk_rounded_rect_to_float (&clip->rect, rect);
+
+  glUniform4fv (program->clip_location, 1, rect);
+  glUniform4fv (program->clip_corner_widths_location, 1, rect + 4);
+  glUniform4fv (program->clip_corner_heights_location, 1, rect + 8);
+}
+
+/* Draws @n_items consecutive render items, starting at @item, with
+ * a single draw call; all the items must share the same state, as
+ * determined by render_item_can_merge()
+ */
+static void
+render_item (GskGLRenderer *self,
+             RenderItem    *item,
+             int            n_items)
+{
+  float mvp[16];
+
+  /* The sources of the item need to be rendered before the item itself */
+  if (item->n_offscreens > 0)
+    render_item_offscreens (self, item);
+
+  gsk_gl_renderer_bind_vao (self);
 
   glUseProgram (item->render_data.program->id);
 
+  set_clip_uniforms (item->render_data.program, &item->clip);
+
   switch(item->mode)
     {
       case MODE_COLOR:
@@ -544,18 +847,114 @@ render_item (GskGLRenderer *self,
           /* Use texture unit 0 for the source */
           glUniform1i (item->render_data.program->source_location, 0);
           gsk_gl_driver_bind_source_texture (self->gl_driver, item->render_data.texture_id);
+        }
+      break;
 
-          if (item->parent_data != NULL)
-            {
-              glUniform1i (item->render_data.program->blendMode_location, item->blend_mode);
-
-              /* Use texture unit 1 for the mask */
-              if (item->parent_data->texture_id != 0)
-                {
-                  glUniform1i (item->render_data.program->mask_location, 1);
-                  gsk_gl_driver_bind_mask_texture (self->gl_driver, item->parent_data->texture_id);
-                }
-            }
+      case MODE_TEXT:
+        {
+          const Program *program = item->render_data.program;
+
+          g_assert(item->render_data.texture_id != 0);
+          glUniform1i (program->source_location, 0);
+          gsk_gl_driver_bind_source_texture (self->gl_driver, item->render_data.texture_id);
+
+          glUniformMatrix4fv (program->color_matrix.color_matrix_location, 1, GL_FALSE,
+                              item->text_data.color_matrix);
+          glUniform4f (program->color_matrix.color_offset_location, 0.f, 0.f, 0.f, 0.f);
+        }
+      break;
+
+      case MODE_COLOR_MATRIX:
+        {
+          const Program *program = item->render_data.program;
+
+          glUniform1i (program->source_location, 0);
+          gsk_gl_driver_bind_source_texture (self->gl_driver, item->offscreens[0].texture_id);
+
+          glUniformMatrix4fv (program->color_matrix.color_matrix_location, 1, GL_FALSE,
+                              item->color_matrix_data.matrix);
+          glUniform4fv (program->color_matrix.color_offset_location, 1,
+                        item->color_matrix_data.offset);
+        }
+      break;
+
+      case MODE_BLEND:
+        {
+          const Program *program = item->render_data.program;
+
+          /* Use texture unit 0 for the second offscreen, i.e. the top
+           * child, and texture unit 1 for the bottom one
+           */
+          glUniform1i (program->source_location, 0);
+          gsk_gl_driver_bind_source_texture (self->gl_driver, item->offscreens[1].texture_id);
+          glUniform1i (program->mask_location, 1);
+          gsk_gl_driver_bind_mask_texture (self->gl_driver, item->offscreens[0].texture_id);
+
+          glUniform1i (program->blendMode_location, item->blend_mode);
+        }
+      break;
+
+      case MODE_CROSS_FADE:
+        {
+          const Program *program = item->render_data.program;
+
+          /* The start child is the first offscreen and goes into texture
+           * unit 0, the end child into texture unit 1
+           */
+          glUniform1i (program->source_location, 0);
+          gsk_gl_driver_bind_source_texture (self->gl_driver, item->offscreens[0].texture_id);
+          glUniform1i (program->mask_location, 1);
+          gsk_gl_driver_bind_mask_texture (self->gl_driver, item->offscreens[1].texture_id);
+
+          glUniform1f (program->cross_fade.progress_location, item->cross_fade_data.progress);
+        }
+      break;
+
+      case MODE_LINEAR_GRADIENT:
+        {
+          const Program *program = item->render_data.program;
+
+          glUniform4fv (program->linear_gradient.color_stops_location,
+                        item->linear_gradient_data.n_color_stops,
+                        item->linear_gradient_data.color_stops);
+          glUniform1fv (program->linear_gradient.color_offsets_location,
+                        item->linear_gradient_data.n_color_stops,
+                        item->linear_gradient_data.color_offsets);
+          glUniform1i (program->linear_gradient.n_color_stops_location,
+                       item->linear_gradient_data.n_color_stops);
+          glUniform2fv (program->linear_gradient.start_point_location, 1,
+                        item->linear_gradient_data.start_point);
+          glUniform2fv (program->linear_gradient.end_point_location, 1,
+                        item->linear_gradient_data.end_point);
+          glUniform1i (program->linear_gradient.repeating_location,
+                       item->linear_gradient_data.repeating);
+        }
+      break;
+
+      case MODE_BORDER:
+        {
+          const Program *program = item->render_data.program;
+
+          glUniform4fv (program->border.outline_location, 1, item->border_data.outline);
+          glUniform4fv (program->border.corner_widths_location, 1, item->border_data.outline + 4);
+          glUniform4fv (program->border.corner_heights_location, 1, item->border_data.outline + 8);
+          glUniform4fv (program->border.widths_location, 1, item->border_data.widths);
+          glUniform4fv (program->border.colors_location, 4, item->border_data.colors);
+        }
+      break;
+
+      case MODE_INSET_SHADOW:
+      case MODE_OUTSET_SHADOW:
+        {
+          const Program *program = item->render_data.program;
+
+          glUniform4fv (program->shadow.outline_location, 1, item->shadow_data.outline);
+          glUniform4fv (program->shadow.corner_widths_location, 1, item->shadow_data.outline + 4);
+          glUniform4fv (program->shadow.corner_heights_location, 1, item->shadow_data.outline + 8);
+          glUniform4fv (program->shadow.color_location, 1, item->shadow_data.color);
+          glUniform2fv (program->shadow.offset_location, 1, item->shadow_data.offset);
+          glUniform1f (program->shadow.spread_location, item->shadow_data.spread);
+          glUniform1f (program->shadow.blur_radius_location, item->shadow_data.blur_radius);
         }
       break;
 
@@ -564,83 +963,109 @@ render_item (GskGLRenderer *self,
     }
 
   /* Pass the opacity component */
-  if (item->children != NULL)
-    opacity = 1.0;
-  else
-    opacity = item->opacity;
-
-  glUniform1f (item->render_data.program->alpha_location, opacity);
+  glUniform1f (item->render_data.program->alpha_location, item->opacity);
 
   /* Pass the mvp to the vertex shader */
   GSK_NOTE (TRANSFORMS, graphene_matrix_print (&item->mvp));
   graphene_matrix_to_float (&item->mvp, mvp);
   glUniformMatrix4fv (item->render_data.program->mvp_location, 1, GL_FALSE, mvp);
 
-  /* Draw the quad */
+  /* Draw the quads */
   GSK_NOTE2 (OPENGL, TRANSFORMS,
-             g_print ("Drawing item <%s>[%p] (w:%g, h:%g) with opacity: %g blend mode: %d\n",
+             g_print ("Drawing item <%s>[%p] (w:%g, h:%g) with opacity: %g blend mode: %d (%d quads)\n",
                       item->name,
                       item,
                       item->size.width, item->size.height,
                       item->opacity,
-                      item->blend_mode));
+                      item->blend_mode,
+                      n_items));
 
-  glDrawArrays (GL_TRIANGLES, 0, N_VERTICES);
+  glDrawArrays (GL_TRIANGLES,
+                item->render_data.vertex_offset,
+                item[n_items - 1].render_data.vertex_offset +
+                item[n_items - 1].render_data.vertex_count -
+                item->render_data.vertex_offset);
 
 #ifdef G_ENABLE_DEBUG
-  gsk_profiler_counter_inc (gsk_renderer_get_profiler (GSK_RENDERER (self)),
-                            self->profile_counters.draw_calls);
+  {
+    GskProfiler *profiler = gsk_renderer_get_profiler (GSK_RENDERER (self));
+
+    gsk_profiler_counter_inc (profiler, self->profile_counters.draw_calls);
+    if (n_items > 1)
+      gsk_profiler_counter_add (profiler, self->profile_counters.merged_items, n_items - 1);
+  }
 #endif
+}
 
-  /* Render all children items, so we can take the result
-   * render target texture during the compositing
-   */
-  if (item->children != NULL)
+static gboolean
+render_item_can_merge (const RenderItem *item,
+                       const RenderItem *next)
+{
+  /* Items that use offscreen passes need their own draw call */
+  if (item->n_offscreens > 0 || next->n_offscreens > 0)
+    return FALSE;
+
+  /* The quads must be adjacent in the vertex buffer */
+  if (next->render_data.vertex_offset != item->render_data.vertex_offset + item->render_data.vertex_count)
+    return FALSE;
+
+  if (item->mode != next->mode ||
+      item->render_data.program != next->render_data.program ||
+      item->render_data.render_target_id != next->render_data.render_target_id ||
+      item->blend_mode != next->blend_mode ||
+      item->opacity != next->opacity)
+    return FALSE;
+
+  switch (item->mode)
     {
-      int i;
+    case MODE_COLOR:
+      if (!gdk_rgba_equal (&item->color_data.color, &next->color_data.color))
+        return FALSE;
+      break;
 
-      for (i = 0; i < item->children->len; i++)
-        {
-          RenderItem *child = &g_array_index (item->children, RenderItem, i);
+    case MODE_TEXTURE:
+      if (item->render_data.texture_id != next->render_data.texture_id)
+        return FALSE;
+      break;
 
-          render_item (self, child);
-        }
+    case MODE_TEXT:
+      if (item->render_data.texture_id != next->render_data.texture_id ||
+          memcmp (item->text_data.color_matrix, next->text_data.color_matrix, sizeof (item->text_data.color_matrix)) != 0)
+        return FALSE;
+      break;
 
-      /* Bind the parent render target */
-      if (item->parent_data != NULL)
-        gsk_gl_driver_bind_render_target (self->gl_driver, item->parent_data->render_target_id);
+    /* The other modes are drawn using per-node uniforms */
+    default:
+      return FALSE;
+    }
 
-      /* Bind the same VAO, as the render target is created with the same size
-       * and vertices as the texture target
-       */
-      gsk_gl_driver_bind_vao (self->gl_driver, item->render_data.vao_id);
+  if (memcmp (&item->clip, &next->clip, sizeof (Clip)) != 0)
+    return FALSE;
 
-      /* Since we're rendering the target texture, we only need the blit program */
-      glUseProgram (self->blit_program.id);
+  return memcmp (&item->mvp, &next->mvp, sizeof (graphene_matrix_t)) == 0;
+}
 
-      /* Use texture unit 0 for the render target */
-      glUniform1i (item->render_data.program->source_location, 0);
-      gsk_gl_driver_bind_source_texture (self->gl_driver, item->render_data.render_target_id);
+static void
+render_item_batches (GskGLRenderer *self,
+                     GArray        *items)
+{
+  guint i, j;
 
-      /* Pass the opacity component; if we got here, we know that the original render
-       * target is neither fully opaque nor at full opacity
+  for (i = 0; i < items->len; i = j)
+    {
+      RenderItem *item = &g_array_index (items, RenderItem, i);
+
+      /* Merge all the following items that share the same state
+       * into a single draw call
        */
-      glUniform1f (item->render_data.program->alpha_location, item->opacity);
-
-      /* Pass the mvp to the vertex shader */
-      GSK_NOTE (TRANSFORMS, graphene_matrix_print (&item->mvp));
-      graphene_matrix_to_float (&item->mvp, mvp);
-      glUniformMatrix4fv (item->render_data.program->mvp_location, 1, GL_FALSE, mvp);
-
-      /* Draw the quad */
-      GSK_NOTE2 (OPENGL, TRANSFORMS,
-                 g_print ("Drawing offscreen item <%s>[%p] (w:%g, h:%g) with opacity: %g\n",
-                          item->name,
-                          item,
-                          item->size.width, item->size.height,
-                          item->opacity));
-
-      glDrawArrays (GL_TRIANGLES, 0, N_VERTICES);
+      for (j = i + 1; j < items->len; j++)
+        {
+          if (!render_item_can_merge (&g_array_index (items, RenderItem, j - 1),
+                                      &g_array_index (items, RenderItem, j)))
+            break;
+        }
+
+      render_item (self, item, j - i);
     }
 }
 
@@ -706,22 +1131,406 @@ project_item (const graphene_matrix_t *projection,
   return graphene_vec4_get_z (&vec) / graphene_vec4_get_w (&vec);
 }
 
+static void
+render_item_clear (gpointer data)
+{
+  RenderItem *item = data;
+  int i;
+
+  for (i = 0; i < item->n_offscreens; i++)
+    g_clear_pointer (&item->offscreens[i].children, g_array_unref);
+
+  item->n_offscreens = 0;
+}
+
+static void
+rgba_to_premultiplied_float (const GdkRGBA *rgba,
+                             float         *color)
+{
+  color[0] = rgba->red * rgba->alpha;
+  color[1] = rgba->green * rgba->alpha;
+  color[2] = rgba->blue * rgba->alpha;
+  color[3] = rgba->alpha;
+}
+
+/* Intersects @src with @rounded and stores the result into @dest.
+ *
+ * Returns %FALSE if the intersection cannot be represented by a single
+ * rounded rectangle; @dest is left untouched in that case.
+ */
 static gboolean
-render_node_needs_render_target (GskRenderNode *node)
+clip_intersect_rounded_rect (Clip                 *dest,
+                             const Clip           *src,
+                             const GskRoundedRect *rounded)
 {
+  if (!src->is_set)
+    {
+      gsk_rounded_rect_init_copy (&dest->rect, rounded);
+      dest->is_set = TRUE;
+      return TRUE;
+    }
+
+  if (gsk_rounded_rect_contains_rect (rounded, &src->rect.bounds))
+    {
+      *dest = *src;
+      return TRUE;
+    }
+
+  if (gsk_rounded_rect_contains_rect (&src->rect, &rounded->bounds))
+    {
+      gsk_rounded_rect_init_copy (&dest->rect, rounded);
+      dest->is_set = TRUE;
+      return TRUE;
+    }
+
+  if (gsk_rounded_rect_is_rectilinear (&src->rect) &&
+      gsk_rounded_rect_is_rectilinear (rounded))
+    {
+      graphene_rect_t bounds;
+
+      /* An empty intersection results in an empty clip */
+      graphene_rect_intersection (&src->rect.bounds, &rounded->bounds, &bounds);
+      gsk_rounded_rect_init_from_rect (&dest->rect, &bounds, 0.f);
+      dest->is_set = TRUE;
+      return TRUE;
+    }
+
   return FALSE;
 }
 
+/* Converts @src into the coordinate space of the child of a transform
+ * node; this only works for translations and positive scales.
+ */
+static gboolean
+clip_transform (Clip                    *dest,
+                const Clip              *src,
+                const graphene_matrix_t *transform)
+{
+  graphene_matrix_t inverse;
+  float scale_x, scale_y;
+  int i;
+
+  if (!src->is_set)
+    {
+      *dest = *src;
+      return TRUE;
+    }
+
+  if (!graphene_matrix_is_2d (transform) ||
+      graphene_matrix_get_value (transform, 0, 1) != 0.f ||
+      graphene_matrix_get_value (transform, 1, 0) != 0.f)
+    return FALSE;
+
+  scale_x = graphene_matrix_get_value (transform, 0, 0);
+  scale_y = graphene_matrix_get_value (transform, 1, 1);
+  if (scale_x <= 0.f || scale_y <= 0.f)
+    return FALSE;
+
+  if (!graphene_matrix_inverse (transform, &inverse))
+    return FALSE;
+
+  graphene_matrix_transform_bounds (&inverse, &src->rect.bounds, &dest->rect.bounds);
+  for (i = 0; i < 4; i++)
+    {
+      dest->rect.corner[i].width = src->rect.corner[i].width / scale_x;
+      dest->rect.corner[i].height = src->rect.corner[i].height / scale_y;
+    }
+  dest->is_set = TRUE;
+
+  return TRUE;
+}
+
+static void
+init_shadow_data (RenderItem           *item,
+                  const GskRoundedRect *outline,
+                  const GdkRGBA        *color,
+                  float                 dx,
+                  float                 dy,
+                  float                 spread,
+                  float                 blur_radius)
+{
+  gsk_rounded_rect_to_float (outline, item->shadow_data.outline);
+  rgba_to_premultiplied_float (color, item->shadow_data.color);
+  item->shadow_data.offset[0] = dx;
+  item->shadow_data.offset[1] = dy;
+  item->shadow_data.spread = spread;
+  item->shadow_data.blur_radius = blur_radius;
+}
+
+/* Rasterizes @node with cairo and uploads the result into a texture;
+ * this is used for the nodes that we cannot render natively
+ */
+static void
+gsk_gl_renderer_add_fallback (GskGLRenderer *self,
+                              RenderItem    *item,
+                              GskRenderNode *node,
+                              int            scale_factor)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  GSK_NOTE (FALLBACK, g_print ("Using cairo fallback for node <%s>[%p] of type %s\n",
+                               item->name, node, node->node_class->type_name));
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                        item->size.width,
+                                        item->size.height);
+  cairo_surface_set_device_scale (surface, scale_factor, scale_factor);
+  cr = cairo_create (surface);
+  cairo_translate (cr, -node->bounds.origin.x, -node->bounds.origin.y);
+
+  gsk_render_node_draw (node, cr);
+
+  cairo_destroy (cr);
+
+  /* Upload the Cairo surface to a GL texture */
+  item->render_data.texture_id = gsk_gl_driver_create_texture (self->gl_driver,
+                                                               item->size.width,
+                                                               item->size.height);
+  gsk_gl_driver_bind_source_texture (self->gl_driver, item->render_data.texture_id);
+  gsk_gl_driver_init_texture_with_surface (self->gl_driver,
+                                           item->render_data.texture_id,
+                                           surface,
+                                           GL_NEAREST, GL_NEAREST);
+
+  cairo_surface_destroy (surface);
+  item->mode = MODE_TEXTURE;
+}
+
+/* Monochrome glyphs are white in the glyph cache, and take the color
+ * of the text; color glyphs only take its alpha
+ */
+static void
+init_text_color_matrix (RenderItem    *item,
+                        const GdkRGBA *color,
+                        gboolean       is_color)
+{
+  memset (item->text_data.color_matrix, 0, sizeof (item->text_data.color_matrix));
+  item->text_data.color_matrix[0] = is_color ? 1.f : color->red;
+  item->text_data.color_matrix[5] = is_color ? 1.f : color->green;
+  item->text_data.color_matrix[10] = is_color ? 1.f : color->blue;
+  item->text_data.color_matrix[15] = color->alpha;
+}
+
+/* Converts the glyphs of a text node into one textured quad per glyph,
+ * sampling from the pages of the glyph cache; consecutive glyphs in the
+ * same page, and of the same kind, share a render item, and are drawn
+ * with a single call.
+ *
+ * Returns %FALSE, without adding anything, if some of the glyphs could
+ * not be cached.
+ */
+static gboolean
+gsk_gl_renderer_add_text (GskGLRenderer *self,
+                          RenderItem    *item,
+                          GskRenderNode *node,
+                          GArray        *render_items,
+                          int            scale_factor)
+{
+  PangoFont *font = gsk_text_node_peek_font (node);
+  const PangoGlyphInfo *glyphs = gsk_text_node_peek_glyphs (node);
+  const GdkRGBA *color = gsk_text_node_peek_color (node);
+  guint i, n_glyphs = gsk_text_node_get_num_glyphs (node);
+  guint n_items = render_items->len;
+  guint n_vertices = self->vertices->len;
+  float x = gsk_text_node_get_x (node);
+  float y = gsk_text_node_get_y (node);
+  int x_position = 0;
+  int page = -1;
+  gboolean is_color = FALSE;
+
+  item->mode = MODE_TEXT;
+  item->render_data.program_id = self->color_matrix_program.id;
+  item->render_data.program = &self->color_matrix_program;
+
+  for (i = 0; i < n_glyphs; i++)
+    {
+      const PangoGlyphInfo *gi = &glyphs[i];
+      const GskCachedGlyph *glyph;
+      float glyph_x, glyph_y, x0, y0, x1, y1, u0, v0, u1, v1;
+
+      if (gi->glyph == PANGO_GLYPH_EMPTY)
+        goto next;
+
+      glyph = gsk_glyph_cache_lookup (self->glyph_cache, font, gi->glyph, scale_factor);
+      if (glyph == NULL)
+        {
+          g_array_set_size (render_items, n_items);
+          g_array_set_size (self->vertices, n_vertices);
+          return FALSE;
+        }
+
+      if (glyph->draw_area.size.width == 0.f)
+        goto next;
+
+      if ((int) glyph->page != page || glyph->is_color != is_color)
+        {
+          if (page >= 0)
+            {
+              item->render_data.vertex_count = self->vertices->len - item->render_data.vertex_offset;
+              g_array_append_val (render_items, *item);
+            }
+
+          page = glyph->page;
+          is_color = glyph->is_color;
+          item->text_data.page = page;
+          init_text_color_matrix (item, color, is_color);
+          item->render_data.vertex_offset = self->vertices->len;
+        }
+
+      /* Align the glyphs to the pixel grid, like cairo does with
+       * hinted metrics, so they are sampled without blurring
+       */
+      glyph_x = roundf ((x + (float) (x_position + gi->geometry.x_offset) / PANGO_SCALE) * scale_factor) / scale_factor;
+      glyph_y = roundf ((y + (float) gi->geometry.y_offset / PANGO_SCALE) * scale_factor) / scale_factor;
+
+      x0 = glyph_x + glyph->draw_area.origin.x;
+      y0 = glyph_y + glyph->draw_area.origin.y;
+      x1 = x0 + glyph->draw_area.size.width;
+      y1 = y0 + glyph->draw_area.size.height;
+
+      u0 = glyph->texture_area.origin.x;
+      v0 = glyph->texture_area.origin.y;
+      u1 = u0 + glyph->texture_area.size.width;
+      v1 = v0 + glyph->texture_area.size.height;
+
+      {
+        GskQuadVertex vertex_data[N_VERTICES] = {
+          { { x0, y0 }, { u0, v0 }, },
+          { { x0, y1 }, { u0, v1 }, },
+          { { x1, y0 }, { u1, v0 }, },
+
+          { { x1, y1 }, { u1, v1 }, },
+          { { x0, y1 }, { u0, v1 }, },
+          { { x1, y0 }, { u1, v0 }, },
+        };
+
+        g_array_append_vals (self->vertices, vertex_data, N_VERTICES);
+      }
+
+next:
+      x_position += gi->geometry.width;
+    }
+
+  if (page >= 0)
+    {
+      item->render_data.vertex_count = self->vertices->len - item->render_data.vertex_offset;
+      g_array_append_val (render_items, *item);
+    }
+
+  return TRUE;
+}
+
+/* Text items reference the pages of the glyph cache, which can change
+ * while the frame is being built; their textures are resolved once the
+ * whole frame has been converted, so each page is uploaded only once
+ */
+static void
+gsk_gl_renderer_resolve_text_items (GskGLRenderer *self,
+                                    GArray        *render_items)
+{
+  guint i;
+  int j;
+
+  for (i = 0; i < render_items->len; i++)
+    {
+      RenderItem *item = &g_array_index (render_items, RenderItem, i);
+      graphene_rect_t texture_area;
+
+      for (j = 0; j < item->n_offscreens; j++)
+        gsk_gl_renderer_resolve_text_items (self, item->offscreens[j].children);
+
+      if (item->mode != MODE_TEXT)
+        continue;
+
+      item->render_data.texture_id =
+        gsk_gl_driver_get_texture_for_texture (self->gl_driver,
+                                               gsk_glyph_cache_get_page_texture (self->glyph_cache,
+                                                                                 item->text_data.page),
+                                               GL_LINEAR, GL_LINEAR,
+                                               &texture_area);
+    }
+}
+
+static void gsk_gl_renderer_add_render_item (GskGLRenderer           *self,
+                                             const graphene_matrix_t *projection,
+                                             const graphene_matrix_t *modelview,
+                                             GArray                  *render_items,
+                                             GskRenderNode           *node);
+
+/* The projection of offscreen passes is the same as the one of the
+ * frame, which puts the top of the item into the last row of the
+ * texture, so offscreens are sampled upside down compared with
+ * uploaded textures
+ */
+static const graphene_rect_t offscreen_texture_area = GRAPHENE_RECT_INIT (0, 1, 1, -1);
+
+/* Adds an offscreen pass to @item, covering its bounds, and converts
+ * @child into the render items of the pass
+ */
+static void
+gsk_gl_renderer_add_offscreen (GskGLRenderer *self,
+                               RenderItem    *item,
+                               GskRenderNode *child)
+{
+  Offscreen *offscreen;
+  graphene_matrix_t projection, identity, prev_mvp;
+  int prev_render_target_id;
+  Clip prev_clip;
+
+  g_assert (item->n_offscreens < MAX_OFFSCREENS);
+
+  offscreen = &item->offscreens[item->n_offscreens++];
+  offscreen->width = ceilf (item->size.width);
+  offscreen->height = ceilf (item->size.height);
+  offscreen->children = g_array_new (FALSE, FALSE, sizeof (RenderItem));
+  g_array_set_clear_func (offscreen->children, render_item_clear);
+
+  /* Render targets are recycled by the driver, together with their
+   * textures, as long as they are used in every frame
+   */
+  offscreen->texture_id = gsk_gl_driver_create_texture (self->gl_driver,
+                                                        offscreen->width,
+                                                        offscreen->height);
+  gsk_gl_driver_bind_source_texture (self->gl_driver, offscreen->texture_id);
+  gsk_gl_driver_init_texture_empty (self->gl_driver, offscreen->texture_id);
+  gsk_gl_driver_create_render_target (self->gl_driver, offscreen->texture_id, TRUE, TRUE);
+
+  /* The children are drawn in the coordinate space of the item, with
+   * its bounds covering the whole render target
+   */
+  graphene_matrix_init_ortho (&projection,
+                              item->min.x, item->max.x,
+                              item->max.y, item->min.y,
+                              ORTHO_NEAR_PLANE,
+                              ORTHO_FAR_PLANE);
+  graphene_matrix_init_identity (&identity);
+
+  prev_mvp = self->mvp;
+  prev_clip = self->clip;
+  prev_render_target_id = self->render_target_id;
+
+  self->mvp = projection;
+  self->clip.is_set = FALSE;
+  self->render_target_id = offscreen->texture_id;
+
+  gsk_gl_renderer_add_render_item (self, &projection, &identity, offscreen->children, child);
+
+  self->mvp = prev_mvp;
+  self->clip = prev_clip;
+  self->render_target_id = prev_render_target_id;
+}
+
 static void
 gsk_gl_renderer_add_render_item (GskGLRenderer           *self,
                                  const graphene_matrix_t *projection,
                                  const graphene_matrix_t *modelview,
                                  GArray                  *render_items,
-                                 GskRenderNode           *node,
-                                 RenderItem              *parent)
+                                 GskRenderNode           *node)
 {
   RenderItem item;
-  RenderItem *ritem = NULL;
+  /* The area of the source texture covered by the item */
+  graphene_rect_t texture_area = GRAPHENE_RECT_INIT (0, 0, 1, 1);
   int program_id;
   int scale_factor;
 
@@ -757,38 +1566,37 @@ gsk_gl_renderer_add_render_item (GskGLRenderer           *self,
 
   item.blend_mode = GSK_BLEND_MODE_DEFAULT;
 
-  /* Back-pointer to the parent node */
-  if (parent != NULL)
-    item.parent_data = &(parent->render_data);
-  else
-    item.parent_data = NULL;
-
-  /* Select the program to use */
-  if (parent != NULL)
-    {
-      item.render_data.program = &self->blend_program;
-      program_id = self->blend_program.id;
-    }
-  else
+  /* Skip the nodes outside of the area being redrawn, together with
+   * their children, so that they are neither rasterized nor uploaded
+   */
+  if (self->render_mode == RENDER_SCISSOR &&
+      self->render_target_id == self->texture_id)
     {
-      item.render_data.program = &self->blit_program;
-      program_id = self->blit_program.id;
+      graphene_rect_t transformed_bounds;
+
+      graphene_matrix_transform_bounds (modelview, &node->bounds, &transformed_bounds);
+      if (!graphene_rect_intersection (&self->damage_bounds, &transformed_bounds, NULL))
+        {
+#ifdef G_ENABLE_DEBUG
+          gsk_profiler_counter_inc (gsk_renderer_get_profiler (GSK_RENDERER (self)),
+                                    self->profile_counters.culled_nodes);
+#endif
+          return;
+        }
     }
 
-  if (render_node_needs_render_target (node))
-    {
-      item.render_data.render_target_id =
-        gsk_gl_driver_create_texture (self->gl_driver, item.size.width, item.size.height);
-      gsk_gl_driver_init_texture_empty (self->gl_driver, item.render_data.render_target_id);
-      gsk_gl_driver_create_render_target (self->gl_driver, item.render_data.render_target_id, TRUE, TRUE);
+  /* Skip the nodes that are entirely clipped */
+  if (self->clip.is_set &&
+      !graphene_rect_intersection (&self->clip.rect.bounds, &node->bounds, NULL))
+    return;
 
-      item.children = g_array_new (FALSE, FALSE, sizeof (RenderItem));
-    }
-  else
-    {
-      item.render_data.render_target_id = self->texture_id;
-      item.children = NULL;
-    }
+  item.clip = self->clip;
+
+  /* The program used by textured items, unless overridden below */
+  item.render_data.program = &self->blit_program;
+  program_id = self->blit_program.id;
+
+  item.render_data.render_target_id = self->render_target_id;
 
   switch (gsk_render_node_get_node_type (node))
     {
@@ -802,7 +1610,8 @@ gsk_gl_renderer_add_render_item (GskGLRenderer           *self,
         item.render_data.texture_id = gsk_gl_driver_get_texture_for_texture (self->gl_driver,
                                                                              texture,
                                                                              gl_min_filter,
-                                                                             gl_mag_filter);
+                                                                             gl_mag_filter,
+                                                                             &texture_area);
         item.mode = MODE_TEXTURE;
       }
       break;
@@ -841,19 +1650,176 @@ gsk_gl_renderer_add_render_item (GskGLRenderer           *self,
       }
       break;
 
-    case GSK_COLOR_MATRIX_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
       {
-        GskRenderNode *child = gsk_color_matrix_node_get_child (node);
+        const GskColorStop *stops = gsk_linear_gradient_node_peek_color_stops (node);
+        gsize i, n_stops = gsk_linear_gradient_node_get_n_color_stops (node);
+        const graphene_point_t *start = gsk_linear_gradient_node_peek_start (node);
+        const graphene_point_t *end = gsk_linear_gradient_node_peek_end (node);
+
+        if (n_stops > MAX_GRADIENT_STOPS)
+          {
+            gsk_gl_renderer_add_fallback (self, &item, node, scale_factor);
+            break;
+          }
+
+        for (i = 0; i < n_stops; i++)
+          {
+            rgba_to_premultiplied_float (&stops[i].color,
+                                         &item.linear_gradient_data.color_stops[4 * i]);
+            item.linear_gradient_data.color_offsets[i] = stops[i].offset;
+          }
 
-        gsk_gl_renderer_add_render_item (self, projection, modelview, render_items, child, ritem);
+        item.linear_gradient_data.n_color_stops = n_stops;
+        item.linear_gradient_data.start_point[0] = start->x;
+        item.linear_gradient_data.start_point[1] = start->y;
+        item.linear_gradient_data.end_point[0] = end->x;
+        item.linear_gradient_data.end_point[1] = end->y;
+        item.linear_gradient_data.repeating =
+          gsk_render_node_get_node_type (node) == GSK_REPEATING_LINEAR_GRADIENT_NODE;
+
+        program_id = self->linear_gradient_program.id;
+        item.render_data.program = &self->linear_gradient_program;
+        item.mode = MODE_LINEAR_GRADIENT;
+      }
+      break;
+
+    case GSK_BORDER_NODE:
+      {
+        const float *widths = gsk_border_node_peek_widths (node);
+        const GdkRGBA *colors = gsk_border_node_peek_colors (node);
+        int i;
+
+        gsk_rounded_rect_to_float (gsk_border_node_peek_outline (node),
+                                   item.border_data.outline);
+
+        for (i = 0; i < 4; i++)
+          {
+            item.border_data.widths[i] = widths[i];
+            rgba_to_premultiplied_float (&colors[i], &item.border_data.colors[4 * i]);
+          }
+
+        program_id = self->border_program.id;
+        item.render_data.program = &self->border_program;
+        item.mode = MODE_BORDER;
+      }
+      break;
+
+    case GSK_INSET_SHADOW_NODE:
+      {
+        init_shadow_data (&item,
+                          gsk_inset_shadow_node_peek_outline (node),
+                          gsk_inset_shadow_node_peek_color (node),
+                          gsk_inset_shadow_node_get_dx (node),
+                          gsk_inset_shadow_node_get_dy (node),
+                          gsk_inset_shadow_node_get_spread (node),
+                          gsk_inset_shadow_node_get_blur_radius (node));
+
+        program_id = self->inset_shadow_program.id;
+        item.render_data.program = &self->inset_shadow_program;
+        item.mode = MODE_INSET_SHADOW;
+      }
+      break;
+
+    case GSK_OUTSET_SHADOW_NODE:
+      {
+        init_shadow_data (&item,
+                          gsk_outset_shadow_node_peek_outline (node),
+                          gsk_outset_shadow_node_peek_color (node),
+                          gsk_outset_shadow_node_get_dx (node),
+                          gsk_outset_shadow_node_get_dy (node),
+                          gsk_outset_shadow_node_get_spread (node),
+                          gsk_outset_shadow_node_get_blur_radius (node));
+
+        program_id = self->outset_shadow_program.id;
+        item.render_data.program = &self->outset_shadow_program;
+        item.mode = MODE_OUTSET_SHADOW;
+      }
+      break;
+
+    case GSK_CLIP_NODE:
+    case GSK_ROUNDED_CLIP_NODE:
+      {
+        GskRenderNode *child;
+        GskRoundedRect rounded;
+        Clip prev_clip, clip;
+
+        if (gsk_render_node_get_node_type (node) == GSK_CLIP_NODE)
+          {
+            gsk_rounded_rect_init_from_rect (&rounded, gsk_clip_node_peek_clip (node), 0.f);
+            child = gsk_clip_node_get_child (node);
+          }
+        else
+          {
+            gsk_rounded_rect_init_copy (&rounded, gsk_rounded_clip_node_peek_clip (node));
+            child = gsk_rounded_clip_node_get_child (node);
+          }
+
+        if (!clip_intersect_rounded_rect (&clip, &self->clip, &rounded))
+          {
+            gsk_gl_renderer_add_fallback (self, &item, node, scale_factor);
+            break;
+          }
+
+        if (clip.rect.bounds.size.width <= 0.f || clip.rect.bounds.size.height <= 0.f)
+          return;
+
+        prev_clip = self->clip;
+        self->clip = clip;
+        gsk_gl_renderer_add_render_item (self, projection, modelview, render_items, child);
+        self->clip = prev_clip;
       }
       return;
 
+    case GSK_OPACITY_NODE:
+      {
+        GskRenderNode *child = gsk_opacity_node_get_child (node);
+        double opacity = gsk_opacity_node_get_opacity (node);
+
+        /* Only translucent children need to be isolated */
+        if (opacity >= 1.0)
+          {
+            gsk_gl_renderer_add_render_item (self, projection, modelview, render_items, child);
+            return;
+          }
+
+        if (opacity <= 0.0 || item.size.width < 1 || item.size.height < 1)
+          return;
+
+        gsk_gl_renderer_add_offscreen (self, &item, child);
+
+        item.render_data.texture_id = item.offscreens[0].texture_id;
+        texture_area = offscreen_texture_area;
+        item.opacity = opacity;
+        item.mode = MODE_TEXTURE;
+      }
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      {
+        if (item.size.width < 1 || item.size.height < 1)
+          return;
+
+        gsk_gl_renderer_add_offscreen (self, &item, gsk_color_matrix_node_get_child (node));
+
+        graphene_matrix_to_float (gsk_color_matrix_node_peek_color_matrix (node),
+                                  item.color_matrix_data.matrix);
+        graphene_vec4_to_float (gsk_color_matrix_node_peek_color_offset (node),
+                                item.color_matrix_data.offset);
+
+        program_id = self->color_matrix_program.id;
+        item.render_data.program = &self->color_matrix_program;
+        texture_area = offscreen_texture_area;
+        item.mode = MODE_COLOR_MATRIX;
+      }
+      break;
+
     case GSK_SHADOW_NODE:
       {
         GskRenderNode *child = gsk_shadow_node_get_child (node);
 
-        gsk_gl_renderer_add_render_item (self, projection, modelview, render_items, child, ritem);
+        gsk_gl_renderer_add_render_item (self, projection, modelview, render_items, child);
       }
       return;
 
@@ -861,31 +1827,51 @@ gsk_gl_renderer_add_render_item (GskGLRenderer           *self,
       {
         GskRenderNode *child = gsk_repeat_node_get_child (node);
 
-        gsk_gl_renderer_add_render_item (self, projection, modelview, render_items, child, ritem);
+        gsk_gl_renderer_add_render_item (self, projection, modelview, render_items, child);
       }
       return;
 
     case GSK_BLEND_NODE:
       {
-        GskRenderNode *child = gsk_blend_node_get_bottom_child (node);
+        GskBlendMode blend_mode = gsk_blend_node_get_blend_mode (node);
+
+        /* The non-separable blend modes are not implemented by the shader */
+        if (blend_mode >= GSK_BLEND_MODE_COLOR)
+          {
+            gsk_gl_renderer_add_fallback (self, &item, node, scale_factor);
+            break;
+          }
 
-        gsk_gl_renderer_add_render_item (self, projection, modelview, render_items, child, ritem);
+        if (item.size.width < 1 || item.size.height < 1)
+          return;
+
+        gsk_gl_renderer_add_offscreen (self, &item, gsk_blend_node_get_bottom_child (node));
+        gsk_gl_renderer_add_offscreen (self, &item, gsk_blend_node_get_top_child (node));
 
-        child = gsk_blend_node_get_top_child (node);
-        gsk_gl_renderer_add_render_item (self, projection, modelview, render_items, child, ritem);
+        item.blend_mode = blend_mode;
+        program_id = self->blend_program.id;
+        item.render_data.program = &self->blend_program;
+        texture_area = offscreen_texture_area;
+        item.mode = MODE_BLEND;
       }
-      return;
+      break;
 
     case GSK_CROSS_FADE_NODE:
       {
-        GskRenderNode *child = gsk_cross_fade_node_get_start_child (node);
+        if (item.size.width < 1 || item.size.height < 1)
+          return;
+
+        gsk_gl_renderer_add_offscreen (self, &item, gsk_cross_fade_node_get_start_child (node));
+        gsk_gl_renderer_add_offscreen (self, &item, gsk_cross_fade_node_get_end_child (node));
 
-        gsk_gl_renderer_add_render_item (self, projection, modelview, render_items, child, ritem);
+        item.cross_fade_data.progress = gsk_cross_fade_node_get_progress (node);
 
-        child = gsk_cross_fade_node_get_end_child (node);
-        gsk_gl_renderer_add_render_item (self, projection, modelview, render_items, child, ritem);
+        program_id = self->cross_fade_program.id;
+        item.render_data.program = &self->cross_fade_program;
+        texture_area = offscreen_texture_area;
+        item.mode = MODE_CROSS_FADE;
       }
-      return;
+      break;
 
     case GSK_CONTAINER_NODE:
       {
@@ -894,7 +1880,13 @@ gsk_gl_renderer_add_render_item (GskGLRenderer           *self,
         for (i = 0, p = gsk_container_node_get_n_children (node); i < p; i++)
           {
             GskRenderNode *child = gsk_container_node_get_child (node, i);
-            gsk_gl_renderer_add_render_item (self, projection, modelview, render_items, child, ritem);
+            const graphene_rect_t *visible = gsk_container_node_peek_visible_bounds (node, i);
+
+            /* Hidden below an opaque sibling */
+            if (visible->size.width <= 0 || visible->size.height <= 0)
+              continue;
+
+            gsk_gl_renderer_add_render_item (self, projection, modelview, render_items, child);
           }
       }
       return;
@@ -902,83 +1894,77 @@ gsk_gl_renderer_add_render_item (GskGLRenderer           *self,
     case GSK_TRANSFORM_NODE:
       {
         graphene_matrix_t transform, transformed_mv;
+        Clip prev_clip, clip;
 
         gsk_transform_node_get_transform (node, &transform);
+
+        /* The clip is applied in node coordinates, so it needs to
+         * be transformed as well
+         */
+        if (!clip_transform (&clip, &self->clip, &transform))
+          {
+            gsk_gl_renderer_add_fallback (self, &item, node, scale_factor);
+            break;
+          }
+
         graphene_matrix_multiply (&transform, modelview, &transformed_mv);
+
+        prev_clip = self->clip;
+        self->clip = clip;
         gsk_gl_renderer_add_render_item (self,
                                          projection, &transformed_mv,
                                          render_items,
-                                         gsk_transform_node_get_child (node),
-                                         ritem);
+                                         gsk_transform_node_get_child (node));
+        self->clip = prev_clip;
       }
       return;
 
+    case GSK_TEXT_NODE:
+      {
+        if (gsk_gl_renderer_add_text (self, &item, node, render_items, scale_factor))
+          return;
+
+        /* Some of the glyphs do not fit in the glyph cache */
+        gsk_gl_renderer_add_fallback (self, &item, node, scale_factor);
+      }
+      break;
+
     case GSK_NOT_A_RENDER_NODE:
       g_assert_not_reached ();
       return;
 
     default:
-      {
-        cairo_surface_t *surface;
-        cairo_t *cr;
-
-        surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-                                              item.size.width,
-                                              item.size.height);
-        cairo_surface_set_device_scale (surface, scale_factor, scale_factor);
-        cr = cairo_create (surface);
-        cairo_translate (cr, -node->bounds.origin.x, -node->bounds.origin.y);
-
-        gsk_render_node_draw (node, cr);
-
-        cairo_destroy (cr);
-
-        /* Upload the Cairo surface to a GL texture */
-        item.render_data.texture_id = gsk_gl_driver_create_texture (self->gl_driver,
-                                                                    item.size.width,
-                                                                    item.size.height);
-        gsk_gl_driver_bind_source_texture (self->gl_driver, item.render_data.texture_id);
-        gsk_gl_driver_init_texture_with_surface (self->gl_driver,
-                                                 item.render_data.texture_id,
-                                                 surface,
-                                                 GL_NEAREST, GL_NEAREST);
-
-        cairo_surface_destroy (surface);
-        item.mode = MODE_TEXTURE;
-      }
+      gsk_gl_renderer_add_fallback (self, &item, node, scale_factor);
       break;
     }
 
   item.render_data.program_id = program_id;
 
-  /* Create the vertex buffers holding the geometry of the quad */
+  /* Append the geometry of the quad to the vertices of the frame */
   {
+    float u0 = texture_area.origin.x;
+    float v0 = texture_area.origin.y;
+    float u1 = texture_area.origin.x + texture_area.size.width;
+    float v1 = texture_area.origin.y + texture_area.size.height;
     GskQuadVertex vertex_data[N_VERTICES] = {
-      { { item.min.x, item.min.y }, { 0, 0 }, },
-      { { item.min.x, item.max.y }, { 0, 1 }, },
-      { { item.max.x, item.min.y }, { 1, 0 }, },
+      { { item.min.x, item.min.y }, { u0, v0 }, },
+      { { item.min.x, item.max.y }, { u0, v1 }, },
+      { { item.max.x, item.min.y }, { u1, v0 }, },
 
-      { { item.max.x, item.max.y }, { 1, 1 }, },
-      { { item.min.x, item.max.y }, { 0, 1 }, },
-      { { item.max.x, item.min.y }, { 1, 0 }, },
+      { { item.max.x, item.max.y }, { u1, v1 }, },
+      { { item.min.x, item.max.y }, { u0, v1 }, },
+      { { item.max.x, item.min.y }, { u1, v0 }, },
     };
 
-    item.render_data.vao_id =
-      gsk_gl_driver_create_vao_for_quad (self->gl_driver,
-                                         item.render_data.program->position_location,
-                                         item.render_data.program->uv_location,
-                                         N_VERTICES,
-                                         vertex_data);
+    item.render_data.vertex_offset = self->vertices->len;
+    item.render_data.vertex_count = N_VERTICES;
+    g_array_append_vals (self->vertices, vertex_data, N_VERTICES);
   }
 
   GSK_NOTE (OPENGL, g_print ("Adding node <%s>[%p] to render items\n",
                              node->name != NULL ? node->name : "unnamed",
                              node));
   g_array_append_val (render_items, item);
-  ritem = &g_array_index (render_items, RenderItem, render_items->len - 1);
-
-  if (item.children != NULL)
-    render_items = item.children;
 }
 
 static gboolean
@@ -998,14 +1984,42 @@ gsk_gl_renderer_validate_tree (GskGLRenderer           *self,
 
   gdk_gl_context_make_current (self->gl_context);
 
+  self->clip.is_set = FALSE;
+  self->render_target_id = self->texture_id;
+
+  if (self->render_mode == RENDER_SCISSOR)
+    {
+      GdkDrawingContext *context = gsk_renderer_get_drawing_context (GSK_RENDERER (self));
+      cairo_region_t *clip = gdk_drawing_context_get_clip (context);
+      GdkRectangle extents;
+
+      cairo_region_get_extents (clip, &extents);
+      graphene_rect_init (&self->damage_bounds, extents.x, extents.y, extents.width, extents.height);
+
+      cairo_region_destroy (clip);
+    }
+
   gsk_gl_driver_begin_frame (self->gl_driver);
+  gsk_glyph_cache_begin_frame (self->glyph_cache);
 
   GSK_NOTE (OPENGL, g_print ("RenderNode -> RenderItem\n"));
-  gsk_gl_renderer_add_render_item (self, projection, &identity, self->render_items, root, NULL);
+  gsk_gl_renderer_add_render_item (self, projection, &identity, self->render_items, root);
+
+  gsk_gl_renderer_resolve_text_items (self, self->render_items);
 
   GSK_NOTE (OPENGL, g_print ("Total render items: %d\n",
                              self->render_items->len));
 
+  /* Upload the geometry of the whole frame at once; all programs
+   * share the same attribute locations
+   */
+  if (self->vertices->len > 0)
+    self->vao_id = gsk_gl_driver_create_vao_for_vertices (self->gl_driver,
+                                                          self->blit_program.position_location,
+                                                          self->blit_program.uv_location,
+                                                          self->vertices->len,
+                                                          (GskQuadVertex *) self->vertices->data);
+
   gsk_gl_driver_end_frame (self->gl_driver);
 
   return TRUE;
@@ -1022,6 +2036,7 @@ gsk_gl_renderer_clear_tree (GskGLRenderer *self)
   gdk_gl_context_make_current (self->gl_context);
 
   g_array_remove_range (self->render_items, 0, self->render_items->len);
+  g_array_set_size (self->vertices, 0);
 
   removed_textures = gsk_gl_driver_collect_textures (self->gl_driver);
   removed_vaos = gsk_gl_driver_collect_vaos (self->gl_driver);
@@ -1050,16 +2065,13 @@ gsk_gl_renderer_setup_render_mode (GskGLRenderer *self)
 
     case RENDER_SCISSOR:
       {
-        GdkDrawingContext *context = gsk_renderer_get_drawing_context (GSK_RENDERER (self));
         GdkWindow *window = gsk_renderer_get_window (GSK_RENDERER (self));
-        GdkRectangle extents;
+        const graphene_rect_t *extents = &self->damage_bounds;
         int scale_factor = gsk_renderer_get_scale_factor (GSK_RENDERER (self));
 
-        cairo_region_get_extents (gdk_drawing_context_get_clip (context), &extents);
-
-        glScissor (extents.x * scale_factor,
-                   (gdk_window_get_height (window) - extents.height - extents.y) * scale_factor,
-                   extents.width * scale_factor, extents.height * scale_factor);
+        glScissor (extents->origin.x * scale_factor,
+                   (gdk_window_get_height (window) - extents->size.height - extents->origin.y) * scale_factor,
+                   extents->size.width * scale_factor, extents->size.height * scale_factor);
         glEnable (GL_SCISSOR_TEST);
         break;
       }
@@ -1070,9 +2082,6 @@ gsk_gl_renderer_setup_render_mode (GskGLRenderer *self)
   }
 }
 
-#define ORTHO_NEAR_PLANE        -10000
-#define ORTHO_FAR_PLANE          10000
-
 static void
 gsk_gl_renderer_do_render (GskRenderer           *renderer,
                            GskRenderNode         *root,
@@ -1081,7 +2090,6 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
 {
   GskGLRenderer *self = GSK_GL_RENDERER (renderer);
   graphene_matrix_t modelview, projection;
-  guint i;
 #ifdef G_ENABLE_DEBUG
   GskProfiler *profiler;
   gint64 gpu_time, cpu_time;
@@ -1103,6 +2111,11 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
 
   gsk_gl_renderer_update_frustum (self, &modelview, &projection);
 
+  /* The tree is validated and drawn in separate driver sections, which
+   * are still one frame for the upload buffers and the atlas
+   */
+  gsk_gl_driver_begin_upload_frame (self->gl_driver);
+
   if (!gsk_gl_renderer_validate_tree (self, root, &projection))
     return;
 
@@ -1128,12 +2141,7 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
   glBlendFunc (GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
   GSK_NOTE (OPENGL, g_print ("Rendering %u items\n", self->render_items->len));
-  for (i = 0; i < self->render_items->len; i++)
-    {
-      RenderItem *item = &g_array_index (self->render_items, RenderItem, i);
-
-      render_item (self, item);
-    }
+  render_item_batches (self, self->render_items);
 
   /* Draw the output of the GL rendering to the window */
   gsk_gl_driver_end_frame (self->gl_driver);
@@ -1141,6 +2149,15 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
 #ifdef G_ENABLE_DEBUG
   gsk_profiler_counter_inc (profiler, self->profile_counters.frames);
 
+  {
+    GskGLDriverStats stats;
+
+    gsk_gl_driver_get_stats (self->gl_driver, &stats);
+    gsk_profiler_counter_set (profiler, self->profile_counters.atlas_pages, stats.n_atlas_pages);
+    gsk_profiler_counter_set (profiler, self->profile_counters.atlas_occupancy, stats.atlas_occupancy);
+    gsk_profiler_counter_add (profiler, self->profile_counters.upload_bytes, stats.uploaded_bytes);
+  }
+
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
   gsk_profiler_timer_set (profiler, self->profile_timers.cpu_time, cpu_time);
 
@@ -1239,6 +2256,8 @@ gsk_gl_renderer_init (GskGLRenderer *self)
   graphene_matrix_init_identity (&self->mvp);
 
   self->render_items = g_array_new (FALSE, FALSE, sizeof (RenderItem));
+  g_array_set_clear_func (self->render_items, render_item_clear);
+  self->vertices = g_array_new (FALSE, FALSE, sizeof (GskQuadVertex));
 
 #ifdef G_ENABLE_DEBUG
   {
@@ -1246,6 +2265,13 @@ gsk_gl_renderer_init (GskGLRenderer *self)
 
     self->profile_counters.frames = gsk_profiler_add_counter (profiler, "frames", "Frames", FALSE);
     self->profile_counters.draw_calls = gsk_profiler_add_counter (profiler, "draws", "glDrawArrays", TRUE);
+    self->profile_counters.vao_binds = gsk_profiler_add_counter (profiler, "vao-binds", "VAO binds", TRUE);
+    self->profile_counters.merged_items = gsk_profiler_add_counter (profiler, "merged-items", "Merged quads", TRUE);
+    self->profile_counters.offscreens = gsk_profiler_add_counter (profiler, "offscreens", "Offscreen passes", TRUE);
+    self->profile_counters.atlas_pages = gsk_profiler_add_counter (profiler, "atlas-pages", "Atlas pages", FALSE);
+    self->profile_counters.atlas_occupancy = gsk_profiler_add_counter (profiler, "atlas-occupancy", "Atlas occupancy (%)", FALSE);
+    self->profile_counters.upload_bytes = gsk_profiler_add_counter (profiler, "upload-bytes", "Uploaded bytes", TRUE);
+    self->profile_counters.culled_nodes = gsk_profiler_add_counter (profiler, "culled-nodes", "Nodes outside the damage", TRUE);
 
     self->profile_timers.cpu_time = gsk_profiler_add_timer (profiler, "cpu-time", "CPU time", FALSE, TRUE);
     self->profile_timers.gpu_time = gsk_profiler_add_timer (profiler, "gpu-time", "GPU time", FALSE, TRUE);
@@ -0,0 +1,497 @@
+#include "config.h"
+
+#include "gskglyphcacheprivate.h"
+
+#include "gskdebugprivate.h"
+#include "gsktextureprivate.h"
+
+#include <pango/pangocairo.h>
+#include <math.h>
+#include <string.h>
+
+/* The glyphs are rasterized into pages shared by all the fonts; each
+ * renderer uploads a page again whenever new glyphs are added to it.
+ * When the pages are full, the least recently used one is emptied.
+ */
+#define PAGE_SIZE               512
+#define MAX_PAGES               8
+#define MAX_GLYPH_SIZE          128
+
+typedef struct {
+  int y;
+  int height;
+  int x;
+} Shelf;
+
+typedef struct {
+  cairo_surface_t *surface;
+
+  /* The shelves of the page, from top to bottom */
+  GArray *shelves;
+  int next_shelf_y;
+
+  /* Created lazily, and dropped whenever the page changes */
+  GskTexture *texture;
+
+  /* The last frame that used glyphs of the page */
+  guint last_used;
+} Page;
+
+typedef struct {
+  PangoFont *font;
+  PangoGlyph glyph;
+  int scale;
+} GlyphKey;
+
+typedef struct {
+  GlyphKey key;
+
+  GskCachedGlyph value;
+} GlyphEntry;
+
+struct _GskGlyphCache
+{
+  GHashTable *glyphs;
+  GPtrArray *pages;
+
+  guint frame;
+
+  /* Set when a glyph did not fit in any page; a page is
+   * emptied at the beginning of the next frame
+   */
+  gboolean is_full : 1;
+};
+
+static guint
+glyph_key_hash (gconstpointer data)
+{
+  const GlyphKey *key = data;
+
+  return g_direct_hash (key->font) ^ (key->glyph * 31) ^ (key->scale << 24);
+}
+
+static gboolean
+glyph_key_equal (gconstpointer a,
+                 gconstpointer b)
+{
+  const GlyphKey *key_a = a;
+  const GlyphKey *key_b = b;
+
+  return key_a->font == key_b->font &&
+         key_a->glyph == key_b->glyph &&
+         key_a->scale == key_b->scale;
+}
+
+static void
+glyph_entry_free (gpointer data)
+{
+  GlyphEntry *entry = data;
+
+  g_object_unref (entry->key.font);
+  g_slice_free (GlyphEntry, entry);
+}
+
+static void
+page_free (gpointer data)
+{
+  Page *page = data;
+
+  g_clear_object (&page->texture);
+  g_array_unref (page->shelves);
+  cairo_surface_destroy (page->surface);
+  g_slice_free (Page, page);
+}
+
+GskGlyphCache *
+gsk_glyph_cache_new (void)
+{
+  GskGlyphCache *cache;
+
+  cache = g_slice_new0 (GskGlyphCache);
+  cache->glyphs = g_hash_table_new_full (glyph_key_hash, glyph_key_equal, NULL, glyph_entry_free);
+  cache->pages = g_ptr_array_new_with_free_func (page_free);
+
+  return cache;
+}
+
+void
+gsk_glyph_cache_free (GskGlyphCache *cache)
+{
+  g_hash_table_unref (cache->glyphs);
+  g_ptr_array_unref (cache->pages);
+
+  g_slice_free (GskGlyphCache, cache);
+}
+
+static gboolean
+glyph_entry_is_in_page (gpointer key,
+                        gpointer value,
+                        gpointer user_data)
+{
+  GlyphEntry *entry = key;
+
+  return entry->value.page == GPOINTER_TO_UINT (user_data);
+}
+
+static void
+page_clear (Page *page)
+{
+  cairo_t *cr;
+
+  cr = cairo_create (page->surface);
+  cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  g_array_set_size (page->shelves, 0);
+  page->next_shelf_y = 0;
+  g_clear_object (&page->texture);
+}
+
+/* Glyphs are only dropped between frames, so that the lookups
+ * done while building a frame stay valid until it is drawn
+ */
+void
+gsk_glyph_cache_begin_frame (GskGlyphCache *cache)
+{
+  Page *page, *lru_page = NULL;
+  guint i, lru = 0;
+
+  cache->frame++;
+
+  if (!cache->is_full)
+    return;
+
+  cache->is_full = FALSE;
+
+  /* Make room by emptying the page that went unused for longest */
+  for (i = 0; i < cache->pages->len; i++)
+    {
+      page = g_ptr_array_index (cache->pages, i);
+      if (lru_page == NULL || page->last_used < lru_page->last_used)
+        {
+          lru_page = page;
+          lru = i;
+        }
+    }
+
+  if (lru_page == NULL)
+    return;
+
+  GSK_NOTE (GLYPH_CACHE, g_print ("Glyph cache is full, emptying page %u, last used %u frames ago\n",
+                                  lru, cache->frame - lru_page->last_used));
+
+  g_hash_table_foreach_remove (cache->glyphs, glyph_entry_is_in_page, GUINT_TO_POINTER (lru));
+  page_clear (lru_page);
+}
+
+static Page *
+page_new (GskGlyphCache *cache)
+{
+  Page *page;
+
+  page = g_slice_new0 (Page);
+  page->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, PAGE_SIZE, PAGE_SIZE);
+  page->shelves = g_array_new (FALSE, FALSE, sizeof (Shelf));
+
+  g_ptr_array_add (cache->pages, page);
+
+  return page;
+}
+
+/* Allocates an area of the page using the shelf packing algorithm */
+static gboolean
+page_allocate (Page                  *page,
+               int                    width,
+               int                    height,
+               cairo_rectangle_int_t *area)
+{
+  Shelf *shelf;
+  guint i;
+
+  for (i = 0; i < page->shelves->len; i++)
+    {
+      shelf = &g_array_index (page->shelves, Shelf, i);
+
+      /* Glyphs of the same font mostly have similar heights */
+      if (shelf->height < height || shelf->height > height * 3 / 2 + 1)
+        continue;
+
+      if (PAGE_SIZE - shelf->x < width)
+        continue;
+
+      area->x = shelf->x;
+      area->y = shelf->y;
+      area->width = width;
+      area->height = height;
+      shelf->x += width;
+
+      return TRUE;
+    }
+
+  if (PAGE_SIZE - page->next_shelf_y < height)
+    return FALSE;
+
+  g_array_set_size (page->shelves, page->shelves->len + 1);
+  shelf = &g_array_index (page->shelves, Shelf, page->shelves->len - 1);
+  shelf->y = page->next_shelf_y;
+  shelf->height = height;
+  shelf->x = width;
+  page->next_shelf_y += height;
+
+  area->x = 0;
+  area->y = shelf->y;
+  area->width = width;
+  area->height = height;
+
+  return TRUE;
+}
+
+static gboolean
+glyph_cache_allocate (GskGlyphCache         *cache,
+                      int                    width,
+                      int                    height,
+                      guint                 *page_index,
+                      cairo_rectangle_int_t *area)
+{
+  guint i;
+
+  for (i = 0; i < cache->pages->len; i++)
+    {
+      if (page_allocate (g_ptr_array_index (cache->pages, i), width, height, area))
+        {
+          *page_index = i;
+          return TRUE;
+        }
+    }
+
+  if (cache->pages->len == MAX_PAGES)
+    return FALSE;
+
+  *page_index = cache->pages->len;
+
+  return page_allocate (page_new (cache), width, height, area);
+}
+
+static void
+page_draw_glyph (Page                        *page,
+                 const cairo_rectangle_int_t *area,
+                 PangoFont                   *font,
+                 PangoGlyph                   glyph,
+                 int                          scale,
+                 int                          x,
+                 int                          y)
+{
+  PangoGlyphString *glyphs;
+  cairo_t *cr;
+
+  glyphs = pango_glyph_string_new ();
+  pango_glyph_string_set_size (glyphs, 1);
+  memset (&glyphs->glyphs[0], 0, sizeof (PangoGlyphInfo));
+  glyphs->glyphs[0].glyph = glyph;
+
+  cr = cairo_create (page->surface);
+
+  cairo_rectangle (cr, area->x, area->y, area->width, area->height);
+  cairo_clip (cr);
+
+  /* (x, y) is the position of the top-left corner of the area
+   * relative to the glyph origin, in device pixels
+   */
+  cairo_translate (cr, area->x - x, area->y - y);
+  cairo_scale (cr, scale, scale);
+
+  /* Monochrome glyphs come out black, while color glyphs ignore
+   * the source, and keep their colors
+   */
+  cairo_set_source_rgb (cr, 0, 0, 0);
+  pango_cairo_show_glyph_string (cr, font, glyphs);
+
+  cairo_destroy (cr);
+
+  pango_glyph_string_free (glyphs);
+
+  /* Renderers need to upload the page again */
+  g_clear_object (&page->texture);
+}
+
+/* Turns the black mask of a monochrome glyph into premultiplied
+ * white, which renderers tint by multiplying it with the color of
+ * the text. Returns %TRUE, leaving the area untouched, if the glyph
+ * has colors of its own.
+ */
+static gboolean
+page_finish_glyph (Page                        *page,
+                   const cairo_rectangle_int_t *area)
+{
+  guchar *data;
+  int stride, x, y;
+
+  cairo_surface_flush (page->surface);
+  data = cairo_image_surface_get_data (page->surface);
+  stride = cairo_image_surface_get_stride (page->surface);
+
+  for (y = area->y; y < area->y + area->height; y++)
+    {
+      const guint32 *row = (const guint32 *) (data + y * stride);
+
+      for (x = area->x; x < area->x + area->width; x++)
+        {
+          if (row[x] & 0x00ffffff)
+            return TRUE;
+        }
+    }
+
+  for (y = area->y; y < area->y + area->height; y++)
+    {
+      guint32 *row = (guint32 *) (data + y * stride);
+
+      for (x = area->x; x < area->x + area->width; x++)
+        {
+          guint32 alpha = row[x] >> 24;
+
+          row[x] = alpha * 0x01010101;
+        }
+    }
+
+  cairo_surface_mark_dirty_rectangle (page->surface, area->x, area->y, area->width, area->height);
+
+  return FALSE;
+}
+
+/**
+ * gsk_glyph_cache_lookup:
+ * @cache: a #GskGlyphCache
+ * @font: the font of @glyph
+ * @glyph: the glyph to look up
+ * @scale: the scale factor of the target
+ *
+ * Finds @glyph in the cache, rasterizing it into one of the pages
+ * if needed. The glyphs are shared by all the colors of the text:
+ * renderers tint the glyphs that are not #GskCachedGlyph.is_color.
+ *
+ * Returns: (nullable): the cached glyph, or %NULL if the glyph is
+ *   too big, or does not fit into the cache
+ */
+const GskCachedGlyph *
+gsk_glyph_cache_lookup (GskGlyphCache *cache,
+                        PangoFont     *font,
+                        PangoGlyph     glyph,
+                        int            scale)
+{
+  GlyphKey lookup_key;
+  GlyphEntry *entry;
+  Page *page;
+  PangoRectangle ink_rect;
+  cairo_rectangle_int_t area;
+  int x0, y0, x1, y1;
+  guint page_index = 0;
+  gboolean is_color = FALSE;
+
+  lookup_key.font = font;
+  lookup_key.glyph = glyph;
+  lookup_key.scale = scale;
+
+  entry = g_hash_table_lookup (cache->glyphs, &lookup_key);
+  if (entry != NULL)
+    {
+      /* Glyphs without ink don't use their page */
+      if (entry->value.draw_area.size.width != 0.f)
+        {
+          page = g_ptr_array_index (cache->pages, entry->value.page);
+          page->last_used = cache->frame;
+        }
+
+      return &entry->value;
+    }
+
+  pango_font_get_glyph_extents (font, glyph, &ink_rect, NULL);
+
+  if (ink_rect.width == 0 || ink_rect.height == 0)
+    {
+      area.x = area.y = area.width = area.height = 0;
+      x0 = y0 = 0;
+    }
+  else
+    {
+      /* Leave a transparent pixel around the glyph, for antialiasing
+       * and for sampling with linear filtering
+       */
+      x0 = floor ((double) ink_rect.x * scale / PANGO_SCALE) - 1;
+      y0 = floor ((double) ink_rect.y * scale / PANGO_SCALE) - 1;
+      x1 = ceil ((double) (ink_rect.x + ink_rect.width) * scale / PANGO_SCALE) + 1;
+      y1 = ceil ((double) (ink_rect.y + ink_rect.height) * scale / PANGO_SCALE) + 1;
+
+      if (x1 - x0 > MAX_GLYPH_SIZE || y1 - y0 > MAX_GLYPH_SIZE)
+        return NULL;
+
+      if (cache->is_full ||
+          !glyph_cache_allocate (cache, x1 - x0, y1 - y0, &page_index, &area))
+        {
+          cache->is_full = TRUE;
+          return NULL;
+        }
+
+      page = g_ptr_array_index (cache->pages, page_index);
+      page_draw_glyph (page,
+                       &area,
+                       font, glyph, scale,
+                       x0, y0);
+      is_color = page_finish_glyph (page, &area);
+      page->last_used = cache->frame;
+    }
+
+  entry = g_slice_new0 (GlyphEntry);
+  entry->key = lookup_key;
+  entry->key.font = g_object_ref (font);
+
+  entry->value.page = page_index;
+  graphene_rect_init (&entry->value.texture_area,
+                      (float) area.x / PAGE_SIZE,
+                      (float) area.y / PAGE_SIZE,
+                      (float) area.width / PAGE_SIZE,
+                      (float) area.height / PAGE_SIZE);
+  graphene_rect_init (&entry->value.draw_area,
+                      (float) x0 / scale,
+                      (float) y0 / scale,
+                      (float) area.width / scale,
+                      (float) area.height / scale);
+  entry->value.is_color = is_color;
+
+  g_hash_table_add (cache->glyphs, entry);
+
+  GSK_NOTE (GLYPH_CACHE, g_print ("Cached glyph %u of font %p at %d,%d of page %u\n",
+                                  glyph, font, area.x, area.y, page_index));
+
+  return &entry->value;
+}
+
+/**
+ * gsk_glyph_cache_get_page_texture:
+ * @cache: a #GskGlyphCache
+ * @page: the index of a page
+ *
+ * Gets a texture with the current contents of @page. A new texture
+ * is created every time glyphs are added to the page, so renderers
+ * can keep using their per-texture data to avoid uploading it again.
+ *
+ * Returns: (transfer none): the texture of @page
+ */
+GskTexture *
+gsk_glyph_cache_get_page_texture (GskGlyphCache *cache,
+                                  guint          page_index)
+{
+  Page *page;
+
+  g_return_val_if_fail (page_index < cache->pages->len, NULL);
+
+  page = g_ptr_array_index (cache->pages, page_index);
+
+  if (page->texture == NULL)
+    {
+      cairo_surface_flush (page->surface);
+      page->texture = gsk_texture_new_for_surface (page->surface);
+    }
+
+  return page->texture;
+}
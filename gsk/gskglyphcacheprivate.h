@@ -0,0 +1,51 @@
+#ifndef __GSK_GLYPH_CACHE_PRIVATE_H__
+#define __GSK_GLYPH_CACHE_PRIVATE_H__
+
+#include <gdk/gdk.h>
+#include <graphene.h>
+
+#include "gsktexture.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GskGlyphCache GskGlyphCache;
+typedef struct _GskCachedGlyph GskCachedGlyph;
+
+struct _GskCachedGlyph
+{
+  /* The page containing the glyph */
+  guint page;
+
+  /* The area of the page texture covered by the glyph, in
+   * normalized texture coordinates
+   */
+  graphene_rect_t texture_area;
+
+  /* The area covered by the glyph, relative to its origin on
+   * the baseline; empty for glyphs without ink, like spaces
+   */
+  graphene_rect_t draw_area;
+
+  /* Whether the glyph has colors of its own, like emoji; the other
+   * glyphs only have an alpha mask, and need to be tinted with the
+   * color of the text
+   */
+  gboolean is_color;
+};
+
+GskGlyphCache *         gsk_glyph_cache_new                     (void);
+void                    gsk_glyph_cache_free                    (GskGlyphCache          *cache);
+
+void                    gsk_glyph_cache_begin_frame             (GskGlyphCache          *cache);
+
+const GskCachedGlyph *  gsk_glyph_cache_lookup                  (GskGlyphCache          *cache,
+                                                                 PangoFont              *font,
+                                                                 PangoGlyph              glyph,
+                                                                 int                     scale);
+
+GskTexture *            gsk_glyph_cache_get_page_texture        (GskGlyphCache          *cache,
+                                                                 guint                   page_index);
+
+G_END_DECLS
+
+#endif /* __GSK_GLYPH_CACHE_PRIVATE_H__ */
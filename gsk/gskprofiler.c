@@ -2,8 +2,15 @@
 
 #include "gskprofilerprivate.h"
 
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <stdio.h>
+
 #define MAX_SAMPLES     32
 
+/* All traced events use the same process, as there is one file per process */
+#define TRACE_PID       1
+
 typedef struct {
   GQuark id;
   char *description;
@@ -21,6 +28,7 @@ typedef struct {
   gint64 max_value;
   gint64 avg_value;
   gint64 n_samples;
+  guint trace_track;
   gboolean in_flight : 1;
   gboolean can_reset : 1;
   gboolean invert : 1;
@@ -40,10 +48,165 @@ struct _GskProfiler
 
   Sample timer_samples[MAX_SAMPLES];
   guint last_sample;
+
+  guint trace_id;
+  gint64 frame_start;
 };
 
 G_DEFINE_TYPE (GskProfiler, gsk_profiler, G_TYPE_OBJECT)
 
+/* Tracing
+ *
+ * If GSK_TRACE is set to a filename, the timers and counters of every
+ * frame are appended to that file in the Chrome trace event format,
+ * which chrome://tracing and Perfetto can load. The file is flushed
+ * after every frame, and the closing bracket of the event array is
+ * optional in that format, so the trace of a crashed session is still
+ * usable.
+ *
+ * Each profiler, which usually means each renderer, shows up with one
+ * track per timer.
+ */
+static FILE *trace_file;
+static guint n_trace_profilers;
+static guint n_trace_tracks;
+G_LOCK_DEFINE_STATIC (trace_file);
+
+static void
+trace_append_string (GString    *buffer,
+                     const char *s)
+{
+  g_string_append_c (buffer, '"');
+  for (; *s; s++)
+    {
+      if (*s == '"' || *s == '\\')
+        g_string_append_printf (buffer, "\\%c", *s);
+      else if ((guchar) *s < 0x20)
+        g_string_append_printf (buffer, "\\u%04x", *s);
+      else
+        g_string_append_c (buffer, *s);
+    }
+  g_string_append_c (buffer, '"');
+}
+
+static void
+trace_write (GString *buffer)
+{
+  G_LOCK (trace_file);
+  fwrite (buffer->str, 1, buffer->len, trace_file);
+  fflush (trace_file);
+  G_UNLOCK (trace_file);
+}
+
+static void
+trace_open (void)
+{
+  const char *filename = g_getenv ("GSK_TRACE");
+  GString *buffer;
+
+  if (filename == NULL || filename[0] == '\0')
+    return;
+
+  trace_file = g_fopen (filename, "w");
+  if (trace_file == NULL)
+    {
+      g_warning ("Could not open trace file '%s': %s", filename, g_strerror (errno));
+      return;
+    }
+
+  buffer = g_string_new ("[\n");
+  g_string_append_printf (buffer,
+                          "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": ",
+                          TRACE_PID);
+  trace_append_string (buffer, g_get_prgname () ? g_get_prgname () : "GTK");
+  g_string_append (buffer, "}},\n");
+  trace_write (buffer);
+  g_string_free (buffer, TRUE);
+}
+
+static void
+trace_add_timer (GskProfiler *profiler,
+                 NamedTimer  *timer)
+{
+  GString *buffer;
+  char *name;
+
+  G_LOCK (trace_file);
+  timer->trace_track = ++n_trace_tracks;
+  G_UNLOCK (trace_file);
+
+  buffer = g_string_new (NULL);
+  g_string_append_printf (buffer,
+                          "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %u, \"args\": {\"name\": ",
+                          TRACE_PID, timer->trace_track);
+  name = g_strdup_printf ("Renderer %u: %s", profiler->trace_id, timer->description);
+  trace_append_string (buffer, name);
+  g_free (name);
+  g_string_append (buffer, "}},\n");
+  trace_write (buffer);
+  g_string_free (buffer, TRUE);
+}
+
+/* Writes a complete event for every timer that ran in this frame
+ * and a counter event with the values of all counters
+ */
+static void
+trace_frame (GskProfiler *profiler)
+{
+  GHashTableIter iter;
+  gpointer value_p = NULL;
+  GString *buffer;
+  gint64 frame_start;
+  gboolean first;
+
+  frame_start = profiler->frame_start != 0 ? profiler->frame_start : g_get_monotonic_time ();
+  buffer = g_string_new (NULL);
+
+  g_hash_table_iter_init (&iter, profiler->timers);
+  while (g_hash_table_iter_next (&iter, NULL, &value_p))
+    {
+      NamedTimer *timer = value_p;
+      gint64 start;
+
+      if (timer->value <= 0)
+        continue;
+
+      /* Timers that were set, like GPU times, have no start of their own */
+      start = timer->start_time / 1000;
+      if (start < frame_start)
+        start = frame_start;
+
+      g_string_append (buffer, "{\"name\": ");
+      trace_append_string (buffer, timer->description);
+      g_string_append_printf (buffer,
+                              ", \"cat\": \"gsk\", \"ph\": \"X\", \"pid\": %d, \"tid\": %u, "
+                              "\"ts\": %" G_GINT64_FORMAT ", \"dur\": %.3f},\n",
+                              TRACE_PID, timer->trace_track,
+                              start, timer->value / 1000.0);
+    }
+
+  g_string_append_printf (buffer, "{\"name\": \"Renderer %u\", \"cat\": \"gsk\", \"ph\": \"C\", "
+                                  "\"pid\": %d, \"ts\": %" G_GINT64_FORMAT ", \"args\": {",
+                          profiler->trace_id, TRACE_PID, frame_start);
+  first = TRUE;
+  g_hash_table_iter_init (&iter, profiler->counters);
+  while (g_hash_table_iter_next (&iter, NULL, &value_p))
+    {
+      NamedCounter *counter = value_p;
+
+      if (!first)
+        g_string_append (buffer, ", ");
+      first = FALSE;
+
+      trace_append_string (buffer, g_quark_to_string (counter->id));
+      g_string_append_printf (buffer, ": %" G_GINT64_FORMAT, counter->value);
+    }
+  g_string_append (buffer, "}},\n");
+
+  trace_write (buffer);
+  g_string_free (buffer, TRUE);
+}
+
 static void
 named_counter_free (gpointer data)
 {
@@ -85,6 +248,8 @@ static void
 gsk_profiler_class_init (GskProfilerClass *klass)
 {
   G_OBJECT_CLASS (klass)->finalize = gsk_profiler_finalize;
+
+  trace_open ();
 }
 
 static void
@@ -96,6 +261,13 @@ gsk_profiler_init (GskProfiler *self)
   self->timers = g_hash_table_new_full (g_direct_hash, g_direct_equal,
                                         NULL,
                                         named_timer_free);
+
+  if (G_UNLIKELY (trace_file != NULL))
+    {
+      G_LOCK (trace_file);
+      self->trace_id = ++n_trace_profilers;
+      G_UNLOCK (trace_file);
+    }
 }
 
 GskProfiler *
@@ -196,6 +368,9 @@ gsk_profiler_add_timer (GskProfiler *profiler,
   timer = named_timer_new (id, description, invert, can_reset);
   g_hash_table_insert (profiler->timers, GINT_TO_POINTER (id), timer);
 
+  if (G_UNLIKELY (trace_file != NULL))
+    trace_add_timer (profiler, timer);
+
   return timer->id;
 }
 
@@ -215,6 +390,38 @@ gsk_profiler_counter_inc (GskProfiler *profiler,
 
 }
 
+void
+gsk_profiler_counter_add (GskProfiler *profiler,
+                          GQuark       counter_id,
+                          gint64       increment)
+{
+  NamedCounter *counter;
+
+  g_return_if_fail (GSK_IS_PROFILER (profiler));
+
+  counter = gsk_profiler_get_counter (profiler, counter_id);
+  if (counter == NULL)
+    return;
+
+  counter->value += increment;
+}
+
+void
+gsk_profiler_counter_set (GskProfiler *profiler,
+                          GQuark       counter_id,
+                          gint64       value)
+{
+  NamedCounter *counter;
+
+  g_return_if_fail (GSK_IS_PROFILER (profiler));
+
+  counter = gsk_profiler_get_counter (profiler, counter_id);
+  if (counter == NULL)
+    return;
+
+  counter->value = value;
+}
+
 void
 gsk_profiler_timer_begin (GskProfiler *profiler,
                           GQuark       timer_id)
@@ -342,6 +549,9 @@ gsk_profiler_reset (GskProfiler *profiler)
 
   g_return_if_fail (GSK_IS_PROFILER (profiler));
 
+  if (G_UNLIKELY (trace_file != NULL))
+    profiler->frame_start = g_get_monotonic_time ();
+
   g_hash_table_iter_init (&iter, profiler->counters);
   while (g_hash_table_iter_next (&iter, NULL, &value_p))
     {
@@ -378,6 +588,9 @@ gsk_profiler_push_samples (GskProfiler *profiler)
 
   g_return_if_fail (GSK_IS_PROFILER (profiler));
 
+  if (G_UNLIKELY (trace_file != NULL))
+    trace_frame (profiler);
+
   g_hash_table_iter_init (&iter, profiler->timers);
   while (g_hash_table_iter_next (&iter, NULL, &value_p))
     {
@@ -399,6 +612,39 @@ gsk_profiler_push_samples (GskProfiler *profiler)
     }
 }
 
+/*< private >
+ * gsk_profiler_foreach_counter:
+ * @profiler: a #GskProfiler
+ * @func: the function to call for each counter
+ * @user_data: data to pass to @func
+ *
+ * Calls @func with the name, description and current value of
+ * every counter of @profiler, so tools like benchmarks can record
+ * them in their own format.
+ */
+void
+gsk_profiler_foreach_counter (GskProfiler            *profiler,
+                              GskProfilerCounterFunc  func,
+                              gpointer                user_data)
+{
+  GHashTableIter iter;
+  gpointer value_p = NULL;
+
+  g_return_if_fail (GSK_IS_PROFILER (profiler));
+  g_return_if_fail (func != NULL);
+
+  g_hash_table_iter_init (&iter, profiler->counters);
+  while (g_hash_table_iter_next (&iter, NULL, &value_p))
+    {
+      NamedCounter *counter = value_p;
+
+      func (g_quark_to_string (counter->id),
+            counter->description,
+            counter->value,
+            user_data);
+    }
+}
+
 void
 gsk_profiler_append_counters (GskProfiler *profiler,
                               GString     *buffer)
@@ -1,13 +1,18 @@
 #ifndef __GSK_PROFILER_PRIVATE_H__
 #define __GSK_PROFILER_PRIVATE_H__
 
-#include <glib-object.h>
+#include <gdk/gdk.h>
 
 G_BEGIN_DECLS
 
 #define GSK_TYPE_PROFILER (gsk_profiler_get_type ())
 G_DECLARE_FINAL_TYPE (GskProfiler, gsk_profiler, GSK, PROFILER, GObject)
 
+typedef void (* GskProfilerCounterFunc) (const char *counter_name,
+                                         const char *description,
+                                         gint64      value,
+                                         gpointer    user_data);
+
 GskProfiler *   gsk_profiler_new                (void);
 
 GQuark          gsk_profiler_add_counter        (GskProfiler *profiler,
@@ -22,6 +27,12 @@ GQuark          gsk_profiler_add_timer          (GskProfiler *profiler,
 
 void            gsk_profiler_counter_inc        (GskProfiler *profiler,
                                                  GQuark       counter_id);
+void            gsk_profiler_counter_add        (GskProfiler *profiler,
+                                                 GQuark       counter_id,
+                                                 gint64       increment);
+void            gsk_profiler_counter_set        (GskProfiler *profiler,
+                                                 GQuark       counter_id,
+                                                 gint64       value);
 void            gsk_profiler_timer_begin        (GskProfiler *profiler,
                                                  GQuark       timer_id);
 gint64          gsk_profiler_timer_end          (GskProfiler *profiler,
@@ -38,6 +49,10 @@ gint64          gsk_profiler_timer_get          (GskProfiler *profiler,
 void            gsk_profiler_reset              (GskProfiler *profiler);
 
 void            gsk_profiler_push_samples       (GskProfiler *profiler);
+GDK_AVAILABLE_IN_ALL
+void            gsk_profiler_foreach_counter    (GskProfiler            *profiler,
+                                                 GskProfilerCounterFunc  func,
+                                                 gpointer                user_data);
 void            gsk_profiler_append_counters    (GskProfiler *profiler,
                                                  GString     *buffer);
 void            gsk_profiler_append_timers      (GskProfiler *profiler,
@@ -74,6 +74,9 @@ typedef struct
   GskRenderNode *root_node;
   GdkDisplay *display;
 
+  /* The root node of the last frame, used to find the damage */
+  GskRenderNode *prev_node;
+
   GskProfiler *profiler;
 
   int scale_factor;
@@ -176,6 +179,7 @@ gsk_renderer_dispose (GObject *gobject)
 
   gsk_renderer_unrealize (self);
 
+  g_clear_pointer (&priv->prev_node, gsk_render_node_unref);
   g_clear_object (&priv->profiler);
   g_clear_object (&priv->display);
 
@@ -391,6 +395,7 @@ gsk_renderer_set_viewport (GskRenderer           *renderer,
     return;
 
   graphene_rect_init_from_rect (&priv->viewport, viewport);
+  gsk_renderer_reset_damage (renderer);
 
   g_object_notify_by_pspec (G_OBJECT (renderer), gsk_renderer_properties[PROP_VIEWPORT]);
 }
@@ -436,6 +441,7 @@ gsk_renderer_set_scale_factor (GskRenderer *renderer,
   if (priv->scale_factor != scale_factor)
     {
       priv->scale_factor = scale_factor;
+      gsk_renderer_reset_damage (renderer);
 
       g_object_notify_by_pspec (G_OBJECT (renderer), gsk_renderer_properties[PROP_SCALE_FACTOR]);
     }
@@ -612,6 +618,7 @@ gsk_renderer_unrealize (GskRenderer *renderer)
     return;
 
   GSK_RENDERER_GET_CLASS (renderer)->unrealize (renderer);
+  gsk_renderer_reset_damage (renderer);
 
   priv->is_realized = FALSE;
 }
@@ -967,6 +974,79 @@ gsk_renderer_begin_draw_frame (GskRenderer          *renderer,
   return priv->drawing_context;
 }
 
+/*< private >
+ * gsk_renderer_compute_damage:
+ * @renderer: a #GskRenderer
+ * @root: the root node of the next frame
+ * @region: the area that was invalidated
+ *
+ * Compares @root with the root node passed in the previous call, and
+ * returns the area where they differ together with @region, to be passed
+ * to gsk_renderer_begin_draw_frame() instead of @region. @region is
+ * always included, as the window system may have lost its contents even
+ * if the tree did not change.
+ *
+ * This is only valid if the contents of the window are kept between
+ * frames, and @root covers the whole window. If there is no previous
+ * frame to compare with, a copy of @region is returned.
+ *
+ * Returns: (transfer full): the area to redraw
+ */
+cairo_region_t *
+gsk_renderer_compute_damage (GskRenderer          *renderer,
+                             GskRenderNode        *root,
+                             const cairo_region_t *region)
+{
+  GskRendererPrivate *priv = gsk_renderer_get_instance_private (renderer);
+  cairo_region_t *damage;
+
+  g_return_val_if_fail (GSK_IS_RENDERER (renderer), NULL);
+  g_return_val_if_fail (GSK_IS_RENDER_NODE (root), NULL);
+  g_return_val_if_fail (region != NULL, NULL);
+
+  if (priv->prev_node != NULL)
+    {
+      damage = cairo_region_copy (region);
+      gsk_render_node_diff (priv->prev_node, root, damage);
+
+      GSK_NOTE (RENDERER, {
+                cairo_rectangle_int_t extents;
+
+                cairo_region_get_extents (damage, &extents);
+                g_print ("Render node diff and expose: %d rectangles within %d,%d %dx%d\n",
+                         cairo_region_num_rectangles (damage),
+                         extents.x, extents.y, extents.width, extents.height);
+                });
+    }
+  else
+    {
+      damage = cairo_region_copy (region);
+    }
+
+  g_clear_pointer (&priv->prev_node, gsk_render_node_unref);
+  priv->prev_node = gsk_render_node_ref (root);
+
+  return damage;
+}
+
+/*< private >
+ * gsk_renderer_reset_damage:
+ * @renderer: a #GskRenderer
+ *
+ * Forgets the root node of the previous frame, so that the next call
+ * to gsk_renderer_compute_damage() does not compare with it; this is
+ * needed whenever the contents of the window are lost.
+ */
+void
+gsk_renderer_reset_damage (GskRenderer *renderer)
+{
+  GskRendererPrivate *priv = gsk_renderer_get_instance_private (renderer);
+
+  g_return_if_fail (GSK_IS_RENDERER (renderer));
+
+  g_clear_pointer (&priv->prev_node, gsk_render_node_unref);
+}
+
 void
 gsk_renderer_end_draw_frame (GskRenderer       *renderer,
                              GdkDrawingContext *context)
@@ -67,8 +67,14 @@ cairo_surface_t *       gsk_renderer_create_cairo_surface       (GskRenderer
                                                                  int             width,
                                                                  int             height);
 
+GDK_AVAILABLE_IN_ALL
 GskProfiler *           gsk_renderer_get_profiler               (GskRenderer    *renderer);
 
+cairo_region_t *        gsk_renderer_compute_damage             (GskRenderer          *renderer,
+                                                                 GskRenderNode        *root,
+                                                                 const cairo_region_t *region);
+void                    gsk_renderer_reset_damage               (GskRenderer          *renderer);
+
 G_END_DECLS
 
 #endif /* __GSK_RENDERER_PRIVATE_H__ */
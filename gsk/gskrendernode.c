@@ -50,6 +50,7 @@
 #include <graphene-gobject.h>
 
 #include <math.h>
+#include <string.h>
 
 #include <gobject/gvaluecollector.h>
 
@@ -67,14 +68,161 @@ G_DEFINE_BOXED_TYPE (GskRenderNode, gsk_render_node,
 
 G_DEFINE_QUARK (gsk-serialization-error-quark, gsk_serialization_error)
 
+/* Node memory is carved out of blocks of this size; anything bigger
+ * than a quarter of a block gets an allocation of its own.
+ *
+ * Every node holds a reference on its block rather than on the arena,
+ * so a node that outlives its frame, like the ones that widgets keep
+ * between frames, only keeps the memory of its own block alive. The
+ * blocks are small to bound that: the memory retained by the nodes of
+ * a frame is at most one block per surviving node, and usually a lot
+ * less, as the nodes of a widget are allocated next to each other.
+ */
+#define ARENA_BLOCK_SIZE (8 * 1024)
+#define ARENA_ALIGNMENT 16
+
+typedef struct _GskRenderNodeArenaBlock GskRenderNodeArenaBlock;
+
+struct _GskRenderNodeArenaBlock
+{
+  volatile int ref_count;
+  gsize used;
+};
+
+/* The nodes start after the header of the block, aligned */
+#define ARENA_BLOCK_HEADER_SIZE ((sizeof (GskRenderNodeArenaBlock) + ARENA_ALIGNMENT - 1) & ~(gsize) (ARENA_ALIGNMENT - 1))
+
+struct _GskRenderNodeArena
+{
+  volatile int ref_count;
+
+  /* The block that nodes are currently allocated from */
+  GskRenderNodeArenaBlock *block;
+};
+
+static GPrivate current_arena = G_PRIVATE_INIT (NULL);
+
+static void
+gsk_render_node_arena_block_unref (GskRenderNodeArenaBlock *block)
+{
+  if (g_atomic_int_dec_and_test (&block->ref_count))
+    g_free (block);
+}
+
+/*< private >
+ * gsk_render_node_arena_new:
+ *
+ * Creates an arena that render nodes can be allocated from, to avoid
+ * a separate allocation for every node of a frame. Make it the current
+ * arena with gsk_render_node_arena_set_current() while creating nodes.
+ *
+ * Nodes are allocated from blocks that are released once all of their
+ * nodes are gone, so nodes that outlive the frame stay valid and only
+ * keep the memory of their blocks alive.
+ *
+ * Returns: (transfer full): a new #GskRenderNodeArena
+ */
+GskRenderNodeArena *
+gsk_render_node_arena_new (void)
+{
+  GskRenderNodeArena *arena;
+
+  arena = g_slice_new0 (GskRenderNodeArena);
+  arena->ref_count = 1;
+
+  return arena;
+}
+
+GskRenderNodeArena *
+gsk_render_node_arena_ref (GskRenderNodeArena *arena)
+{
+  g_atomic_int_inc (&arena->ref_count);
+
+  return arena;
+}
+
+void
+gsk_render_node_arena_unref (GskRenderNodeArena *arena)
+{
+  if (!g_atomic_int_dec_and_test (&arena->ref_count))
+    return;
+
+  if (arena->block)
+    gsk_render_node_arena_block_unref (arena->block);
+  g_slice_free (GskRenderNodeArena, arena);
+}
+
+/*< private >
+ * gsk_render_node_arena_set_current:
+ * @arena: (nullable): the arena to allocate nodes from, or %NULL
+ *   to allocate them individually
+ *
+ * Sets the arena that nodes created on the calling thread are allocated
+ * from. The caller keeps its reference on @arena and has to restore the
+ * previous arena before dropping it.
+ *
+ * Returns: (transfer none) (nullable): the previous arena
+ */
+GskRenderNodeArena *
+gsk_render_node_arena_set_current (GskRenderNodeArena *arena)
+{
+  GskRenderNodeArena *previous = g_private_get (&current_arena);
+
+  g_private_set (&current_arena, arena);
+
+  return previous;
+}
+
+/* Returns the memory for a node and a reference on its block in
+ * @out_block, or %NULL if the node is too big to share a block
+ */
+static gpointer
+gsk_render_node_arena_alloc (GskRenderNodeArena       *arena,
+                             gsize                     size,
+                             GskRenderNodeArenaBlock **out_block)
+{
+  GskRenderNodeArenaBlock *block;
+  gpointer mem;
+
+  size = (size + ARENA_ALIGNMENT - 1) & ~(gsize) (ARENA_ALIGNMENT - 1);
+
+  if (size > (ARENA_BLOCK_SIZE - ARENA_BLOCK_HEADER_SIZE) / 4)
+    return NULL;
+
+  block = arena->block;
+  if (block == NULL || block->used + size > ARENA_BLOCK_SIZE)
+    {
+      if (block)
+        gsk_render_node_arena_block_unref (block);
+
+      block = arena->block = g_malloc (ARENA_BLOCK_SIZE);
+      block->ref_count = 1;
+      block->used = ARENA_BLOCK_HEADER_SIZE;
+    }
+
+  mem = (guchar *) block + block->used;
+  block->used += size;
+  memset (mem, 0, size);
+
+  g_atomic_int_inc (&block->ref_count);
+  *out_block = block;
+
+  return mem;
+}
+
 static void
 gsk_render_node_finalize (GskRenderNode *self)
 {
+  GskRenderNodeArenaBlock *block = self->block;
+
   self->node_class->finalize (self);
 
   g_clear_pointer (&self->name, g_free);
 
-  g_free (self);
+  if (block)
+    gsk_render_node_arena_block_unref (block);
+  else
+    g_free (self);
 }
 
 /*< private >
@@ -86,12 +234,23 @@ gsk_render_node_finalize (GskRenderNode *self)
 GskRenderNode *
 gsk_render_node_new (const GskRenderNodeClass *node_class, gsize extra_size)
 {
+  GskRenderNodeArenaBlock *block = NULL;
+  GskRenderNodeArena *arena;
   GskRenderNode *self;
 
   g_return_val_if_fail (node_class != NULL, NULL);
   g_return_val_if_fail (node_class->node_type != GSK_NOT_A_RENDER_NODE, NULL);
 
-  self = g_malloc0 (node_class->struct_size + extra_size);
+  arena = g_private_get (&current_arena);
+  if (arena)
+    self = gsk_render_node_arena_alloc (arena, node_class->struct_size + extra_size, &block);
+  else
+    self = NULL;
+
+  if (self)
+    self->block = block;
+  else
+    self = g_malloc0 (node_class->struct_size + extra_size);
 
   self->node_class = node_class;
 
@@ -235,6 +394,36 @@ gsk_render_node_get_name (GskRenderNode *node)
   return node->name;
 }
 
+/*< private >
+ * gsk_render_node_diff:
+ * @node1: a #GskRenderNode
+ * @node2: the #GskRenderNode to compare with
+ * @region: a #cairo_region_t to add the differences to
+ *
+ * Compares @node1 and @node2, and adds the areas where they draw
+ * differently to @region.
+ *
+ * The nodes are compared structurally, so subtrees that are created
+ * again with the same contents do not add anything. The result errs
+ * on the side of caution, and may contain areas that do not change.
+ */
+void
+gsk_render_node_diff (GskRenderNode  *node1,
+                      GskRenderNode  *node2,
+                      cairo_region_t *region)
+{
+  if (node1 == node2)
+    return;
+
+  if (node1->node_class != node2->node_class)
+    {
+      gsk_render_node_diff_impossible (node1, node2, region);
+      return;
+    }
+
+  node1->node_class->diff (node1, node2, region);
+}
+
 /**
  * gsk_render_node_draw:
  * @node: a #GskRenderNode
@@ -248,6 +437,12 @@ gsk_render_node_get_name (GskRenderNode *node)
  *
  * For advanced nodes that cannot be supported using Cairo, in particular
  * for nodes doing 3D operations, this function may fail.
+ *
+ * Nodes that lie outside of the clip region of @cr are skipped.
+ *
+ * The same node may be drawn to different cairo contexts from several
+ * threads at once, as long as it does not contain #GskCairoNodes with
+ * surfaces other than image surfaces, see gsk_cairo_node_new().
  **/
 void
 gsk_render_node_draw (GskRenderNode *node,
@@ -257,6 +452,21 @@ gsk_render_node_draw (GskRenderNode *node,
   g_return_if_fail (cr != NULL);
   g_return_if_fail (cairo_status (cr) == CAIRO_STATUS_SUCCESS);
 
+  if (!GSK_RENDER_MODE_CHECK (GEOMETRY))
+    {
+      double x1, y1, x2, y2;
+
+      cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+      if (node->bounds.origin.x >= x2 ||
+          node->bounds.origin.y >= y2 ||
+          node->bounds.origin.x + node->bounds.size.width <= x1 ||
+          node->bounds.origin.y + node->bounds.size.height <= y1)
+        {
+          GSK_NOTE (CAIRO, g_print ("Culling node %s[%p]\n", node->name, node));
+          return;
+        }
+    }
+
   cairo_save (cr);
 
   if (!GSK_RENDER_MODE_CHECK (GEOMETRY))
@@ -313,6 +523,9 @@ gsk_render_node_draw (GskRenderNode *node,
  * The intended use of this functions is testing, benchmarking and debugging.
  * The format is not meant as a permanent storage format.
  *
+ * See gsk_render_node_serialize_binary() for a format that is faster to
+ * load.
+ *
  * Returns: a #GBytes representing the node.
  **/
 GBytes *
@@ -377,8 +590,9 @@ gsk_render_node_write_to_file (GskRenderNode *node,
  * @bytes: the bytes containing the data
  * @error: (allow-none): location to store error or %NULL
  *
- * Loads data previously created via gsk_render_node_serialize(). For a
- * discussion of the supported format, see that function.
+ * Loads data previously created via gsk_render_node_serialize() or
+ * gsk_render_node_serialize_binary(). For a discussion of the supported
+ * formats, see those functions.
  *
  * Returns: (nullable) (transfer full): a new #GskRenderNode or %NULL on
  *     error.
@@ -392,6 +606,9 @@ gsk_render_node_deserialize (GBytes  *bytes,
   GVariant *variant, *node_variant;
   GskRenderNode *node = NULL;
 
+  if (gsk_render_node_is_binary (bytes))
+    return gsk_render_node_deserialize_binary (bytes, error);
+
   variant = g_variant_new_from_bytes (G_VARIANT_TYPE ("(suuv)"), bytes, FALSE);
 
   g_variant_get (variant, "(suuv)", &id_string, &version, &node_type, &node_variant);
@@ -174,6 +174,13 @@ GskRenderNode *         gsk_cross_fade_node_new                 (GskRenderNode
                                                                  GskRenderNode            *end,
                                                                  double                    progress);
 
+GDK_AVAILABLE_IN_3_92
+GskRenderNode *         gsk_text_node_new                       (PangoFont                *font,
+                                                                 PangoGlyphString         *glyphs,
+                                                                 const GdkRGBA            *color,
+                                                                 double                    x_offset,
+                                                                 double                    y_offset);
+
 GDK_AVAILABLE_IN_3_90
 void                    gsk_render_node_set_scaling_filters     (GskRenderNode *node,
                                                                  GskScalingFilter min_filter,
@@ -194,6 +201,8 @@ void                    gsk_render_node_draw                    (GskRenderNode *
 
 GDK_AVAILABLE_IN_3_90
 GBytes *                gsk_render_node_serialize               (GskRenderNode *node);
+GDK_AVAILABLE_IN_3_92
+GBytes *                gsk_render_node_serialize_binary        (GskRenderNode *node);
 GDK_AVAILABLE_IN_3_90
 gboolean                gsk_render_node_write_to_file           (GskRenderNode *node,
                                                                  const char    *filename,
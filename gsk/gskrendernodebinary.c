@@ -0,0 +1,1313 @@
+/* GSK - The GTK Scene Kit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The binary node format
+ *
+ * Unlike the GVariant format, which nests every node inside its parent
+ * and inlines all pixel data, the binary format is made of three flat
+ * sections:
+ *
+ *  - the node table, one GskBinaryNode per node. Children come before
+ *    their parents, so nodes can be created in a single pass, and refer
+ *    to their children by index. The root is the last node. A node that
+ *    appears several times in the tree is only stored once.
+ *  - the data section holding the properties of each node, in the order
+ *    the node type's constructor takes them.
+ *  - the blob section holding the pixels of textures and cairo surfaces,
+ *    with identical pixel data only stored once. Each blob is aligned to
+ *    BLOB_ALIGNMENT, so that surfaces can be created directly on top of
+ *    a mapped file without copying.
+ *
+ * All values are stored in host byte order; files written on a machine
+ * with a different byte order are rejected.
+ */
+
+#include "config.h"
+
+#include "gskrendernodeprivate.h"
+
+#include "gskroundedrectprivate.h"
+#include "gsktextureprivate.h"
+
+#include <pango/pangocairo.h>
+
+#include <math.h>
+#include <string.h>
+
+#define GSK_BINARY_MAGIC "GSKBNODE"
+#define GSK_BINARY_BYTE_ORDER 0x01020304
+#define GSK_BINARY_VERSION 1
+
+#define BLOB_ALIGNMENT 64
+#define NO_BLOB G_MAXUINT32
+
+typedef struct {
+  char magic[8];
+  guint32 byte_order;
+  guint32 version;
+  guint32 n_nodes;
+  guint32 n_blobs;
+  guint64 nodes_offset;
+  guint64 data_offset;
+  guint64 data_size;
+  guint64 blobs_offset;
+} GskBinaryHeader;
+
+typedef struct {
+  guint32 node_type;
+  guint32 size;
+  guint64 offset; /* relative to the data section */
+} GskBinaryNode;
+
+typedef struct {
+  guint64 offset; /* relative to the start of the file */
+  guint64 size;
+} GskBinaryBlob;
+
+/*** Writing ***/
+
+typedef struct {
+  GArray *nodes;
+  GByteArray *data;
+  GHashTable *node_indices;
+  GPtrArray *blobs;
+  GHashTable *blob_indices;
+} GskBinaryWriter;
+
+static void
+write_data (GskBinaryWriter *writer,
+            gconstpointer    data,
+            gsize            size)
+{
+  g_byte_array_append (writer->data, data, size);
+}
+
+static void
+write_uint (GskBinaryWriter *writer,
+            guint32          value)
+{
+  write_data (writer, &value, sizeof (value));
+}
+
+static void
+write_float (GskBinaryWriter *writer,
+             float            value)
+{
+  write_data (writer, &value, sizeof (value));
+}
+
+static void
+write_double (GskBinaryWriter *writer,
+              double           value)
+{
+  write_data (writer, &value, sizeof (value));
+}
+
+static void
+write_rect (GskBinaryWriter       *writer,
+            const graphene_rect_t *rect)
+{
+  write_float (writer, rect->origin.x);
+  write_float (writer, rect->origin.y);
+  write_float (writer, rect->size.width);
+  write_float (writer, rect->size.height);
+}
+
+static void
+write_rounded_rect (GskBinaryWriter      *writer,
+                    const GskRoundedRect *rect)
+{
+  int i;
+
+  write_rect (writer, &rect->bounds);
+  for (i = 0; i < 4; i++)
+    {
+      write_float (writer, rect->corner[i].width);
+      write_float (writer, rect->corner[i].height);
+    }
+}
+
+static void
+write_rgba (GskBinaryWriter *writer,
+            const GdkRGBA   *rgba)
+{
+  write_double (writer, rgba->red);
+  write_double (writer, rgba->green);
+  write_double (writer, rgba->blue);
+  write_double (writer, rgba->alpha);
+}
+
+static void
+write_matrix (GskBinaryWriter         *writer,
+              const graphene_matrix_t *matrix)
+{
+  float v[16];
+
+  graphene_matrix_to_float (matrix, v);
+  write_data (writer, v, sizeof (v));
+}
+
+static void
+write_string (GskBinaryWriter *writer,
+              const char      *string)
+{
+  guint32 len = strlen (string);
+
+  write_uint (writer, len);
+  write_data (writer, string, len);
+}
+
+/* Adds the pixels of @surface to the blob section, unless they are
+ * already in it, and writes the surface description
+ */
+static void
+write_surface (GskBinaryWriter *writer,
+               cairo_surface_t *surface)
+{
+  cairo_surface_t *image;
+  GBytes *bytes;
+  gpointer index;
+  int width, height, stride;
+
+  if (surface == NULL)
+    {
+      write_uint (writer, NO_BLOB);
+      return;
+    }
+
+  if (cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_IMAGE &&
+      cairo_image_surface_get_format (surface) == CAIRO_FORMAT_ARGB32)
+    {
+      image = cairo_surface_reference (surface);
+    }
+  else
+    {
+      double x1, y1, x2, y2;
+      cairo_t *cr;
+
+      cr = cairo_create (surface);
+      cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+      cairo_destroy (cr);
+
+      image = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, ceil (x2 - x1), ceil (y2 - y1));
+      cr = cairo_create (image);
+      cairo_set_source_surface (cr, surface, -x1, -y1);
+      cairo_paint (cr);
+      cairo_destroy (cr);
+    }
+
+  cairo_surface_flush (image);
+  width = cairo_image_surface_get_width (image);
+  height = cairo_image_surface_get_height (image);
+  stride = cairo_image_surface_get_stride (image);
+
+  bytes = g_bytes_new (cairo_image_surface_get_data (image), stride * height);
+  cairo_surface_destroy (image);
+
+  index = g_hash_table_lookup (writer->blob_indices, bytes);
+  if (index == NULL)
+    {
+      g_ptr_array_add (writer->blobs, g_bytes_ref (bytes));
+      index = GUINT_TO_POINTER (writer->blobs->len);
+      g_hash_table_insert (writer->blob_indices, bytes, index);
+    }
+  else
+    {
+      g_bytes_unref (bytes);
+    }
+
+  write_uint (writer, GPOINTER_TO_UINT (index) - 1);
+  write_uint (writer, width);
+  write_uint (writer, height);
+  write_uint (writer, stride);
+}
+
+static guint32 write_node (GskBinaryWriter *writer,
+                           GskRenderNode   *node);
+
+static void
+write_node_data (GskBinaryWriter *writer,
+                 GskRenderNode   *node)
+{
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CONTAINER_NODE:
+      {
+        guint i, n = gsk_container_node_get_n_children (node);
+        guint32 *children = g_newa (guint32, n + 1);
+
+        for (i = 0; i < n; i++)
+          children[i] = write_node (writer, gsk_container_node_get_child (node, i));
+
+        write_uint (writer, n);
+        write_data (writer, children, sizeof (guint32) * n);
+      }
+      break;
+
+    case GSK_CAIRO_NODE:
+      write_rect (writer, &node->bounds);
+      write_surface (writer, gsk_cairo_node_get_surface (node));
+      break;
+
+    case GSK_COLOR_NODE:
+      write_rgba (writer, gsk_color_node_peek_color (node));
+      write_rect (writer, &node->bounds);
+      break;
+
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+      {
+        const GskColorStop *stops = gsk_linear_gradient_node_peek_color_stops (node);
+        gsize i, n = gsk_linear_gradient_node_get_n_color_stops (node);
+
+        write_rect (writer, &node->bounds);
+        write_float (writer, gsk_linear_gradient_node_peek_start (node)->x);
+        write_float (writer, gsk_linear_gradient_node_peek_start (node)->y);
+        write_float (writer, gsk_linear_gradient_node_peek_end (node)->x);
+        write_float (writer, gsk_linear_gradient_node_peek_end (node)->y);
+        write_uint (writer, n);
+        for (i = 0; i < n; i++)
+          {
+            write_double (writer, stops[i].offset);
+            write_rgba (writer, &stops[i].color);
+          }
+      }
+      break;
+
+    case GSK_BORDER_NODE:
+      {
+        const float *widths = gsk_border_node_peek_widths (node);
+        const GdkRGBA *colors = gsk_border_node_peek_colors (node);
+        int i;
+
+        write_rounded_rect (writer, gsk_border_node_peek_outline (node));
+        for (i = 0; i < 4; i++)
+          write_float (writer, widths[i]);
+        for (i = 0; i < 4; i++)
+          write_rgba (writer, &colors[i]);
+      }
+      break;
+
+    case GSK_TEXTURE_NODE:
+      {
+        cairo_surface_t *surface;
+
+        surface = gsk_texture_download_surface (gsk_texture_node_get_texture (node));
+        write_rect (writer, &node->bounds);
+        write_surface (writer, surface);
+        cairo_surface_destroy (surface);
+      }
+      break;
+
+    case GSK_INSET_SHADOW_NODE:
+      write_rounded_rect (writer, gsk_inset_shadow_node_peek_outline (node));
+      write_rgba (writer, gsk_inset_shadow_node_peek_color (node));
+      write_float (writer, gsk_inset_shadow_node_get_dx (node));
+      write_float (writer, gsk_inset_shadow_node_get_dy (node));
+      write_float (writer, gsk_inset_shadow_node_get_spread (node));
+      write_float (writer, gsk_inset_shadow_node_get_blur_radius (node));
+      break;
+
+    case GSK_OUTSET_SHADOW_NODE:
+      write_rounded_rect (writer, gsk_outset_shadow_node_peek_outline (node));
+      write_rgba (writer, gsk_outset_shadow_node_peek_color (node));
+      write_float (writer, gsk_outset_shadow_node_get_dx (node));
+      write_float (writer, gsk_outset_shadow_node_get_dy (node));
+      write_float (writer, gsk_outset_shadow_node_get_spread (node));
+      write_float (writer, gsk_outset_shadow_node_get_blur_radius (node));
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      {
+        guint32 child = write_node (writer, gsk_transform_node_get_child (node));
+        graphene_matrix_t transform;
+
+        gsk_transform_node_get_transform (node, &transform);
+        write_uint (writer, child);
+        write_matrix (writer, &transform);
+      }
+      break;
+
+    case GSK_OPACITY_NODE:
+      write_uint (writer, write_node (writer, gsk_opacity_node_get_child (node)));
+      write_double (writer, gsk_opacity_node_get_opacity (node));
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      {
+        guint32 child = write_node (writer, gsk_color_matrix_node_get_child (node));
+        float offset[4];
+
+        graphene_vec4_to_float (gsk_color_matrix_node_peek_color_offset (node), offset);
+        write_uint (writer, child);
+        write_matrix (writer, gsk_color_matrix_node_peek_color_matrix (node));
+        write_data (writer, offset, sizeof (offset));
+      }
+      break;
+
+    case GSK_REPEAT_NODE:
+      write_uint (writer, write_node (writer, gsk_repeat_node_get_child (node)));
+      write_rect (writer, &node->bounds);
+      write_rect (writer, gsk_repeat_node_peek_child_bounds (node));
+      break;
+
+    case GSK_CLIP_NODE:
+      write_uint (writer, write_node (writer, gsk_clip_node_get_child (node)));
+      write_rect (writer, gsk_clip_node_peek_clip (node));
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      write_uint (writer, write_node (writer, gsk_rounded_clip_node_get_child (node)));
+      write_rounded_rect (writer, gsk_rounded_clip_node_peek_clip (node));
+      break;
+
+    case GSK_SHADOW_NODE:
+      {
+        guint32 child = write_node (writer, gsk_shadow_node_get_child (node));
+        gsize i, n = gsk_shadow_node_get_n_shadows (node);
+
+        write_uint (writer, child);
+        write_uint (writer, n);
+        for (i = 0; i < n; i++)
+          {
+            const GskShadow *shadow = gsk_shadow_node_peek_shadow (node, i);
+
+            write_rgba (writer, &shadow->color);
+            write_float (writer, shadow->dx);
+            write_float (writer, shadow->dy);
+            write_float (writer, shadow->radius);
+          }
+      }
+      break;
+
+    case GSK_BLEND_NODE:
+      {
+        guint32 bottom = write_node (writer, gsk_blend_node_get_bottom_child (node));
+        guint32 top = write_node (writer, gsk_blend_node_get_top_child (node));
+
+        write_uint (writer, bottom);
+        write_uint (writer, top);
+        write_uint (writer, gsk_blend_node_get_blend_mode (node));
+      }
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      {
+        guint32 start = write_node (writer, gsk_cross_fade_node_get_start_child (node));
+        guint32 end = write_node (writer, gsk_cross_fade_node_get_end_child (node));
+
+        write_uint (writer, start);
+        write_uint (writer, end);
+        write_double (writer, gsk_cross_fade_node_get_progress (node));
+      }
+      break;
+
+    case GSK_TEXT_NODE:
+      {
+        const PangoGlyphInfo *glyphs = gsk_text_node_peek_glyphs (node);
+        guint i, n = gsk_text_node_get_num_glyphs (node);
+        PangoFontDescription *desc;
+        char *s;
+
+        desc = pango_font_describe (gsk_text_node_peek_font (node));
+        s = pango_font_description_to_string (desc);
+        write_string (writer, s);
+        g_free (s);
+        pango_font_description_free (desc);
+
+        write_rgba (writer, gsk_text_node_peek_color (node));
+        write_float (writer, gsk_text_node_get_x (node));
+        write_float (writer, gsk_text_node_get_y (node));
+        write_uint (writer, n);
+        for (i = 0; i < n; i++)
+          {
+            write_uint (writer, glyphs[i].glyph);
+            write_uint (writer, glyphs[i].geometry.width);
+            write_uint (writer, glyphs[i].geometry.x_offset);
+            write_uint (writer, glyphs[i].geometry.y_offset);
+            write_uint (writer, glyphs[i].attr.is_cluster_start);
+          }
+      }
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+/* Writes @node after all of its children and returns its index */
+static guint32
+write_node (GskBinaryWriter *writer,
+            GskRenderNode   *node)
+{
+  GByteArray *parent_data, *node_data;
+  GskBinaryNode entry;
+  gpointer index;
+
+  index = g_hash_table_lookup (writer->node_indices, node);
+  if (index != NULL)
+    return GPOINTER_TO_UINT (index) - 1;
+
+  /* The data of the children is written while writing ours, so
+   * collect ours separately and append it once the children are done
+   */
+  parent_data = writer->data;
+  writer->data = g_byte_array_new ();
+  write_node_data (writer, node);
+  node_data = writer->data;
+  writer->data = parent_data;
+
+  entry.node_type = gsk_render_node_get_node_type (node);
+  entry.size = node_data->len;
+  entry.offset = writer->data->len;
+  g_byte_array_append (writer->data, node_data->data, node_data->len);
+  g_byte_array_unref (node_data);
+
+  g_array_append_val (writer->nodes, entry);
+  g_hash_table_insert (writer->node_indices, node, GUINT_TO_POINTER (writer->nodes->len));
+
+  return writer->nodes->len - 1;
+}
+
+static gsize
+align (gsize offset,
+       gsize alignment)
+{
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * gsk_render_node_serialize_binary:
+ * @node: a #GskRenderNode
+ *
+ * Serializes the @node like gsk_render_node_serialize(), but in a binary
+ * format that is faster to load. Pixel data that is used by several nodes
+ * is only stored once, and when the result is loaded from a mapped file
+ * using gsk_render_node_deserialize(), the pixel data is not copied.
+ *
+ * Just like for gsk_render_node_serialize(), the format is meant for
+ * testing, benchmarking and debugging, and only the same version of GTK+
+ * is guaranteed to be able to load it.
+ *
+ * Returns: a #GBytes representing the node.
+ *
+ * Since: 3.92
+ **/
+GBytes *
+gsk_render_node_serialize_binary (GskRenderNode *node)
+{
+  GskBinaryWriter writer;
+  GskBinaryHeader header;
+  GskBinaryBlob *blobs;
+  guchar *data;
+  gsize size;
+  guint i;
+
+  g_return_val_if_fail (GSK_IS_RENDER_NODE (node), NULL);
+
+  writer.nodes = g_array_new (FALSE, FALSE, sizeof (GskBinaryNode));
+  writer.data = g_byte_array_new ();
+  writer.node_indices = g_hash_table_new (NULL, NULL);
+  writer.blobs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+  writer.blob_indices = g_hash_table_new_full (g_bytes_hash, g_bytes_equal, (GDestroyNotify) g_bytes_unref, NULL);
+
+  write_node (&writer, node);
+
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, GSK_BINARY_MAGIC, sizeof (header.magic));
+  header.byte_order = GSK_BINARY_BYTE_ORDER;
+  header.version = GSK_BINARY_VERSION;
+  header.n_nodes = writer.nodes->len;
+  header.n_blobs = writer.blobs->len;
+  header.nodes_offset = align (sizeof (GskBinaryHeader), 8);
+  header.blobs_offset = align (header.nodes_offset + sizeof (GskBinaryNode) * header.n_nodes, 8);
+  header.data_offset = align (header.blobs_offset + sizeof (GskBinaryBlob) * header.n_blobs, 8);
+  header.data_size = writer.data->len;
+
+  blobs = g_new (GskBinaryBlob, header.n_blobs);
+  size = header.data_offset + header.data_size;
+  for (i = 0; i < header.n_blobs; i++)
+    {
+      blobs[i].offset = align (size, BLOB_ALIGNMENT);
+      blobs[i].size = g_bytes_get_size (g_ptr_array_index (writer.blobs, i));
+      size = blobs[i].offset + blobs[i].size;
+    }
+
+  data = g_malloc0 (size);
+  memcpy (data, &header, sizeof (header));
+  memcpy (data + header.nodes_offset, writer.nodes->data, sizeof (GskBinaryNode) * header.n_nodes);
+  memcpy (data + header.blobs_offset, blobs, sizeof (GskBinaryBlob) * header.n_blobs);
+  memcpy (data + header.data_offset, writer.data->data, header.data_size);
+  for (i = 0; i < header.n_blobs; i++)
+    {
+      memcpy (data + blobs[i].offset,
+              g_bytes_get_data (g_ptr_array_index (writer.blobs, i), NULL),
+              blobs[i].size);
+    }
+
+  g_free (blobs);
+  g_array_unref (writer.nodes);
+  g_byte_array_unref (writer.data);
+  g_hash_table_unref (writer.node_indices);
+  g_ptr_array_unref (writer.blobs);
+  g_hash_table_unref (writer.blob_indices);
+
+  return g_bytes_new_take (data, size);
+}
+
+/*** Reading ***/
+
+typedef struct {
+  GBytes *bytes;
+  const guchar *data;
+  gsize size;
+
+  const GskBinaryHeader *header;
+  const GskBinaryNode *entries;
+  const GskBinaryBlob *blobs;
+
+  GskRenderNode **nodes;
+  GHashTable *fonts;
+} GskBinaryReader;
+
+/* Reads the data of a single node; running past its end sets @error
+ * and returns zeroes from then on
+ */
+typedef struct {
+  const guchar *data;
+  gsize remaining;
+  gboolean error;
+} GskBinaryData;
+
+static const cairo_user_data_key_t gsk_binary_bytes_key;
+
+static void
+read_data (GskBinaryData *d,
+           gpointer       data,
+           gsize          size)
+{
+  if (d->error || d->remaining < size)
+    {
+      d->error = TRUE;
+      memset (data, 0, size);
+      return;
+    }
+
+  memcpy (data, d->data, size);
+  d->data += size;
+  d->remaining -= size;
+}
+
+static guint32
+read_uint (GskBinaryData *d)
+{
+  guint32 value;
+
+  read_data (d, &value, sizeof (value));
+
+  return value;
+}
+
+static float
+read_float (GskBinaryData *d)
+{
+  float value;
+
+  read_data (d, &value, sizeof (value));
+
+  return value;
+}
+
+static double
+read_double (GskBinaryData *d)
+{
+  double value;
+
+  read_data (d, &value, sizeof (value));
+
+  return value;
+}
+
+static void
+read_rect (GskBinaryData   *d,
+           graphene_rect_t *rect)
+{
+  float x = read_float (d);
+  float y = read_float (d);
+  float width = read_float (d);
+  float height = read_float (d);
+
+  graphene_rect_init (rect, x, y, width, height);
+}
+
+static void
+read_rounded_rect (GskBinaryData  *d,
+                   GskRoundedRect *rect)
+{
+  int i;
+
+  read_rect (d, &rect->bounds);
+  for (i = 0; i < 4; i++)
+    {
+      rect->corner[i].width = read_float (d);
+      rect->corner[i].height = read_float (d);
+    }
+}
+
+static void
+read_rgba (GskBinaryData *d,
+           GdkRGBA       *rgba)
+{
+  rgba->red = read_double (d);
+  rgba->green = read_double (d);
+  rgba->blue = read_double (d);
+  rgba->alpha = read_double (d);
+}
+
+static void
+read_matrix (GskBinaryData     *d,
+             graphene_matrix_t *matrix)
+{
+  float v[16];
+
+  read_data (d, v, sizeof (v));
+  graphene_matrix_init_from_float (matrix, v);
+}
+
+/* Children always come before their parent, so they have been
+ * created already
+ */
+static GskRenderNode *
+read_child (GskBinaryReader *reader,
+            GskBinaryData   *d,
+            guint            parent)
+{
+  guint32 index = read_uint (d);
+
+  if (index >= parent)
+    {
+      d->error = TRUE;
+      return NULL;
+    }
+
+  return reader->nodes[index];
+}
+
+static PangoFont *
+read_font (GskBinaryReader *reader,
+           GskBinaryData   *d)
+{
+  PangoFontDescription *desc;
+  PangoFontMap *fontmap;
+  PangoContext *context;
+  PangoFont *font;
+  guint32 len;
+  char *s;
+
+  len = read_uint (d);
+  if (d->error || len > d->remaining)
+    {
+      d->error = TRUE;
+      return NULL;
+    }
+
+  s = g_strndup ((const char *) d->data, len);
+  d->data += len;
+  d->remaining -= len;
+
+  font = g_hash_table_lookup (reader->fonts, s);
+  if (font != NULL)
+    {
+      g_free (s);
+      return g_object_ref (font);
+    }
+
+  desc = pango_font_description_from_string (s);
+  fontmap = pango_cairo_font_map_get_default ();
+  context = pango_font_map_create_context (fontmap);
+  font = pango_font_map_load_font (fontmap, context, desc);
+  g_object_unref (context);
+  pango_font_description_free (desc);
+
+  if (font == NULL)
+    {
+      g_free (s);
+      return NULL;
+    }
+
+  g_hash_table_insert (reader->fonts, s, g_object_ref (font));
+
+  return font;
+}
+
+/* Creates a surface for the pixels in a blob. If the blob is suitably
+ * aligned, the surface uses the data in place and keeps a reference on
+ * the bytes that were loaded.
+ */
+static cairo_surface_t *
+read_surface (GskBinaryReader *reader,
+              GskBinaryData   *d,
+              gboolean        *has_surface)
+{
+  const GskBinaryBlob *blob;
+  cairo_surface_t *surface;
+  guint32 index, width, height, stride;
+  const guchar *pixels;
+
+  index = read_uint (d);
+  *has_surface = index != NO_BLOB;
+  if (index == NO_BLOB)
+    return NULL;
+
+  width = read_uint (d);
+  height = read_uint (d);
+  stride = read_uint (d);
+
+  if (d->error ||
+      index >= reader->header->n_blobs ||
+      width == 0 || height == 0 ||
+      width > G_MAXINT / 4 ||
+      stride < width * 4 || stride % 4 != 0)
+    {
+      d->error = TRUE;
+      return NULL;
+    }
+
+  blob = &reader->blobs[index];
+  if (blob->size / stride < height)
+    {
+      d->error = TRUE;
+      return NULL;
+    }
+
+  pixels = reader->data + blob->offset;
+
+  if (GPOINTER_TO_SIZE (pixels) % 4 == 0 &&
+      stride == cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, width))
+    {
+      surface = cairo_image_surface_create_for_data ((guchar *) pixels,
+                                                     CAIRO_FORMAT_ARGB32,
+                                                     width, height, stride);
+      cairo_surface_set_user_data (surface,
+                                   &gsk_binary_bytes_key,
+                                   g_bytes_ref (reader->bytes),
+                                   (cairo_destroy_func_t) g_bytes_unref);
+    }
+  else
+    {
+      guint y;
+
+      surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+      for (y = 0; y < height; y++)
+        memcpy (cairo_image_surface_get_data (surface) + y * cairo_image_surface_get_stride (surface),
+                pixels + y * stride,
+                width * 4);
+      cairo_surface_mark_dirty (surface);
+    }
+
+  return surface;
+}
+
+static GskRenderNode *
+read_node (GskBinaryReader *reader,
+           guint            i,
+           GError         **error)
+{
+  const GskBinaryNode *entry = &reader->entries[i];
+  GskRenderNode *result = NULL;
+  GskBinaryData d;
+
+  if (entry->offset > reader->header->data_size ||
+      entry->size > reader->header->data_size - entry->offset)
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Node %u is out of bounds", i);
+      return NULL;
+    }
+
+  d.data = reader->data + reader->header->data_offset + entry->offset;
+  d.remaining = entry->size;
+  d.error = FALSE;
+
+  switch (entry->node_type)
+    {
+    case GSK_CONTAINER_NODE:
+      {
+        guint32 j, n = read_uint (&d);
+        GskRenderNode **children;
+
+        if (d.error || n > d.remaining / sizeof (guint32))
+          {
+            d.error = TRUE;
+            break;
+          }
+
+        children = g_new (GskRenderNode *, n);
+        for (j = 0; j < n; j++)
+          children[j] = read_child (reader, &d, i);
+
+        if (!d.error)
+          result = gsk_container_node_new (children, n);
+        g_free (children);
+      }
+      break;
+
+    case GSK_CAIRO_NODE:
+      {
+        cairo_surface_t *surface;
+        graphene_rect_t bounds;
+        gboolean has_surface;
+
+        read_rect (&d, &bounds);
+        surface = read_surface (reader, &d, &has_surface);
+        if (d.error)
+          break;
+
+        if (has_surface)
+          {
+            result = gsk_cairo_node_new_for_surface (&bounds, surface);
+            cairo_surface_destroy (surface);
+          }
+        else
+          {
+            result = gsk_cairo_node_new (&bounds);
+          }
+      }
+      break;
+
+    case GSK_COLOR_NODE:
+      {
+        graphene_rect_t bounds;
+        GdkRGBA color;
+
+        read_rgba (&d, &color);
+        read_rect (&d, &bounds);
+        if (!d.error)
+          result = gsk_color_node_new (&color, &bounds);
+      }
+      break;
+
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+      {
+        graphene_rect_t bounds;
+        graphene_point_t start, end;
+        GskColorStop *stops;
+        guint32 j, n;
+
+        read_rect (&d, &bounds);
+        start.x = read_float (&d);
+        start.y = read_float (&d);
+        end.x = read_float (&d);
+        end.y = read_float (&d);
+        n = read_uint (&d);
+        if (d.error || n > d.remaining / (5 * sizeof (double)))
+          {
+            d.error = TRUE;
+            break;
+          }
+
+        stops = g_new (GskColorStop, n);
+        for (j = 0; j < n; j++)
+          {
+            stops[j].offset = read_double (&d);
+            read_rgba (&d, &stops[j].color);
+          }
+
+        if (d.error)
+          ;
+        else if (entry->node_type == GSK_LINEAR_GRADIENT_NODE)
+          result = gsk_linear_gradient_node_new (&bounds, &start, &end, stops, n);
+        else
+          result = gsk_repeating_linear_gradient_node_new (&bounds, &start, &end, stops, n);
+        g_free (stops);
+      }
+      break;
+
+    case GSK_BORDER_NODE:
+      {
+        GskRoundedRect outline;
+        float widths[4];
+        GdkRGBA colors[4];
+        int j;
+
+        read_rounded_rect (&d, &outline);
+        for (j = 0; j < 4; j++)
+          widths[j] = read_float (&d);
+        for (j = 0; j < 4; j++)
+          read_rgba (&d, &colors[j]);
+        if (!d.error)
+          result = gsk_border_node_new (&outline, widths, colors);
+      }
+      break;
+
+    case GSK_TEXTURE_NODE:
+      {
+        cairo_surface_t *surface;
+        graphene_rect_t bounds;
+        gboolean has_surface;
+        GskTexture *texture;
+
+        read_rect (&d, &bounds);
+        surface = read_surface (reader, &d, &has_surface);
+        if (d.error || !has_surface)
+          {
+            d.error = TRUE;
+            break;
+          }
+
+        texture = gsk_texture_new_for_surface (surface);
+        result = gsk_texture_node_new (texture, &bounds);
+        g_object_unref (texture);
+        cairo_surface_destroy (surface);
+      }
+      break;
+
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+      {
+        GskRoundedRect outline;
+        GdkRGBA color;
+        float dx, dy, spread, blur_radius;
+
+        read_rounded_rect (&d, &outline);
+        read_rgba (&d, &color);
+        dx = read_float (&d);
+        dy = read_float (&d);
+        spread = read_float (&d);
+        blur_radius = read_float (&d);
+
+        if (d.error)
+          ;
+        else if (entry->node_type == GSK_INSET_SHADOW_NODE)
+          result = gsk_inset_shadow_node_new (&outline, &color, dx, dy, spread, blur_radius);
+        else
+          result = gsk_outset_shadow_node_new (&outline, &color, dx, dy, spread, blur_radius);
+      }
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      {
+        GskRenderNode *child = read_child (reader, &d, i);
+        graphene_matrix_t transform;
+
+        read_matrix (&d, &transform);
+        if (!d.error)
+          result = gsk_transform_node_new (child, &transform);
+      }
+      break;
+
+    case GSK_OPACITY_NODE:
+      {
+        GskRenderNode *child = read_child (reader, &d, i);
+        double opacity = read_double (&d);
+
+        if (!d.error)
+          result = gsk_opacity_node_new (child, opacity);
+      }
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      {
+        GskRenderNode *child = read_child (reader, &d, i);
+        graphene_matrix_t matrix;
+        graphene_vec4_t offset;
+        float v[4];
+
+        read_matrix (&d, &matrix);
+        read_data (&d, v, sizeof (v));
+        graphene_vec4_init_from_float (&offset, v);
+        if (!d.error)
+          result = gsk_color_matrix_node_new (child, &matrix, &offset);
+      }
+      break;
+
+    case GSK_REPEAT_NODE:
+      {
+        GskRenderNode *child = read_child (reader, &d, i);
+        graphene_rect_t bounds, child_bounds;
+
+        read_rect (&d, &bounds);
+        read_rect (&d, &child_bounds);
+        if (!d.error)
+          result = gsk_repeat_node_new (&bounds, child, &child_bounds);
+      }
+      break;
+
+    case GSK_CLIP_NODE:
+      {
+        GskRenderNode *child = read_child (reader, &d, i);
+        graphene_rect_t clip;
+
+        read_rect (&d, &clip);
+        if (!d.error)
+          result = gsk_clip_node_new (child, &clip);
+      }
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      {
+        GskRenderNode *child = read_child (reader, &d, i);
+        GskRoundedRect clip;
+
+        read_rounded_rect (&d, &clip);
+        if (!d.error)
+          result = gsk_rounded_clip_node_new (child, &clip);
+      }
+      break;
+
+    case GSK_SHADOW_NODE:
+      {
+        GskRenderNode *child = read_child (reader, &d, i);
+        GskShadow *shadows;
+        guint32 j, n;
+
+        n = read_uint (&d);
+        if (d.error || n > d.remaining / (4 * sizeof (double) + 3 * sizeof (float)))
+          {
+            d.error = TRUE;
+            break;
+          }
+
+        shadows = g_new (GskShadow, n);
+        for (j = 0; j < n; j++)
+          {
+            read_rgba (&d, &shadows[j].color);
+            shadows[j].dx = read_float (&d);
+            shadows[j].dy = read_float (&d);
+            shadows[j].radius = read_float (&d);
+          }
+
+        if (!d.error)
+          result = gsk_shadow_node_new (child, shadows, n);
+        g_free (shadows);
+      }
+      break;
+
+    case GSK_BLEND_NODE:
+      {
+        GskRenderNode *bottom = read_child (reader, &d, i);
+        GskRenderNode *top = read_child (reader, &d, i);
+        guint32 blend_mode = read_uint (&d);
+
+        if (!d.error)
+          result = gsk_blend_node_new (bottom, top, blend_mode);
+      }
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      {
+        GskRenderNode *start = read_child (reader, &d, i);
+        GskRenderNode *end = read_child (reader, &d, i);
+        double progress = read_double (&d);
+
+        if (!d.error)
+          result = gsk_cross_fade_node_new (start, end, progress);
+      }
+      break;
+
+    case GSK_TEXT_NODE:
+      {
+        PangoGlyphString *glyphs;
+        PangoFont *font;
+        GdkRGBA color;
+        float x, y;
+        guint32 j, n;
+
+        font = read_font (reader, &d);
+        if (font == NULL)
+          {
+            if (!d.error)
+              {
+                g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                             "Could not load font for text node");
+                return NULL;
+              }
+            break;
+          }
+
+        read_rgba (&d, &color);
+        x = read_float (&d);
+        y = read_float (&d);
+        n = read_uint (&d);
+        if (d.error || n > d.remaining / (5 * sizeof (guint32)))
+          {
+            d.error = TRUE;
+            g_object_unref (font);
+            break;
+          }
+
+        glyphs = pango_glyph_string_new ();
+        pango_glyph_string_set_size (glyphs, n);
+        for (j = 0; j < n; j++)
+          {
+            glyphs->glyphs[j].glyph = read_uint (&d);
+            glyphs->glyphs[j].geometry.width = (gint32) read_uint (&d);
+            glyphs->glyphs[j].geometry.x_offset = (gint32) read_uint (&d);
+            glyphs->glyphs[j].geometry.y_offset = (gint32) read_uint (&d);
+            glyphs->glyphs[j].attr.is_cluster_start = read_uint (&d);
+          }
+
+        if (!d.error)
+          result = gsk_text_node_new (font, glyphs, &color, x, y);
+
+        pango_glyph_string_free (glyphs);
+        g_object_unref (font);
+      }
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Type %u is not a valid node type", entry->node_type);
+      return NULL;
+    }
+
+  if (d.error || result == NULL)
+    {
+      g_clear_pointer (&result, gsk_render_node_unref);
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Invalid data for node %u", i);
+      return NULL;
+    }
+
+  return result;
+}
+
+/*< private >
+ * gsk_render_node_is_binary:
+ * @bytes: the bytes to check
+ *
+ * Checks if @bytes look like data created by
+ * gsk_render_node_serialize_binary().
+ *
+ * Returns: %TRUE if @bytes start with the binary format's header
+ */
+gboolean
+gsk_render_node_is_binary (GBytes *bytes)
+{
+  gsize size;
+  const guchar *data = g_bytes_get_data (bytes, &size);
+
+  return size >= sizeof (GskBinaryHeader) &&
+         memcmp (data, GSK_BINARY_MAGIC, strlen (GSK_BINARY_MAGIC)) == 0;
+}
+
+/*< private >
+ * gsk_render_node_deserialize_binary:
+ * @bytes: the data created by gsk_render_node_serialize_binary()
+ * @error: (allow-none): location to store error or %NULL
+ *
+ * Loads a node in the binary format. The pixel data of textures and cairo
+ * nodes points directly into @bytes where possible, so the nodes keep
+ * a reference on it.
+ *
+ * Returns: (nullable) (transfer full): a new #GskRenderNode or %NULL on
+ *     error.
+ */
+GskRenderNode *
+gsk_render_node_deserialize_binary (GBytes  *bytes,
+                                    GError **error)
+{
+  GskBinaryReader reader;
+  GskBinaryHeader header;
+  GskRenderNode *result = NULL;
+  guint i;
+
+  reader.bytes = bytes;
+  reader.data = g_bytes_get_data (bytes, &reader.size);
+
+  g_return_val_if_fail (gsk_render_node_is_binary (bytes), NULL);
+
+  /* The header is copied, since the data may not be aligned */
+  memcpy (&header, reader.data, sizeof (header));
+  reader.header = &header;
+
+  if (header.byte_order != GSK_BINARY_BYTE_ORDER)
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_UNSUPPORTED_FORMAT,
+                   "Data was written with a different byte order.");
+      return NULL;
+    }
+
+  if (header.version != GSK_BINARY_VERSION)
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_UNSUPPORTED_VERSION,
+                   "Format version %u not supported.", header.version);
+      return NULL;
+    }
+
+  if (header.n_nodes == 0 ||
+      header.nodes_offset % 8 != 0 ||
+      header.blobs_offset % 8 != 0 ||
+      header.nodes_offset > reader.size ||
+      header.n_nodes > (reader.size - header.nodes_offset) / sizeof (GskBinaryNode) ||
+      header.blobs_offset > reader.size ||
+      header.n_blobs > (reader.size - header.blobs_offset) / sizeof (GskBinaryBlob) ||
+      header.data_offset > reader.size ||
+      header.data_size > reader.size - header.data_offset)
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Invalid header");
+      return NULL;
+    }
+
+  if (GPOINTER_TO_SIZE (reader.data) % 8 != 0)
+    {
+      /* Only happens for bytes that were not loaded from a file */
+      GBytes *copy = g_bytes_new (reader.data, reader.size);
+
+      result = gsk_render_node_deserialize_binary (copy, error);
+      g_bytes_unref (copy);
+
+      return result;
+    }
+
+  reader.entries = (const GskBinaryNode *) (reader.data + header.nodes_offset);
+  reader.blobs = (const GskBinaryBlob *) (reader.data + header.blobs_offset);
+
+  for (i = 0; i < header.n_blobs; i++)
+    {
+      if (reader.blobs[i].offset > reader.size ||
+          reader.blobs[i].size > reader.size - reader.blobs[i].offset)
+        {
+          g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                       "Blob %u is out of bounds", i);
+          return NULL;
+        }
+    }
+
+  reader.nodes = g_new0 (GskRenderNode *, header.n_nodes);
+  reader.fonts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+
+  for (i = 0; i < header.n_nodes; i++)
+    {
+      reader.nodes[i] = read_node (&reader, i, error);
+      if (reader.nodes[i] == NULL)
+        break;
+    }
+
+  if (i == header.n_nodes)
+    result = gsk_render_node_ref (reader.nodes[header.n_nodes - 1]);
+
+  for (i = 0; i < header.n_nodes && reader.nodes[i] != NULL; i++)
+    gsk_render_node_unref (reader.nodes[i]);
+  g_free (reader.nodes);
+  g_hash_table_unref (reader.fonts);
+
+  return result;
+}
@@ -26,6 +26,8 @@
 #include "gskroundedrectprivate.h"
 #include "gsktextureprivate.h"
 
+#include <pango/pangocairo.h>
+
 static gboolean
 check_variant_type (GVariant *variant,
                     const char *type_string,
@@ -42,6 +44,64 @@ check_variant_type (GVariant *variant,
   return TRUE;
 }
 
+static void
+region_union_rect (cairo_region_t        *region,
+                   const graphene_rect_t *rect)
+{
+  cairo_rectangle_int_t int_rect;
+
+  int_rect.x = floor (rect->origin.x);
+  int_rect.y = floor (rect->origin.y);
+  int_rect.width = ceil (rect->origin.x + rect->size.width) - int_rect.x;
+  int_rect.height = ceil (rect->origin.y + rect->size.height) - int_rect.y;
+
+  cairo_region_union_rectangle (region, &int_rect);
+}
+
+/* Sets the opaque area of @node to the whole pixels inside @rect, so
+ * antialiased edges never count as opaque
+ */
+static void
+gsk_render_node_set_opaque (GskRenderNode         *node,
+                            const graphene_rect_t *rect)
+{
+  float x1, y1, x2, y2;
+
+  x1 = ceilf (rect->origin.x);
+  y1 = ceilf (rect->origin.y);
+  x2 = floorf (rect->origin.x + rect->size.width);
+  y2 = floorf (rect->origin.y + rect->size.height);
+
+  if (x2 <= x1 || y2 <= y1)
+    graphene_rect_init_from_rect (&node->opaque, graphene_rect_zero ());
+  else
+    graphene_rect_init (&node->opaque, x1, y1, x2 - x1, y2 - y1);
+}
+
+static float
+rect_area (const graphene_rect_t *rect)
+{
+  return rect->size.width * rect->size.height;
+}
+
+/*< private >
+ * gsk_render_node_diff_impossible:
+ * @node1: a #GskRenderNode
+ * @node2: the #GskRenderNode to compare with
+ * @region: a #cairo_region_t to add the differences to
+ *
+ * Adds the bounds of both nodes to @region; this is the fallback
+ * for nodes that cannot be compared any further.
+ */
+void
+gsk_render_node_diff_impossible (GskRenderNode  *node1,
+                                 GskRenderNode  *node2,
+                                 cairo_region_t *region)
+{
+  region_union_rect (region, &node1->bounds);
+  region_union_rect (region, &node2->bounds);
+}
+
 /*** GSK_COLOR_NODE ***/
 
 typedef struct _GskColorNode GskColorNode;
@@ -103,6 +163,21 @@ gsk_color_node_deserialize (GVariant  *variant,
   return gsk_color_node_new (&color, &GRAPHENE_RECT_INIT (x, y, w, h));
 }
 
+static void
+gsk_color_node_diff (GskRenderNode  *node1,
+                     GskRenderNode  *node2,
+                     cairo_region_t *region)
+{
+  GskColorNode *self1 = (GskColorNode *) node1;
+  GskColorNode *self2 = (GskColorNode *) node2;
+
+  if (graphene_rect_equal (&node1->bounds, &node2->bounds) &&
+      gdk_rgba_equal (&self1->color, &self2->color))
+    return;
+
+  gsk_render_node_diff_impossible (node1, node2, region);
+}
+
 static const GskRenderNodeClass GSK_COLOR_NODE_CLASS = {
   GSK_COLOR_NODE,
   sizeof (GskColorNode),
@@ -111,6 +186,7 @@ static const GskRenderNodeClass GSK_COLOR_NODE_CLASS = {
   gsk_color_node_draw,
   gsk_color_node_serialize,
   gsk_color_node_deserialize,
+  gsk_color_node_diff
 };
 
 const GdkRGBA *
@@ -147,6 +223,9 @@ gsk_color_node_new (const GdkRGBA         *rgba,
   self->color = *rgba;
   graphene_rect_init_from_rect (&self->render_node.bounds, bounds);
 
+  if (rgba->alpha >= 1.0)
+    gsk_render_node_set_opaque (&self->render_node, bounds);
+
   return &self->render_node;
 }
 
@@ -281,6 +360,35 @@ gsk_repeating_linear_gradient_node_deserialize (GVariant  *variant,
   return gsk_linear_gradient_node_real_deserialize (variant, TRUE, error);
 }
 
+static void
+gsk_linear_gradient_node_diff (GskRenderNode  *node1,
+                               GskRenderNode  *node2,
+                               cairo_region_t *region)
+{
+  GskLinearGradientNode *self1 = (GskLinearGradientNode *) node1;
+  GskLinearGradientNode *self2 = (GskLinearGradientNode *) node2;
+  gsize i;
+
+  if (!graphene_rect_equal (&node1->bounds, &node2->bounds) ||
+      !graphene_point_equal (&self1->start, &self2->start) ||
+      !graphene_point_equal (&self1->end, &self2->end) ||
+      self1->n_stops != self2->n_stops)
+    {
+      gsk_render_node_diff_impossible (node1, node2, region);
+      return;
+    }
+
+  for (i = 0; i < self1->n_stops; i++)
+    {
+      if (self1->stops[i].offset != self2->stops[i].offset ||
+          !gdk_rgba_equal (&self1->stops[i].color, &self2->stops[i].color))
+        {
+          gsk_render_node_diff_impossible (node1, node2, region);
+          return;
+        }
+    }
+}
+
 static const GskRenderNodeClass GSK_LINEAR_GRADIENT_NODE_CLASS = {
   GSK_LINEAR_GRADIENT_NODE,
   sizeof (GskLinearGradientNode),
@@ -289,6 +397,7 @@ static const GskRenderNodeClass GSK_LINEAR_GRADIENT_NODE_CLASS = {
   gsk_linear_gradient_node_draw,
   gsk_linear_gradient_node_serialize,
   gsk_linear_gradient_node_deserialize,
+  gsk_linear_gradient_node_diff
 };
 
 static const GskRenderNodeClass GSK_REPEATING_LINEAR_GRADIENT_NODE_CLASS = {
@@ -299,6 +408,7 @@ static const GskRenderNodeClass GSK_REPEATING_LINEAR_GRADIENT_NODE_CLASS = {
   gsk_linear_gradient_node_draw,
   gsk_linear_gradient_node_serialize,
   gsk_repeating_linear_gradient_node_deserialize,
+  gsk_linear_gradient_node_diff
 };
 
 /**
@@ -578,6 +688,32 @@ gsk_border_node_deserialize (GVariant  *variant,
                               colors);
 }
 
+static void
+gsk_border_node_diff (GskRenderNode  *node1,
+                      GskRenderNode  *node2,
+                      cairo_region_t *region)
+{
+  GskBorderNode *self1 = (GskBorderNode *) node1;
+  GskBorderNode *self2 = (GskBorderNode *) node2;
+  guint i;
+
+  if (!gsk_rounded_rect_equal (&self1->outline, &self2->outline))
+    {
+      gsk_render_node_diff_impossible (node1, node2, region);
+      return;
+    }
+
+  for (i = 0; i < 4; i++)
+    {
+      if (self1->border_width[i] != self2->border_width[i] ||
+          !gdk_rgba_equal (&self1->border_color[i], &self2->border_color[i]))
+        {
+          gsk_render_node_diff_impossible (node1, node2, region);
+          return;
+        }
+    }
+}
+
 static const GskRenderNodeClass GSK_BORDER_NODE_CLASS = {
   GSK_BORDER_NODE,
   sizeof (GskBorderNode),
@@ -585,7 +721,8 @@ static const GskRenderNodeClass GSK_BORDER_NODE_CLASS = {
   gsk_border_node_finalize,
   gsk_border_node_draw,
   gsk_border_node_serialize,
-  gsk_border_node_deserialize
+  gsk_border_node_deserialize,
+  gsk_border_node_diff
 };
 
 const GskRoundedRect *
@@ -668,14 +805,43 @@ gsk_texture_node_finalize (GskRenderNode *node)
   g_object_unref (self->texture);
 }
 
+const cairo_user_data_key_t gsk_texture_node_surfaces_key;
+
+/* Intermediate contexts created while drawing a node need to carry
+ * the texture surfaces and scaled fonts of @cr along, or the textures
+ * drawn to them are downloaded again, and their text goes through pango
+ */
+void
+gsk_render_node_copy_draw_data (cairo_t *cr,
+                                cairo_t *derived_cr)
+{
+  GHashTable *table;
+
+  table = cairo_get_user_data (cr, &gsk_texture_node_surfaces_key);
+  if (table)
+    cairo_set_user_data (derived_cr, &gsk_texture_node_surfaces_key, table, NULL);
+
+  table = cairo_get_user_data (cr, &gsk_text_node_scaled_fonts_key);
+  if (table)
+    cairo_set_user_data (derived_cr, &gsk_text_node_scaled_fonts_key, table, NULL);
+}
+
 static void
 gsk_texture_node_draw (GskRenderNode *node,
                        cairo_t       *cr)
 {
   GskTextureNode *self = (GskTextureNode *) node;
-  cairo_surface_t *surface;
+  cairo_surface_t *surface = NULL;
+  GHashTable *surfaces;
 
-  surface = gsk_texture_download_surface (self->texture);
+  surfaces = cairo_get_user_data (cr, &gsk_texture_node_surfaces_key);
+  if (surfaces)
+    surface = g_hash_table_lookup (surfaces, self->texture);
+
+  if (surface)
+    cairo_surface_reference (surface);
+  else
+    surface = gsk_texture_download_surface (self->texture);
 
   cairo_save (cr);
 
@@ -730,6 +896,7 @@ gsk_texture_node_deserialize (GVariant  *variant,
   double bounds[4];
   guint32 width, height;
   GVariant *pixel_variant;
+  GBytes *bytes;
   gsize n_pixels;
 
   if (!check_variant_type (variant, GSK_TEXTURE_NODE_VARIANT_TYPE, error))
@@ -739,9 +906,30 @@ gsk_texture_node_deserialize (GVariant  *variant,
                  &bounds[0], &bounds[1], &bounds[2], &bounds[3],
                  &width, &height, &pixel_variant);
 
-  /* XXX: Make this work without copying the data */
-  texture = gsk_texture_new_for_data (g_variant_get_fixed_array (pixel_variant, &n_pixels, sizeof (guint32)),
-                                      width, height, width * 4);
+  /* Textures can't be empty, and the stride has to fit in an int */
+  if (width == 0 || height == 0 ||
+      width > G_MAXINT / 4 || height > G_MAXINT / (width * 4))
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Invalid texture size %ux%u", width, height);
+      g_variant_unref (pixel_variant);
+      return NULL;
+    }
+
+  g_variant_get_fixed_array (pixel_variant, &n_pixels, sizeof (guint32));
+  if (n_pixels != (gsize) width * height)
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Expected %u pixels for a %ux%u texture, got %" G_GSIZE_FORMAT,
+                   width * height, width, height, n_pixels);
+      g_variant_unref (pixel_variant);
+      return NULL;
+    }
+
+  /* The texture keeps the variant's data alive */
+  bytes = g_variant_get_data_as_bytes (pixel_variant);
+  texture = gsk_texture_new_for_bytes (bytes, width, height, width * 4);
+  g_bytes_unref (bytes);
   g_variant_unref (pixel_variant);
 
   node = gsk_texture_node_new (texture, &GRAPHENE_RECT_INIT(bounds[0], bounds[1], bounds[2], bounds[3]));
@@ -751,6 +939,21 @@ gsk_texture_node_deserialize (GVariant  *variant,
   return node;
 }
 
+static void
+gsk_texture_node_diff (GskRenderNode  *node1,
+                       GskRenderNode  *node2,
+                       cairo_region_t *region)
+{
+  GskTextureNode *self1 = (GskTextureNode *) node1;
+  GskTextureNode *self2 = (GskTextureNode *) node2;
+
+  if (graphene_rect_equal (&node1->bounds, &node2->bounds) &&
+      self1->texture == self2->texture)
+    return;
+
+  gsk_render_node_diff_impossible (node1, node2, region);
+}
+
 static const GskRenderNodeClass GSK_TEXTURE_NODE_CLASS = {
   GSK_TEXTURE_NODE,
   sizeof (GskTextureNode),
@@ -758,7 +961,8 @@ static const GskRenderNodeClass GSK_TEXTURE_NODE_CLASS = {
   gsk_texture_node_finalize,
   gsk_texture_node_draw,
   gsk_texture_node_serialize,
-  gsk_texture_node_deserialize
+  gsk_texture_node_deserialize,
+  gsk_texture_node_diff
 };
 
 GskTexture *
@@ -797,6 +1001,20 @@ gsk_texture_node_new (GskTexture            *texture,
   self->texture = g_object_ref (texture);
   graphene_rect_init_from_rect (&self->render_node.bounds, bounds);
 
+  if (gsk_texture_is_opaque (texture))
+    {
+      graphene_rect_t opaque = *bounds;
+
+      /* Filtering can blend the edges of a scaled texture with
+       * transparency
+       */
+      if (bounds->size.width != gsk_texture_get_width (texture) ||
+          bounds->size.height != gsk_texture_get_height (texture))
+        graphene_rect_inset (&opaque, 1, 1);
+
+      gsk_render_node_set_opaque (&self->render_node, &opaque);
+    }
+
   return &self->render_node;
 }
 
@@ -865,11 +1083,6 @@ draw_shadow (cairo_t             *cr,
     gsk_cairo_blur_finish_drawing (shadow_cr, radius, color, blur_flags);
 }
 
-typedef struct {
-  float radius;
-  graphene_size_t corner;
-} CornerMask;
-
 typedef enum {
   TOP,
   RIGHT,
@@ -877,24 +1090,6 @@ typedef enum {
   LEFT
 } Side;
 
-static guint
-corner_mask_hash (CornerMask *mask)
-{
-  return ((guint)mask->radius << 24) ^
-    ((guint)(mask->corner.width*4)) << 12 ^
-    ((guint)(mask->corner.height*4)) << 0;
-}
-
-static gboolean
-corner_mask_equal (CornerMask *mask1,
-                   CornerMask *mask2)
-{
-  return
-    mask1->radius == mask2->radius &&
-    mask1->corner.width == mask2->corner.width &&
-    mask1->corner.height == mask2->corner.height;
-}
-
 static void
 draw_shadow_corner (cairo_t               *cr,
                     gboolean               inset,
@@ -906,65 +1101,30 @@ draw_shadow_corner (cairo_t               *cr,
                     cairo_rectangle_int_t *drawn_rect)
 {
   float clip_radius;
-  int x1, x2, x3, y1, y2, y3, x, y;
-  GskRoundedRect corner_box;
-  cairo_t *mask_cr;
-  cairo_surface_t *mask;
-  cairo_pattern_t *pattern;
-  cairo_matrix_t matrix;
-  float sx, sy;
-  static GHashTable *corner_mask_cache = NULL;
-  float max_other;
-  CornerMask key;
-  gboolean overlapped;
+  int x1, x2, y1, y2;
 
   clip_radius = gsk_cairo_blur_compute_pixels (radius);
 
-  overlapped = FALSE;
   if (corner == GSK_CORNER_TOP_LEFT || corner == GSK_CORNER_BOTTOM_LEFT)
     {
       x1 = floor (box->bounds.origin.x - clip_radius);
       x2 = ceil (box->bounds.origin.x + box->corner[corner].width + clip_radius);
-      x = x1;
-      sx = 1;
-      max_other = MAX(box->corner[GSK_CORNER_TOP_RIGHT].width, box->corner[GSK_CORNER_BOTTOM_RIGHT].width);
-      x3 = floor (box->bounds.origin.x + box->bounds.size.width - max_other - clip_radius);
-      if (x2 > x3)
-        overlapped = TRUE;
     }
   else
     {
       x1 = floor (box->bounds.origin.x + box->bounds.size.width - box->corner[corner].width - clip_radius);
       x2 = ceil (box->bounds.origin.x + box->bounds.size.width + clip_radius);
-      x = x2;
-      sx = -1;
-      max_other = MAX(box->corner[GSK_CORNER_TOP_LEFT].width, box->corner[GSK_CORNER_BOTTOM_LEFT].width);
-      x3 = ceil (box->bounds.origin.x + max_other + clip_radius);
-      if (x3 > x1)
-        overlapped = TRUE;
     }
 
   if (corner == GSK_CORNER_TOP_LEFT || corner == GSK_CORNER_TOP_RIGHT)
     {
       y1 = floor (box->bounds.origin.y - clip_radius);
       y2 = ceil (box->bounds.origin.y + box->corner[corner].height + clip_radius);
-      y = y1;
-      sy = 1;
-      max_other = MAX(box->corner[GSK_CORNER_BOTTOM_LEFT].height, box->corner[GSK_CORNER_BOTTOM_RIGHT].height);
-      y3 = floor (box->bounds.origin.y + box->bounds.size.height - max_other - clip_radius);
-      if (y2 > y3)
-        overlapped = TRUE;
     }
   else
     {
       y1 = floor (box->bounds.origin.y + box->bounds.size.height - box->corner[corner].height - clip_radius);
       y2 = ceil (box->bounds.origin.y + box->bounds.size.height + clip_radius);
-      y = y2;
-      sy = -1;
-      max_other = MAX(box->corner[GSK_CORNER_TOP_LEFT].height, box->corner[GSK_CORNER_TOP_RIGHT].height);
-      y3 = ceil (box->bounds.origin.y + max_other + clip_radius);
-      if (y3 > y1)
-        overlapped = TRUE;
     }
 
   drawn_rect->x = x1;
@@ -975,64 +1135,11 @@ draw_shadow_corner (cairo_t               *cr,
   cairo_rectangle (cr, x1, y1, x2 - x1, y2 - y1);
   cairo_clip (cr);
 
-  if (inset || overlapped)
-    {
-      /* Fall back to generic path if inset or if the corner radius
-         runs into each other */
-      draw_shadow (cr, inset, box, clip_box, radius, color, GSK_BLUR_X | GSK_BLUR_Y);
-      return;
-    }
-
-  if (has_empty_clip (cr))
-    return;
-
-  /* At this point we're drawing a blurred outset corner. The only
-   * things that affect the output of the blurred mask in this case
-   * is:
-   *
-   * What corner this is, which defines the orientation (sx,sy)
-   * and position (x,y)
-   *
-   * The blur radius (which also defines the clip_radius)
-   *
-   * The the horizontal and vertical corner radius
-   *
-   * We apply the first position and orientation when drawing the
-   * mask, so we cache rendered masks based on the blur radius and the
-   * corner radius.
+  /* Boxes with long enough sides are drawn from cached slices by
+   * gsk_cairo_blur_fill_rounded_rect(), so we only get here if the
+   * corners run into each other
    */
-  if (corner_mask_cache == NULL)
-    corner_mask_cache = g_hash_table_new_full ((GHashFunc)corner_mask_hash,
-                                               (GEqualFunc)corner_mask_equal,
-                                               g_free, (GDestroyNotify)cairo_surface_destroy);
-
-  key.radius = radius;
-  key.corner = box->corner[corner];
-
-  mask = g_hash_table_lookup (corner_mask_cache, &key);
-  if (mask == NULL)
-    {
-      mask = cairo_surface_create_similar_image (cairo_get_target (cr), CAIRO_FORMAT_A8,
-                                                 drawn_rect->width + clip_radius,
-                                                 drawn_rect->height + clip_radius);
-      mask_cr = cairo_create (mask);
-      gsk_rounded_rect_init_from_rect (&corner_box, &GRAPHENE_RECT_INIT (clip_radius, clip_radius, 2*drawn_rect->width, 2*drawn_rect->height), 0);
-      corner_box.corner[0] = box->corner[corner];
-      gsk_rounded_rect_path (&corner_box, mask_cr);
-      cairo_fill (mask_cr);
-      gsk_cairo_blur_surface (mask, radius, GSK_BLUR_X | GSK_BLUR_Y);
-      cairo_destroy (mask_cr);
-      g_hash_table_insert (corner_mask_cache, g_memdup (&key, sizeof (key)), mask);
-    }
-
-  gdk_cairo_set_source_rgba (cr, color);
-  pattern = cairo_pattern_create_for_surface (mask);
-  cairo_matrix_init_identity (&matrix);
-  cairo_matrix_scale (&matrix, sx, sy);
-  cairo_matrix_translate (&matrix, -x, -y);
-  cairo_pattern_set_matrix (pattern, &matrix);
-  cairo_mask (cr, pattern);
-  cairo_pattern_destroy (pattern);
+  draw_shadow (cr, inset, box, clip_box, radius, color, GSK_BLUR_X | GSK_BLUR_Y);
 }
 
 static void
@@ -1139,7 +1246,7 @@ gsk_inset_shadow_node_draw (GskRenderNode *node,
 
   if (!needs_blur (self->blur_radius))
     draw_shadow (cr, TRUE, &box, &clip_box, self->blur_radius, &self->color, GSK_BLUR_NONE);
-  else
+  else if (!gsk_cairo_blur_fill_rounded_rect (cr, &box, self->blur_radius, &self->color, TRUE))
     {
       cairo_region_t *remaining;
       cairo_rectangle_int_t r;
@@ -1253,6 +1360,25 @@ gsk_inset_shadow_node_deserialize (GVariant  *variant,
                                     &color, dx, dy, spread, radius);
 }
 
+static void
+gsk_inset_shadow_node_diff (GskRenderNode  *node1,
+                            GskRenderNode  *node2,
+                            cairo_region_t *region)
+{
+  GskInsetShadowNode *self1 = (GskInsetShadowNode *) node1;
+  GskInsetShadowNode *self2 = (GskInsetShadowNode *) node2;
+
+  if (gsk_rounded_rect_equal (&self1->outline, &self2->outline) &&
+      gdk_rgba_equal (&self1->color, &self2->color) &&
+      self1->dx == self2->dx &&
+      self1->dy == self2->dy &&
+      self1->spread == self2->spread &&
+      self1->blur_radius == self2->blur_radius)
+    return;
+
+  gsk_render_node_diff_impossible (node1, node2, region);
+}
+
 static const GskRenderNodeClass GSK_INSET_SHADOW_NODE_CLASS = {
   GSK_INSET_SHADOW_NODE,
   sizeof (GskInsetShadowNode),
@@ -1260,7 +1386,8 @@ static const GskRenderNodeClass GSK_INSET_SHADOW_NODE_CLASS = {
   gsk_inset_shadow_node_finalize,
   gsk_inset_shadow_node_draw,
   gsk_inset_shadow_node_serialize,
-  gsk_inset_shadow_node_deserialize
+  gsk_inset_shadow_node_deserialize,
+  gsk_inset_shadow_node_diff
 };
 
 /**
@@ -1443,7 +1570,7 @@ gsk_outset_shadow_node_draw (GskRenderNode *node,
 
   if (!needs_blur (self->blur_radius))
     draw_shadow (cr, FALSE, &box, &clip_box, self->blur_radius, &self->color, GSK_BLUR_NONE);
-  else
+  else if (!gsk_cairo_blur_fill_rounded_rect (cr, &box, self->blur_radius, &self->color, FALSE))
     {
       int i;
       cairo_region_t *remaining;
@@ -1556,6 +1683,25 @@ gsk_outset_shadow_node_deserialize (GVariant  *variant,
                                      &color, dx, dy, spread, radius);
 }
 
+static void
+gsk_outset_shadow_node_diff (GskRenderNode  *node1,
+                             GskRenderNode  *node2,
+                             cairo_region_t *region)
+{
+  GskOutsetShadowNode *self1 = (GskOutsetShadowNode *) node1;
+  GskOutsetShadowNode *self2 = (GskOutsetShadowNode *) node2;
+
+  if (gsk_rounded_rect_equal (&self1->outline, &self2->outline) &&
+      gdk_rgba_equal (&self1->color, &self2->color) &&
+      self1->dx == self2->dx &&
+      self1->dy == self2->dy &&
+      self1->spread == self2->spread &&
+      self1->blur_radius == self2->blur_radius)
+    return;
+
+  gsk_render_node_diff_impossible (node1, node2, region);
+}
+
 static const GskRenderNodeClass GSK_OUTSET_SHADOW_NODE_CLASS = {
   GSK_OUTSET_SHADOW_NODE,
   sizeof (GskOutsetShadowNode),
@@ -1563,7 +1709,8 @@ static const GskRenderNodeClass GSK_OUTSET_SHADOW_NODE_CLASS = {
   gsk_outset_shadow_node_finalize,
   gsk_outset_shadow_node_draw,
   gsk_outset_shadow_node_serialize,
-  gsk_outset_shadow_node_deserialize
+  gsk_outset_shadow_node_deserialize,
+  gsk_outset_shadow_node_diff
 };
 
 /**
@@ -1789,6 +1936,24 @@ gsk_cairo_node_deserialize (GVariant  *variant,
   return result;
 }
 
+/* The contents of the surfaces are not compared; widgets
+ * drawing with cairo get a new surface in every frame
+ */
+static void
+gsk_cairo_node_diff (GskRenderNode  *node1,
+                     GskRenderNode  *node2,
+                     cairo_region_t *region)
+{
+  GskCairoNode *self1 = (GskCairoNode *) node1;
+  GskCairoNode *self2 = (GskCairoNode *) node2;
+
+  if (graphene_rect_equal (&node1->bounds, &node2->bounds) &&
+      self1->surface == self2->surface)
+    return;
+
+  gsk_render_node_diff_impossible (node1, node2, region);
+}
+
 static const GskRenderNodeClass GSK_CAIRO_NODE_CLASS = {
   GSK_CAIRO_NODE,
   sizeof (GskCairoNode),
@@ -1796,7 +1961,8 @@ static const GskRenderNodeClass GSK_CAIRO_NODE_CLASS = {
   gsk_cairo_node_finalize,
   gsk_cairo_node_draw,
   gsk_cairo_node_serialize,
-  gsk_cairo_node_deserialize
+  gsk_cairo_node_deserialize,
+  gsk_cairo_node_diff
 };
 
 /*< private >
@@ -1841,6 +2007,13 @@ gsk_cairo_node_new_for_surface (const graphene_rect_t *bounds,
  * into the area given by @bounds. You can draw to the cairo
  * surface using gsk_cairo_node_get_draw_context()
  *
+ * Renderers may draw the node from several threads at once. Once the
+ * node is handed to a renderer, the surface must no longer be drawn
+ * to, so destroy the context returned by gsk_cairo_node_get_draw_context()
+ * before that. Only image surfaces are safe to read from several threads;
+ * nodes with other surfaces are always drawn on the thread calling
+ * gsk_renderer_render().
+ *
  * Returns: A new #GskRenderNode
  *
  * Since: 3.90
@@ -1951,6 +2124,9 @@ struct _GskContainerNode
 {
   GskRenderNode render_node;
 
+  /* Points behind the children, one entry per child */
+  graphene_rect_t *visible_bounds;
+
   guint n_children;
   GskRenderNode *children[];
 };
@@ -1965,16 +2141,76 @@ gsk_container_node_finalize (GskRenderNode *node)
     gsk_render_node_unref (container->children[i]);
 }
 
+/* Clipping is only exact when node space edges land on device pixels,
+ * otherwise the antialiased clip edges show up as seams
+ */
+static gboolean
+gsk_container_node_can_clip (cairo_t *cr)
+{
+  cairo_matrix_t ctm;
+
+  cairo_get_matrix (cr, &ctm);
+
+  return ctm.xx == 1.0 && ctm.yy == 1.0 &&
+         ctm.xy == 0.0 && ctm.yx == 0.0 &&
+         ctm.x0 == floor (ctm.x0) && ctm.y0 == floor (ctm.y0);
+}
+
 static void
 gsk_container_node_draw (GskRenderNode *node,
                          cairo_t       *cr)
 {
   GskContainerNode *container = (GskContainerNode *) node;
-  guint i;
+  graphene_rect_t clip;
+  double x1, y1, x2, y2;
+  gboolean can_clip;
+  guint i, start;
 
-  for (i = 0; i < container->n_children; i++)
+  if (GSK_RENDER_MODE_CHECK (GEOMETRY))
+    {
+      for (i = 0; i < container->n_children; i++)
+        gsk_render_node_draw (container->children[i], cr);
+      return;
+    }
+
+  /* Nothing below a child that covers all that is visible
+   * needs to be drawn
+   */
+  cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+  graphene_rect_init (&clip, x1, y1, x2 - x1, y2 - y1);
+  for (start = container->n_children; start > 0; start--)
+    {
+      if (graphene_rect_contains_rect (&container->children[start - 1]->opaque, &clip))
+        break;
+    }
+  if (start > 0)
+    start--;
+
+  can_clip = gsk_container_node_can_clip (cr);
+
+  for (i = start; i < container->n_children; i++)
     {
-      gsk_render_node_draw (container->children[i], cr);
+      GskRenderNode *child = container->children[i];
+      const graphene_rect_t *visible = &container->visible_bounds[i];
+
+      if (visible->size.width <= 0 || visible->size.height <= 0)
+        {
+          GSK_NOTE (CAIRO, g_print ("Culling occluded node %s[%p]\n", child->name, child));
+          continue;
+        }
+
+      if (!can_clip || graphene_rect_equal (visible, &child->bounds))
+        {
+          gsk_render_node_draw (child, cr);
+        }
+      else
+        {
+          cairo_save (cr);
+          cairo_rectangle (cr, visible->origin.x, visible->origin.y, visible->size.width, visible->size.height);
+          cairo_clip (cr);
+          gsk_render_node_draw (child, cr);
+          cairo_restore (cr);
+        }
     }
 }
 
@@ -1995,6 +2231,70 @@ gsk_container_node_get_bounds (GskContainerNode *container,
     graphene_rect_union (bounds, &container->children[i]->bounds, bounds);
 }
 
+/* Removes the part of @rect that @occluder covers, as long as the
+ * rest is still a rectangle
+ */
+static void
+rect_subtract (graphene_rect_t       *rect,
+               const graphene_rect_t *occluder)
+{
+  float x1, y1, x2, y2;
+  float ox1, oy1, ox2, oy2;
+
+  x1 = rect->origin.x;
+  y1 = rect->origin.y;
+  x2 = x1 + rect->size.width;
+  y2 = y1 + rect->size.height;
+  ox1 = occluder->origin.x;
+  oy1 = occluder->origin.y;
+  ox2 = ox1 + occluder->size.width;
+  oy2 = oy1 + occluder->size.height;
+
+  if (ox1 <= x1 && ox2 >= x2)
+    {
+      if (oy1 <= y1 && oy2 > y1)
+        y1 = MIN (oy2, y2);
+      else if (oy1 < y2 && oy2 >= y2)
+        y2 = MAX (oy1, y1);
+    }
+  else if (oy1 <= y1 && oy2 >= y2)
+    {
+      if (ox1 <= x1 && ox2 > x1)
+        x1 = MIN (ox2, x2);
+      else if (ox1 < x2 && ox2 >= x2)
+        x2 = MAX (ox1, x1);
+    }
+
+  graphene_rect_init (rect, x1, y1, x2 - x1, y2 - y1);
+}
+
+/* Walks the children from the top down, keeping the largest opaque
+ * area seen so far, and records which part of each child can still be
+ * seen. Children hidden behind it get empty visible bounds.
+ */
+static void
+gsk_container_node_compute_occlusion (GskContainerNode *container)
+{
+  graphene_rect_t occluder;
+  guint i;
+
+  graphene_rect_init_from_rect (&occluder, graphene_rect_zero ());
+
+  for (i = container->n_children; i-- > 0; )
+    {
+      GskRenderNode *child = container->children[i];
+
+      graphene_rect_init_from_rect (&container->visible_bounds[i], &child->bounds);
+      if (occluder.size.width > 0)
+        rect_subtract (&container->visible_bounds[i], &occluder);
+
+      if (rect_area (&child->opaque) > rect_area (&occluder))
+        occluder = child->opaque;
+    }
+
+  graphene_rect_init_from_rect (&container->render_node.opaque, &occluder);
+}
+
 #define GSK_CONTAINER_NODE_VARIANT_TYPE "a(uv)"
 
 static GVariant *
@@ -2055,6 +2355,60 @@ gsk_container_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static gboolean
+gsk_container_node_children_match (GskRenderNode *child1,
+                                   GskRenderNode *child2)
+{
+  return child1 == child2 ||
+         (child1->node_class == child2->node_class &&
+          graphene_rect_equal (&child1->bounds, &child2->bounds));
+}
+
+/* Children are paired up from both ends of the lists for as long as
+ * they look alike, which finds single insertions and removals; the
+ * unpaired children in the middle are damaged as a whole
+ */
+static void
+gsk_container_node_diff (GskRenderNode  *node1,
+                         GskRenderNode  *node2,
+                         cairo_region_t *region)
+{
+  GskContainerNode *self1 = (GskContainerNode *) node1;
+  GskContainerNode *self2 = (GskContainerNode *) node2;
+  guint start, end1, end2, i;
+
+  start = 0;
+  while (start < self1->n_children && start < self2->n_children &&
+         gsk_container_node_children_match (self1->children[start], self2->children[start]))
+    {
+      gsk_render_node_diff (self1->children[start], self2->children[start], region);
+      start++;
+    }
+
+  end1 = self1->n_children;
+  end2 = self2->n_children;
+  while (end1 > start && end2 > start &&
+         gsk_container_node_children_match (self1->children[end1 - 1], self2->children[end2 - 1]))
+    {
+      gsk_render_node_diff (self1->children[end1 - 1], self2->children[end2 - 1], region);
+      end1--;
+      end2--;
+    }
+
+  /* Children that were replaced in place are still worth comparing */
+  if (end1 - start == end2 - start)
+    {
+      for (i = start; i < end1; i++)
+        gsk_render_node_diff (self1->children[i], self2->children[i], region);
+      return;
+    }
+
+  for (i = start; i < end1; i++)
+    region_union_rect (region, &self1->children[i]->bounds);
+  for (i = start; i < end2; i++)
+    region_union_rect (region, &self2->children[i]->bounds);
+}
+
 static const GskRenderNodeClass GSK_CONTAINER_NODE_CLASS = {
   GSK_CONTAINER_NODE,
   sizeof (GskContainerNode),
@@ -2062,7 +2416,8 @@ static const GskRenderNodeClass GSK_CONTAINER_NODE_CLASS = {
   gsk_container_node_finalize,
   gsk_container_node_draw,
   gsk_container_node_serialize,
-  gsk_container_node_deserialize
+  gsk_container_node_deserialize,
+  gsk_container_node_diff
 };
 
 /**
@@ -2084,14 +2439,17 @@ gsk_container_node_new (GskRenderNode **children,
   GskContainerNode *container;
   guint i;
 
-  container = (GskContainerNode *) gsk_render_node_new (&GSK_CONTAINER_NODE_CLASS, sizeof (GskRenderNode *) * n_children);
+  container = (GskContainerNode *) gsk_render_node_new (&GSK_CONTAINER_NODE_CLASS,
+                                                        (sizeof (GskRenderNode *) + sizeof (graphene_rect_t)) * n_children);
 
   container->n_children = n_children;
+  container->visible_bounds = (graphene_rect_t *) &container->children[n_children];
 
   for (i = 0; i < container->n_children; i++)
     container->children[i] = gsk_render_node_ref (children[i]);
 
   gsk_container_node_get_bounds (container, &container->render_node.bounds);
+  gsk_container_node_compute_occlusion (container);
 
   return &container->render_node;
 }
@@ -2128,6 +2486,30 @@ gsk_container_node_get_child (GskRenderNode *node,
   return container->children[idx];
 }
 
+/*< private >
+ * gsk_container_node_peek_visible_bounds:
+ * @node: a container #GskRenderNode
+ * @idx: the position of the child
+ *
+ * Retrieves the part of the child at @idx that is not hidden by the
+ * opaque area of a child above it. If the result is empty, the child
+ * does not need to be drawn; if it is smaller than the child's bounds,
+ * it may be drawn with that as its clip.
+ *
+ * Returns: the visible bounds of the child
+ */
+const graphene_rect_t *
+gsk_container_node_peek_visible_bounds (GskRenderNode *node,
+                                        guint          idx)
+{
+  GskContainerNode *container = (GskContainerNode *) node;
+
+  g_return_val_if_fail (GSK_IS_RENDER_NODE_TYPE (node, GSK_CONTAINER_NODE), NULL);
+  g_return_val_if_fail (idx < container->n_children, NULL);
+
+  return &container->visible_bounds[idx];
+}
+
 /*** GSK_TRANSFORM_NODE ***/
 
 typedef struct _GskTransformNode GskTransformNode;
@@ -2233,6 +2615,40 @@ gsk_transform_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static void
+gsk_transform_node_diff (GskRenderNode  *node1,
+                         GskRenderNode  *node2,
+                         cairo_region_t *region)
+{
+  GskTransformNode *self1 = (GskTransformNode *) node1;
+  GskTransformNode *self2 = (GskTransformNode *) node2;
+  cairo_region_t *sub;
+  int i;
+
+  if (memcmp (&self1->transform, &self2->transform, sizeof (graphene_matrix_t)) != 0)
+    {
+      gsk_render_node_diff_impossible (node1, node2, region);
+      return;
+    }
+
+  sub = cairo_region_create ();
+  gsk_render_node_diff (self1->child, self2->child, sub);
+
+  for (i = 0; i < cairo_region_num_rectangles (sub); i++)
+    {
+      cairo_rectangle_int_t rect;
+      graphene_rect_t bounds;
+
+      cairo_region_get_rectangle (sub, i, &rect);
+      graphene_matrix_transform_bounds (&self1->transform,
+                                        &GRAPHENE_RECT_INIT (rect.x, rect.y, rect.width, rect.height),
+                                        &bounds);
+      region_union_rect (region, &bounds);
+    }
+
+  cairo_region_destroy (sub);
+}
+
 static const GskRenderNodeClass GSK_TRANSFORM_NODE_CLASS = {
   GSK_TRANSFORM_NODE,
   sizeof (GskTransformNode),
@@ -2240,7 +2656,8 @@ static const GskRenderNodeClass GSK_TRANSFORM_NODE_CLASS = {
   gsk_transform_node_finalize,
   gsk_transform_node_draw,
   gsk_transform_node_serialize,
-  gsk_transform_node_deserialize
+  gsk_transform_node_deserialize,
+  gsk_transform_node_diff
 };
 
 /**
@@ -2272,6 +2689,22 @@ gsk_transform_node_new (GskRenderNode           *child,
   graphene_matrix_transform_bounds (&self->transform,
                                     &child->bounds,
                                     &self->render_node.bounds);
+
+  /* Only translations keep the opaque area a rectangle */
+  if (child->opaque.size.width > 0)
+    {
+      double xx, yx, xy, yy, dx, dy;
+
+      if (graphene_matrix_to_2d (&self->transform, &xx, &yx, &xy, &yy, &dx, &dy) &&
+          xx == 1.0 && yy == 1.0 && xy == 0.0 && yx == 0.0)
+        {
+          graphene_rect_t opaque;
+
+          graphene_rect_offset_r (&child->opaque, dx, dy, &opaque);
+          gsk_render_node_set_opaque (&self->render_node, &opaque);
+        }
+    }
+
   return &self->render_node;
 }
 
@@ -2389,6 +2822,20 @@ gsk_opacity_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static void
+gsk_opacity_node_diff (GskRenderNode  *node1,
+                       GskRenderNode  *node2,
+                       cairo_region_t *region)
+{
+  GskOpacityNode *self1 = (GskOpacityNode *) node1;
+  GskOpacityNode *self2 = (GskOpacityNode *) node2;
+
+  if (self1->opacity == self2->opacity)
+    gsk_render_node_diff (self1->child, self2->child, region);
+  else
+    gsk_render_node_diff_impossible (node1, node2, region);
+}
+
 static const GskRenderNodeClass GSK_OPACITY_NODE_CLASS = {
   GSK_OPACITY_NODE,
   sizeof (GskOpacityNode),
@@ -2396,7 +2843,8 @@ static const GskRenderNodeClass GSK_OPACITY_NODE_CLASS = {
   gsk_opacity_node_finalize,
   gsk_opacity_node_draw,
   gsk_opacity_node_serialize,
-  gsk_opacity_node_deserialize
+  gsk_opacity_node_deserialize,
+  gsk_opacity_node_diff
 };
 
 /**
@@ -2626,6 +3074,21 @@ gsk_color_matrix_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static void
+gsk_color_matrix_node_diff (GskRenderNode  *node1,
+                            GskRenderNode  *node2,
+                            cairo_region_t *region)
+{
+  GskColorMatrixNode *self1 = (GskColorMatrixNode *) node1;
+  GskColorMatrixNode *self2 = (GskColorMatrixNode *) node2;
+
+  if (memcmp (&self1->color_matrix, &self2->color_matrix, sizeof (graphene_matrix_t)) == 0 &&
+      graphene_vec4_equal (&self1->color_offset, &self2->color_offset))
+    gsk_render_node_diff (self1->child, self2->child, region);
+  else
+    gsk_render_node_diff_impossible (node1, node2, region);
+}
+
 static const GskRenderNodeClass GSK_COLOR_MATRIX_NODE_CLASS = {
   GSK_COLOR_MATRIX_NODE,
   sizeof (GskColorMatrixNode),
@@ -2633,7 +3096,8 @@ static const GskRenderNodeClass GSK_COLOR_MATRIX_NODE_CLASS = {
   gsk_color_matrix_node_finalize,
   gsk_color_matrix_node_draw,
   gsk_color_matrix_node_serialize,
-  gsk_color_matrix_node_deserialize
+  gsk_color_matrix_node_deserialize,
+  gsk_color_matrix_node_diff
 };
 
 /**
@@ -2737,6 +3201,7 @@ gsk_repeat_node_draw (GskRenderNode *node,
                                           ceilf (self->child_bounds.size.width),
                                           ceilf (self->child_bounds.size.height));
   surface_cr = cairo_create (surface);
+  gsk_render_node_copy_draw_data (cr, surface_cr);
   cairo_translate (surface_cr,
                    - self->child_bounds.origin.x,
                    - self->child_bounds.origin.y);
@@ -2808,6 +3273,32 @@ gsk_repeat_node_deserialize (GVariant  *variant,
   return result;
 }
 
+/* A change anywhere in the child shows up in every repetition */
+static void
+gsk_repeat_node_diff (GskRenderNode  *node1,
+                      GskRenderNode  *node2,
+                      cairo_region_t *region)
+{
+  GskRepeatNode *self1 = (GskRepeatNode *) node1;
+  GskRepeatNode *self2 = (GskRepeatNode *) node2;
+  cairo_region_t *sub;
+
+  if (graphene_rect_equal (&node1->bounds, &node2->bounds) &&
+      graphene_rect_equal (&self1->child_bounds, &self2->child_bounds))
+    {
+      sub = cairo_region_create ();
+      gsk_render_node_diff (self1->child, self2->child, sub);
+      if (cairo_region_is_empty (sub))
+        {
+          cairo_region_destroy (sub);
+          return;
+        }
+      cairo_region_destroy (sub);
+    }
+
+  gsk_render_node_diff_impossible (node1, node2, region);
+}
+
 static const GskRenderNodeClass GSK_REPEAT_NODE_CLASS = {
   GSK_REPEAT_NODE,
   sizeof (GskRepeatNode),
@@ -2815,7 +3306,8 @@ static const GskRenderNodeClass GSK_REPEAT_NODE_CLASS = {
   gsk_repeat_node_finalize,
   gsk_repeat_node_draw,
   gsk_repeat_node_serialize,
-  gsk_repeat_node_deserialize
+  gsk_repeat_node_deserialize,
+  gsk_repeat_node_diff
 };
 
 /**
@@ -2955,6 +3447,35 @@ gsk_clip_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static void
+gsk_clip_node_diff (GskRenderNode  *node1,
+                    GskRenderNode  *node2,
+                    cairo_region_t *region)
+{
+  GskClipNode *self1 = (GskClipNode *) node1;
+  GskClipNode *self2 = (GskClipNode *) node2;
+  cairo_region_t *sub;
+  cairo_rectangle_int_t clip_rect;
+
+  if (!graphene_rect_equal (&self1->clip, &self2->clip))
+    {
+      gsk_render_node_diff_impossible (node1, node2, region);
+      return;
+    }
+
+  sub = cairo_region_create ();
+  gsk_render_node_diff (self1->child, self2->child, sub);
+
+  clip_rect.x = floor (self1->clip.origin.x);
+  clip_rect.y = floor (self1->clip.origin.y);
+  clip_rect.width = ceil (self1->clip.origin.x + self1->clip.size.width) - clip_rect.x;
+  clip_rect.height = ceil (self1->clip.origin.y + self1->clip.size.height) - clip_rect.y;
+  cairo_region_intersect_rectangle (sub, &clip_rect);
+
+  cairo_region_union (region, sub);
+  cairo_region_destroy (sub);
+}
+
 static const GskRenderNodeClass GSK_CLIP_NODE_CLASS = {
   GSK_CLIP_NODE,
   sizeof (GskClipNode),
@@ -2962,7 +3483,8 @@ static const GskRenderNodeClass GSK_CLIP_NODE_CLASS = {
   gsk_clip_node_finalize,
   gsk_clip_node_draw,
   gsk_clip_node_serialize,
-  gsk_clip_node_deserialize
+  gsk_clip_node_deserialize,
+  gsk_clip_node_diff
 };
 
 /**
@@ -2993,6 +3515,14 @@ gsk_clip_node_new (GskRenderNode         *child,
 
   graphene_rect_intersection (&self->clip, &child->bounds, &self->render_node.bounds);
 
+  if (child->opaque.size.width > 0)
+    {
+      graphene_rect_t opaque;
+
+      if (graphene_rect_intersection (&self->clip, &child->opaque, &opaque))
+        gsk_render_node_set_opaque (&self->render_node, &opaque);
+    }
+
   return &self->render_node;
 }
 
@@ -3118,6 +3648,35 @@ gsk_rounded_clip_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static void
+gsk_rounded_clip_node_diff (GskRenderNode  *node1,
+                            GskRenderNode  *node2,
+                            cairo_region_t *region)
+{
+  GskRoundedClipNode *self1 = (GskRoundedClipNode *) node1;
+  GskRoundedClipNode *self2 = (GskRoundedClipNode *) node2;
+  cairo_region_t *sub;
+  cairo_rectangle_int_t clip_rect;
+
+  if (!gsk_rounded_rect_equal (&self1->clip, &self2->clip))
+    {
+      gsk_render_node_diff_impossible (node1, node2, region);
+      return;
+    }
+
+  sub = cairo_region_create ();
+  gsk_render_node_diff (self1->child, self2->child, sub);
+
+  clip_rect.x = floor (self1->clip.bounds.origin.x);
+  clip_rect.y = floor (self1->clip.bounds.origin.y);
+  clip_rect.width = ceil (self1->clip.bounds.origin.x + self1->clip.bounds.size.width) - clip_rect.x;
+  clip_rect.height = ceil (self1->clip.bounds.origin.y + self1->clip.bounds.size.height) - clip_rect.y;
+  cairo_region_intersect_rectangle (sub, &clip_rect);
+
+  cairo_region_union (region, sub);
+  cairo_region_destroy (sub);
+}
+
 static const GskRenderNodeClass GSK_ROUNDED_CLIP_NODE_CLASS = {
   GSK_ROUNDED_CLIP_NODE,
   sizeof (GskRoundedClipNode),
@@ -3125,9 +3684,39 @@ static const GskRenderNodeClass GSK_ROUNDED_CLIP_NODE_CLASS = {
   gsk_rounded_clip_node_finalize,
   gsk_rounded_clip_node_draw,
   gsk_rounded_clip_node_serialize,
-  gsk_rounded_clip_node_deserialize
+  gsk_rounded_clip_node_deserialize,
+  gsk_rounded_clip_node_diff
 };
 
+/* The larger of the two bands of @clip that are not touched by
+ * its corners
+ */
+static void
+gsk_rounded_clip_node_get_inner_rect (const GskRoundedRect *clip,
+                                      graphene_rect_t      *inner)
+{
+  const graphene_rect_t *bounds = &clip->bounds;
+  graphene_rect_t horizontal, vertical;
+  float top, bottom, left, right;
+
+  top = MAX (clip->corner[GSK_CORNER_TOP_LEFT].height, clip->corner[GSK_CORNER_TOP_RIGHT].height);
+  bottom = MAX (clip->corner[GSK_CORNER_BOTTOM_LEFT].height, clip->corner[GSK_CORNER_BOTTOM_RIGHT].height);
+  left = MAX (clip->corner[GSK_CORNER_TOP_LEFT].width, clip->corner[GSK_CORNER_BOTTOM_LEFT].width);
+  right = MAX (clip->corner[GSK_CORNER_TOP_RIGHT].width, clip->corner[GSK_CORNER_BOTTOM_RIGHT].width);
+
+  graphene_rect_init (&horizontal,
+                      bounds->origin.x, bounds->origin.y + top,
+                      bounds->size.width, MAX (0, bounds->size.height - top - bottom));
+  graphene_rect_init (&vertical,
+                      bounds->origin.x + left, bounds->origin.y,
+                      MAX (0, bounds->size.width - left - right), bounds->size.height);
+
+  if (rect_area (&horizontal) >= rect_area (&vertical))
+    *inner = horizontal;
+  else
+    *inner = vertical;
+}
+
 /**
  * gsk_rounded_clip_node_new:
  * @child: The node to draw
@@ -3156,6 +3745,15 @@ gsk_rounded_clip_node_new (GskRenderNode         *child,
 
   graphene_rect_intersection (&self->clip.bounds, &child->bounds, &self->render_node.bounds);
 
+  if (child->opaque.size.width > 0)
+    {
+      graphene_rect_t inner, opaque;
+
+      gsk_rounded_clip_node_get_inner_rect (&self->clip, &inner);
+      if (graphene_rect_intersection (&inner, &child->opaque, &opaque))
+        gsk_render_node_set_opaque (&self->render_node, &opaque);
+    }
+
   return &self->render_node;
 }
 
@@ -3343,6 +3941,48 @@ gsk_shadow_node_deserialize (GVariant  *variant,
   return result;
 }
 
+/* The shadows are offset and blurred copies of the child, so
+ * any change in the child damages the whole node
+ */
+static void
+gsk_shadow_node_diff (GskRenderNode  *node1,
+                      GskRenderNode  *node2,
+                      cairo_region_t *region)
+{
+  GskShadowNode *self1 = (GskShadowNode *) node1;
+  GskShadowNode *self2 = (GskShadowNode *) node2;
+  cairo_region_t *sub;
+  gsize i;
+
+  if (!graphene_rect_equal (&node1->bounds, &node2->bounds) ||
+      self1->n_shadows != self2->n_shadows)
+    {
+      gsk_render_node_diff_impossible (node1, node2, region);
+      return;
+    }
+
+  for (i = 0; i < self1->n_shadows; i++)
+    {
+      const GskShadow *shadow1 = &self1->shadows[i];
+      const GskShadow *shadow2 = &self2->shadows[i];
+
+      if (!gdk_rgba_equal (&shadow1->color, &shadow2->color) ||
+          shadow1->dx != shadow2->dx ||
+          shadow1->dy != shadow2->dy ||
+          shadow1->radius != shadow2->radius)
+        {
+          gsk_render_node_diff_impossible (node1, node2, region);
+          return;
+        }
+    }
+
+  sub = cairo_region_create ();
+  gsk_render_node_diff (self1->child, self2->child, sub);
+  if (!cairo_region_is_empty (sub))
+    gsk_render_node_diff_impossible (node1, node2, region);
+  cairo_region_destroy (sub);
+}
+
 static const GskRenderNodeClass GSK_SHADOW_NODE_CLASS = {
   GSK_SHADOW_NODE,
   sizeof (GskShadowNode),
@@ -3350,7 +3990,8 @@ static const GskRenderNodeClass GSK_SHADOW_NODE_CLASS = {
   gsk_shadow_node_finalize,
   gsk_shadow_node_draw,
   gsk_shadow_node_serialize,
-  gsk_shadow_node_deserialize
+  gsk_shadow_node_deserialize,
+  gsk_shadow_node_diff
 };
 
 /**
@@ -3385,6 +4026,9 @@ gsk_shadow_node_new (GskRenderNode         *child,
 
   gsk_shadow_node_get_bounds (self, &self->render_node.bounds);
 
+  /* Shadows are drawn below the child */
+  graphene_rect_init_from_rect (&self->render_node.opaque, &child->opaque);
+
   return &self->render_node;
 }
 
@@ -3559,6 +4203,25 @@ gsk_blend_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static void
+gsk_blend_node_diff (GskRenderNode  *node1,
+                     GskRenderNode  *node2,
+                     cairo_region_t *region)
+{
+  GskBlendNode *self1 = (GskBlendNode *) node1;
+  GskBlendNode *self2 = (GskBlendNode *) node2;
+
+  if (self1->blend_mode == self2->blend_mode)
+    {
+      gsk_render_node_diff (self1->top, self2->top, region);
+      gsk_render_node_diff (self1->bottom, self2->bottom, region);
+    }
+  else
+    {
+      gsk_render_node_diff_impossible (node1, node2, region);
+    }
+}
+
 static const GskRenderNodeClass GSK_BLEND_NODE_CLASS = {
   GSK_BLEND_NODE,
   sizeof (GskBlendNode),
@@ -3566,7 +4229,8 @@ static const GskRenderNodeClass GSK_BLEND_NODE_CLASS = {
   gsk_blend_node_finalize,
   gsk_blend_node_draw,
   gsk_blend_node_serialize,
-  gsk_blend_node_deserialize
+  gsk_blend_node_deserialize,
+  gsk_blend_node_diff
 };
 
 /**
@@ -3731,6 +4395,25 @@ gsk_cross_fade_node_deserialize (GVariant  *variant,
   return result;
 }
 
+static void
+gsk_cross_fade_node_diff (GskRenderNode  *node1,
+                          GskRenderNode  *node2,
+                          cairo_region_t *region)
+{
+  GskCrossFadeNode *self1 = (GskCrossFadeNode *) node1;
+  GskCrossFadeNode *self2 = (GskCrossFadeNode *) node2;
+
+  if (self1->progress == self2->progress)
+    {
+      gsk_render_node_diff (self1->start, self2->start, region);
+      gsk_render_node_diff (self1->end, self2->end, region);
+    }
+  else
+    {
+      gsk_render_node_diff_impossible (node1, node2, region);
+    }
+}
+
 static const GskRenderNodeClass GSK_CROSS_FADE_NODE_CLASS = {
   GSK_CROSS_FADE_NODE,
   sizeof (GskCrossFadeNode),
@@ -3738,7 +4421,8 @@ static const GskRenderNodeClass GSK_CROSS_FADE_NODE_CLASS = {
   gsk_cross_fade_node_finalize,
   gsk_cross_fade_node_draw,
   gsk_cross_fade_node_serialize,
-  gsk_cross_fade_node_deserialize
+  gsk_cross_fade_node_deserialize,
+  gsk_cross_fade_node_diff
 };
 
 /**
@@ -3805,6 +4489,383 @@ gsk_cross_fade_node_get_progress (GskRenderNode *node)
   return self->progress;
 }
 
+/*** GSK_TEXT_NODE ***/
+
+typedef struct _GskTextNode GskTextNode;
+
+struct _GskTextNode
+{
+  GskRenderNode render_node;
+
+  PangoFont *font;
+
+  GdkRGBA color;
+  double x;
+  double y;
+
+  guint num_glyphs;
+  PangoGlyphInfo glyphs[];
+};
+
+static void
+gsk_text_node_finalize (GskRenderNode *node)
+{
+  GskTextNode *self = (GskTextNode *) node;
+
+  g_object_unref (self->font);
+}
+
+/* PangoCairoFont creates its scaled font and glyph metrics lazily,
+ * which is not thread-safe, so text nodes drawn from several threads
+ * without a scaled font looked up in advance take turns calling into
+ * pango.
+ */
+G_LOCK_DEFINE_STATIC (pango_cairo);
+
+const cairo_user_data_key_t gsk_text_node_scaled_fonts_key;
+
+/* Draws the glyphs the way pango_cairo_show_glyph_string() does, with
+ * the scaled font of the node from the scaled fonts of @cr; cairo
+ * scaled fonts can be used from several threads at once
+ */
+static gboolean
+gsk_text_node_show_glyphs (GskTextNode *self,
+                           cairo_t     *cr)
+{
+  GHashTable *scaled_fonts;
+  cairo_scaled_font_t *scaled_font;
+  cairo_glyph_t *cairo_glyphs;
+  double base_x = 0, base_y = 0;
+  int x_position = 0;
+  guint i, count;
+
+  scaled_fonts = cairo_get_user_data (cr, &gsk_text_node_scaled_fonts_key);
+  if (scaled_fonts == NULL)
+    return FALSE;
+
+  scaled_font = g_hash_table_lookup (scaled_fonts, self->font);
+  if (scaled_font == NULL)
+    return FALSE;
+
+  /* pango draws boxes with the code point of unknown glyphs */
+  for (i = 0; i < self->num_glyphs; i++)
+    {
+      if (self->glyphs[i].glyph & PANGO_GLYPH_UNKNOWN_FLAG)
+        return FALSE;
+    }
+
+  if (cairo_has_current_point (cr))
+    cairo_get_current_point (cr, &base_x, &base_y);
+
+  cairo_glyphs = g_new (cairo_glyph_t, self->num_glyphs);
+  count = 0;
+  for (i = 0; i < self->num_glyphs; i++)
+    {
+      const PangoGlyphInfo *gi = &self->glyphs[i];
+
+      if (gi->glyph != PANGO_GLYPH_EMPTY)
+        {
+          cairo_glyphs[count].index = gi->glyph;
+          cairo_glyphs[count].x = base_x + (double) (x_position + gi->geometry.x_offset) / PANGO_SCALE;
+          cairo_glyphs[count].y = base_y + (double) gi->geometry.y_offset / PANGO_SCALE;
+          count++;
+        }
+
+      x_position += gi->geometry.width;
+    }
+
+  cairo_set_scaled_font (cr, scaled_font);
+  cairo_show_glyphs (cr, cairo_glyphs, count);
+
+  g_free (cairo_glyphs);
+
+  return TRUE;
+}
+
+static void
+gsk_text_node_draw (GskRenderNode *node,
+                    cairo_t       *cr)
+{
+  GskTextNode *self = (GskTextNode *) node;
+  PangoGlyphString glyphs;
+
+  glyphs.num_glyphs = self->num_glyphs;
+  glyphs.glyphs = self->glyphs;
+  glyphs.log_clusters = NULL;
+
+  cairo_save (cr);
+
+  gdk_cairo_set_source_rgba (cr, &self->color);
+  cairo_translate (cr, self->x, self->y);
+  if (!gsk_text_node_show_glyphs (self, cr))
+    {
+      G_LOCK (pango_cairo);
+      pango_cairo_show_glyph_string (cr, self->font, &glyphs);
+      G_UNLOCK (pango_cairo);
+    }
+
+  cairo_restore (cr);
+}
+
+#define GSK_TEXT_NODE_VARIANT_TYPE "(sdddddda(uiiii))"
+
+static GVariant *
+gsk_text_node_serialize (GskRenderNode *node)
+{
+  GskTextNode *self = (GskTextNode *) node;
+  PangoFontDescription *desc;
+  char *s;
+  GVariant *v;
+  GVariantBuilder builder;
+  guint i;
+
+  desc = pango_font_describe (self->font);
+  s = pango_font_description_to_string (desc);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(uiiii)"));
+  for (i = 0; i < self->num_glyphs; i++)
+    {
+      const PangoGlyphInfo *glyph = &self->glyphs[i];
+
+      g_variant_builder_add (&builder, "(uiiii)",
+                             glyph->glyph,
+                             glyph->geometry.width,
+                             glyph->geometry.x_offset,
+                             glyph->geometry.y_offset,
+                             glyph->attr.is_cluster_start);
+    }
+
+  v = g_variant_new (GSK_TEXT_NODE_VARIANT_TYPE,
+                     s,
+                     self->color.red, self->color.green,
+                     self->color.blue, self->color.alpha,
+                     self->x, self->y,
+                     &builder);
+
+  g_free (s);
+  pango_font_description_free (desc);
+
+  return v;
+}
+
+static GskRenderNode *
+gsk_text_node_deserialize (GVariant  *variant,
+                           GError   **error)
+{
+  PangoFontDescription *desc;
+  PangoFontMap *fontmap;
+  PangoContext *context;
+  PangoFont *font;
+  PangoGlyphString *glyphs;
+  GVariantIter *iter;
+  GskRenderNode *result;
+  GdkRGBA color;
+  double x, y;
+  char *s;
+  int i;
+
+  if (!check_variant_type (variant, GSK_TEXT_NODE_VARIANT_TYPE, error))
+    return NULL;
+
+  g_variant_get (variant, GSK_TEXT_NODE_VARIANT_TYPE,
+                 &s,
+                 &color.red, &color.green, &color.blue, &color.alpha,
+                 &x, &y,
+                 &iter);
+
+  desc = pango_font_description_from_string (s);
+  fontmap = pango_cairo_font_map_get_default ();
+  context = pango_font_map_create_context (fontmap);
+  font = pango_font_map_load_font (fontmap, context, desc);
+  g_object_unref (context);
+  pango_font_description_free (desc);
+  g_free (s);
+
+  if (font == NULL)
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Could not load font for text node");
+      g_variant_iter_free (iter);
+      return NULL;
+    }
+
+  glyphs = pango_glyph_string_new ();
+  pango_glyph_string_set_size (glyphs, g_variant_iter_n_children (iter));
+
+  for (i = 0; i < glyphs->num_glyphs; i++)
+    {
+      guint32 glyph;
+      gint32 width, x_offset, y_offset, is_cluster_start;
+
+      g_variant_iter_next (iter, "(uiiii)",
+                           &glyph, &width, &x_offset, &y_offset, &is_cluster_start);
+
+      glyphs->glyphs[i].glyph = glyph;
+      glyphs->glyphs[i].geometry.width = width;
+      glyphs->glyphs[i].geometry.x_offset = x_offset;
+      glyphs->glyphs[i].geometry.y_offset = y_offset;
+      glyphs->glyphs[i].attr.is_cluster_start = is_cluster_start;
+    }
+  g_variant_iter_free (iter);
+
+  result = gsk_text_node_new (font, glyphs, &color, x, y);
+
+  pango_glyph_string_free (glyphs);
+  g_object_unref (font);
+
+  /* Invisible text is not an error, but we don't have a node for it */
+  if (result == NULL)
+    result = gsk_container_node_new (NULL, 0);
+
+  return result;
+}
+
+static void
+gsk_text_node_diff (GskRenderNode  *node1,
+                    GskRenderNode  *node2,
+                    cairo_region_t *region)
+{
+  GskTextNode *self1 = (GskTextNode *) node1;
+  GskTextNode *self2 = (GskTextNode *) node2;
+
+  if (self1->font == self2->font &&
+      gdk_rgba_equal (&self1->color, &self2->color) &&
+      self1->x == self2->x &&
+      self1->y == self2->y &&
+      self1->num_glyphs == self2->num_glyphs &&
+      memcmp (self1->glyphs, self2->glyphs, self1->num_glyphs * sizeof (PangoGlyphInfo)) == 0)
+    return;
+
+  gsk_render_node_diff_impossible (node1, node2, region);
+}
+
+static const GskRenderNodeClass GSK_TEXT_NODE_CLASS = {
+  GSK_TEXT_NODE,
+  sizeof (GskTextNode),
+  "GskTextNode",
+  gsk_text_node_finalize,
+  gsk_text_node_draw,
+  gsk_text_node_serialize,
+  gsk_text_node_deserialize,
+  gsk_text_node_diff
+};
+
+/**
+ * gsk_text_node_new:
+ * @font: the #PangoFont containing the glyphs
+ * @glyphs: the #PangoGlyphString to render
+ * @color: the foreground color to render with
+ * @x_offset: horizontal offset of the baseline origin of @glyphs
+ * @y_offset: vertical offset of the baseline origin of @glyphs
+ *
+ * Creates a render node that renders the given glyphs.
+ *
+ * Unlike a cairo node, a text node keeps the glyphs around, so
+ * renderers can rasterize them once and reuse them across frames.
+ *
+ * Returns: (nullable): a new text node, or %NULL if the glyphs
+ *     are not visible
+ *
+ * Since: 3.92
+ */
+GskRenderNode *
+gsk_text_node_new (PangoFont        *font,
+                   PangoGlyphString *glyphs,
+                   const GdkRGBA    *color,
+                   double            x_offset,
+                   double            y_offset)
+{
+  GskTextNode *self;
+  PangoRectangle ink_rect;
+
+  g_return_val_if_fail (PANGO_IS_FONT (font), NULL);
+  g_return_val_if_fail (glyphs != NULL, NULL);
+  g_return_val_if_fail (color != NULL, NULL);
+
+  pango_glyph_string_extents (glyphs, font, &ink_rect, NULL);
+  pango_extents_to_pixels (&ink_rect, NULL);
+
+  if (ink_rect.width == 0 || ink_rect.height == 0)
+    return NULL;
+
+  self = (GskTextNode *) gsk_render_node_new (&GSK_TEXT_NODE_CLASS, sizeof (PangoGlyphInfo) * glyphs->num_glyphs);
+
+  self->font = g_object_ref (font);
+  self->color = *color;
+  self->x = x_offset;
+  self->y = y_offset;
+  self->num_glyphs = glyphs->num_glyphs;
+  memcpy (self->glyphs, glyphs->glyphs, sizeof (PangoGlyphInfo) * glyphs->num_glyphs);
+
+  graphene_rect_init (&self->render_node.bounds,
+                      x_offset + ink_rect.x,
+                      y_offset + ink_rect.y,
+                      ink_rect.width,
+                      ink_rect.height);
+
+  return &self->render_node;
+}
+
+PangoFont *
+gsk_text_node_peek_font (GskRenderNode *node)
+{
+  GskTextNode *self = (GskTextNode *) node;
+
+  g_return_val_if_fail (GSK_IS_RENDER_NODE_TYPE (node, GSK_TEXT_NODE), NULL);
+
+  return self->font;
+}
+
+guint
+gsk_text_node_get_num_glyphs (GskRenderNode *node)
+{
+  GskTextNode *self = (GskTextNode *) node;
+
+  g_return_val_if_fail (GSK_IS_RENDER_NODE_TYPE (node, GSK_TEXT_NODE), 0);
+
+  return self->num_glyphs;
+}
+
+const PangoGlyphInfo *
+gsk_text_node_peek_glyphs (GskRenderNode *node)
+{
+  GskTextNode *self = (GskTextNode *) node;
+
+  g_return_val_if_fail (GSK_IS_RENDER_NODE_TYPE (node, GSK_TEXT_NODE), NULL);
+
+  return self->glyphs;
+}
+
+const GdkRGBA *
+gsk_text_node_peek_color (GskRenderNode *node)
+{
+  GskTextNode *self = (GskTextNode *) node;
+
+  g_return_val_if_fail (GSK_IS_RENDER_NODE_TYPE (node, GSK_TEXT_NODE), NULL);
+
+  return &self->color;
+}
+
+float
+gsk_text_node_get_x (GskRenderNode *node)
+{
+  GskTextNode *self = (GskTextNode *) node;
+
+  g_return_val_if_fail (GSK_IS_RENDER_NODE_TYPE (node, GSK_TEXT_NODE), 0.0);
+
+  return (float) self->x;
+}
+
+float
+gsk_text_node_get_y (GskRenderNode *node)
+{
+  GskTextNode *self = (GskTextNode *) node;
+
+  g_return_val_if_fail (GSK_IS_RENDER_NODE_TYPE (node, GSK_TEXT_NODE), 0.0);
+
+  return (float) self->y;
+}
+
 static const GskRenderNodeClass *klasses[] = {
   [GSK_CONTAINER_NODE] = &GSK_CONTAINER_NODE_CLASS,
   [GSK_CAIRO_NODE] = &GSK_CAIRO_NODE_CLASS,
@@ -3822,7 +4883,8 @@ static const GskRenderNodeClass *klasses[] = {
   [GSK_ROUNDED_CLIP_NODE] = &GSK_ROUNDED_CLIP_NODE_CLASS,
   [GSK_SHADOW_NODE] = &GSK_SHADOW_NODE_CLASS,
   [GSK_BLEND_NODE] = &GSK_BLEND_NODE_CLASS,
-  [GSK_CROSS_FADE_NODE] = &GSK_CROSS_FADE_NODE_CLASS
+  [GSK_CROSS_FADE_NODE] = &GSK_CROSS_FADE_NODE_CLASS,
+  [GSK_TEXT_NODE] = &GSK_TEXT_NODE_CLASS
 };
 
 GskRenderNode *
@@ -7,6 +7,7 @@
 G_BEGIN_DECLS
 
 typedef struct _GskRenderNodeClass GskRenderNodeClass;
+typedef struct _GskRenderNodeArena GskRenderNodeArena;
 
 #define GSK_IS_RENDER_NODE_TYPE(node,type) (GSK_IS_RENDER_NODE (node) && (node)->node_class->node_type == (type))
 
@@ -16,6 +17,9 @@ struct _GskRenderNode
 
   volatile int ref_count;
 
+  /* The arena block the node was allocated from, or %NULL */
+  struct _GskRenderNodeArenaBlock *block;
+
   /* Use for debugging */
   char *name;
 
@@ -24,6 +28,11 @@ struct _GskRenderNode
   GskScalingFilter mag_filter;
 
   graphene_rect_t bounds;
+
+  /* The pixel-aligned area that the node covers with fully opaque
+   * pixels, or an empty rectangle if it is not known
+   */
+  graphene_rect_t opaque;
 };
 
 struct _GskRenderNodeClass
@@ -37,13 +46,27 @@ struct _GskRenderNodeClass
   GVariant * (* serialize) (GskRenderNode *node);
   GskRenderNode * (* deserialize) (GVariant  *variant,
                                    GError   **error);
+  void (* diff) (GskRenderNode  *node1,
+                 GskRenderNode  *node2,
+                 cairo_region_t *region);
 };
 
 GskRenderNode *gsk_render_node_new (const GskRenderNodeClass *node_class, gsize extra_size);
 
+GskRenderNodeArena * gsk_render_node_arena_new (void);
+GskRenderNodeArena * gsk_render_node_arena_ref (GskRenderNodeArena *arena);
+void gsk_render_node_arena_unref (GskRenderNodeArena *arena);
+GskRenderNodeArena * gsk_render_node_arena_set_current (GskRenderNodeArena *arena);
+
+void gsk_render_node_diff (GskRenderNode *node1, GskRenderNode *node2, cairo_region_t *region);
+void gsk_render_node_diff_impossible (GskRenderNode *node1, GskRenderNode *node2, cairo_region_t *region);
+
 GVariant * gsk_render_node_serialize_node (GskRenderNode *node);
 GskRenderNode * gsk_render_node_deserialize_node (GskRenderNodeType type, GVariant *variant, GError **error);
 
+gboolean gsk_render_node_is_binary (GBytes *bytes);
+GskRenderNode * gsk_render_node_deserialize_binary (GBytes *bytes, GError **error);
+
 double gsk_opacity_node_get_opacity (GskRenderNode *node);
 
 GskRenderNode * gsk_color_matrix_node_get_child (GskRenderNode *node);
@@ -76,11 +99,28 @@ float gsk_outset_shadow_node_get_dy (GskRenderNode *node);
 float gsk_outset_shadow_node_get_spread (GskRenderNode *node);
 float gsk_outset_shadow_node_get_blur_radius (GskRenderNode *node);
 
+GDK_AVAILABLE_IN_ALL
+const graphene_rect_t * gsk_container_node_peek_visible_bounds (GskRenderNode *node, guint idx);
+
 GskRenderNode *gsk_cairo_node_new_for_surface (const graphene_rect_t *bounds, cairo_surface_t *surface);
 cairo_surface_t *gsk_cairo_node_get_surface (GskRenderNode *node);
 
 GskTexture *gsk_texture_node_get_texture (GskRenderNode *node);
 
+/* Set on a cairo_t to a GHashTable mapping textures to surfaces that
+ * texture nodes use instead of downloading the texture again
+ */
+extern const cairo_user_data_key_t gsk_texture_node_surfaces_key;
+
+/* Set on a cairo_t to a GHashTable mapping the fonts of text nodes to
+ * their cairo_scaled_font_t, so text nodes can be drawn without
+ * calling into pango, which is not thread-safe
+ */
+extern const cairo_user_data_key_t gsk_text_node_scaled_fonts_key;
+
+void gsk_render_node_copy_draw_data (cairo_t *cr,
+                                     cairo_t *derived_cr);
+
 const GdkRGBA *gsk_color_node_peek_color (GskRenderNode *node);
 
 const graphene_rect_t * gsk_clip_node_peek_clip (GskRenderNode *node);
@@ -101,6 +141,13 @@ GskRenderNode * gsk_cross_fade_node_get_start_child (GskRenderNode *node);
 GskRenderNode * gsk_cross_fade_node_get_end_child (GskRenderNode *node);
 double gsk_cross_fade_node_get_progress (GskRenderNode *node);
 
+PangoFont * gsk_text_node_peek_font (GskRenderNode *node);
+guint gsk_text_node_get_num_glyphs (GskRenderNode *node);
+const PangoGlyphInfo * gsk_text_node_peek_glyphs (GskRenderNode *node);
+const GdkRGBA * gsk_text_node_peek_color (GskRenderNode *node);
+float gsk_text_node_get_x (GskRenderNode *node);
+float gsk_text_node_get_y (GskRenderNode *node);
+
 G_END_DECLS
 
 #endif /* __GSK_RENDER_NODE_PRIVATE_H__ */
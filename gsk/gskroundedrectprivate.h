@@ -8,6 +8,8 @@
 G_BEGIN_DECLS
 
 gboolean                 gsk_rounded_rect_is_circular           (const GskRoundedRect     *self);
+gboolean                 gsk_rounded_rect_equal                 (const GskRoundedRect     *rect1,
+                                                                 const GskRoundedRect     *rect2);
 
 void                     gsk_rounded_rect_path                  (const GskRoundedRect     *self,
                                                                  cairo_t                  *cr);
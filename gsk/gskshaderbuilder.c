@@ -27,6 +27,7 @@ struct _GskShaderBuilder
   GPtrArray *defines;
   GPtrArray *uniforms;
   GPtrArray *attributes;
+  GPtrArray *fragment_includes;
 
   GHashTable *programs;
 };
@@ -71,6 +72,7 @@ gsk_shader_builder_finalize (GObject *gobject)
   g_clear_pointer (&self->defines, g_ptr_array_unref);
   g_clear_pointer (&self->uniforms, g_ptr_array_unref);
   g_clear_pointer (&self->attributes, g_ptr_array_unref);
+  g_clear_pointer (&self->fragment_includes, g_ptr_array_unref);
 
   g_clear_pointer (&self->programs, g_hash_table_unref);
 
@@ -89,6 +91,7 @@ gsk_shader_builder_init (GskShaderBuilder *self)
   self->defines = g_ptr_array_new_with_free_func (g_free);
   self->uniforms = g_ptr_array_new_with_free_func (g_free);
   self->attributes = g_ptr_array_new_with_free_func (g_free);
+  self->fragment_includes = g_ptr_array_new_with_free_func (g_free);
 
   self->programs = g_hash_table_new_full (g_direct_hash, g_direct_equal,
                                           NULL,
@@ -131,6 +134,25 @@ gsk_shader_builder_set_fragment_preamble (GskShaderBuilder *builder,
   builder->fragment_preamble = g_strdup (fragment_preamble);
 }
 
+/*
+ * gsk_shader_builder_add_fragment_include:
+ * @builder: a #GskShaderBuilder
+ * @shader_include: the name of the shader resource
+ *
+ * Adds a shader resource that is appended to the fragment preamble
+ * of every program; this is meant for code that is shared between
+ * fragment shaders, and that does not depend on the GLSL version.
+ */
+void
+gsk_shader_builder_add_fragment_include (GskShaderBuilder *builder,
+                                         const char       *shader_include)
+{
+  g_return_if_fail (GSK_IS_SHADER_BUILDER (builder));
+  g_return_if_fail (shader_include != NULL);
+
+  g_ptr_array_add (builder->fragment_includes, g_strdup (shader_include));
+}
+
 void
 gsk_shader_builder_set_version (GskShaderBuilder *builder,
                                 int               version)
@@ -249,6 +271,22 @@ gsk_shader_builder_compile_shader (GskShaderBuilder *builder,
 
   g_string_append_c (code, '\n');
 
+  if (shader_type == GL_FRAGMENT_SHADER)
+    {
+      for (i = 0; i < builder->fragment_includes->len; i++)
+        {
+          const char *shader_include = g_ptr_array_index (builder->fragment_includes, i);
+
+          if (!lookup_shader_code (code, builder->resource_base_path, shader_include, error))
+            {
+              g_string_free (code, TRUE);
+              return -1;
+            }
+
+          g_string_append_c (code, '\n');
+        }
+    }
+
   if (!lookup_shader_code (code, builder->resource_base_path, shader_source, error))
     {
       g_string_free (code, TRUE);
@@ -343,6 +381,7 @@ gsk_shader_builder_create_program (GskShaderBuilder *builder,
   int vertex_id, fragment_id;
   int program_id;
   int status;
+  int i;
 
   g_return_val_if_fail (GSK_IS_SHADER_BUILDER (builder), -1);
   g_return_val_if_fail (vertex_shader != NULL, -1);
@@ -368,6 +407,17 @@ gsk_shader_builder_create_program (GskShaderBuilder *builder,
   program_id = glCreateProgram ();
   glAttachShader (program_id, vertex_id);
   glAttachShader (program_id, fragment_id);
+
+  /* Bind the attributes to the same location in every program, so that
+   * a single vertex array object can be shared across programs
+   */
+  for (i = 0; i < builder->attributes->len; i++)
+    {
+      const char *attribute = g_ptr_array_index (builder->attributes, i);
+
+      glBindAttribLocation (program_id, i, attribute);
+    }
+
   glLinkProgram (program_id);
 
   glGetProgramiv (program_id, GL_LINK_STATUS, &status);
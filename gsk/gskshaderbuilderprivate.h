@@ -20,6 +20,8 @@ void                    gsk_shader_builder_set_vertex_preamble          (GskShad
                                                                          const char       *shader_preamble);
 void                    gsk_shader_builder_set_fragment_preamble        (GskShaderBuilder *builder,
                                                                          const char       *shader_preamble);
+void                    gsk_shader_builder_add_fragment_include         (GskShaderBuilder *builder,
+                                                                         const char       *shader_include);
 
 GQuark                  gsk_shader_builder_add_uniform                  (GskShaderBuilder *builder,
                                                                          const char       *uniform_name);
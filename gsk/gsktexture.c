@@ -39,6 +39,8 @@
 
 #include "gdk/gdkinternals.h"
 
+#include <string.h>
+
 /**
  * GskTexture:
  *
@@ -133,6 +135,12 @@ gsk_texture_get_property (GObject    *gobject,
     }
 }
 
+static gboolean
+gsk_texture_real_is_opaque (GskTexture *texture)
+{
+  return FALSE;
+}
+
 static void
 gsk_texture_dispose (GObject *object)
 {    
@@ -150,6 +158,7 @@ gsk_texture_class_init (GskTextureClass *klass)
 
   klass->download = gsk_texture_real_download;
   klass->download_surface = gsk_texture_real_download_surface;
+  klass->is_opaque = gsk_texture_real_is_opaque;
 
   gobject_class->set_property = gsk_texture_set_property;
   gobject_class->get_property = gsk_texture_get_property;
@@ -260,6 +269,14 @@ gsk_cairo_texture_download (GskTexture *texture,
   cairo_surface_destroy (surface);
 }
 
+static gboolean
+gsk_cairo_texture_is_opaque (GskTexture *texture)
+{
+  GskCairoTexture *self = GSK_CAIRO_TEXTURE (texture);
+
+  return cairo_surface_get_content (self->surface) == CAIRO_CONTENT_COLOR;
+}
+
 static void
 gsk_cairo_texture_class_init (GskCairoTextureClass *klass)
 {
@@ -268,6 +285,7 @@ gsk_cairo_texture_class_init (GskCairoTextureClass *klass)
 
   texture_class->download = gsk_cairo_texture_download;
   texture_class->download_surface = gsk_cairo_texture_download_surface;
+  texture_class->is_opaque = gsk_cairo_texture_is_opaque;
 
   gobject_class->finalize = gsk_cairo_texture_finalize;
 }
@@ -277,33 +295,6 @@ gsk_cairo_texture_init (GskCairoTexture *self)
 {
 }
 
-GskTexture *
-gsk_texture_new_for_data (const guchar *data,
-                          int           width,
-                          int           height,
-                          int           stride)
-{
-  GskTexture *texture;
-  cairo_surface_t *original, *copy;
-  cairo_t *cr;
-
-  original = cairo_image_surface_create_for_data ((guchar *) data, CAIRO_FORMAT_ARGB32, width, height, stride);
-  copy = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
-
-  cr = cairo_create (copy);
-  cairo_set_source_surface (cr, original, 0, 0);
-  cairo_paint (cr);
-  cairo_destroy (cr);
-
-  texture = gsk_texture_new_for_surface (copy);
-
-  cairo_surface_destroy (copy);
-  cairo_surface_finish (original);
-  cairo_surface_destroy (original);
-
-  return texture;
-}
-
 GskTexture *
 gsk_texture_new_for_surface (cairo_surface_t *surface)
 {
@@ -374,6 +365,14 @@ gsk_pixbuf_texture_download_surface (GskTexture *texture)
   return gdk_cairo_surface_create_from_pixbuf (self->pixbuf, 1, NULL);
 }
 
+static gboolean
+gsk_pixbuf_texture_is_opaque (GskTexture *texture)
+{
+  GskPixbufTexture *self = GSK_PIXBUF_TEXTURE (texture);
+
+  return !gdk_pixbuf_get_has_alpha (self->pixbuf);
+}
+
 static void
 gsk_pixbuf_texture_class_init (GskPixbufTextureClass *klass)
 {
@@ -382,6 +381,7 @@ gsk_pixbuf_texture_class_init (GskPixbufTextureClass *klass)
 
   texture_class->download = gsk_pixbuf_texture_download;
   texture_class->download_surface = gsk_pixbuf_texture_download_surface;
+  texture_class->is_opaque = gsk_pixbuf_texture_is_opaque;
 
   gobject_class->finalize = gsk_pixbuf_texture_finalize;
 }
@@ -408,6 +408,151 @@ gsk_texture_new_for_pixbuf (GdkPixbuf *pixbuf)
   return GSK_TEXTURE (self);
 }
 
+/* GskBytesTexture */
+
+#define GSK_TYPE_BYTES_TEXTURE (gsk_bytes_texture_get_type ())
+
+G_DECLARE_FINAL_TYPE (GskBytesTexture, gsk_bytes_texture, GSK, BYTES_TEXTURE, GskTexture)
+
+struct _GskBytesTexture {
+  GskTexture parent_instance;
+
+  GBytes *bytes;
+  gsize stride;
+};
+
+struct _GskBytesTextureClass {
+  GskTextureClass parent_class;
+};
+
+G_DEFINE_TYPE (GskBytesTexture, gsk_bytes_texture, GSK_TYPE_TEXTURE)
+
+static const cairo_user_data_key_t gsk_bytes_texture_key;
+
+static void
+gsk_bytes_texture_finalize (GObject *object)
+{
+  GskBytesTexture *self = GSK_BYTES_TEXTURE (object);
+
+  g_bytes_unref (self->bytes);
+
+  G_OBJECT_CLASS (gsk_bytes_texture_parent_class)->finalize (object);
+}
+
+static void
+gsk_bytes_texture_download (GskTexture *texture,
+                            guchar     *data,
+                            gsize       stride)
+{
+  GskBytesTexture *self = GSK_BYTES_TEXTURE (texture);
+  const guchar *src;
+  int y;
+
+  src = g_bytes_get_data (self->bytes, NULL);
+  for (y = 0; y < texture->height; y++)
+    memcpy (data + y * stride, src + y * self->stride, texture->width * 4);
+}
+
+/* The surface points into the bytes, which it keeps alive, so drawing
+ * the texture or uploading it does not copy the pixels first
+ */
+static cairo_surface_t *
+gsk_bytes_texture_download_surface (GskTexture *texture)
+{
+  GskBytesTexture *self = GSK_BYTES_TEXTURE (texture);
+  cairo_surface_t *surface;
+
+  surface = cairo_image_surface_create_for_data ((guchar *) g_bytes_get_data (self->bytes, NULL),
+                                                 CAIRO_FORMAT_ARGB32,
+                                                 texture->width, texture->height,
+                                                 self->stride);
+  cairo_surface_set_user_data (surface, &gsk_bytes_texture_key,
+                               g_bytes_ref (self->bytes),
+                               (cairo_destroy_func_t) g_bytes_unref);
+
+  return surface;
+}
+
+static void
+gsk_bytes_texture_class_init (GskBytesTextureClass *klass)
+{
+  GskTextureClass *texture_class = GSK_TEXTURE_CLASS (klass);
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  texture_class->download = gsk_bytes_texture_download;
+  texture_class->download_surface = gsk_bytes_texture_download_surface;
+
+  gobject_class->finalize = gsk_bytes_texture_finalize;
+}
+
+static void
+gsk_bytes_texture_init (GskBytesTexture *self)
+{
+}
+
+/**
+ * gsk_texture_new_for_bytes:
+ * @bytes: the pixel data, in the format of %CAIRO_FORMAT_ARGB32
+ * @width: the width of the texture
+ * @height: the height of the texture
+ * @stride: rowstride of @bytes, a multiple of 4
+ *
+ * Creates a new texture using @bytes as its pixel data, without
+ * copying them. The bytes can come from any source, like
+ * g_mapped_file_get_bytes() to use the pixels of a file mapped
+ * into memory, and must not change while the texture exists.
+ *
+ * Returns: (transfer full): a new #GskTexture
+ *
+ * Since: 3.92
+ */
+GskTexture *
+gsk_texture_new_for_bytes (GBytes *bytes,
+                           int     width,
+                           int     height,
+                           int     stride)
+{
+  GskBytesTexture *self;
+
+  g_return_val_if_fail (bytes != NULL, NULL);
+  g_return_val_if_fail (width > 0 && height > 0, NULL);
+  g_return_val_if_fail (stride >= width * 4 && stride % 4 == 0, NULL);
+  g_return_val_if_fail (g_bytes_get_size (bytes) >= (gsize) stride * (height - 1) + width * 4, NULL);
+
+  self = g_object_new (GSK_TYPE_BYTES_TEXTURE,
+                       "width", width,
+                       "height", height,
+                       NULL);
+
+  self->bytes = g_bytes_ref (bytes);
+  self->stride = stride;
+
+  return GSK_TEXTURE (self);
+}
+
+/* The data is copied once, into memory owned by the texture */
+GskTexture *
+gsk_texture_new_for_data (const guchar *data,
+                          int           width,
+                          int           height,
+                          int           stride)
+{
+  GskTexture *texture;
+  GBytes *bytes;
+  guchar *copy;
+  int y;
+
+  copy = g_malloc ((gsize) width * height * 4);
+  for (y = 0; y < height; y++)
+    memcpy (copy + (gsize) y * width * 4, data + (gsize) y * stride, width * 4);
+
+  bytes = g_bytes_new_take (copy, (gsize) width * height * 4);
+  texture = gsk_texture_new_for_bytes (bytes, width, height, width * 4);
+  g_bytes_unref (bytes);
+
+  return texture;
+}
+
 /**
  * gsk_texture_get_width:
  * @texture: a #GskTexture
@@ -450,6 +595,20 @@ gsk_texture_download_surface (GskTexture *texture)
   return GSK_TEXTURE_GET_CLASS (texture)->download_surface (texture);
 }
 
+/*< private >
+ * gsk_texture_is_opaque:
+ * @texture: a #GskTexture
+ *
+ * Checks if every pixel of @texture is known to be fully opaque.
+ *
+ * Returns: %TRUE if @texture has no alpha channel
+ */
+gboolean
+gsk_texture_is_opaque (GskTexture *texture)
+{
+  return GSK_TEXTURE_GET_CLASS (texture)->is_opaque (texture);
+}
+
 /**
  * gsk_texture_download:
  * @texture: a #GskTexture
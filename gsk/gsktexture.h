@@ -47,6 +47,11 @@ GskTexture *            gsk_texture_new_for_data               (const guchar
                                                                 int              stride);
 GDK_AVAILABLE_IN_3_90
 GskTexture *            gsk_texture_new_for_pixbuf             (GdkPixbuf       *pixbuf);
+GDK_AVAILABLE_IN_3_92
+GskTexture *            gsk_texture_new_for_bytes              (GBytes          *bytes,
+                                                                int              width,
+                                                                int              height,
+                                                                int              stride);
 
 GDK_AVAILABLE_IN_3_90
 int                     gsk_texture_get_width                  (GskTexture      *texture);
@@ -28,6 +28,7 @@ struct _GskTextureClass {
                                                          guchar                 *data,
                                                          gsize                   stride);
   cairo_surface_t *     (* download_surface)            (GskTexture             *texture);
+  gboolean              (* is_opaque)                   (GskTexture             *texture);
 };
 
 gpointer                gsk_texture_new                 (const GskTextureClass  *klass,
@@ -35,6 +36,7 @@ gpointer                gsk_texture_new                 (const GskTextureClass
                                                          int                     height);
 GskTexture *            gsk_texture_new_for_surface     (cairo_surface_t        *surface);
 cairo_surface_t *       gsk_texture_download_surface    (GskTexture             *texture);
+gboolean                gsk_texture_is_opaque           (GskTexture             *texture);
 
 gboolean                gsk_texture_set_render_data     (GskTexture             *self,
                                                          gpointer                key,
@@ -0,0 +1,35 @@
+#ifndef __GSK_VULKAN_BLEND_MODE_PIPELINE_PRIVATE_H__
+#define __GSK_VULKAN_BLEND_MODE_PIPELINE_PRIVATE_H__
+
+#include <graphene.h>
+#include <gsk/gskrendernode.h>
+
+#include "gskvulkanpipelineprivate.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GskVulkanBlendModePipelineLayout GskVulkanBlendModePipelineLayout;
+
+#define GSK_TYPE_VULKAN_BLEND_MODE_PIPELINE (gsk_vulkan_blend_mode_pipeline_get_type ())
+
+G_DECLARE_FINAL_TYPE (GskVulkanBlendModePipeline, gsk_vulkan_blend_mode_pipeline, GSK, VULKAN_BLEND_MODE_PIPELINE, GskVulkanPipeline)
+
+GskVulkanPipeline *     gsk_vulkan_blend_mode_pipeline_new              (GskVulkanPipelineLayout         *layout,
+                                                                         const char                      *shader_name,
+                                                                         VkRenderPass                    render_pass);
+
+gsize                   gsk_vulkan_blend_mode_pipeline_count_vertex_data(GskVulkanBlendModePipeline      *pipeline);
+void                    gsk_vulkan_blend_mode_pipeline_collect_vertex_data(GskVulkanBlendModePipeline      *pipeline,
+                                                                         guchar                          *data,
+                                                                         const graphene_rect_t           *rect,
+                                                                         const graphene_rect_t           *top_tex_rect,
+                                                                         const graphene_rect_t           *bottom_tex_rect,
+                                                                         GskBlendMode                    blend_mode);
+gsize                   gsk_vulkan_blend_mode_pipeline_draw             (GskVulkanBlendModePipeline      *pipeline,
+                                                                         VkCommandBuffer                 command_buffer,
+                                                                         gsize                           offset,
+                                                                         gsize                           n_commands);
+
+G_END_DECLS
+
+#endif /* __GSK_VULKAN_BLEND_MODE_PIPELINE_PRIVATE_H__ */
@@ -207,8 +207,11 @@ gsk_vulkan_pipeline_layout_new (GdkVulkanContext *context)
   GSK_VK_CHECK (vkCreatePipelineLayout, device,
                                         &(VkPipelineLayoutCreateInfo) {
                                             .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-                                            .setLayoutCount = 1,
-                                            .pSetLayouts = &self->descriptor_set_layout,
+                                            .setLayoutCount = 2,
+                                            .pSetLayouts = (VkDescriptorSetLayout[2]) {
+                                                self->descriptor_set_layout,
+                                                self->descriptor_set_layout
+                                            },
                                             .pushConstantRangeCount = gst_vulkan_push_constants_get_range_count (),
                                             .pPushConstantRanges = gst_vulkan_push_constants_get_ranges ()
                                         },
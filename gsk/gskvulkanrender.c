@@ -10,10 +10,13 @@
 #include "gskvulkanpipelineprivate.h"
 #include "gskvulkanrenderpassprivate.h"
 
+#include "gskvulkanblendmodepipelineprivate.h"
 #include "gskvulkanblendpipelineprivate.h"
+#include "gskvulkanblurpipelineprivate.h"
 #include "gskvulkanborderpipelineprivate.h"
 #include "gskvulkanboxshadowpipelineprivate.h"
 #include "gskvulkancolorpipelineprivate.h"
+#include "gskvulkancrossfadepipelineprivate.h"
 #include "gskvulkaneffectpipelineprivate.h"
 #include "gskvulkanlineargradientpipelineprivate.h"
 
@@ -32,16 +35,19 @@ struct _GskVulkanRender
   int scale_factor;
   VkRect2D viewport;
   cairo_region_t *clip;
+  /* The extents of clip, in the coordinates of the rendered node */
+  graphene_rect_t clip_bounds;
 
   GHashTable *framebuffers;
   GskVulkanCommandPool *command_pool;
   VkFence fence;
   VkRenderPass render_pass;
+  VkRenderPass offscreen_render_pass;
   GskVulkanPipelineLayout *layout;
   GskVulkanUploader *uploader;
   GskVulkanBuffer *vertex_buffer;
 
-  GHashTable *descriptor_set_indexes;
+  GHashTable *descriptor_set_indexes[GSK_VULKAN_N_SAMPLERS];
   VkDescriptorPool descriptor_pool;
   uint32_t descriptor_pool_maxsets;
   VkDescriptorSet *descriptor_sets;  
@@ -50,6 +56,7 @@ struct _GskVulkanRender
 
   GskVulkanImage *target;
 
+  /* In drawing order, once the passes are uploaded */
   GSList *render_passes;
   GSList *cleanup_images;
 };
@@ -61,6 +68,7 @@ gsk_vulkan_render_setup (GskVulkanRender       *self,
 {
   GdkWindow *window = gsk_renderer_get_window (self->renderer);
   graphene_matrix_t modelview, projection;
+  cairo_rectangle_int_t extents;
 
   self->target = g_object_ref (target);
 
@@ -72,6 +80,7 @@ gsk_vulkan_render_setup (GskVulkanRender       *self,
                                                       0, 0,
                                                       gsk_vulkan_image_get_width (target), gsk_vulkan_image_get_height (target)
                                                   });
+      self->clip_bounds = *rect;
     }
   else
     {
@@ -80,6 +89,8 @@ gsk_vulkan_render_setup (GskVulkanRender       *self,
       self->viewport.extent.width = gdk_window_get_width (window) * self->scale_factor;
       self->viewport.extent.height = gdk_window_get_height (window) * self->scale_factor;
       self->clip = gdk_drawing_context_get_clip (gsk_renderer_get_drawing_context (self->renderer));
+      cairo_region_get_extents (self->clip, &extents);
+      graphene_rect_init (&self->clip_bounds, extents.x, extents.y, extents.width, extents.height);
     }
 
   graphene_matrix_init_scale (&modelview, self->scale_factor, self->scale_factor, 1.0);
@@ -92,46 +103,11 @@ gsk_vulkan_render_setup (GskVulkanRender       *self,
   graphene_matrix_multiply (&modelview, &projection, &self->mvp);
 }
 
-GskVulkanRender *
-gsk_vulkan_render_new (GskRenderer      *renderer,
-                       GdkVulkanContext *context)
+static VkRenderPass
+gsk_vulkan_render_create_render_pass (GskVulkanRender *self,
+                                      VkImageLayout    final_layout)
 {
-  GskVulkanRender *self;
-  VkDevice device;
-
-  self = g_slice_new0 (GskVulkanRender);
-
-  self->vulkan = context;
-  self->renderer = renderer;
-  self->framebuffers = g_hash_table_new (g_direct_hash, g_direct_equal);
-  self->descriptor_set_indexes = g_hash_table_new (g_direct_hash, g_direct_equal);
-
-  device = gdk_vulkan_context_get_device (self->vulkan);
-
-  self->command_pool = gsk_vulkan_command_pool_new (self->vulkan);
-  GSK_VK_CHECK (vkCreateFence, device,
-                               &(VkFenceCreateInfo) {
-                                   .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-                                   .flags = VK_FENCE_CREATE_SIGNALED_BIT
-                               },
-                               NULL,
-                               &self->fence);
-
-  self->descriptor_pool_maxsets = DESCRIPTOR_POOL_MAXSETS;
-  GSK_VK_CHECK (vkCreateDescriptorPool, device,
-                                        &(VkDescriptorPoolCreateInfo) {
-                                            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-                                            .maxSets = self->descriptor_pool_maxsets,
-                                            .poolSizeCount = 1,
-                                            .pPoolSizes = (VkDescriptorPoolSize[1]) {
-                                                {
-                                                    .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                                    .descriptorCount = self->descriptor_pool_maxsets
-                                                }
-                                            }
-                                        },
-                                        NULL,
-                                        &self->descriptor_pool);
+  VkRenderPass render_pass;
 
   GSK_VK_CHECK (vkCreateRenderPass, gdk_vulkan_context_get_device (self->vulkan),
                                     &(VkRenderPassCreateInfo) {
@@ -144,7 +120,7 @@ gsk_vulkan_render_new (GskRenderer      *renderer,
                                               .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
                                               .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
                                               .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-                                              .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                                              .finalLayout = final_layout,
                                            }
                                         },
                                         .subpassCount = 1,
@@ -170,10 +146,71 @@ gsk_vulkan_render_new (GskRenderer      *renderer,
                                                .pPreserveAttachments = (uint32_t []) { 0 },
                                             }
                                          },
-                                         .dependencyCount = 0
+                                         /* Images drawn offscreen are sampled by
+                                          * the passes drawn after them */
+                                         .dependencyCount = final_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ? 1 : 0,
+                                         .pDependencies = (VkSubpassDependency []) {
+                                            {
+                                               .srcSubpass = 0,
+                                               .dstSubpass = VK_SUBPASS_EXTERNAL,
+                                               .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                               .dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                               .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                                               .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+                                            }
+                                         }
                                       },
                                       NULL,
-                                      &self->render_pass);
+                                      &render_pass);
+
+  return render_pass;
+}
+
+GskVulkanRender *
+gsk_vulkan_render_new (GskRenderer      *renderer,
+                       GdkVulkanContext *context)
+{
+  GskVulkanRender *self;
+  VkDevice device;
+  guint i;
+
+  self = g_slice_new0 (GskVulkanRender);
+
+  self->vulkan = context;
+  self->renderer = renderer;
+  self->framebuffers = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (i = 0; i < GSK_VULKAN_N_SAMPLERS; i++)
+    self->descriptor_set_indexes[i] = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  device = gdk_vulkan_context_get_device (self->vulkan);
+
+  self->command_pool = gsk_vulkan_command_pool_new (self->vulkan);
+  GSK_VK_CHECK (vkCreateFence, device,
+                               &(VkFenceCreateInfo) {
+                                   .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+                                   .flags = VK_FENCE_CREATE_SIGNALED_BIT
+                               },
+                               NULL,
+                               &self->fence);
+
+  self->descriptor_pool_maxsets = DESCRIPTOR_POOL_MAXSETS;
+  GSK_VK_CHECK (vkCreateDescriptorPool, device,
+                                        &(VkDescriptorPoolCreateInfo) {
+                                            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                                            .maxSets = self->descriptor_pool_maxsets,
+                                            .poolSizeCount = 1,
+                                            .pPoolSizes = (VkDescriptorPoolSize[1]) {
+                                                {
+                                                    .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                    .descriptorCount = self->descriptor_pool_maxsets
+                                                }
+                                            }
+                                        },
+                                        NULL,
+                                        &self->descriptor_pool);
+
+  self->render_pass = gsk_vulkan_render_create_render_pass (self, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+  self->offscreen_render_pass = gsk_vulkan_render_create_render_pass (self, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
   self->layout = gsk_vulkan_pipeline_layout_new (self->vulkan);
 
@@ -203,7 +240,7 @@ gsk_vulkan_render_remove_framebuffer_from_image (gpointer  data,
   g_slice_free (HashFramebufferEntry, fb);
 }
 
-static VkFramebuffer
+VkFramebuffer
 gsk_vulkan_render_get_framebuffer (GskVulkanRender *self,
                                    GskVulkanImage  *image)
 {
@@ -241,34 +278,111 @@ gsk_vulkan_render_add_cleanup_image (GskVulkanRender *self,
   self->cleanup_images = g_slist_prepend (self->cleanup_images, image);
 }
 
+int
+gsk_vulkan_render_get_scale_factor (GskVulkanRender *self)
+{
+  return self->scale_factor;
+}
+
 void
 gsk_vulkan_render_add_node (GskVulkanRender *self,
                             GskRenderNode   *node)
 {
-  GskVulkanRenderPass *pass = gsk_vulkan_render_pass_new (self->vulkan);
+  GskVulkanRenderPass *pass;
+
+  /* Only the damaged area of the window is redrawn, so the nodes
+   * outside of it can be skipped entirely
+   */
+  pass = gsk_vulkan_render_pass_new (self->vulkan,
+                                     self->target,
+                                     self->render_pass,
+                                     self->scale_factor,
+                                     &self->mvp,
+                                     &self->clip_bounds,
+                                     self->clip);
 
   self->render_passes = g_slist_prepend (self->render_passes, pass);
 
-  gsk_vulkan_render_pass_add (pass,
-                              self,
-                              &self->mvp,
-                              &GRAPHENE_RECT_INIT (
-                                  self->viewport.offset.x, self->viewport.offset.y,
-                                  self->viewport.extent.width, self->viewport.extent.height
-                              ),
-                              node);
+  gsk_vulkan_render_pass_add (pass, self, node);
+}
+
+/**
+ * gsk_vulkan_render_new_offscreen_pass:
+ * @self: a #GskVulkanRender
+ * @target: the image to draw to
+ * @bounds: the area of the nodes drawn to @target
+ *
+ * Creates a pass that draws @bounds into all of @target, so that
+ * other passes can sample from it. The pass needs to be added with
+ * gsk_vulkan_render_add_render_pass() once it is uploaded.
+ *
+ * Returns: (transfer full): a new #GskVulkanRenderPass
+ */
+GskVulkanRenderPass *
+gsk_vulkan_render_new_offscreen_pass (GskVulkanRender       *self,
+                                      GskVulkanImage        *target,
+                                      const graphene_rect_t *bounds)
+{
+  GskVulkanRenderPass *pass;
+  graphene_matrix_t modelview, projection, mvp;
+  cairo_region_t *clip;
+  int width, height;
+
+  width = gsk_vulkan_image_get_width (target);
+  height = gsk_vulkan_image_get_height (target);
+
+  graphene_matrix_init_translate (&modelview, &GRAPHENE_POINT3D_INIT (- bounds->origin.x, - bounds->origin.y, 0.0));
+  graphene_matrix_scale (&modelview, width / bounds->size.width, height / bounds->size.height, 1.0);
+  graphene_matrix_init_ortho (&projection,
+                              0, width,
+                              0, height,
+                              ORTHO_NEAR_PLANE,
+                              ORTHO_FAR_PLANE);
+  graphene_matrix_multiply (&modelview, &projection, &mvp);
+
+  clip = cairo_region_create_rectangle (&(cairo_rectangle_int_t) { 0, 0, width, height });
+
+  pass = gsk_vulkan_render_pass_new (self->vulkan,
+                                     target,
+                                     self->offscreen_render_pass,
+                                     1,
+                                     &mvp,
+                                     bounds,
+                                     clip);
+
+  cairo_region_destroy (clip);
+
+  return pass;
+}
+
+void
+gsk_vulkan_render_add_render_pass (GskVulkanRender     *self,
+                                   GskVulkanRenderPass *pass)
+{
+  self->render_passes = g_slist_prepend (self->render_passes, pass);
 }
 
 void
 gsk_vulkan_render_upload (GskVulkanRender *self)
 {
-  GSList *l;
+  GSList *l, *passes;
 
-  for (l = self->render_passes; l; l = l->next)
+  /* Uploading a pass adds the offscreen passes for the images it
+   * samples from, each after the ones it samples from itself, so
+   * adding the pass after them puts the list in reverse drawing order
+   */
+  passes = self->render_passes;
+  self->render_passes = NULL;
+
+  for (l = passes; l; l = l->next)
     {
       gsk_vulkan_render_pass_upload (l->data, self, self->uploader);
+      gsk_vulkan_render_add_render_pass (self, l->data);
     }
 
+  g_slist_free (passes);
+  self->render_passes = g_slist_reverse (self->render_passes);
+
   gsk_vulkan_uploader_upload (self->uploader);
 }
 
@@ -302,7 +416,7 @@ gsk_vulkan_render_collect_vertex_data (GskVulkanRender *self)
 
   for (l = self->render_passes; l; l = l->next)
     {
-      offset += gsk_vulkan_render_pass_collect_vertex_data (l->data, data, offset, n_bytes - offset);
+      offset += gsk_vulkan_render_pass_collect_vertex_data (l->data, self, data, offset, n_bytes - offset);
       g_assert (offset <= n_bytes);
     }
 
@@ -340,6 +454,15 @@ gsk_vulkan_render_get_pipeline (GskVulkanRender       *self,
     { "outset-shadow", gsk_vulkan_box_shadow_pipeline_new },
     { "outset-shadow-clip", gsk_vulkan_box_shadow_pipeline_new },
     { "outset-shadow-clip-rounded", gsk_vulkan_box_shadow_pipeline_new },
+    { "blur", gsk_vulkan_blur_pipeline_new },
+    { "blur-clip", gsk_vulkan_blur_pipeline_new },
+    { "blur-clip-rounded", gsk_vulkan_blur_pipeline_new },
+    { "blend-mode", gsk_vulkan_blend_mode_pipeline_new },
+    { "blend-mode-clip", gsk_vulkan_blend_mode_pipeline_new },
+    { "blend-mode-clip-rounded", gsk_vulkan_blend_mode_pipeline_new },
+    { "cross-fade", gsk_vulkan_cross_fade_pipeline_new },
+    { "cross-fade-clip", gsk_vulkan_cross_fade_pipeline_new },
+    { "cross-fade-clip-rounded", gsk_vulkan_cross_fade_pipeline_new },
   };
 
   g_return_val_if_fail (type < GSK_VULKAN_N_PIPELINES, NULL);
@@ -363,31 +486,44 @@ gsk_vulkan_render_get_descriptor_set (GskVulkanRender *self,
   return self->descriptor_sets[id];
 }
 
+static guint
+gsk_vulkan_render_get_n_descriptor_set_indexes (GskVulkanRender *self)
+{
+  guint i, n;
+
+  n = 0;
+  for (i = 0; i < GSK_VULKAN_N_SAMPLERS; i++)
+    n += g_hash_table_size (self->descriptor_set_indexes[i]);
+
+  return n;
+}
+
 gsize
-gsk_vulkan_render_reserve_descriptor_set (GskVulkanRender *self,
-                                          GskVulkanImage  *source)
+gsk_vulkan_render_reserve_descriptor_set (GskVulkanRender      *self,
+                                          GskVulkanImage       *source,
+                                          GskVulkanSamplerType  sampler)
 {
   gpointer id_plus_one;
 
-  id_plus_one = g_hash_table_lookup (self->descriptor_set_indexes, source);
+  id_plus_one = g_hash_table_lookup (self->descriptor_set_indexes[sampler], source);
   if (id_plus_one)
     return GPOINTER_TO_SIZE (id_plus_one) - 1;
 
-  id_plus_one = GSIZE_TO_POINTER (g_hash_table_size (self->descriptor_set_indexes) + 1);
-  g_hash_table_insert (self->descriptor_set_indexes, source, id_plus_one);
+  id_plus_one = GSIZE_TO_POINTER (gsk_vulkan_render_get_n_descriptor_set_indexes (self) + 1);
+  g_hash_table_insert (self->descriptor_set_indexes[sampler], source, id_plus_one);
   
   return GPOINTER_TO_SIZE (id_plus_one) - 1;
 }
 
 static void
 gsk_vulkan_render_prepare_descriptor_sets (GskVulkanRender *self,
-                                           VkSampler        sampler)
+                                           const VkSampler *samplers)
 {
   GHashTableIter iter;
   gpointer key, value;
   VkDevice device;
   GSList *l;
-  guint i, needed_sets;
+  guint i, j, needed_sets;
 
   device = gdk_vulkan_context_get_device (self->vulkan);
 
@@ -396,7 +532,7 @@ gsk_vulkan_render_prepare_descriptor_sets (GskVulkanRender *self,
       gsk_vulkan_render_pass_reserve_descriptor_sets (l->data, self);
     }
   
-  needed_sets = g_hash_table_size (self->descriptor_set_indexes);
+  needed_sets = gsk_vulkan_render_get_n_descriptor_set_indexes (self);
   if (needed_sets > self->n_descriptor_sets)
     {
       if (needed_sets > self->descriptor_pool_maxsets)
@@ -450,95 +586,52 @@ gsk_vulkan_render_prepare_descriptor_sets (GskVulkanRender *self,
                                           },
                                           self->descriptor_sets);
 
-  g_hash_table_iter_init (&iter, self->descriptor_set_indexes);
-  while (g_hash_table_iter_next (&iter, &key, &value))
+  for (j = 0; j < GSK_VULKAN_N_SAMPLERS; j++)
     {
-      GskVulkanImage *image = key;
-      gsize id = GPOINTER_TO_SIZE (value) - 1;
-
-      vkUpdateDescriptorSets (device,
-                              1,
-                              (VkWriteDescriptorSet[1]) {
-                                  {
-                                      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                                      .dstSet = self->descriptor_sets[id],
-                                      .dstBinding = 0,
-                                      .dstArrayElement = 0,
-                                      .descriptorCount = 1,
-                                      .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                      .pImageInfo = &(VkDescriptorImageInfo) {
-                                          .sampler = sampler,
-                                          .imageView = gsk_vulkan_image_get_image_view (image),
-                                          .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+      g_hash_table_iter_init (&iter, self->descriptor_set_indexes[j]);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        {
+          GskVulkanImage *image = key;
+          gsize id = GPOINTER_TO_SIZE (value) - 1;
+
+          vkUpdateDescriptorSets (device,
+                                  1,
+                                  (VkWriteDescriptorSet[1]) {
+                                      {
+                                          .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                          .dstSet = self->descriptor_sets[id],
+                                          .dstBinding = 0,
+                                          .dstArrayElement = 0,
+                                          .descriptorCount = 1,
+                                          .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                          .pImageInfo = &(VkDescriptorImageInfo) {
+                                              .sampler = samplers[j],
+                                              .imageView = gsk_vulkan_image_get_image_view (image),
+                                              .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                                          }
                                       }
-                                  }
-                              },
-                              0, NULL);
+                                  },
+                                  0, NULL);
+        }
     }
 }
 
 void
 gsk_vulkan_render_draw (GskVulkanRender   *self,
-                        VkSampler          sampler)
+                        const VkSampler   *samplers)
 {
   VkCommandBuffer command_buffer;
   GSList *l;
-  guint i;
 
-  gsk_vulkan_render_prepare_descriptor_sets (self, sampler);
+  gsk_vulkan_render_prepare_descriptor_sets (self, samplers);
 
   command_buffer = gsk_vulkan_command_pool_get_buffer (self->command_pool);
 
   self->vertex_buffer = gsk_vulkan_render_collect_vertex_data (self);
 
-  vkCmdSetViewport (command_buffer,
-                    0,
-                    1,
-                    &(VkViewport) {
-                      .x = 0,
-                      .y = 0,
-                      .width = self->viewport.extent.width,
-                      .height = self->viewport.extent.height,
-                      .minDepth = 0,
-                      .maxDepth = 1
-                    });
-
-  for (i = 0; i < cairo_region_num_rectangles (self->clip); i++)
+  for (l = self->render_passes; l; l = l->next)
     {
-      cairo_rectangle_int_t rect;
-
-      cairo_region_get_rectangle (self->clip, i, &rect);
-
-      vkCmdSetScissor (command_buffer,
-                       0,
-                       1,
-                       &(VkRect2D) {
-                           { rect.x * self->scale_factor, rect.y * self->scale_factor },
-                           { rect.width * self->scale_factor, rect.height * self->scale_factor }
-                       });
-
-      vkCmdBeginRenderPass (command_buffer,
-                            &(VkRenderPassBeginInfo) {
-                                .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-                                .renderPass = self->render_pass,
-                                .framebuffer = gsk_vulkan_render_get_framebuffer (self, self->target),
-                                .renderArea = { 
-                                    { rect.x * self->scale_factor, rect.y * self->scale_factor },
-                                    { rect.width * self->scale_factor, rect.height * self->scale_factor }
-                                },
-                                .clearValueCount = 1,
-                                .pClearValues = (VkClearValue [1]) {
-                                    { .color = { .float32 = { 0.f, 0.f, 0.f, 0.f } } }
-                                }
-                            },
-                            VK_SUBPASS_CONTENTS_INLINE);
-
-      for (l = self->render_passes; l; l = l->next)
-        {
-          gsk_vulkan_render_pass_draw (l->data, self, self->vertex_buffer, self->layout, command_buffer);
-        }
-
-      vkCmdEndRenderPass (command_buffer);
+      gsk_vulkan_render_pass_draw (l->data, self, self->vertex_buffer, self->layout, command_buffer);
     }
 
   gsk_vulkan_command_pool_submit_buffer (self->command_pool, command_buffer, self->fence);
@@ -565,6 +658,7 @@ static void
 gsk_vulkan_render_cleanup (GskVulkanRender *self)
 {
   VkDevice device = gdk_vulkan_context_get_device (self->vulkan);
+  guint i;
 
   /* XXX: Wait for fence here or just in reset()? */
   GSK_VK_CHECK (vkWaitForFences, device,
@@ -583,7 +677,8 @@ gsk_vulkan_render_cleanup (GskVulkanRender *self)
 
   g_clear_pointer (&self->vertex_buffer, gsk_vulkan_buffer_free);
 
-  g_hash_table_remove_all (self->descriptor_set_indexes);
+  for (i = 0; i < GSK_VULKAN_N_SAMPLERS; i++)
+    g_hash_table_remove_all (self->descriptor_set_indexes[i]);
   GSK_VK_CHECK (vkResetDescriptorPool, device,
                                        self->descriptor_pool,
                                        0);
@@ -633,12 +728,16 @@ gsk_vulkan_render_free (GskVulkanRender *self)
   vkDestroyRenderPass (device,
                        self->render_pass,
                        NULL);
+  vkDestroyRenderPass (device,
+                       self->offscreen_render_pass,
+                       NULL);
 
   vkDestroyDescriptorPool (device,
                            self->descriptor_pool,
                            NULL);
   g_free (self->descriptor_sets);
-  g_hash_table_unref (self->descriptor_set_indexes);
+  for (i = 0; i < GSK_VULKAN_N_SAMPLERS; i++)
+    g_hash_table_unref (self->descriptor_set_indexes[i]);
 
   vkDestroyFence (device,
                   self->fence,
@@ -3,9 +3,11 @@
 #include "gskvulkanrendererprivate.h"
 
 #include "gskdebugprivate.h"
+#include "gskglyphcacheprivate.h"
 #include "gskprivate.h"
 #include "gskrendererprivate.h"
 #include "gskrendernodeprivate.h"
+#include "gskroundedrectprivate.h"
 #include "gsktextureprivate.h"
 #include "gskvulkanbufferprivate.h"
 #include "gskvulkanimageprivate.h"
@@ -22,7 +24,29 @@ struct _GskVulkanTextureData {
   GskVulkanRenderer *renderer;
 };
 
+/* Images drawn with cairo are kept across frames, until they don't
+ * fit in the budget anymore; the least recently used go first
+ */
+#define IMAGE_CACHE_BUDGET_MB 64
+
+typedef struct _GskVulkanCachedImage GskVulkanCachedImage;
+
+struct _GskVulkanCachedImage {
+  GskVulkanCacheKey key;
+  GskVulkanImage *image;
+  gsize size;
+  GList link;
+};
+
 #ifdef G_ENABLE_DEBUG
+typedef struct {
+  GQuark upload_bytes;
+  GQuark image_cache_hits;
+  GQuark image_cache_misses;
+  GQuark image_cache_hit_rate;
+  GQuark image_cache_size;
+} ProfileCounters;
+
 typedef struct {
   GQuark cpu_time;
   GQuark gpu_time;
@@ -38,13 +62,20 @@ struct _GskVulkanRenderer
   guint n_targets;
   GskVulkanImage **targets;
 
-  VkSampler sampler;
+  VkSampler samplers[GSK_VULKAN_N_SAMPLERS];
 
   GskVulkanRender *render;
 
   GSList *textures;
 
+  GskGlyphCache *glyph_cache;
+
+  GHashTable *cached_images;
+  GQueue cached_images_lru;
+  gsize cached_images_size;
+
 #ifdef G_ENABLE_DEBUG
+  ProfileCounters profile_counters;
   ProfileTimers profile_timers;
 #endif
 };
@@ -56,6 +87,49 @@ struct _GskVulkanRendererClass
 
 G_DEFINE_TYPE (GskVulkanRenderer, gsk_vulkan_renderer, GSK_TYPE_RENDERER)
 
+static guint
+gsk_vulkan_cache_key_hash (gconstpointer data)
+{
+  const GskVulkanCacheKey *key = data;
+
+  return g_direct_hash (key->node) ^
+         ((guint) key->bounds.size.width << 16) ^
+         (guint) key->bounds.size.height;
+}
+
+static gboolean
+gsk_vulkan_cache_key_equal (gconstpointer a,
+                            gconstpointer b)
+{
+  const GskVulkanCacheKey *key_a = a;
+  const GskVulkanCacheKey *key_b = b;
+
+  return key_a->node == key_b->node &&
+         graphene_rect_equal (&key_a->bounds, &key_b->bounds) &&
+         gsk_rounded_rect_equal (&key_a->clip, &key_b->clip);
+}
+
+static void
+gsk_vulkan_renderer_free_cached_image (gpointer data)
+{
+  GskVulkanCachedImage *cached = data;
+
+  gsk_render_node_unref (cached->key.node);
+  g_object_unref (cached->image);
+
+  g_slice_free (GskVulkanCachedImage, cached);
+}
+
+static void
+gsk_vulkan_renderer_remove_cached_image (GskVulkanRenderer    *self,
+                                         GskVulkanCachedImage *cached)
+{
+  g_queue_unlink (&self->cached_images_lru, &cached->link);
+  self->cached_images_size -= cached->size;
+
+  g_hash_table_remove (self->cached_images, cached);
+}
+
 static void
 gsk_vulkan_renderer_free_targets (GskVulkanRenderer *self)
 {
@@ -124,7 +198,22 @@ gsk_vulkan_renderer_realize (GskRenderer  *renderer,
                                      .unnormalizedCoordinates = VK_FALSE
                                  },
                                  NULL,
-                                 &self->sampler);
+                                 &self->samplers[GSK_VULKAN_SAMPLER_DEFAULT]);
+
+  /* Used for the tiles of repeat nodes */
+  GSK_VK_CHECK (vkCreateSampler, device,
+                                 &(VkSamplerCreateInfo) {
+                                     .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+                                     .magFilter = VK_FILTER_LINEAR,
+                                     .minFilter = VK_FILTER_LINEAR,
+                                     .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+                                     .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+                                     .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+                                     .borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+                                     .unnormalizedCoordinates = VK_FALSE
+                                 },
+                                 NULL,
+                                 &self->samplers[GSK_VULKAN_SAMPLER_REPEAT]);
 
   g_signal_connect (self->vulkan,
                     "images-updated",
@@ -134,6 +223,15 @@ gsk_vulkan_renderer_realize (GskRenderer  *renderer,
 
   self->render = gsk_vulkan_render_new (renderer, self->vulkan);
 
+  self->glyph_cache = gsk_glyph_cache_new ();
+
+  self->cached_images = g_hash_table_new_full (gsk_vulkan_cache_key_hash,
+                                               gsk_vulkan_cache_key_equal,
+                                               NULL,
+                                               gsk_vulkan_renderer_free_cached_image);
+  g_queue_init (&self->cached_images_lru);
+  self->cached_images_size = 0;
+
   return TRUE;
 }
 
@@ -143,6 +241,13 @@ gsk_vulkan_renderer_unrealize (GskRenderer *renderer)
   GskVulkanRenderer *self = GSK_VULKAN_RENDERER (renderer);
   VkDevice device;
   GSList *l;
+  guint i;
+
+  g_clear_pointer (&self->glyph_cache, gsk_glyph_cache_free);
+
+  g_queue_init (&self->cached_images_lru);
+  g_clear_pointer (&self->cached_images, g_hash_table_unref);
+  self->cached_images_size = 0;
 
   for (l = self->textures; l; l = l->next)
     {
@@ -162,14 +267,33 @@ gsk_vulkan_renderer_unrealize (GskRenderer *renderer)
                                        gsk_vulkan_renderer_update_images_cb,
                                        self);
 
-  vkDestroySampler (device,
-                    self->sampler,
-                    NULL);
-  self->sampler = VK_NULL_HANDLE;
+  for (i = 0; i < GSK_VULKAN_N_SAMPLERS; i++)
+    {
+      vkDestroySampler (device,
+                        self->samplers[i],
+                        NULL);
+      self->samplers[i] = VK_NULL_HANDLE;
+    }
 
   g_clear_object (&self->vulkan);
 }
 
+#ifdef G_ENABLE_DEBUG
+static void
+gsk_vulkan_renderer_update_cache_counters (GskVulkanRenderer *self)
+{
+  GskProfiler *profiler = gsk_renderer_get_profiler (GSK_RENDERER (self));
+  gint64 hits, misses;
+
+  hits = gsk_profiler_counter_get (profiler, self->profile_counters.image_cache_hits);
+  misses = gsk_profiler_counter_get (profiler, self->profile_counters.image_cache_misses);
+  if (hits + misses > 0)
+    gsk_profiler_counter_set (profiler, self->profile_counters.image_cache_hit_rate, hits * 100 / (hits + misses));
+
+  gsk_profiler_counter_set (profiler, self->profile_counters.image_cache_size, self->cached_images_size / 1024);
+}
+#endif
+
 static GskTexture *
 gsk_vulkan_renderer_render_texture (GskRenderer           *renderer,
                                     GskRenderNode         *root,
@@ -197,11 +321,12 @@ gsk_vulkan_renderer_render_texture (GskRenderer           *renderer,
 
   gsk_vulkan_render_reset (render, image, viewport);
 
+  gsk_glyph_cache_begin_frame (self->glyph_cache);
   gsk_vulkan_render_add_node (render, root);
 
   gsk_vulkan_render_upload (render);
 
-  gsk_vulkan_render_draw (render, self->sampler);
+  gsk_vulkan_render_draw (render, self->samplers);
 
   texture = gsk_vulkan_render_download_target (render);
 
@@ -209,6 +334,8 @@ gsk_vulkan_renderer_render_texture (GskRenderer           *renderer,
   gsk_vulkan_render_free (render);
 
 #ifdef G_ENABLE_DEBUG
+  gsk_vulkan_renderer_update_cache_counters (self);
+
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
   gsk_profiler_timer_set (profiler, self->profile_timers.cpu_time, cpu_time);
 
@@ -238,13 +365,16 @@ gsk_vulkan_renderer_render (GskRenderer   *renderer,
 
   gsk_vulkan_render_reset (render, self->targets[gdk_vulkan_context_get_draw_index (self->vulkan)], NULL);
 
+  gsk_glyph_cache_begin_frame (self->glyph_cache);
   gsk_vulkan_render_add_node (render, root);
 
   gsk_vulkan_render_upload (render);
 
-  gsk_vulkan_render_draw (render, self->sampler);
+  gsk_vulkan_render_draw (render, self->samplers);
 
 #ifdef G_ENABLE_DEBUG
+  gsk_vulkan_renderer_update_cache_counters (self);
+
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
   gsk_profiler_timer_set (profiler, self->profile_timers.cpu_time, cpu_time);
 
@@ -288,6 +418,12 @@ gsk_vulkan_renderer_init (GskVulkanRenderer *self)
   gsk_ensure_resources ();
 
 #ifdef G_ENABLE_DEBUG
+  self->profile_counters.upload_bytes = gsk_profiler_add_counter (profiler, "upload-bytes", "Uploaded bytes", TRUE);
+  self->profile_counters.image_cache_hits = gsk_profiler_add_counter (profiler, "image-cache-hits", "Cached images reused", TRUE);
+  self->profile_counters.image_cache_misses = gsk_profiler_add_counter (profiler, "image-cache-misses", "Cached images missing", TRUE);
+  self->profile_counters.image_cache_hit_rate = gsk_profiler_add_counter (profiler, "image-cache-hit-rate", "Image cache hit rate (%)", FALSE);
+  self->profile_counters.image_cache_size = gsk_profiler_add_counter (profiler, "image-cache-size", "Image cache size (kB)", FALSE);
+
   self->profile_timers.cpu_time = gsk_profiler_add_timer (profiler, "cpu-time", "CPU time", FALSE, TRUE);
 #endif
 }
@@ -326,6 +462,12 @@ gsk_vulkan_renderer_ref_texture_image (GskVulkanRenderer *self,
                                           cairo_image_surface_get_stride (surface));
   cairo_surface_destroy (surface);
 
+#ifdef G_ENABLE_DEBUG
+  gsk_profiler_counter_add (gsk_renderer_get_profiler (GSK_RENDERER (self)),
+                            self->profile_counters.upload_bytes,
+                            gsk_vulkan_image_get_width (image) * gsk_vulkan_image_get_height (image) * 4);
+#endif
+
   data = g_slice_new0 (GskVulkanTextureData);
   data->image = image;
   data->texture = texture;
@@ -343,3 +485,104 @@ gsk_vulkan_renderer_ref_texture_image (GskVulkanRenderer *self,
 
   return image;
 }
+
+/**
+ * gsk_vulkan_renderer_ref_cached_image:
+ * @self: a #GskVulkanRenderer
+ * @key: the description of the image
+ *
+ * Looks up an image that was added to the cache with
+ * gsk_vulkan_renderer_cache_image() in this or a previous frame.
+ *
+ * Returns: (transfer full) (nullable): the image, or %NULL
+ */
+GskVulkanImage *
+gsk_vulkan_renderer_ref_cached_image (GskVulkanRenderer       *self,
+                                      const GskVulkanCacheKey *key)
+{
+  GskVulkanCachedImage *cached;
+
+  cached = g_hash_table_lookup (self->cached_images, key);
+
+#ifdef G_ENABLE_DEBUG
+  gsk_profiler_counter_inc (gsk_renderer_get_profiler (GSK_RENDERER (self)),
+                            cached ? self->profile_counters.image_cache_hits
+                                   : self->profile_counters.image_cache_misses);
+#endif
+
+  if (cached == NULL)
+    return NULL;
+
+  g_queue_unlink (&self->cached_images_lru, &cached->link);
+  g_queue_push_head_link (&self->cached_images_lru, &cached->link);
+
+  return g_object_ref (cached->image);
+}
+
+/**
+ * gsk_vulkan_renderer_cache_image:
+ * @self: a #GskVulkanRenderer
+ * @key: the description of the image
+ * @image: the image that was uploaded
+ *
+ * Keeps @image around for the next frames, so that it doesn't need
+ * to be drawn and uploaded again. Images that were used least recently
+ * are dropped when the cache exceeds its budget; the render still owns
+ * a reference to the images it uses, so they stay valid until the frame
+ * is done.
+ */
+void
+gsk_vulkan_renderer_cache_image (GskVulkanRenderer       *self,
+                                 const GskVulkanCacheKey *key,
+                                 GskVulkanImage          *image)
+{
+  GskVulkanCachedImage *cached;
+  gsize size;
+
+  size = gsk_vulkan_image_get_width (image) * gsk_vulkan_image_get_height (image) * 4;
+
+#ifdef G_ENABLE_DEBUG
+  gsk_profiler_counter_add (gsk_renderer_get_profiler (GSK_RENDERER (self)),
+                            self->profile_counters.upload_bytes,
+                            size);
+#endif
+
+  /* Images that could not stay in the cache anyway are not worth
+   * evicting everything else for
+   */
+  if (size > IMAGE_CACHE_BUDGET_MB * 1024 * 1024 / 4)
+    return;
+
+  cached = g_hash_table_lookup (self->cached_images, key);
+  if (cached)
+    gsk_vulkan_renderer_remove_cached_image (self, cached);
+
+  cached = g_slice_new0 (GskVulkanCachedImage);
+  cached->key = *key;
+  cached->key.node = gsk_render_node_ref (key->node);
+  cached->image = g_object_ref (image);
+  cached->size = size;
+  cached->link.data = cached;
+
+  g_hash_table_add (self->cached_images, cached);
+  g_queue_push_head_link (&self->cached_images_lru, &cached->link);
+  self->cached_images_size += size;
+
+  while (self->cached_images_size > IMAGE_CACHE_BUDGET_MB * 1024 * 1024)
+    {
+      GskVulkanCachedImage *last = g_queue_peek_tail (&self->cached_images_lru);
+
+      GSK_NOTE (VULKAN, g_print ("Dropping %zux%zu image of node '%s' from the cache\n",
+                                 gsk_vulkan_image_get_width (last->image),
+                                 gsk_vulkan_image_get_height (last->image),
+                                 last->key.node->node_class->type_name));
+
+      gsk_vulkan_renderer_remove_cached_image (self, last);
+    }
+}
+
+GskGlyphCache *
+gsk_vulkan_renderer_get_glyph_cache (GskVulkanRenderer *self)
+{
+  return self->glyph_cache;
+}
@@ -4,6 +4,7 @@
 #include <vulkan/vulkan.h>
 #include <gsk/gskrenderer.h>
 
+#include "gsk/gskglyphcacheprivate.h"
 #include "gsk/gskvulkanimageprivate.h"
 
 G_BEGIN_DECLS
@@ -18,6 +19,19 @@ G_BEGIN_DECLS
 
 typedef struct _GskVulkanRenderer                GskVulkanRenderer;
 typedef struct _GskVulkanRendererClass           GskVulkanRendererClass;
+typedef struct _GskVulkanCacheKey                GskVulkanCacheKey;
+
+struct _GskVulkanCacheKey
+{
+  /* The node that was drawn into the image */
+  GskRenderNode *node;
+
+  /* The area of the node covered by the image */
+  graphene_rect_t bounds;
+
+  /* The clip applied while drawing; the bounds when not clipped */
+  GskRoundedRect clip;
+};
 
 GType gsk_vulkan_renderer_get_type (void) G_GNUC_CONST;
 
@@ -25,6 +39,14 @@ GskVulkanImage *        gsk_vulkan_renderer_ref_texture_image           (GskVulk
                                                                          GskTexture             *texture,
                                                                          GskVulkanUploader      *uploader);
 
+GskVulkanImage *        gsk_vulkan_renderer_ref_cached_image            (GskVulkanRenderer      *self,
+                                                                         const GskVulkanCacheKey *key);
+void                    gsk_vulkan_renderer_cache_image                 (GskVulkanRenderer      *self,
+                                                                         const GskVulkanCacheKey *key,
+                                                                         GskVulkanImage         *image);
+
+GskGlyphCache *         gsk_vulkan_renderer_get_glyph_cache             (GskVulkanRenderer      *self);
+
 G_END_DECLS
 
 #endif /* __GSK_VULKAN_RENDERER_PRIVATE_H__ */
@@ -6,19 +6,28 @@
 #include "gskrendernodeprivate.h"
 #include "gskrenderer.h"
 #include "gskroundedrectprivate.h"
+#include "gskcairoblurprivate.h"
+#include "gskvulkanblendmodepipelineprivate.h"
 #include "gskvulkanblendpipelineprivate.h"
+#include "gskvulkanblurpipelineprivate.h"
 #include "gskvulkanborderpipelineprivate.h"
 #include "gskvulkanboxshadowpipelineprivate.h"
 #include "gskvulkanclipprivate.h"
 #include "gskvulkancolorpipelineprivate.h"
+#include "gskvulkancrossfadepipelineprivate.h"
 #include "gskvulkaneffectpipelineprivate.h"
 #include "gskvulkanlineargradientpipelineprivate.h"
 #include "gskvulkanimageprivate.h"
 #include "gskvulkanpushconstantsprivate.h"
 #include "gskvulkanrendererprivate.h"
 
+#include <math.h>
+
 typedef union _GskVulkanOp GskVulkanOp;
 typedef struct _GskVulkanOpRender GskVulkanOpRender;
+typedef struct _GskVulkanOpText GskVulkanOpText;
+typedef struct _GskVulkanOpShadow GskVulkanOpShadow;
+typedef struct _GskVulkanOpBlur GskVulkanOpBlur;
 typedef struct _GskVulkanOpPushConstants GskVulkanOpPushConstants;
 
 typedef enum {
@@ -35,6 +44,15 @@ typedef enum {
   GSK_VULKAN_OP_BORDER,
   GSK_VULKAN_OP_INSET_SHADOW,
   GSK_VULKAN_OP_OUTSET_SHADOW,
+  GSK_VULKAN_OP_REPEAT,
+  GSK_VULKAN_OP_BLEND_MODE,
+  GSK_VULKAN_OP_CROSS_FADE,
+  /* GskVulkanOpText */
+  GSK_VULKAN_OP_TEXT,
+  /* GskVulkanOpShadow */
+  GSK_VULKAN_OP_SHADOW,
+  /* GskVulkanOpBlur */
+  GSK_VULKAN_OP_BLUR,
   /* GskVulkanOpPushConstants */
   GSK_VULKAN_OP_PUSH_VERTEX_CONSTANTS
 } GskVulkanOpType;
@@ -49,6 +67,51 @@ struct _GskVulkanOpRender
   gsize                vertex_offset; /* offset into vertex buffer */
   gsize                vertex_count; /* number of vertices */
   gsize                descriptor_set_index; /* index into descriptor sets array for the right descriptor set to bind */
+  GskVulkanImage      *source2; /* second source image for ops that sample from two images */
+  gsize                descriptor_set_index2; /* descriptor set index for source2 */
+};
+
+struct _GskVulkanOpText
+{
+  GskVulkanOpType      type;
+  GskRenderNode       *node; /* node that's the source of this op */
+  GskVulkanPipeline   *pipeline; /* pipeline to use */
+  GskRoundedRect       clip; /* clip rect (or random memory if not relevant) */
+  GskVulkanImage      *source; /* source image to render */
+  gsize                vertex_offset; /* offset into vertex buffer */
+  gsize                vertex_count; /* number of vertices */
+  gsize                descriptor_set_index; /* index into descriptor sets array for the right descriptor set to bind */
+  guint                page; /* glyph cache page containing all the glyphs */
+  guint                num_glyphs; /* number of glyphs with ink */
+};
+
+struct _GskVulkanOpShadow
+{
+  GskVulkanOpType      type;
+  GskRenderNode       *node; /* node that's the source of this op */
+  GskVulkanPipeline   *pipeline; /* pipeline to use */
+  GskRoundedRect       clip; /* clip rect (or random memory if not relevant) */
+  GskVulkanImage      *source; /* source image to render */
+  gsize                vertex_offset; /* offset into vertex buffer */
+  gsize                vertex_count; /* number of vertices */
+  gsize                descriptor_set_index; /* index into descriptor sets array for the right descriptor set to bind */
+  gsize                shadow; /* index of the shadow in the shadow node */
+  graphene_rect_t      source_rect; /* area of the node covered by source */
+};
+
+struct _GskVulkanOpBlur
+{
+  GskVulkanOpType      type;
+  GskRenderNode       *node; /* node that's the source of this op */
+  GskVulkanPipeline   *pipeline; /* pipeline to use */
+  GskRoundedRect       clip; /* clip rect (or random memory if not relevant) */
+  GskVulkanImage      *source; /* source image to render */
+  gsize                vertex_offset; /* offset into vertex buffer */
+  gsize                vertex_count; /* number of vertices */
+  gsize                descriptor_set_index; /* index into descriptor sets array for the right descriptor set to bind */
+  graphene_rect_t      rect; /* area of the node covered by source */
+  float                step[2]; /* distance between two texels along the blurred axis */
+  float                sigma; /* standard deviation of the blur, in texels */
 };
 
 struct _GskVulkanOpPushConstants
@@ -62,6 +125,9 @@ union _GskVulkanOp
 {
   GskVulkanOpType          type;
   GskVulkanOpRender        render;
+  GskVulkanOpText          text;
+  GskVulkanOpShadow        shadow;
+  GskVulkanOpBlur          blur;
   GskVulkanOpPushConstants constants;
 };
 
@@ -70,10 +136,23 @@ struct _GskVulkanRenderPass
   GdkVulkanContext *vulkan;
 
   GArray *render_ops;
+
+  GskVulkanImage *target;
+  VkRenderPass render_pass;
+  int scale_factor;
+  graphene_matrix_t mvp;
+  graphene_rect_t viewport;
+  cairo_region_t *clip;
 };
 
 GskVulkanRenderPass *
-gsk_vulkan_render_pass_new (GdkVulkanContext *context)
+gsk_vulkan_render_pass_new (GdkVulkanContext        *context,
+                            GskVulkanImage          *target,
+                            VkRenderPass             render_pass,
+                            int                      scale_factor,
+                            const graphene_matrix_t *mvp,
+                            const graphene_rect_t   *viewport,
+                            const cairo_region_t    *clip)
 {
   GskVulkanRenderPass *self;
 
@@ -81,6 +160,13 @@ gsk_vulkan_render_pass_new (GdkVulkanContext *context)
   self->vulkan = g_object_ref (context);
   self->render_ops = g_array_new (FALSE, FALSE, sizeof (GskVulkanOp));
 
+  self->target = g_object_ref (target);
+  self->render_pass = render_pass;
+  self->scale_factor = scale_factor;
+  graphene_matrix_init_from_matrix (&self->mvp, mvp);
+  self->viewport = *viewport;
+  self->clip = cairo_region_copy (clip);
+
   return self;
 }
 
@@ -89,10 +175,61 @@ gsk_vulkan_render_pass_free (GskVulkanRenderPass *self)
 {
   g_array_unref (self->render_ops);
   g_object_unref (self->vulkan);
+  g_object_unref (self->target);
+  cairo_region_destroy (self->clip);
 
   g_slice_free (GskVulkanRenderPass, self);
 }
 
+/* Adds the glyphs of @node to the glyph cache, and finds the page
+ * containing them; the color matrix pipeline can only sample from a
+ * single image per op, so we fail if the glyphs end up in different
+ * pages
+ */
+static gboolean
+gsk_vulkan_render_pass_cache_glyphs (GskVulkanRender *render,
+                                     GskRenderNode   *node,
+                                     guint           *page,
+                                     guint           *num_glyphs)
+{
+  GskRenderer *renderer = gsk_vulkan_render_get_renderer (render);
+  GskGlyphCache *cache = gsk_vulkan_renderer_get_glyph_cache (GSK_VULKAN_RENDERER (renderer));
+  const PangoGlyphInfo *glyphs = gsk_text_node_peek_glyphs (node);
+  guint i, n_glyphs = gsk_text_node_get_num_glyphs (node);
+  int scale = gsk_renderer_get_scale_factor (renderer);
+  gboolean has_page = FALSE;
+
+  *page = 0;
+  *num_glyphs = 0;
+
+  for (i = 0; i < n_glyphs; i++)
+    {
+      const GskCachedGlyph *glyph;
+
+      if (glyphs[i].glyph == PANGO_GLYPH_EMPTY)
+        continue;
+
+      glyph = gsk_glyph_cache_lookup (cache,
+                                      gsk_text_node_peek_font (node),
+                                      glyphs[i].glyph,
+                                      scale);
+      if (glyph == NULL)
+        return FALSE;
+
+      if (glyph->draw_area.size.width == 0.f)
+        continue;
+
+      if (has_page && glyph->page != *page)
+        return FALSE;
+
+      *page = glyph->page;
+      has_page = TRUE;
+      (*num_glyphs)++;
+    }
+
+  return TRUE;
+}
+
 #define FALLBACK(...) G_STMT_START { \
   GSK_NOTE (FALLBACK, g_print (__VA_ARGS__)); \
   goto fallback; \
@@ -110,22 +247,120 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
   };
   GskVulkanPipelineType pipeline_type;
 
+  /* The clip starts out as the area being redrawn, so this also
+   * skips the nodes outside of the damage of the window
+   */
+  if (!graphene_rect_intersection (&constants->clip.rect.bounds, &node->bounds, NULL))
+    {
+      GSK_NOTE (VULKAN, g_print ("Skipping node '%s' outside of the clip\n", node->node_class->type_name));
+      return;
+    }
+
   switch (gsk_render_node_get_node_type (node))
     {
     case GSK_NOT_A_RENDER_NODE:
       g_assert_not_reached ();
       return;
+    default:
+      FALLBACK ("Unsupported node '%s'\n", node->node_class->type_name);
+
     case GSK_REPEAT_NODE:
+      {
+        const graphene_rect_t *child_bounds = gsk_repeat_node_peek_child_bounds (node);
+
+        if (child_bounds->size.width <= 0 || child_bounds->size.height <= 0)
+          return;
+      }
+      if (gsk_vulkan_clip_contains_rect (&constants->clip, &node->bounds))
+        pipeline_type = GSK_VULKAN_PIPELINE_BLEND;
+      else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
+        pipeline_type = GSK_VULKAN_PIPELINE_BLEND_CLIP;
+      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+        pipeline_type = GSK_VULKAN_PIPELINE_BLEND_CLIP_ROUNDED;
+      else
+        FALLBACK ("Repeat nodes can't deal with clip type %u\n", constants->clip.type);
+      op.type = GSK_VULKAN_OP_REPEAT;
+      op.render.pipeline = gsk_vulkan_render_get_pipeline (render, pipeline_type);
+      g_array_append_val (self->render_ops, op);
+      return;
+
     case GSK_SHADOW_NODE:
+      {
+        gsize i;
+
+        if (gsk_vulkan_clip_contains_rect (&constants->clip, &node->bounds))
+          pipeline_type = GSK_VULKAN_PIPELINE_COLOR_MATRIX;
+        else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
+          pipeline_type = GSK_VULKAN_PIPELINE_COLOR_MATRIX_CLIP;
+        else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+          pipeline_type = GSK_VULKAN_PIPELINE_COLOR_MATRIX_CLIP_ROUNDED;
+        else
+          FALLBACK ("Shadow nodes can't deal with clip type %u\n", constants->clip.type);
+
+        /* Each shadow is drawn from a (blurred) image of the child,
+         * which is drawn on top of them as usual
+         */
+        for (i = 0; i < gsk_shadow_node_get_n_shadows (node); i++)
+          {
+            if (gdk_rgba_is_clear (&gsk_shadow_node_peek_shadow (node, i)->color))
+              continue;
+
+            op.type = GSK_VULKAN_OP_SHADOW;
+            op.shadow.pipeline = gsk_vulkan_render_get_pipeline (render, pipeline_type);
+            op.shadow.shadow = i;
+            g_array_append_val (self->render_ops, op);
+          }
+
+        gsk_vulkan_render_pass_add_node (self, render, constants, gsk_shadow_node_get_child (node));
+      }
+      return;
+
     case GSK_BLEND_NODE:
+      if (gsk_blend_node_get_blend_mode (node) == GSK_BLEND_MODE_DEFAULT)
+        {
+          gsk_vulkan_render_pass_add_node (self, render, constants, gsk_blend_node_get_bottom_child (node));
+          gsk_vulkan_render_pass_add_node (self, render, constants, gsk_blend_node_get_top_child (node));
+          return;
+        }
+      if (gsk_vulkan_clip_contains_rect (&constants->clip, &node->bounds))
+        pipeline_type = GSK_VULKAN_PIPELINE_BLEND_MODE;
+      else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
+        pipeline_type = GSK_VULKAN_PIPELINE_BLEND_MODE_CLIP;
+      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+        pipeline_type = GSK_VULKAN_PIPELINE_BLEND_MODE_CLIP_ROUNDED;
+      else
+        FALLBACK ("Blend nodes can't deal with clip type %u\n", constants->clip.type);
+      op.type = GSK_VULKAN_OP_BLEND_MODE;
+      op.render.pipeline = gsk_vulkan_render_get_pipeline (render, pipeline_type);
+      g_array_append_val (self->render_ops, op);
+      return;
+
     case GSK_CROSS_FADE_NODE:
-    default:
-      FALLBACK ("Unsupported node '%s'\n", node->node_class->type_name);
+      if (gsk_cross_fade_node_get_progress (node) <= 0.0)
+        {
+          gsk_vulkan_render_pass_add_node (self, render, constants, gsk_cross_fade_node_get_start_child (node));
+          return;
+        }
+      if (gsk_cross_fade_node_get_progress (node) >= 1.0)
+        {
+          gsk_vulkan_render_pass_add_node (self, render, constants, gsk_cross_fade_node_get_end_child (node));
+          return;
+        }
+      if (gsk_vulkan_clip_contains_rect (&constants->clip, &node->bounds))
+        pipeline_type = GSK_VULKAN_PIPELINE_CROSS_FADE;
+      else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
+        pipeline_type = GSK_VULKAN_PIPELINE_CROSS_FADE_CLIP;
+      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+        pipeline_type = GSK_VULKAN_PIPELINE_CROSS_FADE_CLIP_ROUNDED;
+      else
+        FALLBACK ("Cross fade nodes can't deal with clip type %u\n", constants->clip.type);
+      op.type = GSK_VULKAN_OP_CROSS_FADE;
+      op.render.pipeline = gsk_vulkan_render_get_pipeline (render, pipeline_type);
+      g_array_append_val (self->render_ops, op);
+      return;
 
     case GSK_INSET_SHADOW_NODE:
-      if (gsk_inset_shadow_node_get_blur_radius (node) > 0)
-        FALLBACK ("Blur support not implemented for inset shadows\n");
-      else if (gsk_vulkan_clip_contains_rect (&constants->clip, &node->bounds))
+      if (gsk_vulkan_clip_contains_rect (&constants->clip, &node->bounds))
         pipeline_type = GSK_VULKAN_PIPELINE_INSET_SHADOW;
       else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
         pipeline_type = GSK_VULKAN_PIPELINE_INSET_SHADOW_CLIP;
@@ -139,9 +374,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
       return;
 
     case GSK_OUTSET_SHADOW_NODE:
-      if (gsk_outset_shadow_node_get_blur_radius (node) > 0)
-        FALLBACK ("Blur support not implemented for outset shadows\n");
-      else if (gsk_vulkan_clip_contains_rect (&constants->clip, &node->bounds))
+      if (gsk_vulkan_clip_contains_rect (&constants->clip, &node->bounds))
         pipeline_type = GSK_VULKAN_PIPELINE_OUTSET_SHADOW;
       else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
         pipeline_type = GSK_VULKAN_PIPELINE_OUTSET_SHADOW_CLIP;
@@ -184,6 +417,24 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
       g_array_append_val (self->render_ops, op);
       return;
 
+    case GSK_TEXT_NODE:
+      if (!gsk_vulkan_render_pass_cache_glyphs (render, node, &op.text.page, &op.text.num_glyphs))
+        FALLBACK ("Text node glyphs don't fit in a single glyph cache page\n");
+      if (op.text.num_glyphs == 0)
+        return;
+      if (gsk_vulkan_clip_contains_rect (&constants->clip, &node->bounds))
+        pipeline_type = GSK_VULKAN_PIPELINE_COLOR_MATRIX;
+      else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
+        pipeline_type = GSK_VULKAN_PIPELINE_COLOR_MATRIX_CLIP;
+      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+        pipeline_type = GSK_VULKAN_PIPELINE_COLOR_MATRIX_CLIP_ROUNDED;
+      else
+        FALLBACK ("Text nodes can't deal with clip type %u\n", constants->clip.type);
+      op.type = GSK_VULKAN_OP_TEXT;
+      op.text.pipeline = gsk_vulkan_render_get_pipeline (render, pipeline_type);
+      g_array_append_val (self->render_ops, op);
+      return;
+
     case GSK_COLOR_NODE:
       if (gsk_vulkan_clip_contains_rect (&constants->clip, &node->bounds))
         pipeline_type = GSK_VULKAN_PIPELINE_COLOR;
@@ -265,6 +516,12 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
 
         for (i = 0; i < gsk_container_node_get_n_children (node); i++)
           {
+            const graphene_rect_t *visible = gsk_container_node_peek_visible_bounds (node, i);
+
+            /* Hidden below an opaque sibling */
+            if (visible->size.width <= 0 || visible->size.height <= 0)
+              continue;
+
             gsk_vulkan_render_pass_add_node (self, render, constants, gsk_container_node_get_child (node, i));
           }
       }
@@ -361,19 +618,94 @@ fallback:
 void
 gsk_vulkan_render_pass_add (GskVulkanRenderPass     *self,
                             GskVulkanRender         *render,
-                            const graphene_matrix_t *mvp,
-                            const graphene_rect_t   *viewport,
                             GskRenderNode           *node)
 {
   GskVulkanOp op = { 0, };
 
   op.type = GSK_VULKAN_OP_PUSH_VERTEX_CONSTANTS;
-  gsk_vulkan_push_constants_init (&op.constants.constants, mvp, viewport);
+  gsk_vulkan_push_constants_init (&op.constants.constants, &self->mvp, &self->viewport);
   g_array_append_val (self->render_ops, op);
 
   gsk_vulkan_render_pass_add_node (self, render, &op.constants.constants, node);
 }
 
+static void
+gsk_vulkan_cache_key_init (GskVulkanCacheKey     *key,
+                           GskRenderNode         *node,
+                           const graphene_rect_t *bounds,
+                           const GskRoundedRect  *clip)
+{
+  key->node = node;
+  key->bounds = *bounds;
+  if (clip)
+    gsk_rounded_rect_init_copy (&key->clip, clip);
+  else
+    gsk_rounded_rect_init_from_rect (&key->clip, bounds, 0);
+}
+
+/* Images drawn with cairo are cached by the renderer, so that they
+ * are only drawn and uploaded again when the nodes change
+ */
+static GskVulkanImage *
+gsk_vulkan_render_pass_ref_cached_image (GskVulkanRender         *render,
+                                         const GskVulkanCacheKey *key)
+{
+  GskVulkanImage *result;
+
+  result = gsk_vulkan_renderer_ref_cached_image (GSK_VULKAN_RENDERER (gsk_vulkan_render_get_renderer (render)), key);
+  if (result)
+    gsk_vulkan_render_add_cleanup_image (render, result);
+
+  return result;
+}
+
+static GskVulkanImage *
+gsk_vulkan_render_pass_upload_surface (GskVulkanRender         *render,
+                                       GskVulkanUploader       *uploader,
+                                       const GskVulkanCacheKey *key,
+                                       cairo_surface_t         *surface)
+{
+  GskVulkanImage *result;
+
+  result = gsk_vulkan_image_new_from_data (uploader,
+                                           cairo_image_surface_get_data (surface),
+                                           cairo_image_surface_get_width (surface),
+                                           cairo_image_surface_get_height (surface),
+                                           cairo_image_surface_get_stride (surface));
+
+  gsk_vulkan_renderer_cache_image (GSK_VULKAN_RENDERER (gsk_vulkan_render_get_renderer (render)), key, result);
+  gsk_vulkan_render_add_cleanup_image (render, result);
+
+  return result;
+}
+
+/* Draws @node into a new image with a pass of its own, which is drawn
+ * before the passes that sample from the image
+ */
+static GskVulkanImage *
+gsk_vulkan_render_pass_render_offscreen (GskVulkanRenderPass   *self,
+                                         GskVulkanRender       *render,
+                                         GskVulkanUploader     *uploader,
+                                         GskRenderNode         *node,
+                                         const graphene_rect_t *bounds)
+{
+  int scale_factor = gsk_vulkan_render_get_scale_factor (render);
+  GskVulkanRenderPass *pass;
+  GskVulkanImage *result;
+
+  result = gsk_vulkan_image_new_for_framebuffer (self->vulkan,
+                                                 MAX (1, ceil (bounds->size.width * scale_factor)),
+                                                 MAX (1, ceil (bounds->size.height * scale_factor)));
+  gsk_vulkan_render_add_cleanup_image (render, result);
+
+  pass = gsk_vulkan_render_new_offscreen_pass (render, result, bounds);
+  gsk_vulkan_render_pass_add (pass, render, node);
+  gsk_vulkan_render_pass_upload (pass, render, uploader);
+  gsk_vulkan_render_add_render_pass (render, pass);
+
+  return result;
+}
+
 static GskVulkanImage *
 gsk_vulkan_render_pass_get_node_as_texture (GskVulkanRenderPass   *self,
                                             GskVulkanRender       *render,
@@ -381,68 +713,144 @@ gsk_vulkan_render_pass_get_node_as_texture (GskVulkanRenderPass   *self,
                                             GskRenderNode         *node,
                                             const graphene_rect_t *bounds)
 {
+  GskVulkanCacheKey key;
   GskVulkanImage *result;
-  cairo_surface_t *surface;
-  cairo_t *cr;
 
-  if (graphene_rect_equal (bounds, &node->bounds))
+  if (graphene_rect_equal (bounds, &node->bounds) &&
+      gsk_render_node_get_node_type (node) == GSK_TEXTURE_NODE)
     {
-      switch (gsk_render_node_get_node_type (node))
-        {
-        case GSK_TEXTURE_NODE:
-          return gsk_vulkan_renderer_ref_texture_image (GSK_VULKAN_RENDERER (gsk_vulkan_render_get_renderer (render)),
-                                                        gsk_texture_node_get_texture (node),
-                                                        uploader);
-        case GSK_CAIRO_NODE:
-          surface = cairo_surface_reference (gsk_cairo_node_get_surface (node));
-          goto got_surface;
+      result = gsk_vulkan_renderer_ref_texture_image (GSK_VULKAN_RENDERER (gsk_vulkan_render_get_renderer (render)),
+                                                      gsk_texture_node_get_texture (node),
+                                                      uploader);
+      gsk_vulkan_render_add_cleanup_image (render, result);
+      return result;
+    }
 
-        default:
-          break;
-        }
+  if (graphene_rect_equal (bounds, &node->bounds) &&
+      gsk_render_node_get_node_type (node) == GSK_CAIRO_NODE &&
+      gsk_cairo_node_get_surface (node) != NULL)
+    {
+      gsk_vulkan_cache_key_init (&key, node, bounds, NULL);
+      result = gsk_vulkan_render_pass_ref_cached_image (render, &key);
+      if (result)
+        return result;
+
+      return gsk_vulkan_render_pass_upload_surface (render, uploader, &key, gsk_cairo_node_get_surface (node));
     }
 
-  GSK_NOTE (FALLBACK, g_print ("Node as texture not implemented. Using %gx%g fallback surface\n",
-                               ceil (bounds->size.width),
-                               ceil (bounds->size.height)));
+  return gsk_vulkan_render_pass_render_offscreen (self, render, uploader, node, bounds);
+}
 
-  /* XXX: We could intersect bounds with clip bounds here */
-  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-                                        ceil (bounds->size.width),
-                                        ceil (bounds->size.height));
-  cr = cairo_create (surface);
-  cairo_translate (cr, -bounds->origin.x, -bounds->origin.y);
+/* Blurs @source, an image of @bounds, along one axis with a gaussian
+ * of standard deviation @radius, which is what cairo uses for the
+ * blur radius of shadow nodes; blurring along both axes one after
+ * the other gives the full two-dimensional blur
+ */
+static GskVulkanImage *
+gsk_vulkan_render_pass_blur (GskVulkanRenderPass   *self,
+                             GskVulkanRender       *render,
+                             GskRenderNode         *node,
+                             GskVulkanImage        *source,
+                             const graphene_rect_t *bounds,
+                             float                  radius,
+                             gboolean               vertical)
+{
+  int scale_factor = gsk_vulkan_render_get_scale_factor (render);
+  gsize width = gsk_vulkan_image_get_width (source);
+  gsize height = gsk_vulkan_image_get_height (source);
+  GskVulkanRenderPass *pass;
+  GskVulkanImage *result;
+  GskVulkanOp op = { 0, };
 
-  gsk_render_node_draw (node, cr);
+  result = gsk_vulkan_image_new_for_framebuffer (self->vulkan, width, height);
+  gsk_vulkan_render_add_cleanup_image (render, result);
 
-  cairo_destroy (cr);
+  pass = gsk_vulkan_render_new_offscreen_pass (render, result, bounds);
 
-got_surface:
-  result = gsk_vulkan_image_new_from_data (uploader,
-                                           cairo_image_surface_get_data (surface),
-                                           cairo_image_surface_get_width (surface),
-                                           cairo_image_surface_get_height (surface),
-                                           cairo_image_surface_get_stride (surface));
+  op.type = GSK_VULKAN_OP_PUSH_VERTEX_CONSTANTS;
+  gsk_vulkan_push_constants_init (&op.constants.constants, &pass->mvp, &pass->viewport);
+  g_array_append_val (pass->render_ops, op);
 
-  cairo_surface_destroy (surface);
+  op.type = GSK_VULKAN_OP_BLUR;
+  op.blur.node = node;
+  op.blur.pipeline = gsk_vulkan_render_get_pipeline (render, GSK_VULKAN_PIPELINE_BLUR);
+  op.blur.source = source;
+  op.blur.rect = *bounds;
+  op.blur.step[0] = vertical ? 0.0 : 1.0 / width;
+  op.blur.step[1] = vertical ? 1.0 / height : 0.0;
+  op.blur.sigma = radius * scale_factor;
+  g_array_append_val (pass->render_ops, op);
 
-  gsk_vulkan_render_add_cleanup_image (render, result);
+  gsk_vulkan_render_add_render_pass (render, pass);
 
   return result;
 }
 
+static void
+gsk_vulkan_render_pass_upload_shadow (GskVulkanRenderPass *self,
+                                      GskVulkanOpShadow   *op,
+                                      const GskVulkanOp   *previous,
+                                      GskVulkanRender     *render,
+                                      GskVulkanUploader   *uploader)
+{
+  const GskShadow *shadow = gsk_shadow_node_peek_shadow (op->node, op->shadow);
+  GskRenderNode *child = gsk_shadow_node_get_child (op->node);
+  GskVulkanImage *image;
+  int padding;
+
+  /* Shadows of the same node with the same radius share their image */
+  if (previous &&
+      previous->type == GSK_VULKAN_OP_SHADOW &&
+      previous->shadow.node == op->node &&
+      gsk_shadow_node_peek_shadow (op->node, previous->shadow.shadow)->radius == shadow->radius)
+    {
+      op->source = previous->shadow.source;
+      op->source_rect = previous->shadow.source_rect;
+      return;
+    }
+
+  /* Like cairo, don't blur for radius 1 */
+  if (shadow->radius <= 1.0)
+    {
+      op->source_rect = child->bounds;
+      op->source = gsk_vulkan_render_pass_get_node_as_texture (self,
+                                                               render,
+                                                               uploader,
+                                                               child,
+                                                               &child->bounds);
+      return;
+    }
+
+  padding = gsk_cairo_blur_compute_pixels (shadow->radius);
+  op->source_rect = child->bounds;
+  graphene_rect_inset (&op->source_rect, - padding, - padding);
+
+  image = gsk_vulkan_render_pass_render_offscreen (self, render, uploader, child, &op->source_rect);
+  image = gsk_vulkan_render_pass_blur (self, render, op->node, image, &op->source_rect, shadow->radius, FALSE);
+  op->source = gsk_vulkan_render_pass_blur (self, render, op->node, image, &op->source_rect, shadow->radius, TRUE);
+}
+
 static void
 gsk_vulkan_render_pass_upload_fallback (GskVulkanRenderPass  *self,
                                         GskVulkanOpRender    *op,
                                         GskVulkanRender      *render,
                                         GskVulkanUploader    *uploader)
 {
+  GskVulkanCacheKey key;
   GskRenderNode *node;
   cairo_surface_t *surface;
   cairo_t *cr;
 
   node = op->node;
 
+  gsk_vulkan_cache_key_init (&key,
+                             node,
+                             &node->bounds,
+                             op->type == GSK_VULKAN_OP_FALLBACK ? NULL : &op->clip);
+  op->source = gsk_vulkan_render_pass_ref_cached_image (render, &key);
+  if (op->source)
+    return;
+
   /* XXX: We could intersect bounds with clip bounds here */
   surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
                                         ceil (node->bounds.size.width),
@@ -471,15 +879,9 @@ gsk_vulkan_render_pass_upload_fallback (GskVulkanRenderPass  *self,
 
   cairo_destroy (cr);
 
-  op->source = gsk_vulkan_image_new_from_data (uploader,
-                                               cairo_image_surface_get_data (surface),
-                                               cairo_image_surface_get_width (surface),
-                                               cairo_image_surface_get_height (surface),
-                                               cairo_image_surface_get_stride (surface));
+  op->source = gsk_vulkan_render_pass_upload_surface (render, uploader, &key, surface);
 
   cairo_surface_destroy (surface);
-
-  gsk_vulkan_render_add_cleanup_image (render, op->source);
 }
 
 void
@@ -503,15 +905,11 @@ gsk_vulkan_render_pass_upload (GskVulkanRenderPass  *self,
           break;
 
         case GSK_VULKAN_OP_SURFACE:
-          {
-            cairo_surface_t *surface = gsk_cairo_node_get_surface (op->render.node);
-            op->render.source = gsk_vulkan_image_new_from_data (uploader,
-                                                                cairo_image_surface_get_data (surface),
-                                                                cairo_image_surface_get_width (surface),
-                                                                cairo_image_surface_get_height (surface),
-                                                                cairo_image_surface_get_stride (surface));
-            gsk_vulkan_render_add_cleanup_image (render, op->render.source);
-          }
+          op->render.source = gsk_vulkan_render_pass_get_node_as_texture (self,
+                                                                          render,
+                                                                          uploader,
+                                                                          op->render.node,
+                                                                          &op->render.node->bounds);
           break;
 
         case GSK_VULKAN_OP_TEXTURE:
@@ -523,6 +921,21 @@ gsk_vulkan_render_pass_upload (GskVulkanRenderPass  *self,
           }
           break;
 
+        case GSK_VULKAN_OP_TEXT:
+          {
+            GskRenderer *renderer = gsk_vulkan_render_get_renderer (render);
+            GskGlyphCache *cache = gsk_vulkan_renderer_get_glyph_cache (GSK_VULKAN_RENDERER (renderer));
+
+            /* All the glyphs of the frame are in the cache at this point,
+             * so every page is only uploaded once
+             */
+            op->text.source = gsk_vulkan_renderer_ref_texture_image (GSK_VULKAN_RENDERER (renderer),
+                                                                     gsk_glyph_cache_get_page_texture (cache, op->text.page),
+                                                                     uploader);
+            gsk_vulkan_render_add_cleanup_image (render, op->text.source);
+          }
+          break;
+
         case GSK_VULKAN_OP_OPACITY:
           {
             GskRenderNode *child = gsk_opacity_node_get_child (op->render.node);
@@ -547,6 +960,62 @@ gsk_vulkan_render_pass_upload (GskVulkanRenderPass  *self,
           }
           break;
 
+        case GSK_VULKAN_OP_REPEAT:
+          {
+            GskRenderNode *child = gsk_repeat_node_get_child (op->render.node);
+
+            op->render.source = gsk_vulkan_render_pass_get_node_as_texture (self,
+                                                                            render,
+                                                                            uploader,
+                                                                            child,
+                                                                            gsk_repeat_node_peek_child_bounds (op->render.node));
+          }
+          break;
+
+        case GSK_VULKAN_OP_BLEND_MODE:
+          {
+            GskRenderNode *top = gsk_blend_node_get_top_child (op->render.node);
+            GskRenderNode *bottom = gsk_blend_node_get_bottom_child (op->render.node);
+
+            op->render.source = gsk_vulkan_render_pass_get_node_as_texture (self,
+                                                                            render,
+                                                                            uploader,
+                                                                            top,
+                                                                            &op->render.node->bounds);
+            op->render.source2 = gsk_vulkan_render_pass_get_node_as_texture (self,
+                                                                             render,
+                                                                             uploader,
+                                                                             bottom,
+                                                                             &op->render.node->bounds);
+          }
+          break;
+
+        case GSK_VULKAN_OP_CROSS_FADE:
+          {
+            GskRenderNode *start = gsk_cross_fade_node_get_start_child (op->render.node);
+            GskRenderNode *end = gsk_cross_fade_node_get_end_child (op->render.node);
+
+            op->render.source = gsk_vulkan_render_pass_get_node_as_texture (self,
+                                                                            render,
+                                                                            uploader,
+                                                                            start,
+                                                                            &op->render.node->bounds);
+            op->render.source2 = gsk_vulkan_render_pass_get_node_as_texture (self,
+                                                                             render,
+                                                                             uploader,
+                                                                             end,
+                                                                             &op->render.node->bounds);
+          }
+          break;
+
+        case GSK_VULKAN_OP_SHADOW:
+          gsk_vulkan_render_pass_upload_shadow (self,
+                                                &op->shadow,
+                                                i > 0 ? &g_array_index (self->render_ops, GskVulkanOp, i - 1) : NULL,
+                                                render,
+                                                uploader);
+          break;
+
         default:
           g_assert_not_reached ();
         case GSK_VULKAN_OP_COLOR:
@@ -555,6 +1024,7 @@ gsk_vulkan_render_pass_upload (GskVulkanRenderPass  *self,
         case GSK_VULKAN_OP_BORDER:
         case GSK_VULKAN_OP_INSET_SHADOW:
         case GSK_VULKAN_OP_OUTSET_SHADOW:
+        case GSK_VULKAN_OP_BLUR:
           break;
         }
     }
@@ -579,10 +1049,36 @@ gsk_vulkan_render_pass_count_vertex_data (GskVulkanRenderPass *self)
         case GSK_VULKAN_OP_FALLBACK_ROUNDED_CLIP:
         case GSK_VULKAN_OP_SURFACE:
         case GSK_VULKAN_OP_TEXTURE:
+        case GSK_VULKAN_OP_REPEAT:
           op->render.vertex_count = gsk_vulkan_blend_pipeline_count_vertex_data (GSK_VULKAN_BLEND_PIPELINE (op->render.pipeline));
           n_bytes += op->render.vertex_count;
           break;
 
+        case GSK_VULKAN_OP_TEXT:
+          op->text.vertex_count = gsk_vulkan_effect_pipeline_count_vertex_data (GSK_VULKAN_EFFECT_PIPELINE (op->text.pipeline)) * op->text.num_glyphs;
+          n_bytes += op->text.vertex_count;
+          break;
+
+        case GSK_VULKAN_OP_SHADOW:
+          op->shadow.vertex_count = gsk_vulkan_effect_pipeline_count_vertex_data (GSK_VULKAN_EFFECT_PIPELINE (op->shadow.pipeline));
+          n_bytes += op->shadow.vertex_count;
+          break;
+
+        case GSK_VULKAN_OP_BLUR:
+          op->blur.vertex_count = gsk_vulkan_blur_pipeline_count_vertex_data (GSK_VULKAN_BLUR_PIPELINE (op->blur.pipeline));
+          n_bytes += op->blur.vertex_count;
+          break;
+
+        case GSK_VULKAN_OP_BLEND_MODE:
+          op->render.vertex_count = gsk_vulkan_blend_mode_pipeline_count_vertex_data (GSK_VULKAN_BLEND_MODE_PIPELINE (op->render.pipeline));
+          n_bytes += op->render.vertex_count;
+          break;
+
+        case GSK_VULKAN_OP_CROSS_FADE:
+          op->render.vertex_count = gsk_vulkan_cross_fade_pipeline_count_vertex_data (GSK_VULKAN_CROSS_FADE_PIPELINE (op->render.pipeline));
+          n_bytes += op->render.vertex_count;
+          break;
+
         case GSK_VULKAN_OP_COLOR:
           op->render.vertex_count = gsk_vulkan_color_pipeline_count_vertex_data (GSK_VULKAN_COLOR_PIPELINE (op->render.pipeline));
           n_bytes += op->render.vertex_count;
@@ -620,8 +1116,90 @@ gsk_vulkan_render_pass_count_vertex_data (GskVulkanRenderPass *self)
   return n_bytes;
 }
 
+/* Collects one color matrix pipeline instance per glyph, sampling
+ * from the glyph cache page that was uploaded for the op; monochrome
+ * glyphs are white in the glyph cache, and take the color of the
+ * text, while color glyphs only take its alpha
+ */
+static void
+gsk_vulkan_render_pass_collect_text_vertex_data (GskVulkanOpText *op,
+                                                 GskVulkanRender *render,
+                                                 guchar          *data)
+{
+  GskRenderNode *node = op->node;
+  GskRenderer *renderer = gsk_vulkan_render_get_renderer (render);
+  GskGlyphCache *cache = gsk_vulkan_renderer_get_glyph_cache (GSK_VULKAN_RENDERER (renderer));
+  const PangoGlyphInfo *glyphs = gsk_text_node_peek_glyphs (node);
+  guint i, n_glyphs = gsk_text_node_get_num_glyphs (node);
+  gsize instance_size = gsk_vulkan_effect_pipeline_count_vertex_data (GSK_VULKAN_EFFECT_PIPELINE (op->pipeline));
+  const GdkRGBA *color = gsk_text_node_peek_color (node);
+  int scale = gsk_renderer_get_scale_factor (renderer);
+  float x = gsk_text_node_get_x (node);
+  float y = gsk_text_node_get_y (node);
+  int x_position = 0;
+  guint count = 0;
+  graphene_matrix_t tint_matrix, color_glyph_matrix;
+  graphene_vec4_t color_offset;
+
+  graphene_matrix_init_from_float (&tint_matrix,
+                                   (float[16]) {
+                                       color->red, 0.0, 0.0, 0.0,
+                                       0.0, color->green, 0.0, 0.0,
+                                       0.0, 0.0, color->blue, 0.0,
+                                       0.0, 0.0, 0.0, color->alpha
+                                   });
+  graphene_matrix_init_from_float (&color_glyph_matrix,
+                                   (float[16]) {
+                                       1.0, 0.0, 0.0, 0.0,
+                                       0.0, 1.0, 0.0, 0.0,
+                                       0.0, 0.0, 1.0, 0.0,
+                                       0.0, 0.0, 0.0, color->alpha
+                                   });
+  graphene_vec4_init (&color_offset, 0.0, 0.0, 0.0, 0.0);
+
+  for (i = 0; i < n_glyphs; i++)
+    {
+      const PangoGlyphInfo *gi = &glyphs[i];
+      const GskCachedGlyph *glyph;
+      graphene_rect_t rect;
+      float glyph_x, glyph_y;
+
+      if (gi->glyph == PANGO_GLYPH_EMPTY)
+        goto next;
+
+      /* The glyphs were added to the cache in add_node() */
+      glyph = gsk_glyph_cache_lookup (cache,
+                                      gsk_text_node_peek_font (node),
+                                      gi->glyph,
+                                      scale);
+      g_assert (glyph != NULL && glyph->page == op->page);
+
+      if (glyph->draw_area.size.width == 0.f)
+        goto next;
+
+      glyph_x = roundf ((x + (float) (x_position + gi->geometry.x_offset) / PANGO_SCALE) * scale) / scale;
+      glyph_y = roundf ((y + (float) gi->geometry.y_offset / PANGO_SCALE) * scale) / scale;
+
+      graphene_rect_offset_r (&glyph->draw_area, glyph_x, glyph_y, &rect);
+
+      gsk_vulkan_effect_pipeline_collect_vertex_data (GSK_VULKAN_EFFECT_PIPELINE (op->pipeline),
+                                                      data + count * instance_size,
+                                                      &rect,
+                                                      &glyph->texture_area,
+                                                      glyph->is_color ? &color_glyph_matrix : &tint_matrix,
+                                                      &color_offset);
+      count++;
+
+next:
+      x_position += gi->geometry.width;
+    }
+
+  g_assert (count == op->num_glyphs);
+}
+
 gsize
 gsk_vulkan_render_pass_collect_vertex_data (GskVulkanRenderPass *self,
+                                            GskVulkanRender     *render,
                                             guchar              *data,
                                             gsize                offset,
                                             gsize                total)
@@ -646,7 +1224,107 @@ gsk_vulkan_render_pass_collect_vertex_data (GskVulkanRenderPass *self,
             op->render.vertex_offset = offset + n_bytes;
             gsk_vulkan_blend_pipeline_collect_vertex_data (GSK_VULKAN_BLEND_PIPELINE (op->render.pipeline),
                                                            data + n_bytes + offset,
-                                                           &op->render.node->bounds);
+                                                           &op->render.node->bounds,
+                                                           &GRAPHENE_RECT_INIT (0, 0, 1, 1));
+            n_bytes += op->render.vertex_count;
+          }
+          break;
+
+        case GSK_VULKAN_OP_TEXT:
+          {
+            op->text.vertex_offset = offset + n_bytes;
+            gsk_vulkan_render_pass_collect_text_vertex_data (&op->text,
+                                                             render,
+                                                             data + n_bytes + offset);
+            n_bytes += op->text.vertex_count;
+          }
+          break;
+
+        case GSK_VULKAN_OP_REPEAT:
+          {
+            const graphene_rect_t *bounds = &op->render.node->bounds;
+            const graphene_rect_t *child_bounds = gsk_repeat_node_peek_child_bounds (op->render.node);
+
+            /* The repeat sampler wraps the texture coordinates outside
+             * of the image of the child into the other tiles
+             */
+            op->render.vertex_offset = offset + n_bytes;
+            gsk_vulkan_blend_pipeline_collect_vertex_data (GSK_VULKAN_BLEND_PIPELINE (op->render.pipeline),
+                                                           data + n_bytes + offset,
+                                                           bounds,
+                                                           &GRAPHENE_RECT_INIT ((bounds->origin.x - child_bounds->origin.x) / child_bounds->size.width,
+                                                                                (bounds->origin.y - child_bounds->origin.y) / child_bounds->size.height,
+                                                                                bounds->size.width / child_bounds->size.width,
+                                                                                bounds->size.height / child_bounds->size.height));
+            n_bytes += op->render.vertex_count;
+          }
+          break;
+
+        case GSK_VULKAN_OP_SHADOW:
+          {
+            const GskShadow *shadow = gsk_shadow_node_peek_shadow (op->shadow.node, op->shadow.shadow);
+            graphene_matrix_t color_matrix;
+            graphene_vec4_t color_offset;
+            graphene_rect_t rect;
+
+            /* Replace the color of the child, keeping its alpha */
+            graphene_matrix_init_from_float (&color_matrix,
+                                             (float[16]) {
+                                                 0.0, 0.0, 0.0, 0.0,
+                                                 0.0, 0.0, 0.0, 0.0,
+                                                 0.0, 0.0, 0.0, 0.0,
+                                                 0.0, 0.0, 0.0, shadow->color.alpha
+                                             });
+            graphene_vec4_init (&color_offset, shadow->color.red, shadow->color.green, shadow->color.blue, 0.0);
+            graphene_rect_offset_r (&op->shadow.source_rect, shadow->dx, shadow->dy, &rect);
+
+            op->shadow.vertex_offset = offset + n_bytes;
+            gsk_vulkan_effect_pipeline_collect_vertex_data (GSK_VULKAN_EFFECT_PIPELINE (op->shadow.pipeline),
+                                                            data + n_bytes + offset,
+                                                            &rect,
+                                                            &GRAPHENE_RECT_INIT (0, 0, 1, 1),
+                                                            &color_matrix,
+                                                            &color_offset);
+            n_bytes += op->shadow.vertex_count;
+          }
+          break;
+
+        case GSK_VULKAN_OP_BLUR:
+          {
+            op->blur.vertex_offset = offset + n_bytes;
+            gsk_vulkan_blur_pipeline_collect_vertex_data (GSK_VULKAN_BLUR_PIPELINE (op->blur.pipeline),
+                                                          data + n_bytes + offset,
+                                                          &op->blur.rect,
+                                                          &GRAPHENE_RECT_INIT (0, 0, 1, 1),
+                                                          op->blur.step[0],
+                                                          op->blur.step[1],
+                                                          op->blur.sigma);
+            n_bytes += op->blur.vertex_count;
+          }
+          break;
+
+        case GSK_VULKAN_OP_BLEND_MODE:
+          {
+            op->render.vertex_offset = offset + n_bytes;
+            gsk_vulkan_blend_mode_pipeline_collect_vertex_data (GSK_VULKAN_BLEND_MODE_PIPELINE (op->render.pipeline),
+                                                                data + n_bytes + offset,
+                                                                &op->render.node->bounds,
+                                                                &GRAPHENE_RECT_INIT (0, 0, 1, 1),
+                                                                &GRAPHENE_RECT_INIT (0, 0, 1, 1),
+                                                                gsk_blend_node_get_blend_mode (op->render.node));
+            n_bytes += op->render.vertex_count;
+          }
+          break;
+
+        case GSK_VULKAN_OP_CROSS_FADE:
+          {
+            op->render.vertex_offset = offset + n_bytes;
+            gsk_vulkan_cross_fade_pipeline_collect_vertex_data (GSK_VULKAN_CROSS_FADE_PIPELINE (op->render.pipeline),
+                                                                data + n_bytes + offset,
+                                                                &op->render.node->bounds,
+                                                                &GRAPHENE_RECT_INIT (0, 0, 1, 1),
+                                                                &GRAPHENE_RECT_INIT (0, 0, 1, 1),
+                                                                gsk_cross_fade_node_get_progress (op->render.node));
             n_bytes += op->render.vertex_count;
           }
           break;
@@ -693,6 +1371,7 @@ gsk_vulkan_render_pass_collect_vertex_data (GskVulkanRenderPass *self,
             gsk_vulkan_effect_pipeline_collect_vertex_data (GSK_VULKAN_EFFECT_PIPELINE (op->render.pipeline),
                                                             data + n_bytes + offset,
                                                             &op->render.node->bounds,
+                                                            &GRAPHENE_RECT_INIT (0, 0, 1, 1),
                                                             &color_matrix,
                                                             &color_offset);
             n_bytes += op->render.vertex_count;
@@ -705,6 +1384,7 @@ gsk_vulkan_render_pass_collect_vertex_data (GskVulkanRenderPass *self,
             gsk_vulkan_effect_pipeline_collect_vertex_data (GSK_VULKAN_EFFECT_PIPELINE (op->render.pipeline),
                                                             data + n_bytes + offset,
                                                             &op->render.node->bounds,
+                                                            &GRAPHENE_RECT_INIT (0, 0, 1, 1),
                                                             gsk_color_matrix_node_peek_color_matrix (op->render.node),
                                                             gsk_color_matrix_node_peek_color_offset (op->render.node));
             n_bytes += op->render.vertex_count;
@@ -785,7 +1465,29 @@ gsk_vulkan_render_pass_reserve_descriptor_sets (GskVulkanRenderPass *self,
         case GSK_VULKAN_OP_TEXTURE:
         case GSK_VULKAN_OP_OPACITY:
         case GSK_VULKAN_OP_COLOR_MATRIX:
-          op->render.descriptor_set_index = gsk_vulkan_render_reserve_descriptor_set (render, op->render.source);
+          op->render.descriptor_set_index = gsk_vulkan_render_reserve_descriptor_set (render, op->render.source, GSK_VULKAN_SAMPLER_DEFAULT);
+          break;
+
+        case GSK_VULKAN_OP_REPEAT:
+          op->render.descriptor_set_index = gsk_vulkan_render_reserve_descriptor_set (render, op->render.source, GSK_VULKAN_SAMPLER_REPEAT);
+          break;
+
+        case GSK_VULKAN_OP_BLEND_MODE:
+        case GSK_VULKAN_OP_CROSS_FADE:
+          op->render.descriptor_set_index = gsk_vulkan_render_reserve_descriptor_set (render, op->render.source, GSK_VULKAN_SAMPLER_DEFAULT);
+          op->render.descriptor_set_index2 = gsk_vulkan_render_reserve_descriptor_set (render, op->render.source2, GSK_VULKAN_SAMPLER_DEFAULT);
+          break;
+
+        case GSK_VULKAN_OP_TEXT:
+          op->text.descriptor_set_index = gsk_vulkan_render_reserve_descriptor_set (render, op->text.source, GSK_VULKAN_SAMPLER_DEFAULT);
+          break;
+
+        case GSK_VULKAN_OP_SHADOW:
+          op->shadow.descriptor_set_index = gsk_vulkan_render_reserve_descriptor_set (render, op->shadow.source, GSK_VULKAN_SAMPLER_DEFAULT);
+          break;
+
+        case GSK_VULKAN_OP_BLUR:
+          op->blur.descriptor_set_index = gsk_vulkan_render_reserve_descriptor_set (render, op->blur.source, GSK_VULKAN_SAMPLER_DEFAULT);
           break;
 
         default:
@@ -801,12 +1503,12 @@ gsk_vulkan_render_pass_reserve_descriptor_sets (GskVulkanRenderPass *self,
     }
 }
 
-void
-gsk_vulkan_render_pass_draw (GskVulkanRenderPass     *self,
-                             GskVulkanRender         *render,
-                             GskVulkanBuffer         *vertex_buffer,
-                             GskVulkanPipelineLayout *layout,
-                             VkCommandBuffer          command_buffer)
+static void
+gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
+                                  GskVulkanRender         *render,
+                                  GskVulkanBuffer         *vertex_buffer,
+                                  GskVulkanPipelineLayout *layout,
+                                  VkCommandBuffer          command_buffer)
 {
   GskVulkanPipeline *current_pipeline = NULL;
   gsize current_draw_index = 0;
@@ -825,6 +1527,7 @@ gsk_vulkan_render_pass_draw (GskVulkanRenderPass     *self,
         case GSK_VULKAN_OP_FALLBACK_ROUNDED_CLIP:
         case GSK_VULKAN_OP_SURFACE:
         case GSK_VULKAN_OP_TEXTURE:
+        case GSK_VULKAN_OP_REPEAT:
           if (current_pipeline != op->render.pipeline)
             {
               current_pipeline = op->render.pipeline;
@@ -857,6 +1560,39 @@ gsk_vulkan_render_pass_draw (GskVulkanRenderPass     *self,
                                                                 current_draw_index, 1);
           break;
 
+        case GSK_VULKAN_OP_TEXT:
+          if (current_pipeline != op->text.pipeline)
+            {
+              current_pipeline = op->text.pipeline;
+              vkCmdBindPipeline (command_buffer,
+                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                 gsk_vulkan_pipeline_get_pipeline (current_pipeline));
+              vkCmdBindVertexBuffers (command_buffer,
+                                      0,
+                                      1,
+                                      (VkBuffer[1]) {
+                                          gsk_vulkan_buffer_get_buffer (vertex_buffer)
+                                      },
+                                      (VkDeviceSize[1]) { op->text.vertex_offset });
+              current_draw_index = 0;
+            }
+
+          vkCmdBindDescriptorSets (command_buffer,
+                                   VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                   gsk_vulkan_pipeline_layout_get_pipeline_layout (layout),
+                                   0,
+                                   1,
+                                   (VkDescriptorSet[1]) {
+                                       gsk_vulkan_render_get_descriptor_set (render, op->text.descriptor_set_index)
+                                   },
+                                   0,
+                                   NULL);
+
+          current_draw_index += gsk_vulkan_effect_pipeline_draw (GSK_VULKAN_EFFECT_PIPELINE (current_pipeline),
+                                                                 command_buffer,
+                                                                 current_draw_index, op->text.num_glyphs);
+          break;
+
         case GSK_VULKAN_OP_OPACITY:
         case GSK_VULKAN_OP_COLOR_MATRIX:
           if (current_pipeline != op->render.pipeline)
@@ -984,6 +1720,140 @@ gsk_vulkan_render_pass_draw (GskVulkanRenderPass     *self,
                                                                      current_draw_index, 1);
           break;
 
+        case GSK_VULKAN_OP_SHADOW:
+          if (current_pipeline != op->shadow.pipeline)
+            {
+              current_pipeline = op->shadow.pipeline;
+              vkCmdBindPipeline (command_buffer,
+                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                 gsk_vulkan_pipeline_get_pipeline (current_pipeline));
+              vkCmdBindVertexBuffers (command_buffer,
+                                      0,
+                                      1,
+                                      (VkBuffer[1]) {
+                                          gsk_vulkan_buffer_get_buffer (vertex_buffer)
+                                      },
+                                      (VkDeviceSize[1]) { op->shadow.vertex_offset });
+              current_draw_index = 0;
+            }
+
+          vkCmdBindDescriptorSets (command_buffer,
+                                   VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                   gsk_vulkan_pipeline_layout_get_pipeline_layout (layout),
+                                   0,
+                                   1,
+                                   (VkDescriptorSet[1]) {
+                                       gsk_vulkan_render_get_descriptor_set (render, op->shadow.descriptor_set_index)
+                                   },
+                                   0,
+                                   NULL);
+
+          current_draw_index += gsk_vulkan_effect_pipeline_draw (GSK_VULKAN_EFFECT_PIPELINE (current_pipeline),
+                                                                 command_buffer,
+                                                                 current_draw_index, 1);
+          break;
+
+        case GSK_VULKAN_OP_BLUR:
+          if (current_pipeline != op->blur.pipeline)
+            {
+              current_pipeline = op->blur.pipeline;
+              vkCmdBindPipeline (command_buffer,
+                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                 gsk_vulkan_pipeline_get_pipeline (current_pipeline));
+              vkCmdBindVertexBuffers (command_buffer,
+                                      0,
+                                      1,
+                                      (VkBuffer[1]) {
+                                          gsk_vulkan_buffer_get_buffer (vertex_buffer)
+                                      },
+                                      (VkDeviceSize[1]) { op->blur.vertex_offset });
+              current_draw_index = 0;
+            }
+
+          vkCmdBindDescriptorSets (command_buffer,
+                                   VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                   gsk_vulkan_pipeline_layout_get_pipeline_layout (layout),
+                                   0,
+                                   1,
+                                   (VkDescriptorSet[1]) {
+                                       gsk_vulkan_render_get_descriptor_set (render, op->blur.descriptor_set_index)
+                                   },
+                                   0,
+                                   NULL);
+
+          current_draw_index += gsk_vulkan_blur_pipeline_draw (GSK_VULKAN_BLUR_PIPELINE (current_pipeline),
+                                                               command_buffer,
+                                                               current_draw_index, 1);
+          break;
+
+        case GSK_VULKAN_OP_BLEND_MODE:
+          if (current_pipeline != op->render.pipeline)
+            {
+              current_pipeline = op->render.pipeline;
+              vkCmdBindPipeline (command_buffer,
+                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                 gsk_vulkan_pipeline_get_pipeline (current_pipeline));
+              vkCmdBindVertexBuffers (command_buffer,
+                                      0,
+                                      1,
+                                      (VkBuffer[1]) {
+                                          gsk_vulkan_buffer_get_buffer (vertex_buffer)
+                                      },
+                                      (VkDeviceSize[1]) { op->render.vertex_offset });
+              current_draw_index = 0;
+            }
+
+          vkCmdBindDescriptorSets (command_buffer,
+                                   VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                   gsk_vulkan_pipeline_layout_get_pipeline_layout (layout),
+                                   0,
+                                   2,
+                                   (VkDescriptorSet[2]) {
+                                       gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index),
+                                       gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index2)
+                                   },
+                                   0,
+                                   NULL);
+
+          current_draw_index += gsk_vulkan_blend_mode_pipeline_draw (GSK_VULKAN_BLEND_MODE_PIPELINE (current_pipeline),
+                                                                     command_buffer,
+                                                                     current_draw_index, 1);
+          break;
+
+        case GSK_VULKAN_OP_CROSS_FADE:
+          if (current_pipeline != op->render.pipeline)
+            {
+              current_pipeline = op->render.pipeline;
+              vkCmdBindPipeline (command_buffer,
+                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                 gsk_vulkan_pipeline_get_pipeline (current_pipeline));
+              vkCmdBindVertexBuffers (command_buffer,
+                                      0,
+                                      1,
+                                      (VkBuffer[1]) {
+                                          gsk_vulkan_buffer_get_buffer (vertex_buffer)
+                                      },
+                                      (VkDeviceSize[1]) { op->render.vertex_offset });
+              current_draw_index = 0;
+            }
+
+          vkCmdBindDescriptorSets (command_buffer,
+                                   VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                   gsk_vulkan_pipeline_layout_get_pipeline_layout (layout),
+                                   0,
+                                   2,
+                                   (VkDescriptorSet[2]) {
+                                       gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index),
+                                       gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index2)
+                                   },
+                                   0,
+                                   NULL);
+
+          current_draw_index += gsk_vulkan_cross_fade_pipeline_draw (GSK_VULKAN_CROSS_FADE_PIPELINE (current_pipeline),
+                                                                     command_buffer,
+                                                                     current_draw_index, 1);
+          break;
+
         case GSK_VULKAN_OP_PUSH_VERTEX_CONSTANTS:
           gsk_vulkan_push_constants_push (&op->constants.constants,
                                           command_buffer, 
@@ -996,3 +1866,60 @@ gsk_vulkan_render_pass_draw (GskVulkanRenderPass     *self,
         }
     }
 }
+
+void
+gsk_vulkan_render_pass_draw (GskVulkanRenderPass     *self,
+                             GskVulkanRender         *render,
+                             GskVulkanBuffer         *vertex_buffer,
+                             GskVulkanPipelineLayout *layout,
+                             VkCommandBuffer          command_buffer)
+{
+  guint i;
+
+  vkCmdSetViewport (command_buffer,
+                    0,
+                    1,
+                    &(VkViewport) {
+                      .x = 0,
+                      .y = 0,
+                      .width = gsk_vulkan_image_get_width (self->target),
+                      .height = gsk_vulkan_image_get_height (self->target),
+                      .minDepth = 0,
+                      .maxDepth = 1
+                    });
+
+  for (i = 0; i < cairo_region_num_rectangles (self->clip); i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (self->clip, i, &rect);
+
+      vkCmdSetScissor (command_buffer,
+                       0,
+                       1,
+                       &(VkRect2D) {
+                           { rect.x * self->scale_factor, rect.y * self->scale_factor },
+                           { rect.width * self->scale_factor, rect.height * self->scale_factor }
+                       });
+
+      vkCmdBeginRenderPass (command_buffer,
+                            &(VkRenderPassBeginInfo) {
+                                .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+                                .renderPass = self->render_pass,
+                                .framebuffer = gsk_vulkan_render_get_framebuffer (render, self->target),
+                                .renderArea = { 
+                                    { rect.x * self->scale_factor, rect.y * self->scale_factor },
+                                    { rect.width * self->scale_factor, rect.height * self->scale_factor }
+                                },
+                                .clearValueCount = 1,
+                                .pClearValues = (VkClearValue [1]) {
+                                    { .color = { .float32 = { 0.f, 0.f, 0.f, 0.f } } }
+                                }
+                            },
+                            VK_SUBPASS_CONTENTS_INLINE);
+
+      gsk_vulkan_render_pass_draw_rect (self, render, vertex_buffer, layout, command_buffer);
+
+      vkCmdEndRenderPass (command_buffer);
+    }
+}
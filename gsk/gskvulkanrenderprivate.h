@@ -31,11 +31,28 @@ typedef enum {
   GSK_VULKAN_PIPELINE_OUTSET_SHADOW,
   GSK_VULKAN_PIPELINE_OUTSET_SHADOW_CLIP,
   GSK_VULKAN_PIPELINE_OUTSET_SHADOW_CLIP_ROUNDED,
+  GSK_VULKAN_PIPELINE_BLUR,
+  GSK_VULKAN_PIPELINE_BLUR_CLIP,
+  GSK_VULKAN_PIPELINE_BLUR_CLIP_ROUNDED,
+  GSK_VULKAN_PIPELINE_BLEND_MODE,
+  GSK_VULKAN_PIPELINE_BLEND_MODE_CLIP,
+  GSK_VULKAN_PIPELINE_BLEND_MODE_CLIP_ROUNDED,
+  GSK_VULKAN_PIPELINE_CROSS_FADE,
+  GSK_VULKAN_PIPELINE_CROSS_FADE_CLIP,
+  GSK_VULKAN_PIPELINE_CROSS_FADE_CLIP_ROUNDED,
   /* add more */
   GSK_VULKAN_N_PIPELINES
 } GskVulkanPipelineType;
 
+typedef enum {
+  GSK_VULKAN_SAMPLER_DEFAULT,
+  GSK_VULKAN_SAMPLER_REPEAT,
+  /* add more */
+  GSK_VULKAN_N_SAMPLERS
+} GskVulkanSamplerType;
+
 typedef struct _GskVulkanRender GskVulkanRender;
+typedef struct _GskVulkanRenderPass GskVulkanRenderPass;
 
 GskVulkanRender *       gsk_vulkan_render_new                           (GskRenderer            *renderer,
                                                                          GdkVulkanContext       *context);
@@ -47,6 +64,7 @@ void                    gsk_vulkan_render_reset                         (GskVulk
                                                                          const graphene_rect_t  *rect);
 
 GskRenderer *           gsk_vulkan_render_get_renderer                  (GskVulkanRender        *self);
+int                     gsk_vulkan_render_get_scale_factor              (GskVulkanRender        *self);
 
 void                    gsk_vulkan_render_add_cleanup_image             (GskVulkanRender        *self,
                                                                          GskVulkanImage         *image);
@@ -54,6 +72,12 @@ void                    gsk_vulkan_render_add_cleanup_image             (GskVulk
 void                    gsk_vulkan_render_add_node                      (GskVulkanRender        *self,
                                                                          GskRenderNode          *node);
 
+GskVulkanRenderPass *   gsk_vulkan_render_new_offscreen_pass            (GskVulkanRender        *self,
+                                                                         GskVulkanImage         *target,
+                                                                         const graphene_rect_t  *bounds);
+void                    gsk_vulkan_render_add_render_pass               (GskVulkanRender        *self,
+                                                                         GskVulkanRenderPass    *pass);
+
 void                    gsk_vulkan_render_upload                        (GskVulkanRender        *self);
 
 GskVulkanPipeline *     gsk_vulkan_render_get_pipeline                  (GskVulkanRender        *self,
@@ -61,9 +85,12 @@ GskVulkanPipeline *     gsk_vulkan_render_get_pipeline                  (GskVulk
 VkDescriptorSet         gsk_vulkan_render_get_descriptor_set            (GskVulkanRender        *self,
                                                                          gsize                   id);
 gsize                   gsk_vulkan_render_reserve_descriptor_set        (GskVulkanRender        *self,
-                                                                         GskVulkanImage         *source);
+                                                                         GskVulkanImage         *source,
+                                                                         GskVulkanSamplerType    sampler);
+VkFramebuffer           gsk_vulkan_render_get_framebuffer               (GskVulkanRender        *self,
+                                                                         GskVulkanImage         *image);
 void                    gsk_vulkan_render_draw                          (GskVulkanRender        *self,
-                                                                         VkSampler               sampler);
+                                                                         const VkSampler        *samplers);
 
 void                    gsk_vulkan_render_submit                        (GskVulkanRender        *self);
 
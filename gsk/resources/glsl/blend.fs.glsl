@@ -27,36 +27,99 @@ vec3 BlendLighten(vec3 Cb, vec3 Cs) {
   return max(Cb, Cs);
 }
 
+float ColorDodge(float Cb, float Cs) {
+  if (Cb == 0.0)
+    return 0.0;
+  if (Cs == 1.0)
+    return 1.0;
+  return min(1.0, Cb / (1.0 - Cs));
+}
+
+vec3 BlendColorDodge(vec3 Cb, vec3 Cs) {
+  return vec3(ColorDodge(Cb.r, Cs.r), ColorDodge(Cb.g, Cs.g), ColorDodge(Cb.b, Cs.b));
+}
+
+float ColorBurn(float Cb, float Cs) {
+  if (Cb == 1.0)
+    return 1.0;
+  if (Cs == 0.0)
+    return 0.0;
+  return 1.0 - min(1.0, (1.0 - Cb) / Cs);
+}
+
+vec3 BlendColorBurn(vec3 Cb, vec3 Cs) {
+  return vec3(ColorBurn(Cb.r, Cs.r), ColorBurn(Cb.g, Cs.g), ColorBurn(Cb.b, Cs.b));
+}
+
+vec3 BlendSoftLight(vec3 Cb, vec3 Cs) {
+  vec3 d = mix(((16.0 * Cb - 12.0) * Cb + 4.0) * Cb, sqrt(Cb), step(0.25, Cb));
+  vec3 darken = Cb - (1.0 - 2.0 * Cs) * Cb * (1.0 - Cb);
+  vec3 lighten = Cb + (2.0 * Cs - 1.0) * (d - Cb);
+
+  return mix(darken, lighten, step(0.5, Cs));
+}
+
+vec3 BlendDifference(vec3 Cb, vec3 Cs) {
+  return abs(Cb - Cs);
+}
+
+vec3 BlendExclusion(vec3 Cb, vec3 Cs) {
+  return Cb + Cs - 2.0 * Cb * Cs;
+}
+
 void main() {
+  // The top child is in uSource, the bottom child in uMask; both
+  // are premultiplied
   vec4 Cs = Texture(uSource, vUv);
   vec4 Cb = Texture(uMask, vUv);
+  vec3 cs = Cs.a > 0.0 ? Cs.rgb / Cs.a : vec3(0.0);
+  vec3 cb = Cb.a > 0.0 ? Cb.rgb / Cb.a : vec3(0.0);
   vec3 res;
 
   if (uBlendMode == 0) {
-    res = Cs.xyz;
+    res = cs;
   }
   else if (uBlendMode == 1) {
-    res = BlendMultiply(Cb.xyz, Cs.xyz);
+    res = BlendMultiply(cb, cs);
   }
   else if (uBlendMode == 2) {
-    res = BlendScreen(Cb.xyz, Cs.xyz);
+    res = BlendScreen(cb, cs);
   }
   else if (uBlendMode == 3) {
-    res = BlendOverlay(Cb.xyz, Cs.xyz);
+    res = BlendOverlay(cb, cs);
   }
   else if (uBlendMode == 4) {
-    res = BlendDarken(Cb.xyz, Cs.xyz);
+    res = BlendDarken(cb, cs);
   }
   else if (uBlendMode == 5) {
-    res = BlendLighten(Cb.xyz, Cs.xyz);
+    res = BlendLighten(cb, cs);
+  }
+  else if (uBlendMode == 6) {
+    res = BlendColorDodge(cb, cs);
+  }
+  else if (uBlendMode == 7) {
+    res = BlendColorBurn(cb, cs);
   }
   else if (uBlendMode == 8) {
-    res = BlendHardLight(Cb.xyz, Cs.xyz);
+    res = BlendHardLight(cb, cs);
+  }
+  else if (uBlendMode == 9) {
+    res = BlendSoftLight(cb, cs);
+  }
+  else if (uBlendMode == 10) {
+    res = BlendDifference(cb, cs);
+  }
+  else if (uBlendMode == 11) {
+    res = BlendExclusion(cb, cs);
   }
   else {
     // Use red for debugging missing blend modes
     res = vec3(1.0, 0.0, 0.0);
   }
 
-  setOutputColor(vec4(res, Cs.a * uAlpha));
+  // Composite the blended top child over the bottom one
+  vec3 color = Cs.rgb * (1.0 - Cb.a) + Cb.rgb * (1.0 - Cs.a) + Cs.a * Cb.a * res;
+  float alpha = Cs.a + Cb.a * (1.0 - Cs.a);
+
+  setOutputColor(clip(vec4(color, alpha) * uAlpha));
 }
@@ -1,5 +1,6 @@
 void main() {
   vec4 diffuse = Texture(uSource, vUv);
 
-  setOutputColor(vec4(diffuse.xyz, diffuse.a * uAlpha));
+  // The source is premultiplied
+  setOutputColor(clip(diffuse * uAlpha));
 }
@@ -0,0 +1,43 @@
+uniform vec4 uOutline;
+uniform vec4 uCornerWidths;
+uniform vec4 uCornerHeights;
+// (top, right, bottom, left)
+uniform vec4 uWidths;
+// Premultiplied colors, in the same order as the widths
+uniform vec4 uColors[4];
+
+void main() {
+  vec4 inside = vec4(uOutline.xy + uWidths.wx, uOutline.zw - uWidths.yz - uWidths.wx);
+  vec4 inside_widths = max(uCornerWidths - uWidths.wyyw, 0.0);
+  vec4 inside_heights = max(uCornerHeights - uWidths.xxzz, 0.0);
+
+  float alpha = clamp(rounded_rect_coverage(uOutline, uCornerWidths, uCornerHeights, vPosition) -
+                      rounded_rect_coverage(inside, inside_widths, inside_heights, vPosition),
+                      0.0, 1.0);
+
+  // Pick the color of the closest side; like the cairo renderer,
+  // this splits the corners diagonally
+  vec4 d = vec4(vPosition.y - uOutline.y,
+                uOutline.x + uOutline.z - vPosition.x,
+                uOutline.y + uOutline.w - vPosition.y,
+                vPosition.x - uOutline.x);
+
+  vec4 color = uColors[0];
+  float m = d.x;
+
+  if (d.y < m) {
+    m = d.y;
+    color = uColors[1];
+  }
+
+  if (d.z < m) {
+    m = d.z;
+    color = uColors[2];
+  }
+
+  if (d.w < m) {
+    color = uColors[3];
+  }
+
+  setOutputColor(clip(color * alpha * uAlpha));
+}
@@ -0,0 +1,12 @@
+// The clip is a rounded rectangle in node coordinates; a negative
+// width means that no clip is set
+uniform vec4 uClip;
+uniform vec4 uClipCornerWidths;
+uniform vec4 uClipCornerHeights;
+
+vec4 clip(vec4 color) {
+  if (uClip.z < 0.0)
+    return color;
+
+  return color * rounded_rect_coverage(uClip, uClipCornerWidths, uClipCornerHeights, vPosition);
+}
@@ -1,5 +1,5 @@
 uniform vec4 uColor;
 
 void main() {
-  setOutputColor(uColor);
+  setOutputColor(clip(uColor));
 }
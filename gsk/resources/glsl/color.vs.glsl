@@ -3,4 +3,7 @@ void main() {
 
   // Flip the sampling
   vUv = vec2(aUv.x, aUv.y);
+
+  // The position in node coordinates, used for clipping
+  vPosition = aPosition;
 }
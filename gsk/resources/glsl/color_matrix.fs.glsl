@@ -0,0 +1,15 @@
+uniform mat4 uColorMatrix;
+uniform vec4 uColorOffset;
+
+void main() {
+  vec4 diffuse = Texture(uSource, vUv);
+  vec4 color = vec4(0.0);
+
+  // The color matrix operates on unpremultiplied colors
+  if (diffuse.a > 0.0)
+    color = uColorMatrix * vec4(diffuse.rgb / diffuse.a, diffuse.a);
+
+  color = clamp(color + uColorOffset, 0.0, 1.0);
+
+  setOutputColor(clip(vec4(color.rgb * color.a, color.a) * uAlpha));
+}
@@ -0,0 +1,9 @@
+uniform float uProgress;
+
+void main() {
+  // The start child is in uSource, the end child in uMask
+  vec4 start = Texture(uSource, vUv);
+  vec4 end = Texture(uMask, vUv);
+
+  setOutputColor(clip(mix(start, end, uProgress) * uAlpha));
+}
@@ -1,4 +1,8 @@
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+precision highp float;
+#else
 precision mediump float;
+#endif
 
 uniform mat4 uMVP;
 uniform sampler2D uSource;
@@ -7,6 +11,7 @@ uniform float uAlpha;
 uniform int uBlendMode;
 
 varying vec2 vUv;
+varying vec2 vPosition;
 
 vec4 Texture(sampler2D sampler, vec2 texCoords) {
   return texture2D(sampler, texCoords);
@@ -7,6 +7,7 @@ uniform float uAlpha;
 uniform int uBlendMode;
 
 in vec2 vUv;
+in vec2 vPosition;
 
 out vec4 outputColor;
 
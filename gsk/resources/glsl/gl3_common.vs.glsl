@@ -4,3 +4,4 @@ in vec2 aPosition;
 in vec2 aUv;
 
 out vec2 vUv;
+out vec2 vPosition;
@@ -5,6 +5,7 @@ uniform float uAlpha;
 uniform int uBlendMode;
 
 varying vec2 vUv;
+varying vec2 vPosition;
 
 vec4 Texture(sampler2D sampler, vec2 texCoords) {
   return texture2D(sampler, texCoords);
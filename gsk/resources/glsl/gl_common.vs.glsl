@@ -4,3 +4,4 @@ attribute vec2 aPosition;
 attribute vec2 aUv;
 
 varying vec2 vUv;
+varying vec2 vPosition;
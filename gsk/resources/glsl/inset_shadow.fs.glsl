@@ -0,0 +1,20 @@
+uniform vec4 uOutline;
+uniform vec4 uCornerWidths;
+uniform vec4 uCornerHeights;
+// Premultiplied
+uniform vec4 uColor;
+uniform vec2 uOffset;
+uniform float uSpread;
+uniform float uBlurRadius;
+
+void main() {
+  vec4 inside = vec4(uOutline.xy + uOffset + vec2(uSpread),
+                     max(uOutline.zw - vec2(2.0 * uSpread), vec2(0.0)));
+  vec4 inside_widths = max(uCornerWidths - uSpread, 0.0);
+  vec4 inside_heights = max(uCornerHeights - uSpread, 0.0);
+
+  float alpha = rounded_rect_coverage(uOutline, uCornerWidths, uCornerHeights, vPosition) *
+                (1.0 - rounded_rect_shadow(inside, inside_widths, inside_heights, vPosition, uBlurRadius / 2.0));
+
+  setOutputColor(clip(uColor * alpha * uAlpha));
+}
@@ -0,0 +1,41 @@
+uniform vec4 uColorStops[8];
+uniform float uColorOffsets[8];
+uniform int uNumColorStops;
+uniform vec2 uStartPoint;
+uniform vec2 uEndPoint;
+uniform int uRepeating;
+
+void main() {
+  vec2 gradient = uEndPoint - uStartPoint;
+  float pos = dot(vPosition - uStartPoint, gradient) / dot(gradient, gradient);
+
+  if (uRepeating != 0)
+    pos = fract(pos);
+  else
+    pos = clamp(pos, 0.0, 1.0);
+
+  // The color stops are premultiplied
+  vec4 color = uColorStops[0];
+
+  for (int i = 1; i < 8; i++) {
+    if (i >= uNumColorStops)
+      break;
+
+    // Stops at the same offset make a hard transition, so the color
+    // of the last stop that was passed wins
+    if (pos >= uColorOffsets[i]) {
+      color = uColorStops[i];
+      continue;
+    }
+
+    if (uColorOffsets[i] > uColorOffsets[i - 1]) {
+      float t = clamp((pos - uColorOffsets[i - 1]) / (uColorOffsets[i] - uColorOffsets[i - 1]), 0.0, 1.0);
+
+      color = mix(uColorStops[i - 1], uColorStops[i], t);
+    }
+
+    break;
+  }
+
+  setOutputColor(clip(color * uAlpha));
+}
@@ -0,0 +1,92 @@
+// Rounded rectangles are passed as three vec4:
+//  - bounds: (x, y, width, height)
+//  - corner widths: (top left, top right, bottom right, bottom left)
+//  - corner heights: (top left, top right, bottom right, bottom left)
+// which is the same layout used by gsk_rounded_rect_to_float()
+
+float ellipsis_coverage(vec2 point, vec2 center, vec2 radius) {
+  vec2 p0 = (point - center) / radius;
+  vec2 p1 = 2.0 * p0 / radius;
+  float d = (dot(p0, p0) - 1.0) / length(p1);
+
+  return clamp(0.5 - d, 0.0, 1.0);
+}
+
+float rounded_rect_coverage(vec4 bounds, vec4 corner_widths, vec4 corner_heights, vec2 p) {
+  vec2 tl = bounds.xy;
+  vec2 br = bounds.xy + bounds.zw;
+
+  if (p.x < tl.x || p.y < tl.y || p.x >= br.x || p.y >= br.y)
+    return 0.0;
+
+  vec2 ref_tl = vec2(tl.x + corner_widths.x, tl.y + corner_heights.x);
+  vec2 ref_tr = vec2(br.x - corner_widths.y, tl.y + corner_heights.y);
+  vec2 ref_br = vec2(br.x - corner_widths.z, br.y - corner_heights.z);
+  vec2 ref_bl = vec2(tl.x + corner_widths.w, br.y - corner_heights.w);
+
+  if (p.x < ref_tl.x && p.y < ref_tl.y)
+    return ellipsis_coverage(p, ref_tl, vec2(corner_widths.x, corner_heights.x));
+
+  if (p.x > ref_tr.x && p.y < ref_tr.y)
+    return ellipsis_coverage(p, ref_tr, vec2(corner_widths.y, corner_heights.y));
+
+  if (p.x > ref_br.x && p.y > ref_br.y)
+    return ellipsis_coverage(p, ref_br, vec2(corner_widths.z, corner_heights.z));
+
+  if (p.x < ref_bl.x && p.y > ref_bl.y)
+    return ellipsis_coverage(p, ref_bl, vec2(corner_widths.w, corner_heights.w));
+
+  return 1.0;
+}
+
+// Approximation of the error function, see Abramowitz and Stegun, 7.1.27
+vec2 erf(vec2 x) {
+  vec2 s = sign(x);
+  vec2 a = abs(x);
+
+  x = 1.0 + (0.278393 + (0.230389 + 0.078108 * (a * a)) * a) * a;
+  x *= x;
+
+  return s - s / (x * x);
+}
+
+float gaussian(float x, float sigma) {
+  return exp(-(x * x) / (2.0 * sigma * sigma)) / (2.506628 * sigma);
+}
+
+// The coverage of a horizontal slice of a blurred rounded box
+float rounded_box_shadow_x(float x, float y, float sigma, float corner, vec2 half_size) {
+  float delta = min(half_size.y - corner - abs(y), 0.0);
+  float curved = half_size.x - corner + sqrt(max(0.0, corner * corner - delta * delta));
+  vec2 integral = 0.5 + 0.5 * erf((x + vec2(-curved, curved)) * (0.707107 / sigma));
+
+  return integral.y - integral.x;
+}
+
+// The coverage of a rounded box blurred by a gaussian with the given
+// standard deviation; the box is sampled along the vertical axis, and
+// the corners are approximated by using their average radius
+float rounded_rect_shadow(vec4 bounds, vec4 corner_widths, vec4 corner_heights, vec2 p, float sigma) {
+  if (sigma < 0.01)
+    return rounded_rect_coverage(bounds, corner_widths, corner_heights, p);
+
+  vec2 half_size = max(bounds.zw, vec2(0.0)) * 0.5;
+  vec2 point = p - (bounds.xy + half_size);
+  float corner = (dot(corner_widths, vec4(0.25)) + dot(corner_heights, vec4(0.25))) * 0.5;
+  corner = min(corner, min(half_size.x, half_size.y));
+
+  float low = point.y - half_size.y;
+  float high = point.y + half_size.y;
+  float start = clamp(-3.0 * sigma, low, high);
+  float end = clamp(3.0 * sigma, low, high);
+  float dy = (end - start) / 4.0;
+  float y = start + dy * 0.5;
+  float value = 0.0;
+
+  for (int i = 0; i < 4; i++) {
+    value += rounded_box_shadow_x(point.x, point.y - y, sigma, corner, half_size) * gaussian(y, sigma) * dy;
+    y += dy;
+  }
+
+  return value;
+}
@@ -0,0 +1,170 @@
+#version 420 core
+
+#include "clip.frag.glsl"
+
+layout(location = 0) in vec2 inPos;
+layout(location = 1) in vec2 inTopTexCoord;
+layout(location = 2) in vec2 inBottomTexCoord;
+layout(location = 3) in flat uint inBlendMode;
+
+layout(set = 0, binding = 0) uniform sampler2D topTexture;
+layout(set = 1, binding = 0) uniform sampler2D bottomTexture;
+
+layout(location = 0) out vec4 color;
+
+/* The blend functions below follow the W3C compositing spec, Cb is the
+ * color of the bottom child and Cs the one of the top child, both are
+ * not premultiplied */
+
+vec3
+multiply (vec3 Cb, vec3 Cs)
+{
+  return Cb * Cs;
+}
+
+vec3
+screen (vec3 Cb, vec3 Cs)
+{
+  return Cb + Cs - (Cb * Cs);
+}
+
+vec3
+hard_light (vec3 Cb, vec3 Cs)
+{
+  vec3 m = multiply (Cb, 2.0 * Cs);
+  vec3 s = screen (Cb, 2.0 * Cs - 1.0);
+
+  return mix (m, s, step (0.5, Cs));
+}
+
+vec3
+overlay (vec3 Cb, vec3 Cs)
+{
+  return hard_light (Cs, Cb);
+}
+
+float
+color_dodge (float Cb, float Cs)
+{
+  if (Cb == 0.0)
+    return 0.0;
+  if (Cs == 1.0)
+    return 1.0;
+  return min (1.0, Cb / (1.0 - Cs));
+}
+
+float
+color_burn (float Cb, float Cs)
+{
+  if (Cb == 1.0)
+    return 1.0;
+  if (Cs == 0.0)
+    return 0.0;
+  return 1.0 - min (1.0, (1.0 - Cb) / Cs);
+}
+
+vec3
+soft_light (vec3 Cb, vec3 Cs)
+{
+  vec3 d = mix (((16.0 * Cb - 12.0) * Cb + 4.0) * Cb, sqrt (Cb), step (0.25, Cb));
+  vec3 darken = Cb - (1.0 - 2.0 * Cs) * Cb * (1.0 - Cb);
+  vec3 lighten = Cb + (2.0 * Cs - 1.0) * (d - Cb);
+
+  return mix (darken, lighten, step (0.5, Cs));
+}
+
+float
+lum (vec3 c)
+{
+  return dot (c, vec3(0.3, 0.59, 0.11));
+}
+
+vec3
+clip_color (vec3 c)
+{
+  float l = lum (c);
+  float n = min (c.r, min (c.g, c.b));
+  float x = max (c.r, max (c.g, c.b));
+
+  if (n < 0.0)
+    c = l + (c - l) * l / (l - n);
+  if (x > 1.0)
+    c = l + (c - l) * (1.0 - l) / (x - l);
+
+  return c;
+}
+
+vec3
+set_lum (vec3 c, float l)
+{
+  return clip_color (c + (l - lum (c)));
+}
+
+float
+sat (vec3 c)
+{
+  return max (c.r, max (c.g, c.b)) - min (c.r, min (c.g, c.b));
+}
+
+vec3
+set_sat (vec3 c, float s)
+{
+  float c_min = min (c.r, min (c.g, c.b));
+  float c_max = max (c.r, max (c.g, c.b));
+
+  if (c_max > c_min)
+    return (c - c_min) * s / (c_max - c_min);
+
+  return vec3(0.0);
+}
+
+vec3
+blend (vec3 Cb, vec3 Cs, uint mode)
+{
+  if (mode == 1u)
+    return multiply (Cb, Cs);
+  if (mode == 2u)
+    return screen (Cb, Cs);
+  if (mode == 3u)
+    return overlay (Cb, Cs);
+  if (mode == 4u)
+    return min (Cb, Cs);
+  if (mode == 5u)
+    return max (Cb, Cs);
+  if (mode == 6u)
+    return vec3(color_dodge (Cb.r, Cs.r), color_dodge (Cb.g, Cs.g), color_dodge (Cb.b, Cs.b));
+  if (mode == 7u)
+    return vec3(color_burn (Cb.r, Cs.r), color_burn (Cb.g, Cs.g), color_burn (Cb.b, Cs.b));
+  if (mode == 8u)
+    return hard_light (Cb, Cs);
+  if (mode == 9u)
+    return soft_light (Cb, Cs);
+  if (mode == 10u)
+    return abs (Cb - Cs);
+  if (mode == 11u)
+    return Cb + Cs - 2.0 * Cb * Cs;
+  if (mode == 12u)
+    return set_lum (Cs, lum (Cb));
+  if (mode == 13u)
+    return set_lum (set_sat (Cs, sat (Cb)), lum (Cb));
+  if (mode == 14u)
+    return set_lum (set_sat (Cb, sat (Cs)), lum (Cb));
+  if (mode == 15u)
+    return set_lum (Cb, lum (Cs));
+
+  return Cs;
+}
+
+void main()
+{
+  vec4 top = texture (topTexture, inTopTexCoord);
+  vec4 bottom = texture (bottomTexture, inBottomTexCoord);
+  vec3 Cs = top.a > 0.0 ? top.rgb / top.a : vec3(0.0);
+  vec3 Cb = bottom.a > 0.0 ? bottom.rgb / bottom.a : vec3(0.0);
+
+  /* composite the blended top child over the bottom one */
+  vec4 result = vec4(top.rgb * (1.0 - bottom.a) + bottom.rgb * (1.0 - top.a) + top.a * bottom.a * blend (Cb, Cs, inBlendMode),
+                     top.a + bottom.a * (1.0 - top.a));
+
+  color = clip (inPos, result);
+}
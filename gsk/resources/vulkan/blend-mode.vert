@@ -0,0 +1,43 @@
+#version 420 core
+
+#include "clip.vert.glsl"
+
+layout(location = 0) in vec4 inRect;
+layout(location = 1) in vec4 inTopTexRect;
+layout(location = 2) in vec4 inBottomTexRect;
+layout(location = 3) in uint inBlendMode;
+
+layout(location = 0) out vec2 outPos;
+layout(location = 1) out vec2 outTopTexCoord;
+layout(location = 2) out vec2 outBottomTexCoord;
+layout(location = 3) out flat uint outBlendMode;
+
+out gl_PerVertex {
+  vec4 gl_Position;
+};
+
+vec2 offsets[6] = { vec2(0.0, 0.0),
+                    vec2(1.0, 0.0),
+                    vec2(0.0, 1.0),
+                    vec2(0.0, 1.0),
+                    vec2(1.0, 0.0),
+                    vec2(1.0, 1.0) };
+
+void main() {
+  vec4 rect = clip (inRect);
+  vec2 pos = rect.xy + rect.zw * offsets[gl_VertexIndex];
+  gl_Position = push.mvp * vec4 (pos, 0.0, 1.0);
+
+  outPos = pos;
+
+  vec4 texrect = vec4((rect.xy - inRect.xy) / inRect.zw,
+                      rect.zw / inRect.zw);
+  vec4 toptexrect = vec4(inTopTexRect.xy + inTopTexRect.zw * texrect.xy,
+                         inTopTexRect.zw * texrect.zw);
+  vec4 bottomtexrect = vec4(inBottomTexRect.xy + inBottomTexRect.zw * texrect.xy,
+                            inBottomTexRect.zw * texrect.zw);
+
+  outTopTexCoord = toptexrect.xy + toptexrect.zw * offsets[gl_VertexIndex];
+  outBottomTexCoord = bottomtexrect.xy + bottomtexrect.zw * offsets[gl_VertexIndex];
+  outBlendMode = inBlendMode;
+}
@@ -0,0 +1,31 @@
+#version 420 core
+
+#include "clip.frag.glsl"
+
+layout(location = 0) in vec2 inPos;
+layout(location = 1) in vec2 inTexCoord;
+layout(location = 2) in flat vec2 inStep;
+layout(location = 3) in flat float inSigma;
+
+layout(set = 0, binding = 0) uniform sampler2D inTexture;
+
+layout(location = 0) out vec4 color;
+
+void main()
+{
+  int radius = int (ceil (3.0 * inSigma));
+  vec4 sum = vec4(0.0);
+  float total = 0.0;
+
+  /* One direction of a separable gaussian blur, inStep is the
+   * distance between two texels in that direction */
+  for (int i = -radius; i <= radius; i++)
+    {
+      float weight = exp (- float (i * i) / (2.0 * inSigma * inSigma));
+
+      sum += weight * textureLod (inTexture, inTexCoord + float (i) * inStep, 0.0);
+      total += weight;
+    }
+
+  color = clip (inPos, sum / total);
+}
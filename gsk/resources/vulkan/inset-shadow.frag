@@ -10,6 +10,7 @@ layout(location = 3) in flat vec4 inOutlineCornerHeights;
 layout(location = 4) in flat vec4 inColor;
 layout(location = 5) in flat vec2 inOffset;
 layout(location = 6) in flat float inSpread;
+layout(location = 7) in flat float inBlurRadius;
 
 layout(location = 0) out vec4 color;
 
@@ -19,8 +20,7 @@ void main()
   RoundedRect inside = rounded_rect_shrink (outline, vec4(inSpread));
 
   color = vec4(inColor.rgb * inColor.a, inColor.a);
-  color = color * clamp (rounded_rect_coverage (outline, inPos) -
-                         rounded_rect_coverage (inside, inPos - inOffset),
-                         0.0, 1.0);
+  color = color * rounded_rect_coverage (outline, inPos) *
+                  (1.0 - rounded_rect_shadow (inside, inPos - inOffset, inBlurRadius / 2.0));
   color = clip (inPos, color);
 }
@@ -17,6 +17,7 @@ layout(location = 3) out flat vec4 outOutlineCornerHeights;
 layout(location = 4) out flat vec4 outColor;
 layout(location = 5) out flat vec2 outOffset;
 layout(location = 6) out flat float outSpread;
+layout(location = 7) out flat float outBlurRadius;
 
 out gl_PerVertex {
   vec4 gl_Position;
@@ -42,4 +43,5 @@ void main() {
   outColor = inColor;
   outOffset = inOffset;
   outSpread = inSpread;
+  outBlurRadius = inBlurRadius;
 }
@@ -66,4 +66,65 @@ rounded_rect_shrink (RoundedRect r, vec4 amount)
   return RoundedRect (new_bounds, new_widths, new_heights);
 }
 
+/* Approximation of the error function, see Abramowitz and Stegun, 7.1.27 */
+vec2
+erf (vec2 x)
+{
+  vec2 s = sign (x);
+  vec2 a = abs (x);
+
+  x = 1.0 + (0.278393 + (0.230389 + 0.078108 * (a * a)) * a) * a;
+  x *= x;
+
+  return s - s / (x * x);
+}
+
+float
+gaussian (float x, float sigma)
+{
+  return exp (- (x * x) / (2.0 * sigma * sigma)) / (2.506628 * sigma);
+}
+
+/* The coverage of a horizontal slice of a blurred rounded box */
+float
+rounded_box_shadow_x (float x, float y, float sigma, float corner, vec2 half_size)
+{
+  float delta = min (half_size.y - corner - abs (y), 0.0);
+  float curved = half_size.x - corner + sqrt (max (0.0, corner * corner - delta * delta));
+  vec2 integral = 0.5 + 0.5 * erf ((x + vec2(-curved, curved)) * (0.707107 / sigma));
+
+  return integral.y - integral.x;
+}
+
+/* The coverage of a rounded rect blurred by a gaussian with the given
+ * standard deviation. The rect is sampled along the vertical axis and
+ * the corners are approximated by their average radius. */
+float
+rounded_rect_shadow (RoundedRect r, vec2 p, float sigma)
+{
+  if (sigma < 0.01)
+    return rounded_rect_coverage (r, p);
+
+  vec2 half_size = max (r.bounds.zw - r.bounds.xy, 0.0) * 0.5;
+  vec2 point = p - (r.bounds.xy + half_size);
+  float corner = (dot (r.corner_widths, vec4(0.25)) + dot (r.corner_heights, vec4(0.25))) * 0.5;
+  corner = min (corner, min (half_size.x, half_size.y));
+
+  float low = point.y - half_size.y;
+  float high = point.y + half_size.y;
+  float start = clamp (-3.0 * sigma, low, high);
+  float end = clamp (3.0 * sigma, low, high);
+  float dy = (end - start) / 4.0;
+  float y = start + dy * 0.5;
+  float value = 0.0;
+
+  for (int i = 0; i < 4; i++)
+    {
+      value += rounded_box_shadow_x (point.x, point.y - y, sigma, corner, half_size) * gaussian (y, sigma) * dy;
+      y += dy;
+    }
+
+  return value;
+}
+
 #endif
@@ -0,0 +1,99 @@
+/* GTK - The GIMP Toolkit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_CSS_BLOOM_FILTER_PRIVATE_H__
+#define __GTK_CSS_BLOOM_FILTER_PRIVATE_H__
+
+#include <glib.h>
+#include <string.h>
+
+G_BEGIN_DECLS
+
+/* A bloom filter of the names, ids and style classes of all ancestors of a
+ * CSS node. It can tell for sure that no ancestor has a given name, id or
+ * class, which lets selector matching skip walking the ancestors for
+ * descendant selectors.
+ *
+ * Every entry sets 2 of the 256 bits. With the 50 or so entries of deep
+ * widget hierarchies, about 1 in 8 lookups gives a false positive.
+ */
+#define GTK_CSS_BLOOM_FILTER_BITS 256
+
+typedef struct _GtkCssBloomFilter GtkCssBloomFilter;
+
+struct _GtkCssBloomFilter
+{
+  guint64 bits[GTK_CSS_BLOOM_FILTER_BITS / 64];
+};
+
+typedef enum {
+  GTK_CSS_BLOOM_FILTER_NAME,
+  GTK_CSS_BLOOM_FILTER_ID,
+  GTK_CSS_BLOOM_FILTER_CLASS
+} GtkCssBloomFilterKind;
+
+static inline guint64
+gtk_css_bloom_filter_hash (GtkCssBloomFilterKind kind,
+                           gsize                 key)
+{
+  /* Fibonacci hashing, names and ids are interned strings and classes
+   * are quarks, so the key itself is good enough as input.
+   */
+  return ((guint64) key * 4 + kind) * G_GUINT64_CONSTANT (0x9E3779B97F4A7C15);
+}
+
+static inline void
+gtk_css_bloom_filter_clear (GtkCssBloomFilter *filter)
+{
+  memset (filter, 0, sizeof (GtkCssBloomFilter));
+}
+
+/* A filter that contains everything, for when the ancestors are unknown */
+static inline void
+gtk_css_bloom_filter_fill (GtkCssBloomFilter *filter)
+{
+  memset (filter, 0xff, sizeof (GtkCssBloomFilter));
+}
+
+static inline void
+gtk_css_bloom_filter_add (GtkCssBloomFilter     *filter,
+                          GtkCssBloomFilterKind  kind,
+                          gsize                  key)
+{
+  guint64 hash = gtk_css_bloom_filter_hash (kind, key);
+  guint bit1 = hash >> 56;
+  guint bit2 = (hash >> 48) & 0xff;
+
+  filter->bits[bit1 / 64] |= G_GUINT64_CONSTANT (1) << (bit1 % 64);
+  filter->bits[bit2 / 64] |= G_GUINT64_CONSTANT (1) << (bit2 % 64);
+}
+
+static inline gboolean
+gtk_css_bloom_filter_may_contain (const GtkCssBloomFilter *filter,
+                                  GtkCssBloomFilterKind    kind,
+                                  gsize                    key)
+{
+  guint64 hash = gtk_css_bloom_filter_hash (kind, key);
+  guint bit1 = hash >> 56;
+  guint bit2 = (hash >> 48) & 0xff;
+
+  return (filter->bits[bit1 / 64] & (G_GUINT64_CONSTANT (1) << (bit1 % 64))) &&
+         (filter->bits[bit2 / 64] & (G_GUINT64_CONSTANT (1) << (bit2 % 64)));
+}
+
+G_END_DECLS
+
+#endif /* __GTK_CSS_BLOOM_FILTER_PRIVATE_H__ */
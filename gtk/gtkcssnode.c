@@ -20,8 +20,11 @@
 #include "gtkcssnodeprivate.h"
 
 #include "gtkcssanimatedstyleprivate.h"
+#include "gtkcssmatcherprivate.h"
 #include "gtkcsssectionprivate.h"
+#include "gtkcssselectorprivate.h"
 #include "gtkcssstylepropertyprivate.h"
+#include "gtkdebug.h"
 #include "gtkintl.h"
 #include "gtkmarshalers.h"
 #include "gtksettingsprivate.h"
@@ -729,6 +732,22 @@ gtk_css_node_invalidate_style (GtkCssNode *cssnode)
     gtk_css_node_invalidate_style (cssnode->next_sibling);
 }
 
+/* Invalidates the ancestor filters of all descendants of @cssnode */
+static void
+gtk_css_node_invalidate_ancestor_filters (GtkCssNode *cssnode)
+{
+  GtkCssNode *child;
+
+  for (child = cssnode->first_child; child; child = child->next_sibling)
+    {
+      if (!child->ancestor_filter_valid)
+        continue;
+
+      child->ancestor_filter_valid = FALSE;
+      gtk_css_node_invalidate_ancestor_filters (child);
+    }
+}
+
 static void
 gtk_css_node_reposition (GtkCssNode *node,
                          GtkCssNode *new_parent,
@@ -771,6 +790,9 @@ gtk_css_node_reposition (GtkCssNode *node,
           g_object_unref (node);
         }
 
+      node->ancestor_filter_valid = FALSE;
+      gtk_css_node_invalidate_ancestor_filters (node);
+
       if (gtk_css_node_get_style_provider_or_null (node) == NULL)
         gtk_css_node_invalidate_style_provider (node);
       gtk_css_node_invalidate (node, GTK_CSS_CHANGE_TIMESTAMP | GTK_CSS_CHANGE_ANIMATIONS);
@@ -1106,6 +1128,7 @@ gtk_css_node_set_name (GtkCssNode              *cssnode,
   if (gtk_css_node_declaration_set_name (&cssnode->decl, name))
     {
       gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_NAME);
+      gtk_css_node_invalidate_ancestor_filters (cssnode);
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_NAME]);
     }
 }
@@ -1140,6 +1163,7 @@ gtk_css_node_set_id (GtkCssNode                *cssnode,
   if (gtk_css_node_declaration_set_id (&cssnode->decl, id))
     {
       gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_ID);
+      gtk_css_node_invalidate_ancestor_filters (cssnode);
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_ID]);
     }
 }
@@ -1173,6 +1197,7 @@ gtk_css_node_clear_classes (GtkCssNode *cssnode)
   if (gtk_css_node_declaration_clear_classes (&cssnode->decl))
     {
       gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_CLASS);
+      gtk_css_node_invalidate_ancestor_filters (cssnode);
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_CLASSES]);
     }
 }
@@ -1224,6 +1249,7 @@ gtk_css_node_add_class (GtkCssNode *cssnode,
   if (gtk_css_node_declaration_add_class (&cssnode->decl, style_class))
     {
       gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_CLASS);
+      gtk_css_node_invalidate_ancestor_filters (cssnode);
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_CLASSES]);
     }
 }
@@ -1235,6 +1261,7 @@ gtk_css_node_remove_class (GtkCssNode *cssnode,
   if (gtk_css_node_declaration_remove_class (&cssnode->decl, style_class))
     {
       gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_CLASS);
+      gtk_css_node_invalidate_ancestor_filters (cssnode);
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_CLASSES]);
     }
 }
@@ -1246,6 +1273,61 @@ gtk_css_node_has_class (GtkCssNode *cssnode,
   return gtk_css_node_declaration_has_class (cssnode->decl, style_class);
 }
 
+/* The ancestor filter is computed on demand, as only nodes that are
+ * matched against descendant selectors need it.
+ */
+const GtkCssBloomFilter *
+gtk_css_node_get_ancestor_filter (GtkCssNode *cssnode)
+{
+  const GtkCssBloomFilter *parent_filter;
+  GtkCssMatcher matcher;
+  GtkCssNode *parent;
+
+  if (cssnode->ancestor_filter_valid)
+    return &cssnode->ancestor_filter;
+
+  parent = cssnode->parent;
+
+  if (parent == NULL)
+    {
+      gtk_css_bloom_filter_clear (&cssnode->ancestor_filter);
+    }
+  else if (!gtk_css_node_init_matcher (parent, &matcher) ||
+           (parent_filter = _gtk_css_matcher_get_ancestor_filter (&matcher)) == NULL)
+    {
+      /* The ancestors are matched some other way, like with a widget path */
+      gtk_css_bloom_filter_fill (&cssnode->ancestor_filter);
+    }
+  else
+    {
+      const GQuark *classes;
+      const char *id;
+      guint i, n_classes;
+
+      cssnode->ancestor_filter = *parent_filter;
+
+      gtk_css_bloom_filter_add (&cssnode->ancestor_filter,
+                                GTK_CSS_BLOOM_FILTER_NAME,
+                                GPOINTER_TO_SIZE (gtk_css_node_get_name (parent)));
+
+      id = gtk_css_node_get_id (parent);
+      if (id)
+        gtk_css_bloom_filter_add (&cssnode->ancestor_filter,
+                                  GTK_CSS_BLOOM_FILTER_ID,
+                                  GPOINTER_TO_SIZE (id));
+
+      classes = gtk_css_node_declaration_get_classes (parent->decl, &n_classes);
+      for (i = 0; i < n_classes; i++)
+        gtk_css_bloom_filter_add (&cssnode->ancestor_filter,
+                                  GTK_CSS_BLOOM_FILTER_CLASS,
+                                  classes[i]);
+    }
+
+  cssnode->ancestor_filter_valid = TRUE;
+
+  return &cssnode->ancestor_filter;
+}
+
 const GQuark *
 gtk_css_node_list_classes (GtkCssNode *cssnode,
                            guint      *n_classes)
@@ -1275,6 +1357,84 @@ gtk_css_node_invalidate_style_provider (GtkCssNode *cssnode)
     }
 }
 
+/* Whether the rules of @selectors match @cssnode or could match it after
+ * a change of its state, position or its ancestors and siblings. In the
+ * latter case its style's change mask was computed without those rules,
+ * so the node needs a new style to be updated for that change.
+ */
+static gboolean
+gtk_css_node_may_match_any (GtkCssNode *cssnode,
+                            GPtrArray  *selectors)
+{
+  GtkCssSelectorMatches matches;
+  GtkCssMatcher matcher, change_matcher;
+  gboolean result;
+  guint i;
+
+  /* Be safe if we don't know what the node looks like */
+  if (!gtk_css_node_init_matcher (cssnode, &matcher))
+    return TRUE;
+
+  _gtk_css_matcher_superset_init (&change_matcher, &matcher, GTK_CSS_CHANGE_NAME | GTK_CSS_CHANGE_CLASS);
+
+  result = FALSE;
+  _gtk_css_selector_matches_init (&matches);
+
+  for (i = 0; i < selectors->len && !result; i++)
+    {
+      const GtkCssSelectorTree *tree = g_ptr_array_index (selectors, i);
+
+      if (_gtk_css_selector_tree_get_change_all (tree, &change_matcher) != 0)
+        {
+          result = TRUE;
+          continue;
+        }
+
+      /* Selectors without any change bits, like "*", only show up here */
+      _gtk_css_selector_tree_match_all (tree, &matcher, &matches);
+      result = matches.len > 0;
+    }
+
+  _gtk_css_selector_matches_clear (&matches);
+
+  return result;
+}
+
+/*< private >
+ * gtk_css_node_invalidate_style_provider_for_selectors:
+ * @cssnode: a #GtkCssNode
+ * @selectors: (element-type GtkCssSelectorTree): the selector trees of
+ *     the rules that were added to or removed from the style provider
+ *
+ * Like gtk_css_node_invalidate_style_provider(), but only invalidates
+ * the nodes that match one of @selectors or could match it after a
+ * #GtkCssChange. The styles of the other nodes neither change nor depend
+ * on the changed rules. The styles of the children of invalidated nodes
+ * are updated via %GTK_CSS_CHANGE_PARENT_STYLE when they are recomputed.
+ */
+void
+gtk_css_node_invalidate_style_provider_for_selectors (GtkCssNode *cssnode,
+                                                      GPtrArray  *selectors)
+{
+  GtkCssNode *child;
+
+  if (gtk_css_node_may_match_any (cssnode, selectors))
+    gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_SOURCE);
+
+  /* The cache may contain styles for states or siblings of the children
+   * that they don't currently have, and those may match the rules.
+   */
+  g_clear_pointer (&cssnode->cache, gtk_css_node_style_cache_unref);
+
+  for (child = cssnode->first_child;
+       child;
+       child = child->next_sibling)
+    {
+      if (gtk_css_node_get_style_provider_or_null (child) == NULL)
+        gtk_css_node_invalidate_style_provider_for_selectors (child, selectors);
+    }
+}
+
 static void
 gtk_css_node_invalidate_timestamp (GtkCssNode *cssnode)
 {
@@ -1352,6 +1512,25 @@ gtk_css_node_validate_internal (GtkCssNode *cssnode,
     }
 }
 
+#ifdef G_ENABLE_DEBUG
+static void
+gtk_css_node_print_descendant_counts (void)
+{
+  static guint64 last_walked, last_rejected;
+  guint64 walked, rejected;
+
+  _gtk_css_selector_tree_get_descendant_counts (&walked, &rejected);
+  if (walked == last_walked && rejected == last_rejected)
+    return;
+
+  g_message ("Descendant selectors: %" G_GUINT64_FORMAT " ancestor walks, %" G_GUINT64_FORMAT " skipped by the ancestor filter",
+             walked - last_walked, rejected - last_rejected);
+
+  last_walked = walked;
+  last_rejected = rejected;
+}
+#endif
+
 void
 gtk_css_node_validate (GtkCssNode *cssnode)
 {
@@ -1360,6 +1539,8 @@ gtk_css_node_validate (GtkCssNode *cssnode)
   timestamp = gtk_css_node_get_timestamp (cssnode);
 
   gtk_css_node_validate_internal (cssnode, timestamp);
+
+  GTK_NOTE (MISC, gtk_css_node_print_descendant_counts ());
 }
 
 gboolean
@@ -34,6 +34,7 @@
 #include "gtkcssselectorprivate.h"
 #include "gtkcssshorthandpropertyprivate.h"
 #include "gtkcssstylefuncsprivate.h"
+#include "gtkdebug.h"
 #include "gtksettingsprivate.h"
 #include "gtkstyleprovider.h"
 #include "gtkstylecontextprivate.h"
@@ -80,6 +81,7 @@
 
 typedef struct GtkCssRuleset GtkCssRuleset;
 typedef struct _GtkCssScanner GtkCssScanner;
+typedef struct _GtkCssCacheRecorder GtkCssCacheRecorder;
 typedef struct _PropertyValue PropertyValue;
 typedef enum ParserScope ParserScope;
 typedef enum ParserSymbol ParserSymbol;
@@ -97,6 +99,8 @@ struct GtkCssRuleset
   PropertyValue *styles;
   GtkBitmask *set_styles;
   guint n_styles;
+  /* 1 + the index of the ruleset's declarations when recording the cache */
+  guint declarations;
   guint owns_styles : 1;
 };
 
@@ -120,6 +124,32 @@ struct _GtkCssProviderPrivate
   GtkCssSelectorTree *tree;
   GResource *resource;
   gchar *path;
+
+  /* What was loaded before the last reset, until the change is emitted */
+  GtkCssSelectorTree *replaced_tree;
+  guint replaced_definitions :1;
+
+  GtkCssCacheRecorder *cache_recorder;
+};
+
+/* Themes are cached in a compiled form, see gtk_css_provider_load_theme() */
+#define GTK_CSS_CACHE_VERSION "gtk-css-cache-2 " GTK_VERSION
+#define GTK_CSS_CACHE_VARIANT_TYPE "(sa(sxts)a(sss)a(sss)a(sss)aauv)"
+
+/* Collects what the theme cache needs while parsing a theme */
+struct _GtkCssCacheRecorder
+{
+  /* The files that were loaded, including imports */
+  GPtrArray *sources;
+  GVariantBuilder colors;
+  GVariantBuilder keyframes;
+  /* The values of all declarations, with duplicates only stored once */
+  GVariantBuilder values;
+  GHashTable *value_indexes;
+  /* Arrays of indexes into the values, one per ruleset */
+  GPtrArray *declarations;
+  /* Set if the theme cannot be cached, like when there were errors */
+  gboolean failed;
 };
 
 enum {
@@ -340,6 +370,10 @@ gtk_css_provider_emit_error (GtkCssProvider *provider,
                              GtkCssScanner  *scanner,
                              const GError   *error)
 {
+  /* Loading from the cache would not report the error again */
+  if (provider->priv->cache_recorder)
+    provider->priv->cache_recorder->failed = TRUE;
+
   gtk_css_style_provider_emit_error (GTK_STYLE_PROVIDER_PRIVATE (provider),
                                      scanner ? scanner->section : NULL,
                                      error);
@@ -429,6 +463,81 @@ gtk_css_scanner_pop_section (GtkCssScanner *scanner,
   scanner->section = parent;
 }
 
+static GtkCssCacheRecorder *
+gtk_css_cache_recorder_new (void)
+{
+  GtkCssCacheRecorder *recorder;
+
+  recorder = g_slice_new0 (GtkCssCacheRecorder);
+  recorder->sources = g_ptr_array_new_with_free_func (g_object_unref);
+  g_variant_builder_init (&recorder->colors, G_VARIANT_TYPE ("a(sss)"));
+  g_variant_builder_init (&recorder->keyframes, G_VARIANT_TYPE ("a(sss)"));
+  g_variant_builder_init (&recorder->values, G_VARIANT_TYPE ("a(sss)"));
+  recorder->value_indexes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  recorder->declarations = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
+
+  return recorder;
+}
+
+static void
+gtk_css_cache_recorder_free (GtkCssCacheRecorder *recorder)
+{
+  g_ptr_array_unref (recorder->sources);
+  g_variant_builder_clear (&recorder->colors);
+  g_variant_builder_clear (&recorder->keyframes);
+  g_variant_builder_clear (&recorder->values);
+  g_hash_table_unref (recorder->value_indexes);
+  g_ptr_array_unref (recorder->declarations);
+
+  g_slice_free (GtkCssCacheRecorder, recorder);
+}
+
+/* The text between @start and @end, which is parsed again when loading
+ * the cache, relative to the scanner's file
+ */
+static void
+gtk_css_cache_recorder_get_text (GtkCssScanner  *scanner,
+                                 const char     *start,
+                                 const char     *end,
+                                 char          **uri,
+                                 char          **text)
+{
+  GFile *file = _gtk_css_parser_get_file (scanner->parser);
+
+  *uri = file ? g_file_get_uri (file) : g_strdup ("");
+  *text = g_strchomp (g_strndup (start, end - start));
+}
+
+static guint
+gtk_css_cache_recorder_add_value (GtkCssCacheRecorder *recorder,
+                                  GtkCssScanner       *scanner,
+                                  GtkStyleProperty    *property,
+                                  const char          *start,
+                                  const char          *end)
+{
+  char *uri, *text, *key;
+  gpointer index;
+
+  gtk_css_cache_recorder_get_text (scanner, start, end, &uri, &text);
+  key = g_strconcat (property->name, "\n", uri, "\n", text, NULL);
+
+  if (g_hash_table_lookup_extended (recorder->value_indexes, key, NULL, &index))
+    {
+      g_free (key);
+    }
+  else
+    {
+      index = GUINT_TO_POINTER (g_hash_table_size (recorder->value_indexes));
+      g_hash_table_insert (recorder->value_indexes, key, index);
+      g_variant_builder_add (&recorder->values, "(sss)", property->name, uri, text);
+    }
+
+  g_free (uri);
+  g_free (text);
+
+  return GPOINTER_TO_UINT (index);
+}
+
 static void
 gtk_css_provider_init (GtkCssProvider *css_provider)
 {
@@ -449,7 +558,7 @@ gtk_css_provider_init (GtkCssProvider *css_provider)
 static void
 verify_tree_match_results (GtkCssProvider *provider,
 			   const GtkCssMatcher *matcher,
-			   GPtrArray *tree_rules)
+			   const GtkCssSelectorMatches *tree_rules)
 {
 #ifdef VERIFY_TREE
   GtkCssProviderPrivate *priv = provider->priv;
@@ -465,7 +574,7 @@ verify_tree_match_results (GtkCssProvider *provider,
 
       for (j = 0; j < tree_rules->len; j++)
 	{
-	  if (ruleset == tree_rules->pdata[j])
+	  if (ruleset == tree_rules->data[j])
 	    {
 	      found = TRUE;
 	      break;
@@ -491,26 +600,24 @@ verify_tree_get_change_results (GtkCssProvider *provider,
 #ifdef VERIFY_TREE
   {
     GtkCssChange verify_change = 0;
-    GPtrArray *tree_rules;
+    GtkCssSelectorMatches tree_rules;
     int i;
 
-    tree_rules = _gtk_css_selector_tree_match_all (provider->priv->tree, matcher);
-    if (tree_rules)
-      {
-        verify_tree_match_results (provider, matcher, tree_rules);
-
-        for (i = tree_rules->len - 1; i >= 0; i--)
-          {
-	    GtkCssRuleset *ruleset;
+    _gtk_css_selector_matches_init (&tree_rules);
+    _gtk_css_selector_tree_match_all (provider->priv->tree, matcher, &tree_rules);
+    verify_tree_match_results (provider, matcher, &tree_rules);
 
-            ruleset = tree_rules->pdata[i];
+    for (i = tree_rules.len - 1; i >= 0; i--)
+      {
+        GtkCssRuleset *ruleset;
 
-            verify_change |= _gtk_css_selector_get_change (ruleset->selector);
-          }
+        ruleset = tree_rules.data[i];
 
-        g_ptr_array_free (tree_rules, TRUE);
+        verify_change |= _gtk_css_selector_get_change (ruleset->selector);
       }
 
+    _gtk_css_selector_matches_clear (&tree_rules);
+
     if (change != verify_change)
       {
 	GString *s;
@@ -572,48 +679,49 @@ gtk_css_style_provider_lookup (GtkStyleProviderPrivate *provider,
   GtkCssRuleset *ruleset;
   guint j;
   int i;
-  GPtrArray *tree_rules;
+  GtkCssSelectorMatches tree_rules;
 
   css_provider = GTK_CSS_PROVIDER (provider);
   priv = css_provider->priv;
 
-  tree_rules = _gtk_css_selector_tree_match_all (priv->tree, matcher);
-  if (tree_rules)
-    {
-      verify_tree_match_results (css_provider, matcher, tree_rules);
-
-      for (i = tree_rules->len - 1; i >= 0; i--)
-        {
-          ruleset = tree_rules->pdata[i];
+  _gtk_css_selector_matches_init (&tree_rules);
+  _gtk_css_selector_tree_match_all (priv->tree, matcher, &tree_rules);
+  verify_tree_match_results (css_provider, matcher, &tree_rules);
 
-          if (ruleset->styles == NULL)
-            continue;
+  /* The rulesets are sorted by specificity, and so are their addresses,
+   * so the most specific match comes last.
+   */
+  for (i = tree_rules.len - 1; i >= 0; i--)
+    {
+      ruleset = tree_rules.data[i];
 
-          if (!_gtk_bitmask_intersects (_gtk_css_lookup_get_missing (lookup),
-                                        ruleset->set_styles))
-          continue;
+      if (ruleset->styles == NULL)
+        continue;
 
-          for (j = 0; j < ruleset->n_styles; j++)
-            {
-              GtkCssStyleProperty *prop = ruleset->styles[j].property;
-              guint id = _gtk_css_style_property_get_id (prop);
+      if (!_gtk_bitmask_intersects (_gtk_css_lookup_get_missing (lookup),
+                                    ruleset->set_styles))
+        continue;
 
-              if (!_gtk_css_lookup_is_missing (lookup, id))
-                continue;
+      for (j = 0; j < ruleset->n_styles; j++)
+        {
+          GtkCssStyleProperty *prop = ruleset->styles[j].property;
+          guint id = _gtk_css_style_property_get_id (prop);
 
-              _gtk_css_lookup_set (lookup,
-                                   id,
-                                   ruleset->styles[j].section,
-                                  ruleset->styles[j].value);
-            }
+          if (!_gtk_css_lookup_is_missing (lookup, id))
+            continue;
 
-          if (_gtk_bitmask_is_empty (_gtk_css_lookup_get_missing (lookup)))
-            break;
+          _gtk_css_lookup_set (lookup,
+                               id,
+                               ruleset->styles[j].section,
+                               ruleset->styles[j].value);
         }
 
-      g_ptr_array_free (tree_rules, TRUE);
+      if (_gtk_bitmask_is_empty (_gtk_css_lookup_get_missing (lookup)))
+        break;
     }
 
+  _gtk_css_selector_matches_clear (&tree_rules);
+
   if (change)
     {
       GtkCssMatcher change_matcher;
@@ -625,6 +733,24 @@ gtk_css_style_provider_lookup (GtkStyleProviderPrivate *provider,
     }
 }
 
+static gboolean
+gtk_css_style_provider_get_selectors (GtkStyleProviderPrivate *provider,
+                                      GPtrArray               *selectors)
+{
+  GtkCssProvider *css_provider = GTK_CSS_PROVIDER (provider);
+  GtkCssProviderPrivate *priv = css_provider->priv;
+
+  /* Colors and keyframes can be used by the rules of other providers */
+  if (g_hash_table_size (priv->symbolic_colors) > 0 ||
+      g_hash_table_size (priv->keyframes) > 0)
+    return FALSE;
+
+  if (priv->tree)
+    g_ptr_array_add (selectors, priv->tree);
+
+  return TRUE;
+}
+
 static void
 gtk_css_style_provider_private_iface_init (GtkStyleProviderPrivateInterface *iface)
 {
@@ -632,6 +758,7 @@ gtk_css_style_provider_private_iface_init (GtkStyleProviderPrivateInterface *ifa
   iface->get_keyframes = gtk_css_style_provider_get_keyframes;
   iface->lookup = gtk_css_style_provider_lookup;
   iface->emit_error = gtk_css_style_provider_emit_error;
+  iface->get_selectors = gtk_css_style_provider_get_selectors;
 }
 
 static void
@@ -649,6 +776,7 @@ gtk_css_provider_finalize (GObject *object)
 
   g_array_free (priv->rulesets, TRUE);
   _gtk_css_selector_tree_free (priv->tree);
+  _gtk_css_selector_tree_free (priv->replaced_tree);
 
   g_hash_table_destroy (priv->symbolic_colors);
   g_hash_table_destroy (priv->keyframes);
@@ -782,15 +910,55 @@ gtk_css_provider_reset (GtkCssProvider *css_provider)
       priv->path = NULL;
     }
 
+  if (g_hash_table_size (priv->symbolic_colors) > 0 ||
+      g_hash_table_size (priv->keyframes) > 0)
+    priv->replaced_definitions = TRUE;
+
   g_hash_table_remove_all (priv->symbolic_colors);
   g_hash_table_remove_all (priv->keyframes);
 
   for (i = 0; i < priv->rulesets->len; i++)
     gtk_css_ruleset_clear (&g_array_index (priv->rulesets, GtkCssRuleset, i));
   g_array_set_size (priv->rulesets, 0);
-  _gtk_css_selector_tree_free (priv->tree);
+
+  /* Keep the selectors that styles were computed with until the change
+   * is emitted. The tree only points to the cleared rulesets, but those
+   * pointers are never followed when matching.
+   */
+  if (priv->replaced_tree == NULL)
+    priv->replaced_tree = priv->tree;
+  else
+    _gtk_css_selector_tree_free (priv->tree);
   priv->tree = NULL;
+}
+
+/* Only nodes matching the replaced or the new rules need a new style */
+static void
+gtk_css_provider_emit_changed (GtkCssProvider *css_provider)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  GPtrArray *selectors;
+
+  selectors = g_ptr_array_new ();
+
+  if (!priv->replaced_definitions &&
+      gtk_css_style_provider_get_selectors (GTK_STYLE_PROVIDER_PRIVATE (css_provider), selectors))
+    {
+      if (priv->replaced_tree)
+        g_ptr_array_add (selectors, priv->replaced_tree);
 
+      _gtk_style_provider_private_selectors_changed (GTK_STYLE_PROVIDER_PRIVATE (css_provider), selectors);
+    }
+  else
+    {
+      _gtk_style_provider_private_changed (GTK_STYLE_PROVIDER_PRIVATE (css_provider));
+    }
+
+  g_ptr_array_unref (selectors);
+
+  _gtk_css_selector_tree_free (priv->replaced_tree);
+  priv->replaced_tree = NULL;
+  priv->replaced_definitions = FALSE;
 }
 
 static gboolean
@@ -861,7 +1029,9 @@ parse_import (GtkCssScanner *scanner)
 static gboolean
 parse_color_definition (GtkCssScanner *scanner)
 {
+  GtkCssCacheRecorder *recorder = scanner->provider->priv->cache_recorder;
   GtkCssValue *color;
+  const char *start, *end;
   char *name;
 
   gtk_css_scanner_push_section (scanner, GTK_CSS_SECTION_COLOR_DEFINITION);
@@ -885,6 +1055,7 @@ parse_color_definition (GtkCssScanner *scanner)
       return TRUE;
     }
 
+  start = _gtk_css_parser_get_data (scanner->parser);
   color = _gtk_css_color_value_parse (scanner->parser);
   if (color == NULL)
     {
@@ -894,6 +1065,8 @@ parse_color_definition (GtkCssScanner *scanner)
       return TRUE;
     }
 
+  end = _gtk_css_parser_get_data (scanner->parser);
+
   if (!_gtk_css_parser_try (scanner->parser, ";", TRUE))
     {
       g_free (name);
@@ -909,6 +1082,16 @@ parse_color_definition (GtkCssScanner *scanner)
       return TRUE;
     }
 
+  if (recorder)
+    {
+      char *uri, *text;
+
+      gtk_css_cache_recorder_get_text (scanner, start, end, &uri, &text);
+      g_variant_builder_add (&recorder->colors, "(sss)", name, uri, text);
+      g_free (uri);
+      g_free (text);
+    }
+
   g_hash_table_insert (scanner->provider->priv->symbolic_colors, name, color);
 
   gtk_css_scanner_pop_section (scanner, GTK_CSS_SECTION_COLOR_DEFINITION);
@@ -929,6 +1112,10 @@ parse_binding_set (GtkCssScanner *scanner)
       return FALSE;
     }
 
+  /* Binding sets are global, the cache cannot recreate them */
+  if (scanner->provider->priv->cache_recorder)
+    scanner->provider->priv->cache_recorder->failed = TRUE;
+
   name = _gtk_css_parser_try_ident (scanner->parser, TRUE);
   if (name == NULL)
     {
@@ -1026,7 +1213,9 @@ skip_semicolon:
 static gboolean
 parse_keyframes (GtkCssScanner *scanner)
 {
+  GtkCssCacheRecorder *recorder = scanner->provider->priv->cache_recorder;
   GtkCssKeyframes *keyframes;
+  const char *start;
   char *name;
 
   gtk_css_scanner_push_section (scanner, GTK_CSS_SECTION_KEYFRAMES);
@@ -1061,6 +1250,7 @@ parse_keyframes (GtkCssScanner *scanner)
       goto exit;
     }
 
+  start = _gtk_css_parser_get_data (scanner->parser);
   keyframes = _gtk_css_keyframes_parse (scanner->parser);
   if (keyframes == NULL)
     {
@@ -1069,6 +1259,19 @@ parse_keyframes (GtkCssScanner *scanner)
       goto exit;
     }
 
+  if (recorder)
+    {
+      char *uri, *text, *block;
+
+      /* The parser stops at the closing brace, which it expects */
+      gtk_css_cache_recorder_get_text (scanner, start, _gtk_css_parser_get_data (scanner->parser), &uri, &text);
+      block = g_strconcat (text, "}", NULL);
+      g_variant_builder_add (&recorder->keyframes, "(sss)", name, uri, block);
+      g_free (uri);
+      g_free (text);
+      g_free (block);
+    }
+
   g_hash_table_insert (scanner->provider->priv->keyframes, name, keyframes);
 
   if (!_gtk_css_parser_try (scanner->parser, "}", TRUE))
@@ -1138,6 +1341,41 @@ parse_selector_list (GtkCssScanner *scanner)
   return selectors;
 }
 
+/* Adds @value to @ruleset, taking ownership of it. Shorthands are
+ * split up into their subproperties.
+ */
+static void
+gtk_css_ruleset_add_declaration (GtkCssRuleset    *ruleset,
+                                 GtkStyleProperty *property,
+                                 GtkCssValue      *value,
+                                 GtkCssSection    *section)
+{
+  if (GTK_IS_CSS_SHORTHAND_PROPERTY (property))
+    {
+      GtkCssShorthandProperty *shorthand = GTK_CSS_SHORTHAND_PROPERTY (property);
+      guint i;
+
+      for (i = 0; i < _gtk_css_shorthand_property_get_n_subproperties (shorthand); i++)
+        {
+          GtkCssStyleProperty *child = _gtk_css_shorthand_property_get_subproperty (shorthand, i);
+          GtkCssValue *sub = _gtk_css_array_value_get_nth (value, i);
+
+          gtk_css_ruleset_add (ruleset, child, _gtk_css_value_ref (sub), section);
+        }
+
+      _gtk_css_value_unref (value);
+    }
+  else if (GTK_IS_CSS_STYLE_PROPERTY (property))
+    {
+      gtk_css_ruleset_add (ruleset, GTK_CSS_STYLE_PROPERTY (property), value, section);
+    }
+  else
+    {
+      g_assert_not_reached ();
+      _gtk_css_value_unref (value);
+    }
+}
+
 static void
 parse_declaration (GtkCssScanner *scanner,
                    GtkCssRuleset *ruleset)
@@ -1183,12 +1421,15 @@ parse_declaration (GtkCssScanner *scanner,
 
   if (property)
     {
+      GtkCssCacheRecorder *recorder = scanner->provider->priv->cache_recorder;
       GtkCssValue *value;
+      const char *start;
 
       g_free (name);
 
       gtk_css_scanner_push_section (scanner, GTK_CSS_SECTION_VALUE);
 
+      start = _gtk_css_parser_get_data (scanner->parser);
       value = _gtk_style_property_parse_value (property,
                                                scanner->parser);
 
@@ -1215,31 +1456,16 @@ parse_declaration (GtkCssScanner *scanner,
           return;
         }
 
-      if (GTK_IS_CSS_SHORTHAND_PROPERTY (property))
+      if (recorder && ruleset->declarations)
         {
-          GtkCssShorthandProperty *shorthand = GTK_CSS_SHORTHAND_PROPERTY (property);
-          guint i;
+          guint index;
 
-          for (i = 0; i < _gtk_css_shorthand_property_get_n_subproperties (shorthand); i++)
-            {
-              GtkCssStyleProperty *child = _gtk_css_shorthand_property_get_subproperty (shorthand, i);
-              GtkCssValue *sub = _gtk_css_array_value_get_nth (value, i);
-              
-              gtk_css_ruleset_add (ruleset, child, _gtk_css_value_ref (sub), scanner->section);
-            }
-          
-            _gtk_css_value_unref (value);
-        }
-      else if (GTK_IS_CSS_STYLE_PROPERTY (property))
-        {
-          gtk_css_ruleset_add (ruleset, GTK_CSS_STYLE_PROPERTY (property), value, scanner->section);
-        }
-      else
-        {
-          g_assert_not_reached ();
-          _gtk_css_value_unref (value);
+          index = gtk_css_cache_recorder_add_value (recorder, scanner, property,
+                                                    start, _gtk_css_parser_get_data (scanner->parser));
+          g_array_append_val (g_ptr_array_index (recorder->declarations, ruleset->declarations - 1), index);
         }
 
+      gtk_css_ruleset_add_declaration (ruleset, property, value, scanner->section);
 
       gtk_css_scanner_pop_section (scanner, GTK_CSS_SECTION_VALUE);
     }
@@ -1303,6 +1529,14 @@ parse_ruleset (GtkCssScanner *scanner)
       return;
     }
 
+  if (scanner->provider->priv->cache_recorder)
+    {
+      GPtrArray *declarations = scanner->provider->priv->cache_recorder->declarations;
+
+      g_ptr_array_add (declarations, g_array_new (FALSE, FALSE, sizeof (guint)));
+      ruleset.declarations = declarations->len;
+    }
+
   parse_declarations (scanner, &ruleset);
 
   if (!_gtk_css_parser_try (scanner->parser, "}", TRUE))
@@ -1416,6 +1650,9 @@ gtk_css_provider_load_internal (GtkCssProvider *css_provider,
   GtkCssScanner *scanner;
   char *free_data = NULL;
 
+  if (file && css_provider->priv->cache_recorder)
+    g_ptr_array_add (css_provider->priv->cache_recorder->sources, g_object_ref (file));
+
   if (text == NULL)
     {
       GError *load_error = NULL;
@@ -1514,7 +1751,7 @@ gtk_css_provider_load_from_data (GtkCssProvider  *css_provider,
 
   g_free (free_data);
 
-  _gtk_style_provider_private_changed (GTK_STYLE_PROVIDER_PRIVATE (css_provider));
+  gtk_css_provider_emit_changed (css_provider);
 }
 
 /**
@@ -1536,7 +1773,7 @@ gtk_css_provider_load_from_file (GtkCssProvider  *css_provider,
 
   gtk_css_provider_load_internal (css_provider, NULL, file, NULL);
 
-  _gtk_style_provider_private_changed (GTK_STYLE_PROVIDER_PRIVATE (css_provider));
+  gtk_css_provider_emit_changed (css_provider);
 }
 
 /**
@@ -1737,6 +1974,441 @@ _gtk_css_find_theme (const gchar *name,
   return path;
 }
 
+/* The theme cache
+ *
+ * Loading a theme means parsing all of its CSS and building the selector
+ * tree from the rulesets, which is a noticeable part of the startup time
+ * of applications. So themes are cached in a compiled form, a GVariant
+ * of type GTK_CSS_CACHE_VARIANT_TYPE that is mapped into memory:
+ *
+ * - the GTK version, as the format of everything else depends on it
+ * - the files the theme was loaded from, with their modification time
+ *   and size, to check that the cache is up to date; resources have no
+ *   modification time, so their contents are checksummed instead
+ * - the color definitions and keyframes, as their name, the URI that
+ *   relative URLs are resolved against and the text of their value
+ * - the values of all declarations, the same way; values that are used
+ *   more than once, like most colors, are only stored and parsed once
+ * - the declarations of each ruleset, as indexes into the values
+ * - the selector tree, see _gtk_css_selector_tree_serialize()
+ *
+ * Themes that have errors or binding sets are not cached, as loading
+ * them from the cache would not do the same.
+ */
+
+static char *
+gtk_css_provider_get_cache_path (GFile *file)
+{
+  char *uri, *checksum, *name, *path;
+
+  /* The cache does not know about sections */
+  if (gtk_keep_css_sections || GTK_DEBUG_CHECK (NO_CSS_CACHE))
+    return NULL;
+
+  uri = g_file_get_uri (file);
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, uri, -1);
+  name = g_strconcat (checksum, ".cache", NULL);
+  path = g_build_filename (g_get_user_cache_dir (), "gtk-4.0", "css", name, NULL);
+
+  g_free (name);
+  g_free (checksum);
+  g_free (uri);
+
+  return path;
+}
+
+static gboolean
+gtk_css_cache_get_file_stamp (GFile    *file,
+                              gint64   *mtime,
+                              guint64  *size,
+                              char    **checksum)
+{
+  GFileInfo *info;
+
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC ","
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                            G_FILE_QUERY_INFO_NONE,
+                            NULL, NULL);
+  if (info == NULL)
+    return FALSE;
+
+  /* Resources have no modification time */
+  *mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC
+           + g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+  *size = g_file_info_get_size (info);
+
+  g_object_unref (info);
+
+  /* A rebuilt library may ship a different theme of the same size */
+  if (g_file_has_uri_scheme (file, "resource"))
+    {
+      char *data;
+      gsize length;
+
+      if (!g_file_load_contents (file, NULL, &data, &length, NULL, NULL))
+        return FALSE;
+
+      *checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1, (const guchar *) data, length);
+      g_free (data);
+    }
+  else
+    *checksum = g_strdup ("");
+
+  return TRUE;
+}
+
+static void
+gtk_css_provider_write_cache (GtkCssProvider      *css_provider,
+                              GtkCssCacheRecorder *recorder,
+                              const char          *cache_path)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  GVariantBuilder sources, rulesets;
+  GHashTable *match_indexes;
+  GVariant *variant, *tree;
+  GError *error = NULL;
+  char *dir;
+  guint i;
+
+  g_variant_builder_init (&sources, G_VARIANT_TYPE ("a(sxts)"));
+  for (i = 0; i < recorder->sources->len; i++)
+    {
+      GFile *file = g_ptr_array_index (recorder->sources, i);
+      guint64 size;
+      gint64 mtime;
+      char *uri, *checksum;
+
+      if (!gtk_css_cache_get_file_stamp (file, &mtime, &size, &checksum))
+        {
+          g_variant_builder_clear (&sources);
+          return;
+        }
+
+      uri = g_file_get_uri (file);
+      g_variant_builder_add (&sources, "(sxts)", uri, mtime, size, checksum);
+      g_free (checksum);
+      g_free (uri);
+    }
+
+  match_indexes = g_hash_table_new (NULL, NULL);
+  g_variant_builder_init (&rulesets, G_VARIANT_TYPE ("aau"));
+  for (i = 0; i < priv->rulesets->len; i++)
+    {
+      GtkCssRuleset *ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+      GArray *declarations;
+
+      g_hash_table_insert (match_indexes, ruleset, GUINT_TO_POINTER (i));
+
+      declarations = g_ptr_array_index (recorder->declarations, ruleset->declarations - 1);
+      g_variant_builder_add_value (&rulesets,
+                                   g_variant_new_fixed_array (G_VARIANT_TYPE_UINT32,
+                                                              declarations->data,
+                                                              declarations->len,
+                                                              sizeof (guint)));
+    }
+
+  tree = _gtk_css_selector_tree_serialize (priv->tree, match_indexes);
+  g_hash_table_unref (match_indexes);
+
+  variant = g_variant_new (GTK_CSS_CACHE_VARIANT_TYPE,
+                           GTK_CSS_CACHE_VERSION,
+                           &sources,
+                           &recorder->colors,
+                           &recorder->keyframes,
+                           &recorder->values,
+                           &rulesets,
+                           tree);
+  g_variant_ref_sink (variant);
+
+  dir = g_path_get_dirname (cache_path);
+  g_mkdir_with_parents (dir, 0700);
+  g_free (dir);
+
+  if (!g_file_set_contents (cache_path,
+                            g_variant_get_data (variant),
+                            g_variant_get_size (variant),
+                            &error))
+    {
+      GTK_NOTE (MISC, g_message ("Could not write theme cache: %s", error->message));
+      g_error_free (error);
+    }
+
+  g_variant_unref (variant);
+}
+
+typedef struct {
+  char *uri;
+  GFile *file;
+  gboolean failed;
+} GtkCssCacheLoader;
+
+static void
+gtk_css_cache_loader_error (GtkCssParser *parser,
+                            const GError *error,
+                            gpointer      user_data)
+{
+  GtkCssCacheLoader *loader = user_data;
+
+  loader->failed = TRUE;
+}
+
+/* Most values are relative to the same file, so it is kept around */
+static GtkCssParser *
+gtk_css_cache_loader_parser_new (GtkCssCacheLoader *loader,
+                                 const char        *uri,
+                                 const char        *text)
+{
+  if (g_strcmp0 (loader->uri, uri) != 0)
+    {
+      g_free (loader->uri);
+      g_clear_object (&loader->file);
+
+      loader->uri = g_strdup (uri);
+      if (*uri)
+        loader->file = g_file_new_for_uri (uri);
+    }
+
+  return _gtk_css_parser_new (text, loader->file, gtk_css_cache_loader_error, loader);
+}
+
+static gboolean
+gtk_css_cache_check_sources (GVariant *sources)
+{
+  GVariantIter iter;
+  const char *uri, *checksum;
+  guint64 size, current_size;
+  gint64 mtime, current_mtime;
+  char *current_checksum;
+
+  g_variant_iter_init (&iter, sources);
+  while (g_variant_iter_next (&iter, "(&sxt&s)", &uri, &mtime, &size, &checksum))
+    {
+      GFile *file = g_file_new_for_uri (uri);
+      gboolean valid;
+
+      valid = gtk_css_cache_get_file_stamp (file, &current_mtime, &current_size, &current_checksum);
+      if (valid)
+        {
+          valid = current_mtime == mtime &&
+                  current_size == size &&
+                  g_str_equal (current_checksum, checksum);
+          g_free (current_checksum);
+        }
+
+      g_object_unref (file);
+
+      if (!valid)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+gtk_css_provider_load_cache_variant (GtkCssProvider    *css_provider,
+                                     GVariant          *variant,
+                                     GtkCssCacheLoader *loader)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  GVariant *sources, *colors, *keyframes, *values, *rulesets, *tree;
+  GtkStyleProperty **properties = NULL;
+  GtkCssValue **parsed = NULL;
+  GtkCssSelectorTree **selector_matches = NULL;
+  gpointer *matches = NULL;
+  gsize i, j, n_values = 0, n_rulesets;
+  const char *version, *name, *uri, *text;
+  gboolean success = FALSE;
+  GVariantIter iter;
+
+  g_variant_get (variant, "(&s@a(sxts)@a(sss)@a(sss)@a(sss)@aauv)",
+                 &version, &sources, &colors, &keyframes, &values, &rulesets, &tree);
+
+  if (!g_str_equal (version, GTK_CSS_CACHE_VERSION) ||
+      !gtk_css_cache_check_sources (sources))
+    goto out;
+
+  g_variant_iter_init (&iter, colors);
+  while (g_variant_iter_next (&iter, "(&s&s&s)", &name, &uri, &text))
+    {
+      GtkCssParser *parser = gtk_css_cache_loader_parser_new (loader, uri, text);
+      GtkCssValue *color;
+
+      color = _gtk_css_color_value_parse (parser);
+      _gtk_css_parser_free (parser);
+      if (color == NULL)
+        goto out;
+
+      g_hash_table_insert (priv->symbolic_colors, g_strdup (name), color);
+    }
+
+  g_variant_iter_init (&iter, keyframes);
+  while (g_variant_iter_next (&iter, "(&s&s&s)", &name, &uri, &text))
+    {
+      GtkCssParser *parser = gtk_css_cache_loader_parser_new (loader, uri, text);
+      GtkCssKeyframes *parsed_keyframes;
+
+      parsed_keyframes = _gtk_css_keyframes_parse (parser);
+      _gtk_css_parser_free (parser);
+      if (parsed_keyframes == NULL)
+        goto out;
+
+      g_hash_table_insert (priv->keyframes, g_strdup (name), parsed_keyframes);
+    }
+
+  n_values = g_variant_n_children (values);
+  properties = g_new0 (GtkStyleProperty *, n_values);
+  parsed = g_new0 (GtkCssValue *, n_values);
+  for (i = 0; i < n_values; i++)
+    {
+      GtkCssParser *parser;
+
+      g_variant_get_child (values, i, "(&s&s&s)", &name, &uri, &text);
+
+      properties[i] = _gtk_style_property_lookup (name);
+      if (properties[i] == NULL)
+        goto out;
+
+      parser = gtk_css_cache_loader_parser_new (loader, uri, text);
+      parsed[i] = _gtk_style_property_parse_value (properties[i], parser);
+      _gtk_css_parser_free (parser);
+      if (parsed[i] == NULL)
+        goto out;
+    }
+
+  if (loader->failed)
+    goto out;
+
+  n_rulesets = g_variant_n_children (rulesets);
+  g_array_set_size (priv->rulesets, n_rulesets);
+  memset (priv->rulesets->data, 0, n_rulesets * sizeof (GtkCssRuleset));
+  matches = g_new (gpointer, n_rulesets);
+  selector_matches = g_new0 (GtkCssSelectorTree *, n_rulesets);
+
+  for (i = 0; i < n_rulesets; i++)
+    {
+      GtkCssRuleset *ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+      GVariant *declarations;
+      const guint32 *indexes;
+      gsize n_indexes;
+
+      matches[i] = ruleset;
+
+      declarations = g_variant_get_child_value (rulesets, i);
+      indexes = g_variant_get_fixed_array (declarations, &n_indexes, sizeof (guint32));
+      for (j = 0; j < n_indexes; j++)
+        {
+          if (indexes[j] >= n_values)
+            break;
+
+          gtk_css_ruleset_add_declaration (ruleset,
+                                           properties[indexes[j]],
+                                           _gtk_css_value_ref (parsed[indexes[j]]),
+                                           NULL);
+        }
+      g_variant_unref (declarations);
+
+      if (j < n_indexes)
+        goto out;
+    }
+
+  if (!_gtk_css_selector_tree_deserialize (tree, matches, n_rulesets, selector_matches, &priv->tree))
+    goto out;
+
+  for (i = 0; i < n_rulesets; i++)
+    g_array_index (priv->rulesets, GtkCssRuleset, i).selector_match = selector_matches[i];
+
+  success = TRUE;
+
+out:
+  for (i = 0; i < n_values && parsed[i]; i++)
+    _gtk_css_value_unref (parsed[i]);
+  g_free (parsed);
+  g_free (properties);
+  g_free (matches);
+  g_free (selector_matches);
+
+  g_variant_unref (sources);
+  g_variant_unref (colors);
+  g_variant_unref (keyframes);
+  g_variant_unref (values);
+  g_variant_unref (rulesets);
+  g_variant_unref (tree);
+
+  return success;
+}
+
+static gboolean
+gtk_css_provider_load_cache (GtkCssProvider *css_provider,
+                             const char     *cache_path)
+{
+  GtkCssCacheLoader loader = { NULL, };
+  GMappedFile *mapped;
+  GVariant *variant;
+  GBytes *bytes;
+  gboolean success;
+
+  mapped = g_mapped_file_new (cache_path, FALSE, NULL);
+  if (mapped == NULL)
+    return FALSE;
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  g_mapped_file_unref (mapped);
+
+  variant = g_variant_new_from_bytes (G_VARIANT_TYPE (GTK_CSS_CACHE_VARIANT_TYPE), bytes, FALSE);
+  g_variant_ref_sink (variant);
+  g_bytes_unref (bytes);
+
+  success = gtk_css_provider_load_cache_variant (css_provider, variant, &loader);
+
+  g_variant_unref (variant);
+  g_free (loader.uri);
+  g_clear_object (&loader.file);
+
+  if (!success)
+    gtk_css_provider_reset (css_provider);
+
+  return success;
+}
+
+/* Loads a theme, from the cache if it is up to date */
+static void
+gtk_css_provider_load_theme (GtkCssProvider *css_provider,
+                             GFile          *file)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  char *cache_path;
+
+  gtk_css_provider_reset (css_provider);
+
+  cache_path = gtk_css_provider_get_cache_path (file);
+
+  if (cache_path && gtk_css_provider_load_cache (css_provider, cache_path))
+    {
+      GTK_NOTE (MISC, g_message ("Loaded theme from cache %s", cache_path));
+    }
+  else
+    {
+      if (cache_path)
+        priv->cache_recorder = gtk_css_cache_recorder_new ();
+
+      gtk_css_provider_load_internal (css_provider, NULL, file, NULL);
+
+      if (priv->cache_recorder)
+        {
+          if (!priv->cache_recorder->failed)
+            gtk_css_provider_write_cache (css_provider, priv->cache_recorder, cache_path);
+
+          g_clear_pointer (&priv->cache_recorder, gtk_css_cache_recorder_free);
+        }
+    }
+
+  g_free (cache_path);
+
+  gtk_css_provider_emit_changed (css_provider);
+}
+
 /**
  * _gtk_css_provider_load_named:
  * @provider: a #GtkCssProvider
@@ -1772,7 +2444,19 @@ _gtk_css_provider_load_named (GtkCssProvider *provider,
 
   if (g_resources_get_info (resource_path, 0, NULL, NULL, NULL))
     {
-      gtk_css_provider_load_from_resource (provider, resource_path);
+      GFile *file;
+      char *uri, *escaped;
+
+      escaped = g_uri_escape_string (resource_path,
+                                     G_URI_RESERVED_CHARS_ALLOWED_IN_PATH, FALSE);
+      uri = g_strconcat ("resource://", escaped, NULL);
+      file = g_file_new_for_uri (uri);
+
+      gtk_css_provider_load_theme (provider, file);
+
+      g_object_unref (file);
+      g_free (uri);
+      g_free (escaped);
       g_free (resource_path);
       return;
     }
@@ -1784,6 +2468,7 @@ _gtk_css_provider_load_named (GtkCssProvider *provider,
     {
       char *dir, *resource_file;
       GResource *resource;
+      GFile *file;
 
       dir = g_path_get_dirname (path);
       resource_file = g_build_filename (dir, "gtk.gresource", NULL);
@@ -1793,9 +2478,11 @@ _gtk_css_provider_load_named (GtkCssProvider *provider,
       if (resource != NULL)
         g_resources_register (resource);
 
-      gtk_css_provider_load_from_path (provider, path);
+      file = g_file_new_for_path (path);
+      gtk_css_provider_load_theme (provider, file);
+      g_object_unref (file);
 
-      /* Only set this after load, as load_from_path will clear it */
+      /* Only set this after load, as loading will clear it */
       provider->priv->resource = resource;
       provider->priv->path = dir;
 
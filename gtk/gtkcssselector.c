@@ -133,27 +133,68 @@ gtk_css_selector_tree_get_matches (const GtkCssSelectorTree *tree)
   return (gpointer *) ((guint8 *)tree + tree->matches_offset);
 }
 
+void
+_gtk_css_selector_matches_init (GtkCssSelectorMatches *matches)
+{
+  matches->data = matches->preallocated;
+  matches->len = 0;
+  matches->size = GTK_CSS_SELECTOR_MATCHES_PREALLOCATED;
+}
+
+void
+_gtk_css_selector_matches_clear (GtkCssSelectorMatches *matches)
+{
+  if (matches->data != matches->preallocated)
+    g_free (matches->data);
+
+  _gtk_css_selector_matches_init (matches);
+}
+
+/* Keeps the matches sorted, so the caller can go through them in order
+ * without sorting them first.
+ */
 static void
-g_ptr_array_insert_sorted (GPtrArray *array,
-                           gpointer   data)
+gtk_css_selector_matches_insert (GtkCssSelectorMatches *matches,
+                                 gpointer               data)
 {
-  gint i;
+  guint lo, hi;
 
-  for (i = 0; i < array->len; i++)
+  lo = 0;
+  hi = matches->len;
+  while (lo < hi)
     {
-      if (data == array->pdata[i])
+      guint mid = (lo + hi) / 2;
+
+      if (matches->data[mid] == data)
         return;
+      else if (matches->data[mid] < data)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
 
-      if (data < array->pdata[i])
-        break;
+  if (matches->len == matches->size)
+    {
+      matches->size *= 2;
+      if (matches->data == matches->preallocated)
+        {
+          matches->data = g_new (gpointer, matches->size);
+          memcpy (matches->data, matches->preallocated, sizeof (matches->preallocated));
+        }
+      else
+        {
+          matches->data = g_renew (gpointer, matches->data, matches->size);
+        }
     }
 
-  g_ptr_array_insert (array, i, data);
+  memmove (&matches->data[lo + 1], &matches->data[lo], (matches->len - lo) * sizeof (gpointer));
+  matches->data[lo] = data;
+  matches->len++;
 }
 
 static void
-gtk_css_selector_tree_found_match (const GtkCssSelectorTree  *tree,
-				   GPtrArray                **array)
+gtk_css_selector_tree_found_match (const GtkCssSelectorTree *tree,
+				   GtkCssSelectorMatches    *results)
 {
   int i;
   gpointer *matches;
@@ -161,11 +202,8 @@ gtk_css_selector_tree_found_match (const GtkCssSelectorTree  *tree,
   matches = gtk_css_selector_tree_get_matches (tree);
   if (matches)
     {
-      if (!*array)
-        *array = g_ptr_array_sized_new (16);
-
       for (i = 0; matches[i] != NULL; i++)
-        g_ptr_array_insert_sorted (*array, matches[i]);
+        gtk_css_selector_matches_insert (results, matches[i]);
     }
 }
 
@@ -1490,6 +1528,112 @@ gtk_css_selectors_skip_initial_selector (GtkCssSelector *selector, const GtkCssS
   return (GtkCssSelector *)gtk_css_selector_previous (selector);
 }
 
+#ifdef G_ENABLE_DEBUG
+static guint64 descendant_walks;
+static guint64 descendant_rejects;
+#endif
+
+/* Checks the names, ids and classes an ancestor needs to have for @tree to
+ * match it against the ancestor filter. Only the part of the compound
+ * selector that does not branch is checked.
+ */
+static gboolean
+gtk_css_selector_tree_may_match_ancestor (const GtkCssSelectorTree *tree,
+                                          const GtkCssBloomFilter  *filter)
+{
+  while (tree->selector.class->is_simple)
+    {
+      if (tree->selector.class == &GTK_CSS_SELECTOR_NAME)
+        {
+          if (!gtk_css_bloom_filter_may_contain (filter,
+                                                 GTK_CSS_BLOOM_FILTER_NAME,
+                                                 GPOINTER_TO_SIZE (tree->selector.name.name)))
+            return FALSE;
+        }
+      else if (tree->selector.class == &GTK_CSS_SELECTOR_ID)
+        {
+          if (!gtk_css_bloom_filter_may_contain (filter,
+                                                 GTK_CSS_BLOOM_FILTER_ID,
+                                                 GPOINTER_TO_SIZE (tree->selector.id.name)))
+            return FALSE;
+        }
+      else if (tree->selector.class == &GTK_CSS_SELECTOR_CLASS)
+        {
+          if (!gtk_css_bloom_filter_may_contain (filter,
+                                                 GTK_CSS_BLOOM_FILTER_CLASS,
+                                                 tree->selector.style_class.style_class))
+            return FALSE;
+        }
+
+      /* Selectors ending here match without the rest */
+      if (gtk_css_selector_tree_get_matches (tree))
+        return TRUE;
+
+      tree = gtk_css_selector_tree_get_previous (tree);
+      if (tree == NULL || gtk_css_selector_tree_get_sibling (tree) != NULL)
+        return TRUE;
+    }
+
+  return TRUE;
+}
+
+/* Descendant selectors walk all ancestors, so check the ancestor filter
+ * first if the matcher has one.
+ */
+static gboolean
+gtk_css_selector_tree_descendant_may_match (const GtkCssSelectorTree *tree,
+                                            const GtkCssMatcher      *matcher)
+{
+  const GtkCssBloomFilter *filter;
+  const GtkCssSelectorTree *prev;
+
+  filter = _gtk_css_matcher_get_ancestor_filter (matcher);
+  if (filter == NULL)
+    return TRUE;
+
+  for (prev = gtk_css_selector_tree_get_previous (tree);
+       prev != NULL;
+       prev = gtk_css_selector_tree_get_sibling (prev))
+    {
+      if (gtk_css_selector_tree_may_match_ancestor (prev, filter))
+        {
+#ifdef G_ENABLE_DEBUG
+          descendant_walks++;
+#endif
+          return TRUE;
+        }
+    }
+
+#ifdef G_ENABLE_DEBUG
+  descendant_rejects++;
+#endif
+
+  return FALSE;
+}
+
+/*< private >
+ * _gtk_css_selector_tree_get_descendant_counts:
+ * @walked: (out): return location for the number of ancestor walks
+ * @rejected: (out): return location for the number of ancestor walks
+ *     that were skipped thanks to the ancestor filter
+ *
+ * Gets how often descendant selectors were matched by walking the
+ * ancestors of a node. The counts are only kept in debug builds, and
+ * are printed after validating styles when GTK_DEBUG includes "misc".
+ */
+void
+_gtk_css_selector_tree_get_descendant_counts (guint64 *walked,
+                                              guint64 *rejected)
+{
+#ifdef G_ENABLE_DEBUG
+  *walked = descendant_walks;
+  *rejected = descendant_rejects;
+#else
+  *walked = 0;
+  *rejected = 0;
+#endif
+}
+
 static gboolean
 gtk_css_selector_tree_match_foreach (const GtkCssSelector *selector,
                                      const GtkCssMatcher  *matcher,
@@ -1506,22 +1650,34 @@ gtk_css_selector_tree_match_foreach (const GtkCssSelector *selector,
   for (prev = gtk_css_selector_tree_get_previous (tree);
        prev != NULL;
        prev = gtk_css_selector_tree_get_sibling (prev))
-    gtk_css_selector_foreach (&prev->selector, matcher, gtk_css_selector_tree_match_foreach, res);
+    {
+      if (prev->selector.class == &GTK_CSS_SELECTOR_DESCENDANT &&
+          !gtk_css_selector_tree_descendant_may_match (prev, matcher))
+        continue;
+
+      gtk_css_selector_foreach (&prev->selector, matcher, gtk_css_selector_tree_match_foreach, res);
+    }
 
   return FALSE;
 }
 
-GPtrArray *
+/*< private >
+ * _gtk_css_selector_tree_match_all:
+ * @tree: the selector tree
+ * @matcher: the matcher to match against
+ * @matches: an initialized #GtkCssSelectorMatches to add the matches to
+ *
+ * Finds all matches of @matcher in @tree. The matches are added to
+ * @matches sorted by their address.
+ */
+void
 _gtk_css_selector_tree_match_all (const GtkCssSelectorTree *tree,
-				  const GtkCssMatcher *matcher)
+				  const GtkCssMatcher      *matcher,
+                                  GtkCssSelectorMatches    *matches)
 {
-  GPtrArray *array = NULL;
-
   for (; tree != NULL;
        tree = gtk_css_selector_tree_get_sibling (tree))
-    gtk_css_selector_foreach (&tree->selector, matcher, gtk_css_selector_tree_match_foreach, &array);
-
-  return array;
+    gtk_css_selector_foreach (&tree->selector, matcher, gtk_css_selector_tree_match_foreach, matches);
 }
 
 /* When checking for changes via the tree we need to know if a rule further
@@ -1917,3 +2073,288 @@ _gtk_css_selector_tree_builder_build (GtkCssSelectorTreeBuilder *builder)
 
   return tree;
 }
+
+/* Serialization of the tree, used by the theme cache. Nodes are stored
+ * in depth-first order, so the root is the first one, and link to each
+ * other by index. Matches are stored as indexes into the caller's list.
+ */
+
+#define GTK_CSS_SELECTOR_TREE_NODE_VARIANT_TYPE "(ysuxxiiiau)"
+
+static const GtkCssSelectorClass *selector_classes[] = {
+  &GTK_CSS_SELECTOR_DESCENDANT,
+  &GTK_CSS_SELECTOR_CHILD,
+  &GTK_CSS_SELECTOR_SIBLING,
+  &GTK_CSS_SELECTOR_ADJACENT,
+  &GTK_CSS_SELECTOR_ANY,
+  &GTK_CSS_SELECTOR_NOT_ANY,
+  &GTK_CSS_SELECTOR_NAME,
+  &GTK_CSS_SELECTOR_NOT_NAME,
+  &GTK_CSS_SELECTOR_CLASS,
+  &GTK_CSS_SELECTOR_NOT_CLASS,
+  &GTK_CSS_SELECTOR_ID,
+  &GTK_CSS_SELECTOR_NOT_ID,
+  &GTK_CSS_SELECTOR_PSEUDOCLASS_STATE,
+  &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_STATE,
+  &GTK_CSS_SELECTOR_PSEUDOCLASS_POSITION,
+  &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_POSITION
+};
+
+static void
+gtk_css_selector_tree_collect (const GtkCssSelectorTree *tree,
+                               GPtrArray                *nodes,
+                               GHashTable               *indexes)
+{
+  while (tree != NULL)
+    {
+      g_hash_table_insert (indexes, (gpointer) tree, GUINT_TO_POINTER (nodes->len));
+      g_ptr_array_add (nodes, (gpointer) tree);
+
+      gtk_css_selector_tree_collect (gtk_css_selector_tree_get_previous (tree), nodes, indexes);
+
+      tree = gtk_css_selector_tree_get_sibling (tree);
+    }
+}
+
+static gint32
+gtk_css_selector_tree_get_index (GHashTable               *indexes,
+                                 const GtkCssSelectorTree *tree)
+{
+  if (tree == NULL)
+    return -1;
+
+  return GPOINTER_TO_UINT (g_hash_table_lookup (indexes, tree));
+}
+
+/*< private >
+ * _gtk_css_selector_tree_serialize:
+ * @tree: (nullable): a selector tree
+ * @match_indexes: maps the matches of @tree to their index
+ *
+ * Serializes @tree, so that _gtk_css_selector_tree_deserialize() can
+ * recreate it in another process.
+ *
+ * Returns: (transfer floating): a #GVariant of type "a(ysuxxiiiau)"
+ */
+GVariant *
+_gtk_css_selector_tree_serialize (const GtkCssSelectorTree *tree,
+                                  GHashTable               *match_indexes)
+{
+  GVariantBuilder builder;
+  GHashTable *indexes;
+  GPtrArray *nodes;
+  guint i, c;
+
+  nodes = g_ptr_array_new ();
+  indexes = g_hash_table_new (NULL, NULL);
+  gtk_css_selector_tree_collect (tree, nodes, indexes);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" GTK_CSS_SELECTOR_TREE_NODE_VARIANT_TYPE));
+
+  for (i = 0; i < nodes->len; i++)
+    {
+      const GtkCssSelectorTree *node = g_ptr_array_index (nodes, i);
+      const GtkCssSelector *selector = &node->selector;
+      GVariantBuilder matches;
+      const char *name = "";
+      guint32 flags = 0;
+      gint64 a = 0, b = 0;
+      gpointer *match;
+
+      for (c = 0; c < G_N_ELEMENTS (selector_classes); c++)
+        {
+          if (selector_classes[c] == selector->class)
+            break;
+        }
+      g_assert (c < G_N_ELEMENTS (selector_classes));
+
+      if (selector->class == &GTK_CSS_SELECTOR_NAME ||
+          selector->class == &GTK_CSS_SELECTOR_NOT_NAME)
+        name = selector->name.name;
+      else if (selector->class == &GTK_CSS_SELECTOR_ID ||
+               selector->class == &GTK_CSS_SELECTOR_NOT_ID)
+        name = selector->id.name;
+      else if (selector->class == &GTK_CSS_SELECTOR_CLASS ||
+               selector->class == &GTK_CSS_SELECTOR_NOT_CLASS)
+        name = g_quark_to_string (selector->style_class.style_class);
+      else if (selector->class == &GTK_CSS_SELECTOR_PSEUDOCLASS_STATE ||
+               selector->class == &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_STATE)
+        flags = selector->state.state;
+      else if (selector->class == &GTK_CSS_SELECTOR_PSEUDOCLASS_POSITION ||
+               selector->class == &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_POSITION)
+        {
+          flags = selector->position.type;
+          a = selector->position.a;
+          b = selector->position.b;
+        }
+
+      g_variant_builder_init (&matches, G_VARIANT_TYPE ("au"));
+      match = gtk_css_selector_tree_get_matches (node);
+      for (; match && *match; match++)
+        g_variant_builder_add (&matches, "u", GPOINTER_TO_UINT (g_hash_table_lookup (match_indexes, *match)));
+
+      g_variant_builder_add (&builder, GTK_CSS_SELECTOR_TREE_NODE_VARIANT_TYPE,
+                             (guchar) c, name, flags, a, b,
+                             gtk_css_selector_tree_get_index (indexes, gtk_css_selector_tree_get_parent (node)),
+                             gtk_css_selector_tree_get_index (indexes, gtk_css_selector_tree_get_previous (node)),
+                             gtk_css_selector_tree_get_index (indexes, gtk_css_selector_tree_get_sibling (node)),
+                             &matches);
+    }
+
+  g_hash_table_unref (indexes);
+  g_ptr_array_unref (nodes);
+
+  return g_variant_builder_end (&builder);
+}
+
+static gint32
+gtk_css_selector_tree_offset_for_index (gint32 from,
+                                        gint32 to)
+{
+  if (to < 0)
+    return GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET;
+
+  return (to - from) * (gint32) sizeof (GtkCssSelectorTree);
+}
+
+/*< private >
+ * _gtk_css_selector_tree_deserialize:
+ * @variant: a #GVariant created by _gtk_css_selector_tree_serialize()
+ * @matches: (array length=n_matches): the matches, by index
+ * @n_matches: the number of matches
+ * @selector_matches: (array length=n_matches) (out caller-allocates):
+ *   return location for the node each match belongs to
+ * @tree: (out) (nullable): return location for the tree
+ *
+ * Recreates a tree serialized with _gtk_css_selector_tree_serialize().
+ *
+ * Returns: %FALSE if @variant is not a valid tree
+ */
+gboolean
+_gtk_css_selector_tree_deserialize (GVariant            *variant,
+                                    gpointer            *matches,
+                                    guint                n_matches,
+                                    GtkCssSelectorTree **selector_matches,
+                                    GtkCssSelectorTree **tree)
+{
+  GtkCssSelectorTree *nodes;
+  gpointer *match_data;
+  gsize n_nodes, n_match_data;
+  GVariant *node_matches;
+  guint i;
+
+  *tree = NULL;
+
+  if (!g_variant_is_of_type (variant, G_VARIANT_TYPE ("a" GTK_CSS_SELECTOR_TREE_NODE_VARIANT_TYPE)))
+    return FALSE;
+
+  n_nodes = g_variant_n_children (variant);
+  if (n_nodes == 0)
+    return TRUE;
+
+  /* Matches are stored after the nodes, like the builder does */
+  n_match_data = 0;
+  for (i = 0; i < n_nodes; i++)
+    {
+      GVariant *node = g_variant_get_child_value (variant, i);
+      gsize n;
+
+      node_matches = g_variant_get_child_value (node, 8);
+      n = g_variant_n_children (node_matches);
+      if (n > 0)
+        n_match_data += n + 1;
+
+      g_variant_unref (node_matches);
+      g_variant_unref (node);
+    }
+
+  nodes = g_malloc0 (n_nodes * sizeof (GtkCssSelectorTree) + n_match_data * sizeof (gpointer));
+  match_data = (gpointer *) (nodes + n_nodes);
+
+  for (i = 0; i < n_nodes; i++)
+    {
+      GtkCssSelectorTree *node = &nodes[i];
+      const char *name;
+      guint32 flags;
+      gint64 a, b;
+      gint32 parent, previous, sibling;
+      guchar c;
+      gsize j, n;
+
+      g_variant_get_child (variant, i, "(y&suxxiii@au)",
+                           &c, &name, &flags, &a, &b, &parent, &previous, &sibling, &node_matches);
+
+      /* The nodes are in the depth-first order of
+       * gtk_css_selector_tree_collect(), so parents come before and
+       * the other nodes after; anything else could loop forever
+       */
+      if (c >= G_N_ELEMENTS (selector_classes) ||
+          parent < -1 || parent >= (gint32) i ||
+          (previous != -1 && (previous <= (gint32) i || previous >= (gint32) n_nodes)) ||
+          (sibling != -1 && (sibling <= (gint32) i || sibling >= (gint32) n_nodes)))
+        {
+          g_variant_unref (node_matches);
+          g_free (nodes);
+          return FALSE;
+        }
+
+      node->selector.class = selector_classes[c];
+      if (node->selector.class == &GTK_CSS_SELECTOR_NAME ||
+          node->selector.class == &GTK_CSS_SELECTOR_NOT_NAME)
+        node->selector.name.name = g_intern_string (name);
+      else if (node->selector.class == &GTK_CSS_SELECTOR_ID ||
+               node->selector.class == &GTK_CSS_SELECTOR_NOT_ID)
+        node->selector.id.name = g_intern_string (name);
+      else if (node->selector.class == &GTK_CSS_SELECTOR_CLASS ||
+               node->selector.class == &GTK_CSS_SELECTOR_NOT_CLASS)
+        node->selector.style_class.style_class = g_quark_from_string (name);
+      else if (node->selector.class == &GTK_CSS_SELECTOR_PSEUDOCLASS_STATE ||
+               node->selector.class == &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_STATE)
+        node->selector.state.state = flags;
+      else if (node->selector.class == &GTK_CSS_SELECTOR_PSEUDOCLASS_POSITION ||
+               node->selector.class == &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_POSITION)
+        {
+          node->selector.position.type = flags;
+          node->selector.position.a = a;
+          node->selector.position.b = b;
+        }
+
+      node->parent_offset = gtk_css_selector_tree_offset_for_index (i, parent);
+      node->previous_offset = gtk_css_selector_tree_offset_for_index (i, previous);
+      node->sibling_offset = gtk_css_selector_tree_offset_for_index (i, sibling);
+
+      n = g_variant_n_children (node_matches);
+      if (n == 0)
+        {
+          node->matches_offset = GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET;
+        }
+      else
+        {
+          node->matches_offset = (guint8 *) match_data - (guint8 *) node;
+
+          for (j = 0; j < n; j++)
+            {
+              guint32 index;
+
+              g_variant_get_child (node_matches, j, "u", &index);
+              if (index >= n_matches)
+                {
+                  g_variant_unref (node_matches);
+                  g_free (nodes);
+                  return FALSE;
+                }
+
+              *match_data++ = matches[index];
+              selector_matches[index] = node;
+            }
+
+          *match_data++ = NULL;
+        }
+
+      g_variant_unref (node_matches);
+    }
+
+  *tree = nodes;
+
+  return TRUE;
+}
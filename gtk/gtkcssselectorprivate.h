@@ -26,6 +26,21 @@ G_BEGIN_DECLS
 typedef union _GtkCssSelector GtkCssSelector;
 typedef struct _GtkCssSelectorTree GtkCssSelectorTree;
 typedef struct _GtkCssSelectorTreeBuilder GtkCssSelectorTreeBuilder;
+typedef struct _GtkCssSelectorMatches GtkCssSelectorMatches;
+
+/* The matches found in a selector tree, sorted and without duplicates.
+ * It is meant to live on the stack and only allocates memory when there
+ * are a lot of matches.
+ */
+#define GTK_CSS_SELECTOR_MATCHES_PREALLOCATED 64
+
+struct _GtkCssSelectorMatches
+{
+  gpointer *data;
+  guint     len;
+  guint     size;
+  gpointer  preallocated[GTK_CSS_SELECTOR_MATCHES_PREALLOCATED];
+};
 
 GtkCssSelector *  _gtk_css_selector_parse           (GtkCssParser           *parser);
 void              _gtk_css_selector_free            (GtkCssSelector         *selector);
@@ -40,13 +55,26 @@ GtkCssChange      _gtk_css_selector_get_change      (const GtkCssSelector   *sel
 int               _gtk_css_selector_compare         (const GtkCssSelector   *a,
                                                      const GtkCssSelector   *b);
 
+void         _gtk_css_selector_matches_init          (GtkCssSelectorMatches    *matches);
+void         _gtk_css_selector_matches_clear         (GtkCssSelectorMatches    *matches);
+
 void         _gtk_css_selector_tree_free             (GtkCssSelectorTree       *tree);
-GPtrArray *  _gtk_css_selector_tree_match_all        (const GtkCssSelectorTree *tree,
-						      const GtkCssMatcher      *matcher);
+void         _gtk_css_selector_tree_match_all        (const GtkCssSelectorTree *tree,
+						      const GtkCssMatcher      *matcher,
+                                                      GtkCssSelectorMatches    *matches);
 GtkCssChange _gtk_css_selector_tree_get_change_all   (const GtkCssSelectorTree *tree,
 						      const GtkCssMatcher *matcher);
 void         _gtk_css_selector_tree_match_print      (const GtkCssSelectorTree *tree,
 						      GString                  *str);
+void         _gtk_css_selector_tree_get_descendant_counts (guint64            *walked,
+                                                      guint64                  *rejected);
+GVariant *   _gtk_css_selector_tree_serialize        (const GtkCssSelectorTree *tree,
+                                                      GHashTable               *match_indexes);
+gboolean     _gtk_css_selector_tree_deserialize      (GVariant                 *variant,
+                                                      gpointer                 *matches,
+                                                      guint                     n_matches,
+                                                      GtkCssSelectorTree      **selector_matches,
+                                                      GtkCssSelectorTree      **tree);
 
 
 GtkCssSelectorTreeBuilder *_gtk_css_selector_tree_builder_new   (void);
@@ -26,6 +26,7 @@
 #include "gtkcssenumvalueprivate.h"
 #include "gtkcssinheritvalueprivate.h"
 #include "gtkcssinitialvalueprivate.h"
+#include "gtkcsslookupprivate.h"
 #include "gtkcssnumbervalueprivate.h"
 #include "gtkcsssectionprivate.h"
 #include "gtkcssshorthandpropertyprivate.h"
@@ -40,6 +41,218 @@
 
 G_DEFINE_TYPE (GtkCssStaticStyle, gtk_css_static_style, GTK_TYPE_CSS_STYLE)
 
+static const guint core_properties[] = {
+  GTK_CSS_PROPERTY_TEXT_DECORATION_LINE,
+  GTK_CSS_PROPERTY_TEXT_DECORATION_COLOR,
+  GTK_CSS_PROPERTY_TEXT_DECORATION_STYLE,
+  GTK_CSS_PROPERTY_BOX_SHADOW,
+  GTK_CSS_PROPERTY_ICON_SOURCE,
+  GTK_CSS_PROPERTY_ICON_TRANSFORM,
+  GTK_CSS_PROPERTY_ICON_FILTER,
+  GTK_CSS_PROPERTY_OPACITY,
+  GTK_CSS_PROPERTY_FILTER,
+  GTK_CSS_PROPERTY_GTK_KEY_BINDINGS
+};
+
+static const guint font_properties[] = {
+  GTK_CSS_PROPERTY_DPI,
+  GTK_CSS_PROPERTY_FONT_SIZE,
+  GTK_CSS_PROPERTY_FONT_FAMILY,
+  GTK_CSS_PROPERTY_FONT_STYLE,
+  GTK_CSS_PROPERTY_FONT_VARIANT,
+  GTK_CSS_PROPERTY_FONT_WEIGHT,
+  GTK_CSS_PROPERTY_FONT_STRETCH,
+  GTK_CSS_PROPERTY_LETTER_SPACING
+};
+
+static const guint text_properties[] = {
+  GTK_CSS_PROPERTY_COLOR,
+  GTK_CSS_PROPERTY_TEXT_SHADOW,
+  GTK_CSS_PROPERTY_CARET_COLOR,
+  GTK_CSS_PROPERTY_SECONDARY_CARET_COLOR
+};
+
+static const guint icon_properties[] = {
+  GTK_CSS_PROPERTY_ICON_THEME,
+  GTK_CSS_PROPERTY_ICON_PALETTE,
+  GTK_CSS_PROPERTY_ICON_SHADOW,
+  GTK_CSS_PROPERTY_ICON_STYLE
+};
+
+static const guint size_properties[] = {
+  GTK_CSS_PROPERTY_MARGIN_TOP,
+  GTK_CSS_PROPERTY_MARGIN_LEFT,
+  GTK_CSS_PROPERTY_MARGIN_BOTTOM,
+  GTK_CSS_PROPERTY_MARGIN_RIGHT,
+  GTK_CSS_PROPERTY_PADDING_TOP,
+  GTK_CSS_PROPERTY_PADDING_LEFT,
+  GTK_CSS_PROPERTY_PADDING_BOTTOM,
+  GTK_CSS_PROPERTY_PADDING_RIGHT,
+  GTK_CSS_PROPERTY_BORDER_SPACING,
+  GTK_CSS_PROPERTY_MIN_WIDTH,
+  GTK_CSS_PROPERTY_MIN_HEIGHT
+};
+
+static const guint background_properties[] = {
+  GTK_CSS_PROPERTY_BACKGROUND_COLOR,
+  GTK_CSS_PROPERTY_BACKGROUND_CLIP,
+  GTK_CSS_PROPERTY_BACKGROUND_ORIGIN,
+  GTK_CSS_PROPERTY_BACKGROUND_SIZE,
+  GTK_CSS_PROPERTY_BACKGROUND_POSITION,
+  GTK_CSS_PROPERTY_BACKGROUND_REPEAT,
+  GTK_CSS_PROPERTY_BACKGROUND_IMAGE,
+  GTK_CSS_PROPERTY_BACKGROUND_BLEND_MODE
+};
+
+static const guint border_properties[] = {
+  GTK_CSS_PROPERTY_BORDER_TOP_STYLE,
+  GTK_CSS_PROPERTY_BORDER_TOP_WIDTH,
+  GTK_CSS_PROPERTY_BORDER_LEFT_STYLE,
+  GTK_CSS_PROPERTY_BORDER_LEFT_WIDTH,
+  GTK_CSS_PROPERTY_BORDER_BOTTOM_STYLE,
+  GTK_CSS_PROPERTY_BORDER_BOTTOM_WIDTH,
+  GTK_CSS_PROPERTY_BORDER_RIGHT_STYLE,
+  GTK_CSS_PROPERTY_BORDER_RIGHT_WIDTH,
+  GTK_CSS_PROPERTY_BORDER_TOP_LEFT_RADIUS,
+  GTK_CSS_PROPERTY_BORDER_TOP_RIGHT_RADIUS,
+  GTK_CSS_PROPERTY_BORDER_BOTTOM_RIGHT_RADIUS,
+  GTK_CSS_PROPERTY_BORDER_BOTTOM_LEFT_RADIUS,
+  GTK_CSS_PROPERTY_BORDER_TOP_COLOR,
+  GTK_CSS_PROPERTY_BORDER_RIGHT_COLOR,
+  GTK_CSS_PROPERTY_BORDER_BOTTOM_COLOR,
+  GTK_CSS_PROPERTY_BORDER_LEFT_COLOR,
+  GTK_CSS_PROPERTY_BORDER_IMAGE_SOURCE,
+  GTK_CSS_PROPERTY_BORDER_IMAGE_REPEAT,
+  GTK_CSS_PROPERTY_BORDER_IMAGE_SLICE,
+  GTK_CSS_PROPERTY_BORDER_IMAGE_WIDTH
+};
+
+static const guint outline_properties[] = {
+  GTK_CSS_PROPERTY_OUTLINE_STYLE,
+  GTK_CSS_PROPERTY_OUTLINE_WIDTH,
+  GTK_CSS_PROPERTY_OUTLINE_OFFSET,
+  GTK_CSS_PROPERTY_OUTLINE_TOP_LEFT_RADIUS,
+  GTK_CSS_PROPERTY_OUTLINE_TOP_RIGHT_RADIUS,
+  GTK_CSS_PROPERTY_OUTLINE_BOTTOM_RIGHT_RADIUS,
+  GTK_CSS_PROPERTY_OUTLINE_BOTTOM_LEFT_RADIUS,
+  GTK_CSS_PROPERTY_OUTLINE_COLOR
+};
+
+static const guint animation_properties[] = {
+  GTK_CSS_PROPERTY_TRANSITION_PROPERTY,
+  GTK_CSS_PROPERTY_TRANSITION_DURATION,
+  GTK_CSS_PROPERTY_TRANSITION_TIMING_FUNCTION,
+  GTK_CSS_PROPERTY_TRANSITION_DELAY,
+  GTK_CSS_PROPERTY_ANIMATION_NAME,
+  GTK_CSS_PROPERTY_ANIMATION_DURATION,
+  GTK_CSS_PROPERTY_ANIMATION_TIMING_FUNCTION,
+  GTK_CSS_PROPERTY_ANIMATION_ITERATION_COUNT,
+  GTK_CSS_PROPERTY_ANIMATION_DIRECTION,
+  GTK_CSS_PROPERTY_ANIMATION_PLAY_STATE,
+  GTK_CSS_PROPERTY_ANIMATION_DELAY,
+  GTK_CSS_PROPERTY_ANIMATION_FILL_MODE
+};
+
+static const struct {
+  const guint *properties;
+  guint        n_properties;
+} group_info[GTK_CSS_VALUES_N_GROUPS] = {
+  [GTK_CSS_VALUES_CORE] = { core_properties, G_N_ELEMENTS (core_properties) },
+  [GTK_CSS_VALUES_FONT] = { font_properties, G_N_ELEMENTS (font_properties) },
+  [GTK_CSS_VALUES_TEXT] = { text_properties, G_N_ELEMENTS (text_properties) },
+  [GTK_CSS_VALUES_ICON] = { icon_properties, G_N_ELEMENTS (icon_properties) },
+  [GTK_CSS_VALUES_SIZE] = { size_properties, G_N_ELEMENTS (size_properties) },
+  [GTK_CSS_VALUES_BACKGROUND] = { background_properties, G_N_ELEMENTS (background_properties) },
+  [GTK_CSS_VALUES_BORDER] = { border_properties, G_N_ELEMENTS (border_properties) },
+  [GTK_CSS_VALUES_OUTLINE] = { outline_properties, G_N_ELEMENTS (outline_properties) },
+  [GTK_CSS_VALUES_ANIMATION] = { animation_properties, G_N_ELEMENTS (animation_properties) },
+};
+
+/* Where to find each property, filled in class_init */
+static guint8 property_group[GTK_CSS_PROPERTY_N_PROPERTIES];
+static guint8 property_index[GTK_CSS_PROPERTY_N_PROPERTIES];
+/* Groups that only contain inherited properties */
+static gboolean group_is_inherited[GTK_CSS_VALUES_N_GROUPS];
+
+static GtkCssValues *
+gtk_css_values_new (GtkCssValuesGroup group)
+{
+  GtkCssValues *values;
+
+  values = g_malloc0 (sizeof (GtkCssValues) + (group_info[group].n_properties - 1) * sizeof (GtkCssValue *));
+  values->ref_count = 1;
+  values->group = group;
+
+  return values;
+}
+
+static GtkCssValues *
+gtk_css_values_ref (GtkCssValues *values)
+{
+  values->ref_count++;
+
+  return values;
+}
+
+static void
+gtk_css_values_unref (GtkCssValues *values)
+{
+  guint i;
+
+  values->ref_count--;
+  if (values->ref_count > 0)
+    return;
+
+  for (i = 0; i < group_info[values->group].n_properties; i++)
+    {
+      if (values->values[i])
+        _gtk_css_value_unref (values->values[i]);
+    }
+
+  g_free (values);
+}
+
+static GtkCssValues *
+gtk_css_values_copy (const GtkCssValues *values)
+{
+  GtkCssValues *copy;
+  guint i;
+
+  copy = gtk_css_values_new (values->group);
+  for (i = 0; i < group_info[values->group].n_properties; i++)
+    {
+      if (values->values[i])
+        copy->values[i] = _gtk_css_value_ref (values->values[i]);
+    }
+
+  return copy;
+}
+
+static gboolean
+gtk_css_values_equal (const GtkCssValues *values1,
+                      const GtkCssValues *values2)
+{
+  guint i;
+
+  if (values1 == values2)
+    return TRUE;
+
+  for (i = 0; i < group_info[values1->group].n_properties; i++)
+    {
+      GtkCssValue *value1 = values1->values[i];
+      GtkCssValue *value2 = values2->values[i];
+
+      if (value1 == value2)
+        continue;
+
+      if (value1 == NULL || value2 == NULL ||
+          !_gtk_css_value_equal (value1, value2))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
 static GtkCssValue *
 gtk_css_static_style_get_value (GtkCssStyle *style,
                                 guint        id)
@@ -47,7 +260,7 @@ gtk_css_static_style_get_value (GtkCssStyle *style,
   /* This is called a lot, so we avoid a dynamic type check here */
   GtkCssStaticStyle *sstyle = (GtkCssStaticStyle *) style;
 
-  return sstyle->values[id];
+  return sstyle->groups[property_group[id]]->values[property_index[id]];
 }
 
 static GtkCssSection *
@@ -69,11 +282,8 @@ gtk_css_static_style_dispose (GObject *object)
   GtkCssStaticStyle *style = GTK_CSS_STATIC_STYLE (object);
   guint i;
 
-  for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
-    {
-      if (style->values[i])
-        _gtk_css_value_unref (style->values[i]);
-    }
+  for (i = 0; i < GTK_CSS_VALUES_N_GROUPS; i++)
+    g_clear_pointer (&style->groups[i], gtk_css_values_unref);
   if (style->sections)
     {
       g_ptr_array_unref (style->sections);
@@ -88,6 +298,27 @@ gtk_css_static_style_class_init (GtkCssStaticStyleClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GtkCssStyleClass *style_class = GTK_CSS_STYLE_CLASS (klass);
+  guint group, i, n_properties = 0;
+
+  for (group = 0; group < GTK_CSS_VALUES_N_GROUPS; group++)
+    {
+      group_is_inherited[group] = TRUE;
+
+      for (i = 0; i < group_info[group].n_properties; i++)
+        {
+          guint id = group_info[group].properties[i];
+
+          property_group[id] = group;
+          property_index[id] = i;
+
+          if (!_gtk_css_style_property_is_inherit (_gtk_css_style_property_lookup_by_id (id)))
+            group_is_inherited[group] = FALSE;
+        }
+
+      n_properties += group_info[group].n_properties;
+    }
+
+  g_assert (n_properties == GTK_CSS_PROPERTY_N_PROPERTIES);
 
   object_class->dispose = gtk_css_static_style_dispose;
 
@@ -98,6 +329,10 @@ gtk_css_static_style_class_init (GtkCssStaticStyleClass *klass)
 static void
 gtk_css_static_style_init (GtkCssStaticStyle *style)
 {
+  guint i;
+
+  for (i = 0; i < GTK_CSS_VALUES_N_GROUPS; i++)
+    style->groups[i] = gtk_css_values_new (i);
 }
 
 static void
@@ -113,9 +348,20 @@ gtk_css_static_style_set_value (GtkCssStaticStyle *style,
                                 GtkCssValue       *value,
                                 GtkCssSection     *section)
 {
-  if (style->values[id])
-    _gtk_css_value_unref (style->values[id]);
-  style->values[id] = _gtk_css_value_ref (value);
+  GtkCssValues *values = style->groups[property_group[id]];
+  guint index = property_index[id];
+
+  /* Groups shared with other styles must not change */
+  if (values->ref_count > 1)
+    {
+      style->groups[property_group[id]] = gtk_css_values_copy (values);
+      gtk_css_values_unref (values);
+      values = style->groups[property_group[id]];
+    }
+
+  if (values->values[index])
+    _gtk_css_value_unref (values->values[index]);
+  values->values[index] = _gtk_css_value_ref (value);
 
   if (style->sections && style->sections->len > id && g_ptr_array_index (style->sections, id))
     {
@@ -165,6 +411,65 @@ gtk_css_static_style_get_default (void)
   return default_style;
 }
 
+/* Groups of inherited properties that are not set at all have the same
+ * values as the parent's, so they don't need to be computed.
+ */
+static void
+gtk_css_static_style_inherit_groups (GtkCssStaticStyle *style,
+                                     GtkCssLookup      *lookup,
+                                     GtkCssStyle       *parent)
+{
+  GtkCssStaticStyle *sparent;
+  guint group, i;
+
+  if (parent == NULL || !GTK_IS_CSS_STATIC_STYLE (parent))
+    return;
+
+  sparent = GTK_CSS_STATIC_STYLE (parent);
+
+  for (group = 0; group < GTK_CSS_VALUES_N_GROUPS; group++)
+    {
+      if (!group_is_inherited[group])
+        continue;
+
+      for (i = 0; i < group_info[group].n_properties; i++)
+        {
+          if (lookup->values[group_info[group].properties[i]].value != NULL)
+            break;
+        }
+
+      if (i < group_info[group].n_properties)
+        continue;
+
+      gtk_css_values_unref (style->groups[group]);
+      style->groups[group] = gtk_css_values_ref (sparent->groups[group]);
+    }
+}
+
+/* Shares the groups that ended up with the same values as the parent's */
+static void
+gtk_css_static_style_share_groups (GtkCssStaticStyle *style,
+                                   GtkCssStyle       *parent)
+{
+  GtkCssStaticStyle *sparent;
+  guint group;
+
+  if (parent == NULL || !GTK_IS_CSS_STATIC_STYLE (parent))
+    return;
+
+  sparent = GTK_CSS_STATIC_STYLE (parent);
+
+  for (group = 0; group < GTK_CSS_VALUES_N_GROUPS; group++)
+    {
+      if (style->groups[group] == sparent->groups[group] ||
+          !gtk_css_values_equal (style->groups[group], sparent->groups[group]))
+        continue;
+
+      gtk_css_values_unref (style->groups[group]);
+      style->groups[group] = gtk_css_values_ref (sparent->groups[group]);
+    }
+}
+
 GtkCssStyle *
 gtk_css_static_style_new_compute (GtkStyleProviderPrivate *provider,
                                   const GtkCssMatcher     *matcher,
@@ -186,11 +491,15 @@ gtk_css_static_style_new_compute (GtkStyleProviderPrivate *provider,
 
   result->change = change;
 
+  gtk_css_static_style_inherit_groups (result, lookup, parent);
+
   _gtk_css_lookup_resolve (lookup,
                            provider,
                            result,
                            parent);
 
+  gtk_css_static_style_share_groups (result, parent);
+
   _gtk_css_lookup_free (lookup);
 
   return GTK_CSS_STYLE (result);
@@ -220,6 +529,12 @@ gtk_css_static_style_compute_value (GtkCssStaticStyle       *style,
     {
       GtkCssStyleProperty *prop = _gtk_css_style_property_lookup_by_id (id);
 
+      /* The group was taken over from the parent, with this value */
+      if (_gtk_css_style_property_is_inherit (prop) &&
+          parent_style && GTK_IS_CSS_STATIC_STYLE (parent_style) &&
+          GTK_CSS_STATIC_STYLE (parent_style)->groups[property_group[id]] == style->groups[property_group[id]])
+        return;
+
       if (_gtk_css_style_property_is_inherit (prop))
         specified = _gtk_css_inherit_value_new ();
       else
@@ -34,12 +34,37 @@ G_BEGIN_DECLS
 
 typedef struct _GtkCssStaticStyle           GtkCssStaticStyle;
 typedef struct _GtkCssStaticStyleClass      GtkCssStaticStyleClass;
+typedef struct _GtkCssValues                GtkCssValues;
+
+/* The values of a style are kept in groups of related properties, so
+ * that styles can share the groups that are the same as their parent's.
+ */
+typedef enum {
+  GTK_CSS_VALUES_CORE,
+  GTK_CSS_VALUES_FONT,
+  GTK_CSS_VALUES_TEXT,
+  GTK_CSS_VALUES_ICON,
+  GTK_CSS_VALUES_SIZE,
+  GTK_CSS_VALUES_BACKGROUND,
+  GTK_CSS_VALUES_BORDER,
+  GTK_CSS_VALUES_OUTLINE,
+  GTK_CSS_VALUES_ANIMATION,
+  GTK_CSS_VALUES_N_GROUPS
+} GtkCssValuesGroup;
+
+/* Immutable once the style is computed, and then shared by reference */
+struct _GtkCssValues
+{
+  int                    ref_count;
+  GtkCssValuesGroup      group;
+  GtkCssValue           *values[1];            /* the values, as many as the group has properties */
+};
 
 struct _GtkCssStaticStyle
 {
   GtkCssStyle parent;
 
-  GtkCssValue           *values[GTK_CSS_PROPERTY_N_PROPERTIES]; /* the values */
+  GtkCssValues          *groups[GTK_CSS_VALUES_N_GROUPS]; /* the values */
   GPtrArray             *sections;             /* sections the values are defined in */
 
   GtkCssChange           change;               /* change as returned by value lookup */
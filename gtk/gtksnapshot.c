@@ -92,10 +92,18 @@ gtk_snapshot_state_new (GtkSnapshotState       *parent,
   else
     {
       state = g_slice_new0 (GtkSnapshotState);
-      state->nodes = g_ptr_array_new_with_free_func ((GDestroyNotify) gsk_render_node_unref);
+      if (parent != NULL)
+        state->nodes = parent->nodes;
+      else
+        state->nodes = g_ptr_array_new_with_free_func ((GDestroyNotify) gsk_render_node_unref);
       state->parent = parent;
     }
 
+  /* The nodes of a state are always at the end of the array, since
+   * states are popped before their parent gets any more nodes
+   */
+  state->start_node_index = state->nodes->len;
+
   state->name = name;
   if (clip)
     state->clip_region = cairo_region_reference (clip);
@@ -109,7 +117,8 @@ gtk_snapshot_state_new (GtkSnapshotState       *parent,
 static void
 gtk_snapshot_state_clear (GtkSnapshotState *state)
 {
-  g_ptr_array_set_size (state->nodes, 0);
+  if (state->nodes->len > state->start_node_index)
+    g_ptr_array_set_size (state->nodes, state->start_node_index);
   g_clear_pointer (&state->clip_region, cairo_region_destroy);
   g_clear_pointer (&state->name, g_free);
 }
@@ -120,7 +129,8 @@ gtk_snapshot_state_free (GtkSnapshotState *state)
   if (state->cached_state)
     gtk_snapshot_state_free (state->cached_state);
   gtk_snapshot_state_clear (state);
-  g_ptr_array_unref (state->nodes);
+  if (state->parent == NULL)
+    g_ptr_array_unref (state->nodes);
   g_slice_free (GtkSnapshotState, state);
 }
 
@@ -137,6 +147,7 @@ gtk_snapshot_init (GtkSnapshot          *snapshot,
   snapshot->state = NULL;
   snapshot->record_names = record_names;
   snapshot->renderer = renderer;
+  snapshot->layout_renderer = NULL;
 
   if (name && record_names)
     {
@@ -888,8 +899,8 @@ gtk_snapshot_pop_internal (GtkSnapshot *snapshot)
   snapshot->state = state->parent;
 
   node = state->collect_func (state,
-                              (GskRenderNode **) state->nodes->pdata,
-                              state->nodes->len,
+                              (GskRenderNode **) state->nodes->pdata + state->start_node_index,
+                              state->nodes->len - state->start_node_index,
                               state->name);
 
   if (snapshot->state == NULL)
@@ -915,6 +926,8 @@ gtk_snapshot_finish (GtkSnapshot *snapshot)
       g_warning ("Too many gtk_snapshot_push() calls.");
     }
 
+  g_clear_object (&snapshot->layout_renderer);
+
   return result;
 }
 
@@ -940,6 +953,21 @@ gtk_snapshot_pop (GtkSnapshot *snapshot)
     }
 }
 
+/*< private >
+ * gtk_snapshot_pop_collect:
+ * @snapshot: a #GtkSnapshot
+ *
+ * Removes the top element from the stack of render nodes, like
+ * gtk_snapshot_pop(), but returns it instead of appending it.
+ *
+ * Returns: (transfer full) (nullable): the node that was popped
+ */
+GskRenderNode *
+gtk_snapshot_pop_collect (GtkSnapshot *snapshot)
+{
+  return gtk_snapshot_pop_internal (snapshot);
+}
+
 /**
  * gtk_snapshot_get_renderer:
  * @snapshot: a #GtkSnapshot
@@ -1209,6 +1237,33 @@ gtk_snapshot_clips_rect (GtkSnapshot                 *snapshot,
   return cairo_region_contains_rectangle (snapshot->state->clip_region, &offset_rect) == CAIRO_REGION_OVERLAP_OUT;
 }
 
+/*< private >
+ * gtk_snapshot_contains_rect:
+ * @snapshot: a #GtkSnapshot
+ * @rect: a rectangle
+ *
+ * Tests whether the rectangle is entirely inside the clip region of
+ * @snapshot, so that nothing drawn inside of it gets culled.
+ *
+ * Returns: %TRUE if @rect is entirely inside the clip region
+ */
+gboolean
+gtk_snapshot_contains_rect (GtkSnapshot                 *snapshot,
+                            const cairo_rectangle_int_t *rect)
+{
+  cairo_rectangle_int_t offset_rect;
+
+  if (snapshot->state->clip_region == NULL)
+    return TRUE;
+
+  offset_rect.x = rect->x + snapshot->state->translate_x;
+  offset_rect.y = rect->y + snapshot->state->translate_y;
+  offset_rect.width = rect->width;
+  offset_rect.height = rect->height;
+
+  return cairo_region_contains_rectangle (snapshot->state->clip_region, &offset_rect) == CAIRO_REGION_OVERLAP_IN;
+}
+
 /**
  * gtk_snapshot_render_background:
  * @snapshot: a #GtkSnapshot
@@ -1308,6 +1363,291 @@ gtk_snapshot_render_focus (GtkSnapshot     *snapshot,
   gtk_snapshot_offset (snapshot, -x, -y);
 }
 
+/* A PangoRenderer that appends the glyphs of a layout to a snapshot
+ * as text nodes, so renderers can cache the rasterized glyphs
+ */
+#define GTK_TYPE_SNAPSHOT_LAYOUT_RENDERER       (gtk_snapshot_layout_renderer_get_type ())
+#define GTK_SNAPSHOT_LAYOUT_RENDERER(object)    (G_TYPE_CHECK_INSTANCE_CAST ((object), GTK_TYPE_SNAPSHOT_LAYOUT_RENDERER, GtkSnapshotLayoutRenderer))
+
+typedef struct _GtkSnapshotLayoutRenderer      GtkSnapshotLayoutRenderer;
+typedef struct _GtkSnapshotLayoutRendererClass GtkSnapshotLayoutRendererClass;
+
+struct _GtkSnapshotLayoutRenderer
+{
+  PangoRenderer parent_instance;
+
+  GtkSnapshot *snapshot;
+  GdkRGBA fg_color;
+};
+
+struct _GtkSnapshotLayoutRendererClass
+{
+  PangoRendererClass parent_class;
+};
+
+GType gtk_snapshot_layout_renderer_get_type (void);
+
+G_DEFINE_TYPE (GtkSnapshotLayoutRenderer, gtk_snapshot_layout_renderer, PANGO_TYPE_RENDERER)
+
+static void
+gtk_snapshot_layout_renderer_get_color (GtkSnapshotLayoutRenderer *self,
+                                        PangoRenderPart            part,
+                                        GdkRGBA                   *rgba)
+{
+  PangoColor *color = pango_renderer_get_color (PANGO_RENDERER (self), part);
+
+  if (color == NULL)
+    {
+      *rgba = self->fg_color;
+      return;
+    }
+
+  rgba->red = color->red / 65535.;
+  rgba->green = color->green / 65535.;
+  rgba->blue = color->blue / 65535.;
+  rgba->alpha = self->fg_color.alpha;
+}
+
+/* The callbacks get coordinates in user space; layouts with a matrix,
+ * like rotated text, are drawn inside a transform node
+ */
+static gboolean
+gtk_snapshot_layout_renderer_push_matrix (GtkSnapshotLayoutRenderer *self)
+{
+  const PangoMatrix *matrix = pango_renderer_get_matrix (PANGO_RENDERER (self));
+  graphene_matrix_t transform;
+
+  if (matrix == NULL)
+    return FALSE;
+
+  graphene_matrix_init_from_2d (&transform,
+                                matrix->xx, matrix->yx,
+                                matrix->xy, matrix->yy,
+                                matrix->x0, matrix->y0);
+  gtk_snapshot_push_transform (self->snapshot, &transform, "LayoutTransform");
+
+  return TRUE;
+}
+
+static void
+gtk_snapshot_layout_renderer_draw_glyphs (PangoRenderer     *renderer,
+                                          PangoFont         *font,
+                                          PangoGlyphString  *glyphs,
+                                          int                x,
+                                          int                y)
+{
+  GtkSnapshotLayoutRenderer *self = GTK_SNAPSHOT_LAYOUT_RENDERER (renderer);
+  GtkSnapshot *snapshot = self->snapshot;
+  GskRenderNode *node;
+  GdkRGBA color;
+  gboolean transformed;
+
+  gtk_snapshot_layout_renderer_get_color (self, PANGO_RENDER_PART_FOREGROUND, &color);
+
+  transformed = gtk_snapshot_layout_renderer_push_matrix (self);
+
+  /* Text nodes don't go through gtk_snapshot_append_*(), so they
+   * need to be translated explicitly
+   */
+  node = gsk_text_node_new (font,
+                            glyphs,
+                            &color,
+                            snapshot->state->translate_x + (double) x / PANGO_SCALE,
+                            snapshot->state->translate_y + (double) y / PANGO_SCALE);
+  if (node != NULL)
+    {
+      if (snapshot->record_names)
+        {
+          char *str = g_strdup_printf ("Glyphs<%d>", glyphs->num_glyphs);
+          gsk_render_node_set_name (node, str);
+          g_free (str);
+        }
+
+      gtk_snapshot_append_node (snapshot, node);
+      gsk_render_node_unref (node);
+    }
+
+  if (transformed)
+    gtk_snapshot_pop (snapshot);
+}
+
+static void
+gtk_snapshot_layout_renderer_draw_rectangle (PangoRenderer     *renderer,
+                                             PangoRenderPart    part,
+                                             int                x,
+                                             int                y,
+                                             int                width,
+                                             int                height)
+{
+  GtkSnapshotLayoutRenderer *self = GTK_SNAPSHOT_LAYOUT_RENDERER (renderer);
+  GdkRGBA color;
+  gboolean transformed;
+
+  gtk_snapshot_layout_renderer_get_color (self, part, &color);
+
+  transformed = gtk_snapshot_layout_renderer_push_matrix (self);
+
+  gtk_snapshot_append_color (self->snapshot,
+                             &color,
+                             &GRAPHENE_RECT_INIT ((double) x / PANGO_SCALE, (double) y / PANGO_SCALE,
+                                                  (double) width / PANGO_SCALE, (double) height / PANGO_SCALE),
+                             "DrawRectangle");
+
+  if (transformed)
+    gtk_snapshot_pop (self->snapshot);
+}
+
+static void
+gtk_snapshot_layout_renderer_draw_trapezoid (PangoRenderer     *renderer,
+                                             PangoRenderPart    part,
+                                             double             y1_,
+                                             double             x11,
+                                             double             x21,
+                                             double             y2,
+                                             double             x12,
+                                             double             x22)
+{
+  GtkSnapshotLayoutRenderer *self = GTK_SNAPSHOT_LAYOUT_RENDERER (renderer);
+  graphene_rect_t bounds;
+  GdkRGBA color;
+  double x1, x2;
+  cairo_t *cr;
+
+  x1 = MIN (MIN (x11, x21), MIN (x12, x22));
+  x2 = MAX (MAX (x11, x21), MAX (x12, x22));
+  graphene_rect_init (&bounds, floor (x1), floor (y1_), ceil (x2) - floor (x1), ceil (y2) - floor (y1_));
+
+  gtk_snapshot_layout_renderer_get_color (self, part, &color);
+
+  cr = gtk_snapshot_append_cairo (self->snapshot, &bounds, "DrawTrapezoid");
+
+  gdk_cairo_set_source_rgba (cr, &color);
+  cairo_move_to (cr, x11, y1_);
+  cairo_line_to (cr, x21, y1_);
+  cairo_line_to (cr, x22, y2);
+  cairo_line_to (cr, x12, y2);
+  cairo_close_path (cr);
+  cairo_fill (cr);
+
+  cairo_destroy (cr);
+}
+
+static void
+gtk_snapshot_layout_renderer_draw_error_underline (PangoRenderer *renderer,
+                                                   int            x,
+                                                   int            y,
+                                                   int            width,
+                                                   int            height)
+{
+  GtkSnapshotLayoutRenderer *self = GTK_SNAPSHOT_LAYOUT_RENDERER (renderer);
+  GdkRGBA color;
+  gboolean transformed;
+  cairo_t *cr;
+
+  gtk_snapshot_layout_renderer_get_color (self, PANGO_RENDER_PART_UNDERLINE, &color);
+
+  transformed = gtk_snapshot_layout_renderer_push_matrix (self);
+
+  cr = gtk_snapshot_append_cairo (self->snapshot,
+                                  &GRAPHENE_RECT_INIT ((double) x / PANGO_SCALE, (double) y / PANGO_SCALE,
+                                                       (double) width / PANGO_SCALE, (double) height / PANGO_SCALE),
+                                  "DrawErrorUnderline");
+
+  gdk_cairo_set_source_rgba (cr, &color);
+  pango_cairo_show_error_underline (cr,
+                                    (double) x / PANGO_SCALE, (double) y / PANGO_SCALE,
+                                    (double) width / PANGO_SCALE, (double) height / PANGO_SCALE);
+
+  cairo_destroy (cr);
+
+  if (transformed)
+    gtk_snapshot_pop (self->snapshot);
+}
+
+static void
+gtk_snapshot_layout_renderer_draw_shape (PangoRenderer  *renderer,
+                                         PangoAttrShape *attr,
+                                         int             x,
+                                         int             y)
+{
+  GtkSnapshotLayoutRenderer *self = GTK_SNAPSHOT_LAYOUT_RENDERER (renderer);
+  PangoLayout *layout;
+  PangoCairoShapeRendererFunc shape_renderer;
+  gpointer shape_renderer_data;
+  PangoRectangle ink_rect;
+  GdkRGBA color;
+  gboolean transformed;
+  cairo_t *cr;
+
+  layout = pango_renderer_get_layout (renderer);
+  if (layout == NULL)
+    return;
+
+  shape_renderer = pango_cairo_context_get_shape_renderer (pango_layout_get_context (layout),
+                                                           &shape_renderer_data);
+  if (shape_renderer == NULL)
+    return;
+
+  ink_rect = attr->ink_rect;
+  ink_rect.x += x;
+  ink_rect.y += y;
+  pango_extents_to_pixels (&ink_rect, NULL);
+
+  gtk_snapshot_layout_renderer_get_color (self, PANGO_RENDER_PART_FOREGROUND, &color);
+
+  transformed = gtk_snapshot_layout_renderer_push_matrix (self);
+
+  cr = gtk_snapshot_append_cairo (self->snapshot,
+                                  &GRAPHENE_RECT_INIT (ink_rect.x, ink_rect.y,
+                                                       ink_rect.width, ink_rect.height),
+                                  "DrawShape");
+
+  gdk_cairo_set_source_rgba (cr, &color);
+  cairo_move_to (cr, (double) x / PANGO_SCALE, (double) y / PANGO_SCALE);
+  shape_renderer (cr, attr, FALSE, shape_renderer_data);
+
+  cairo_destroy (cr);
+
+  if (transformed)
+    gtk_snapshot_pop (self->snapshot);
+}
+
+static void
+gtk_snapshot_layout_renderer_init (GtkSnapshotLayoutRenderer *self)
+{
+}
+
+static void
+gtk_snapshot_layout_renderer_class_init (GtkSnapshotLayoutRendererClass *klass)
+{
+  PangoRendererClass *renderer_class = PANGO_RENDERER_CLASS (klass);
+
+  renderer_class->draw_glyphs = gtk_snapshot_layout_renderer_draw_glyphs;
+  renderer_class->draw_rectangle = gtk_snapshot_layout_renderer_draw_rectangle;
+  renderer_class->draw_trapezoid = gtk_snapshot_layout_renderer_draw_trapezoid;
+  renderer_class->draw_error_underline = gtk_snapshot_layout_renderer_draw_error_underline;
+  renderer_class->draw_shape = gtk_snapshot_layout_renderer_draw_shape;
+}
+
+static void
+gtk_snapshot_append_layout (GtkSnapshot   *snapshot,
+                            PangoLayout   *layout,
+                            const GdkRGBA *fg_color)
+{
+  GtkSnapshotLayoutRenderer *renderer;
+
+  if (snapshot->layout_renderer == NULL)
+    snapshot->layout_renderer = g_object_new (GTK_TYPE_SNAPSHOT_LAYOUT_RENDERER, NULL);
+
+  renderer = GTK_SNAPSHOT_LAYOUT_RENDERER (snapshot->layout_renderer);
+  renderer->snapshot = snapshot;
+  renderer->fg_color = *fg_color;
+
+  pango_renderer_draw_layout (PANGO_RENDERER (renderer), layout, 0, 0);
+
+  renderer->snapshot = NULL;
+}
+
 /**
  * gtk_snapshot_render_layout:
  * @snapshot: a #GtkSnapshot
@@ -1352,14 +1692,15 @@ gtk_snapshot_render_layout (GtkSnapshot     *snapshot,
 
   gtk_snapshot_offset (snapshot, x, y);
 
-  cr = gtk_snapshot_append_cairo (snapshot, &bounds, "Text<%dchars>", pango_layout_get_character_count (layout));
-
-  _gtk_css_shadows_value_paint_layout (shadow, cr, layout);
+  if (!_gtk_css_shadows_value_is_none (shadow))
+    {
+      cr = gtk_snapshot_append_cairo (snapshot, &bounds, "TextShadow<%dchars>", pango_layout_get_character_count (layout));
+      _gtk_css_shadows_value_paint_layout (shadow, cr, layout);
+      cairo_destroy (cr);
+    }
 
-  gdk_cairo_set_source_rgba (cr, fg_color);
-  pango_cairo_show_layout (cr, layout);
+  gtk_snapshot_append_layout (snapshot, layout, fg_color);
 
-  cairo_destroy (cr);
   gtk_snapshot_offset (snapshot, -x, -y);
 }
 
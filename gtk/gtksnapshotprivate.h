@@ -34,7 +34,8 @@ struct _GtkSnapshotState {
   GtkSnapshotState      *cached_state; /* A cleared state object we can (re)use */
 
   char                  *name;
-  GPtrArray             *nodes;
+  GPtrArray             *nodes; /* Shared by all states, owned by the root state */
+  guint                  start_node_index;
 
   cairo_region_t        *clip_region;
   int                    translate_x;
@@ -82,6 +83,7 @@ struct _GtkSnapshot {
   GtkSnapshotState      *state;
   gboolean               record_names;
   GskRenderer           *renderer;
+  PangoRenderer         *layout_renderer; /* Created on demand, freed by gtk_snapshot_finish() */
 };
 
 void            gtk_snapshot_init               (GtkSnapshot             *state,
@@ -94,6 +96,10 @@ GskRenderNode * gtk_snapshot_finish             (GtkSnapshot             *state)
 
 GskRenderer *   gtk_snapshot_get_renderer       (const GtkSnapshot       *snapshot);
 
+GskRenderNode * gtk_snapshot_pop_collect        (GtkSnapshot             *snapshot);
+gboolean        gtk_snapshot_contains_rect      (GtkSnapshot             *snapshot,
+                                                 const cairo_rectangle_int_t *rect);
+
 G_END_DECLS
 
 #endif /* __GTK_SNAPSHOT_PRIVATE_H__ */
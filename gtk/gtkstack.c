@@ -1974,6 +1974,13 @@ gtk_stack_snapshot (GtkWidget   *widget,
               priv->last_visible_child != NULL)
             {
               GtkSnapshot last_visible_snapshot;
+              GskRenderNodeArena *arena;
+
+              /* The node is kept for the whole transition, so it should
+               * not hold on to the arena blocks of the frame it was
+               * created in
+               */
+              arena = gsk_render_node_arena_set_current (NULL);
 
               gtk_widget_get_allocation (priv->last_visible_child->widget,
                                          &priv->last_visible_surface_allocation);
@@ -1984,6 +1991,8 @@ gtk_stack_snapshot (GtkWidget   *widget,
                                  "StackCaptureLastVisibleChild");
               gtk_widget_snapshot (priv->last_visible_child->widget, &last_visible_snapshot);
               priv->last_visible_node = gtk_snapshot_finish (&last_visible_snapshot);
+
+              gsk_render_node_arena_set_current (arena);
             }
 
           gtk_widget_get_content_size (widget, &width, &height);
@@ -302,14 +302,14 @@ _gtk_style_cascade_set_parent (GtkStyleCascade *cascade,
       g_object_ref (parent);
       g_signal_connect_swapped (parent,
                                 "-gtk-private-changed",
-                                G_CALLBACK (_gtk_style_provider_private_changed),
+                                G_CALLBACK (_gtk_style_provider_private_selectors_changed),
                                 cascade);
     }
 
   if (cascade->parent)
     {
       g_signal_handlers_disconnect_by_func (cascade->parent, 
-                                            _gtk_style_provider_private_changed,
+                                            _gtk_style_provider_private_selectors_changed,
                                             cascade);
       g_object_unref (cascade->parent);
     }
@@ -317,6 +317,26 @@ _gtk_style_cascade_set_parent (GtkStyleCascade *cascade,
   cascade->parent = parent;
 }
 
+/* Adding or removing a provider only changes the nodes matching its
+ * selectors, if it knows them.
+ */
+static void
+gtk_style_cascade_provider_changed (GtkStyleCascade  *cascade,
+                                    GtkStyleProvider *provider)
+{
+  GPtrArray *selectors;
+
+  selectors = g_ptr_array_new ();
+
+  if (GTK_IS_STYLE_PROVIDER_PRIVATE (provider) &&
+      _gtk_style_provider_private_get_selectors (GTK_STYLE_PROVIDER_PRIVATE (provider), selectors))
+    _gtk_style_provider_private_selectors_changed (GTK_STYLE_PROVIDER_PRIVATE (cascade), selectors);
+  else
+    _gtk_style_provider_private_changed (GTK_STYLE_PROVIDER_PRIVATE (cascade));
+
+  g_ptr_array_unref (selectors);
+}
+
 void
 _gtk_style_cascade_add_provider (GtkStyleCascade  *cascade,
                                  GtkStyleProvider *provider,
@@ -333,7 +353,7 @@ _gtk_style_cascade_add_provider (GtkStyleCascade  *cascade,
   data.priority = priority;
   data.changed_signal_id = g_signal_connect_swapped (provider,
                                                      "-gtk-private-changed",
-                                                     G_CALLBACK (_gtk_style_provider_private_changed),
+                                                     G_CALLBACK (_gtk_style_provider_private_selectors_changed),
                                                      cascade);
 
   /* ensure it gets removed first */
@@ -346,7 +366,7 @@ _gtk_style_cascade_add_provider (GtkStyleCascade  *cascade,
     }
   g_array_insert_val (cascade->providers, i, data);
 
-  _gtk_style_provider_private_changed (GTK_STYLE_PROVIDER_PRIVATE (cascade));
+  gtk_style_cascade_provider_changed (cascade, provider);
 }
 
 void
@@ -364,9 +384,12 @@ _gtk_style_cascade_remove_provider (GtkStyleCascade  *cascade,
 
       if (data->provider == provider)
         {
+          /* removing drops the cascade's reference */
+          g_object_ref (provider);
           g_array_remove_index (cascade->providers, i);
   
-          _gtk_style_provider_private_changed (GTK_STYLE_PROVIDER_PRIVATE (cascade));
+          gtk_style_cascade_provider_changed (cascade, provider);
+          g_object_unref (provider);
           break;
         }
     }
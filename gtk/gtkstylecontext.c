@@ -253,9 +253,14 @@ gtk_style_context_pop_style_node (GtkStyleContext *context)
 
 static void
 gtk_style_context_cascade_changed (GtkStyleCascade *cascade,
+                                   GPtrArray       *selectors,
                                    GtkStyleContext *context)
 {
-  gtk_css_node_invalidate_style_provider (gtk_style_context_get_root (context));
+  if (selectors)
+    gtk_css_node_invalidate_style_provider_for_selectors (gtk_style_context_get_root (context),
+                                                          selectors);
+  else
+    gtk_css_node_invalidate_style_provider (gtk_style_context_get_root (context));
 }
 
 static void
@@ -288,7 +293,7 @@ gtk_style_context_set_cascade (GtkStyleContext *context,
   priv->cascade = cascade;
 
   if (cascade && priv->cssnode != NULL)
-    gtk_style_context_cascade_changed (cascade, context);
+    gtk_style_context_cascade_changed (cascade, NULL, context);
 }
 
 static void
@@ -40,8 +40,9 @@ _gtk_style_provider_private_default_init (GtkStyleProviderPrivateInterface *ifac
                                    G_SIGNAL_RUN_LAST,
                                    G_STRUCT_OFFSET (GtkStyleProviderPrivateInterface, changed),
                                    NULL, NULL,
-                                   g_cclosure_marshal_VOID__VOID,
-                                   G_TYPE_NONE, 0);
+                                   g_cclosure_marshal_VOID__POINTER,
+                                   G_TYPE_NONE, 1,
+                                   G_TYPE_POINTER);
 
 }
 
@@ -105,12 +106,60 @@ _gtk_style_provider_private_lookup (GtkStyleProviderPrivate *provider,
   iface->lookup (provider, matcher, lookup, out_change);
 }
 
+/*< private >
+ * _gtk_style_provider_private_get_selectors:
+ * @provider: a #GtkStyleProviderPrivate
+ * @selectors: a #GPtrArray to add the #GtkCssSelectorTrees to
+ *
+ * Adds the selector trees of all the rules of @provider to @selectors.
+ * Adding or removing @provider only changes the style of nodes matching
+ * one of them.
+ *
+ * Returns: %FALSE if @provider can change the style of other nodes, too,
+ *     for example by defining colors
+ */
+gboolean
+_gtk_style_provider_private_get_selectors (GtkStyleProviderPrivate *provider,
+                                           GPtrArray               *selectors)
+{
+  GtkStyleProviderPrivateInterface *iface;
+
+  gtk_internal_return_val_if_fail (GTK_IS_STYLE_PROVIDER_PRIVATE (provider), FALSE);
+  gtk_internal_return_val_if_fail (selectors != NULL, FALSE);
+
+  iface = GTK_STYLE_PROVIDER_PRIVATE_GET_INTERFACE (provider);
+
+  if (!iface->get_selectors)
+    return FALSE;
+
+  return iface->get_selectors (provider, selectors);
+}
+
 void
 _gtk_style_provider_private_changed (GtkStyleProviderPrivate *provider)
 {
   gtk_internal_return_if_fail (GTK_IS_STYLE_PROVIDER_PRIVATE (provider));
 
-  g_signal_emit (provider, signals[CHANGED], 0);
+  g_signal_emit (provider, signals[CHANGED], 0, NULL);
+}
+
+/*< private >
+ * _gtk_style_provider_private_selectors_changed:
+ * @provider: a #GtkStyleProviderPrivate
+ * @selectors: (element-type GtkCssSelectorTree): the selector trees of
+ *     the rules that were added or removed
+ *
+ * Like _gtk_style_provider_private_changed(), but only the style of nodes
+ * matching one of @selectors changed. Passing %NULL means that every
+ * style may have changed.
+ */
+void
+_gtk_style_provider_private_selectors_changed (GtkStyleProviderPrivate *provider,
+                                               GPtrArray               *selectors)
+{
+  gtk_internal_return_if_fail (GTK_IS_STYLE_PROVIDER_PRIVATE (provider));
+
+  g_signal_emit (provider, signals[CHANGED], 0, selectors);
 }
 
 GtkSettings *
@@ -22,6 +22,7 @@
 #include "gtk/gtkcsskeyframesprivate.h"
 #include "gtk/gtkcsslookupprivate.h"
 #include "gtk/gtkcssmatcherprivate.h"
+#include "gtk/gtkcssselectorprivate.h"
 #include "gtk/gtkcssvalueprivate.h"
 #include <gtk/gtktypes.h>
 
@@ -52,8 +53,11 @@ struct _GtkStyleProviderPrivateInterface
   void                  (* emit_error)          (GtkStyleProviderPrivate *provider,
                                                  GtkCssSection           *section,
                                                  const GError            *error);
+  gboolean              (* get_selectors)       (GtkStyleProviderPrivate *provider,
+                                                 GPtrArray               *selectors);
   /* signal */
-  void                  (* changed)             (GtkStyleProviderPrivate *provider);
+  void                  (* changed)             (GtkStyleProviderPrivate *provider,
+                                                 GPtrArray               *selectors);
 };
 
 GType                   _gtk_style_provider_private_get_type     (void) G_GNUC_CONST;
@@ -68,8 +72,13 @@ void                    _gtk_style_provider_private_lookup       (GtkStyleProvid
                                                                   const GtkCssMatcher     *matcher,
                                                                   GtkCssLookup            *lookup,
                                                                   GtkCssChange            *out_change);
+gboolean                _gtk_style_provider_private_get_selectors(GtkStyleProviderPrivate *provider,
+                                                                  GPtrArray               *selectors);
 
 void                    _gtk_style_provider_private_changed      (GtkStyleProviderPrivate *provider);
+void                    _gtk_style_provider_private_selectors_changed
+                                                                 (GtkStyleProviderPrivate *provider,
+                                                                  GPtrArray               *selectors);
 
 void                    _gtk_style_provider_private_emit_error   (GtkStyleProviderPrivate *provider,
                                                                   GtkCssSection           *section,
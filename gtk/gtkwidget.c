@@ -74,6 +74,9 @@
 #include "gtkcssshadowsvalueprivate.h"
 #include "gtkdebugupdatesprivate.h"
 
+#include "gsk/gskrendererprivate.h"
+#include "gsk/gskrendernodeprivate.h"
+
 #include "inspector/window.h"
 
 /* for the use of round() */
@@ -4378,6 +4381,20 @@ update_cursor_on_state_change (GtkWidget *widget)
                                                    widget);
 }
 
+/*
+ * gtk_widget_clear_render_node:
+ * @widget: a #GtkWidget
+ *
+ * Drops the render node cached by gtk_widget_snapshot() for @widget
+ * and for all its ancestors, whose nodes contain the one of @widget.
+ */
+static void
+gtk_widget_clear_render_node (GtkWidget *widget)
+{
+  for (; widget != NULL; widget = widget->priv->parent)
+    g_clear_pointer (&widget->priv->render_node, gsk_render_node_unref);
+}
+
 /**
  * gtk_widget_map:
  * @widget: a #GtkWidget
@@ -4402,6 +4419,7 @@ gtk_widget_map (GtkWidget *widget)
       g_signal_emit (widget, widget_signals[MAP], 0);
 
       update_cursor_on_state_change (widget);
+      gtk_widget_clear_render_node (widget);
 
       if (!_gtk_widget_get_has_window (widget))
         gtk_widget_queue_draw (widget);
@@ -4434,6 +4452,7 @@ gtk_widget_unmap (GtkWidget *widget)
       g_signal_emit (widget, widget_signals[UNMAP], 0);
 
       update_cursor_on_state_change (widget);
+      gtk_widget_clear_render_node (widget);
 
       gtk_widget_pop_verify_invariants (widget);
       g_object_unref (widget);
@@ -5047,6 +5066,8 @@ gtk_widget_queue_resize_internal (GtkWidget *widget)
 {
   GSList *groups, *l, *widgets;
 
+  gtk_widget_clear_render_node (widget);
+
   if (gtk_widget_get_resize_needed (widget))
     return;
 
@@ -5249,6 +5270,8 @@ gtk_widget_queue_draw_region (GtkWidget            *widget,
   if (cairo_region_is_empty (region))
     return;
 
+  gtk_widget_clear_render_node (widget);
+
   /* Just return if the widget isn't mapped */
   if (!_gtk_widget_get_mapped (widget))
     return;
@@ -5561,6 +5584,9 @@ check_clip:
   position_changed |= (old_clip.x != priv->clip.x ||
                       old_clip.y != priv->clip.y);
 
+  if (size_changed || baseline_changed)
+    gtk_widget_clear_render_node (widget);
+
   if (_gtk_widget_get_mapped (widget))
     {
       if (position_changed || size_changed || baseline_changed)
@@ -8320,6 +8346,7 @@ gtk_widget_reposition_after (GtkWidget *widget,
   gtk_widget_push_verify_invariants (widget);
 
   priv->parent = parent;
+  gtk_widget_clear_render_node (parent);
 
   if (previous_sibling)
     {
@@ -10281,6 +10308,7 @@ gtk_widget_finalize (GObject *object)
   g_free (priv->name);
 
   g_clear_object (&priv->accessible);
+  g_clear_pointer (&priv->render_node, gsk_render_node_unref);
 
   gtk_widget_clear_path (widget);
 
@@ -10870,6 +10898,7 @@ gtk_widget_propagate_state (GtkWidget          *widget,
         gtk_grab_remove (widget);
 
       gtk_style_context_set_state (_gtk_widget_get_style_context (widget), new_flags);
+      gtk_widget_clear_render_node (widget);
 
       g_signal_emit (widget, widget_signals[STATE_FLAGS_CHANGED], 0, old_flags);
 
@@ -14008,6 +14037,8 @@ gtk_widget_class_get_css_name (GtkWidgetClass *widget_class)
 void
 _gtk_widget_style_context_invalidated (GtkWidget *widget)
 {
+  gtk_widget_clear_render_node (widget);
+
   g_signal_emit (widget, widget_signals[STYLE_UPDATED], 0);
 }
 
@@ -15092,58 +15123,35 @@ gtk_widget_maybe_add_debug_render_nodes (GtkWidget             *widget,
     }
 }
 
-void
-gtk_widget_snapshot (GtkWidget   *widget,
-                     GtkSnapshot *snapshot)
+static void
+gtk_widget_snapshot_contents (GtkWidget   *widget,
+                              GtkSnapshot *snapshot)
 {
   GtkWidgetClass *klass = GTK_WIDGET_GET_CLASS (widget);
-  GtkWidgetPrivate *priv;
+  GtkWidgetPrivate *priv = widget->priv;
   graphene_rect_t bounds;
   GtkCssValue *filter_value;
   RenderMode mode;
   double opacity;
-  cairo_rectangle_int_t offset_clip;
   GtkCssStyle *style;
   GtkAllocation allocation;
   GtkBorder margin, border, padding;
 
-  if (!_gtk_widget_is_drawable (widget))
-    return;
-
-  if (_gtk_widget_get_alloc_needed (widget))
-    {
-      g_warning ("Trying to snapshot %s %p without a current allocation", G_OBJECT_TYPE_NAME (widget), widget);
-      return;
-    }
-
-  priv = widget->priv;
-  offset_clip = priv->clip;
-  offset_clip.x -= priv->allocation.x;
-  offset_clip.y -= priv->allocation.y;
-
-  if (gtk_snapshot_clips_rect (snapshot, &offset_clip))
-    return;
-
-  opacity = widget->priv->alpha / 255.0;
-  if (opacity <= 0.0)
-    return;
+  opacity = priv->alpha / 255.0;
 
   /* Compatibility mode: if the widget does not have a render node, we draw
    * using gtk_widget_draw() on a temporary node
    */
   mode = get_render_mode (klass);
 
-  if (GTK_DEBUG_CHECK (SNAPSHOT))
-    gtk_snapshot_push (snapshot, TRUE, "%s<%p>", gtk_widget_get_name (widget), widget);
-
   filter_value = _gtk_style_context_peek_property (_gtk_widget_get_style_context (widget), GTK_CSS_PROPERTY_FILTER);
   gtk_css_filter_value_push_snapshot (filter_value, snapshot);
 
   graphene_rect_init (&bounds,
-                      offset_clip.x,
-                      offset_clip.y,
-                      offset_clip.width,
-                      offset_clip.height);
+                      priv->clip.x - priv->allocation.x,
+                      priv->clip.y - priv->allocation.y,
+                      priv->clip.width,
+                      priv->clip.height);
 
   style = gtk_css_node_get_style (priv->cssnode);
   get_box_margin (style, &margin);
@@ -15217,6 +15225,83 @@ gtk_widget_snapshot (GtkWidget   *widget,
 
 
   gtk_css_filter_value_pop_snapshot (filter_value, snapshot);
+}
+
+void
+gtk_widget_snapshot (GtkWidget   *widget,
+                     GtkSnapshot *snapshot)
+{
+  GtkWidgetPrivate *priv;
+  cairo_rectangle_int_t offset_clip;
+  GskRenderNode *node;
+  gboolean has_visible_focus, record_names;
+  int x, y;
+
+  if (!_gtk_widget_is_drawable (widget))
+    return;
+
+  if (_gtk_widget_get_alloc_needed (widget))
+    {
+      g_warning ("Trying to snapshot %s %p without a current allocation", G_OBJECT_TYPE_NAME (widget), widget);
+      return;
+    }
+
+  priv = widget->priv;
+  offset_clip = priv->clip;
+  offset_clip.x -= priv->allocation.x;
+  offset_clip.y -= priv->allocation.y;
+
+  if (gtk_snapshot_clips_rect (snapshot, &offset_clip))
+    return;
+
+  if (priv->alpha == 0)
+    return;
+
+  if (GTK_DEBUG_CHECK (SNAPSHOT))
+    gtk_snapshot_push (snapshot, TRUE, "%s<%p>", gtk_widget_get_name (widget), widget);
+
+  gtk_snapshot_get_offset (snapshot, &x, &y);
+  has_visible_focus = gtk_widget_has_visible_focus (widget);
+  record_names = snapshot->record_names;
+
+  /* Reuse the nodes of the last snapshot, unless the widget was
+   * redrawn or moved since; see gtk_widget_clear_render_node()
+   */
+  if (priv->render_node != NULL &&
+      priv->render_node_x == x &&
+      priv->render_node_y == y &&
+      priv->render_node_focus == has_visible_focus &&
+      priv->render_node_named == record_names)
+    {
+      gtk_snapshot_append_node (snapshot, priv->render_node);
+    }
+  else
+    {
+      g_clear_pointer (&priv->render_node, gsk_render_node_unref);
+
+      gtk_snapshot_push (snapshot, TRUE, NULL);
+      gtk_widget_snapshot_contents (widget, snapshot);
+      node = gtk_snapshot_pop_collect (snapshot);
+
+      if (node != NULL)
+        {
+          gtk_snapshot_append_node (snapshot, node);
+
+          /* The nodes are incomplete if parts of the widget were culled */
+          if (gtk_snapshot_contains_rect (snapshot, &offset_clip))
+            {
+              priv->render_node = node;
+              priv->render_node_x = x;
+              priv->render_node_y = y;
+              priv->render_node_focus = has_visible_focus;
+              priv->render_node_named = record_names;
+            }
+          else
+            {
+              gsk_render_node_unref (node);
+            }
+        }
+    }
 
 #ifdef G_ENABLE_DEBUG
   gtk_widget_maybe_add_debug_render_nodes (widget, snapshot);
@@ -15227,13 +15312,41 @@ gtk_widget_snapshot (GtkWidget   *widget,
     gtk_snapshot_pop (snapshot);
 }
 
+static GskRenderNode *
+gtk_widget_snapshot_for_render (GtkWidget            *widget,
+                                GskRenderer          *renderer,
+                                const cairo_region_t *clip)
+{
+  GskRenderNodeArena *arena, *previous_arena;
+  GtkSnapshot snapshot;
+  GskRenderNode *root;
+
+  /* The nodes of the frame are allocated together, in blocks that are
+   * released once their last node is gone
+   */
+  arena = gsk_render_node_arena_new ();
+  previous_arena = gsk_render_node_arena_set_current (arena);
+
+  gtk_snapshot_init (&snapshot,
+                     renderer,
+                     gtk_inspector_is_recording (widget),
+                     clip,
+                     "Render<%s>", G_OBJECT_TYPE_NAME (widget));
+  gtk_widget_snapshot (widget, &snapshot);
+  root = gtk_snapshot_finish (&snapshot);
+
+  gsk_render_node_arena_set_current (previous_arena);
+  gsk_render_node_arena_unref (arena);
+
+  return root;
+}
+
 void
 gtk_widget_render (GtkWidget            *widget,
                    GdkWindow            *window,
                    const cairo_region_t *region)
 {
   GdkDrawingContext *context;
-  GtkSnapshot snapshot;
   GskRenderer *renderer;
   GskRenderNode *root;
   cairo_region_t *clip;
@@ -15246,17 +15359,52 @@ gtk_widget_render (GtkWidget            *widget,
   if (renderer == NULL)
     return;
 
-  context = gsk_renderer_begin_draw_frame (renderer, region);
-  clip = gdk_drawing_context_get_clip (context);
+  /* With a compositor the contents of the window are kept between
+   * frames, so the whole window is snapshotted, and only the exposed
+   * area and the areas where it differs from the previous frame are
+   * redrawn
+   */
+  if (gdk_display_is_composited (gdk_window_get_display (window)))
+    {
+      cairo_region_t *damage;
+
+      clip = cairo_region_create_rectangle (&(GdkRectangle) {
+                                                0, 0,
+                                                gdk_window_get_width (window),
+                                                gdk_window_get_height (window)
+                                            });
+      root = gtk_widget_snapshot_for_render (widget, renderer, clip);
+      cairo_region_destroy (clip);
+
+      if (root != NULL)
+        damage = gsk_renderer_compute_damage (renderer, root, region);
+      else
+        damage = cairo_region_copy (region);
+
+      /* Nothing was exposed and nothing changed */
+      if (cairo_region_is_empty (damage))
+        {
+          cairo_region_destroy (damage);
+          g_clear_pointer (&root, gsk_render_node_unref);
+          return;
+        }
+
+      context = gsk_renderer_begin_draw_frame (renderer, damage);
+      cairo_region_destroy (damage);
+    }
+  else
+    {
+      /* The tree only covers the clip here, so it cannot be
+       * compared with the next one
+       */
+      gsk_renderer_reset_damage (renderer);
+
+      context = gsk_renderer_begin_draw_frame (renderer, region);
+      clip = gdk_drawing_context_get_clip (context);
+      root = gtk_widget_snapshot_for_render (widget, renderer, clip);
+      cairo_region_destroy (clip);
+    }
 
-  gtk_snapshot_init (&snapshot,
-                     renderer,
-                     gtk_inspector_is_recording (widget),
-                     clip,
-                     "Render<%s>", G_OBJECT_TYPE_NAME (widget));
-  cairo_region_destroy (clip);
-  gtk_widget_snapshot (widget, &snapshot);
-  root = gtk_snapshot_finish (&snapshot);
   if (root != NULL)
     {
       gtk_inspector_record_render (widget,
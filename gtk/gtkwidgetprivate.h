@@ -139,6 +139,16 @@ struct _GtkWidgetPrivate
   GtkAllocation reported_clip;
   gint allocated_baseline;
 
+  /* The render node of the last snapshot, and the offset of the
+   * snapshot it was created for; it is reused until the widget
+   * or one of its children is redrawn
+   */
+  GskRenderNode *render_node;
+  gint render_node_x;
+  gint render_node_y;
+  guint render_node_focus     : 1;
+  guint render_node_named     : 1;
+
   /* The widget's requested sizes */
   SizeRequestCache requests;
 
@@ -71,6 +71,7 @@
 #include "gtkpointerfocusprivate.h"
 
 #include "gdk/gdk-private.h"
+#include "gsk/gskrendererprivate.h"
 
 #ifdef GDK_WINDOWING_X11
 #include "x11/gdkx.h"
@@ -6167,6 +6168,10 @@ gtk_window_unmap (GtkWidget *widget)
   GTK_WIDGET_CLASS (gtk_window_parent_class)->unmap (widget);
   gdk_window_withdraw (gdk_window);
 
+  /* The contents of the window are not kept while it is unmapped */
+  if (priv->renderer != NULL)
+    gsk_renderer_reset_damage (priv->renderer);
+
   while (priv->configure_request_count > 0)
     {
       priv->configure_request_count--;
@@ -10501,6 +10506,13 @@ gtk_window_set_focus_visible (GtkWindow *window,
   if (priv->focus_visible != setting)
     {
       priv->focus_visible = setting;
+
+      /* The focus outline is part of the render nodes that the
+       * focus widget and its ancestors keep between frames
+       */
+      if (priv->focus_widget)
+        gtk_widget_queue_draw (priv->focus_widget);
+
       g_object_notify_by_pspec (G_OBJECT (window), window_props[PROP_FOCUS_VISIBLE]);
     }
 }
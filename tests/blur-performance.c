@@ -2,53 +2,115 @@
 
 #include <gsk/gskcairoblurprivate.h>
 
+#include <string.h>
+
 static void
 init_surface (cairo_t *cr)
 {
   int w = cairo_image_surface_get_width (cairo_get_target (cr));
   int h = cairo_image_surface_get_height (cairo_get_target (cr));
 
-  cairo_set_source_rgb (cr, 0, 0, 0);
-  cairo_fill (cr);
+  cairo_save (cr);
+  cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+  cairo_paint (cr);
+  cairo_restore (cr);
 
-  cairo_set_source_rgb (cr, 1, 1, 1);
+  cairo_set_source_rgba (cr, 1, 0.5, 0.25, 0.75);
   cairo_arc (cr, w/2, h/2, w/2, 0, 2*G_PI);
   cairo_fill (cr);
 }
 
-int
-main (int argc, char **argv)
+static gboolean
+surfaces_equal (cairo_surface_t *a,
+                cairo_surface_t *b)
+{
+  cairo_surface_flush (a);
+  cairo_surface_flush (b);
+
+  return memcmp (cairo_image_surface_get_data (a),
+                 cairo_image_surface_get_data (b),
+                 cairo_image_surface_get_stride (a) * cairo_image_surface_get_height (a)) == 0;
+}
+
+static gboolean
+run_benchmark (cairo_format_t  format,
+               const char     *format_name,
+               int             size)
 {
-  cairo_surface_t *surface;
-  cairo_t *cr;
+  cairo_surface_t *surface, *reference;
+  cairo_t *cr, *reference_cr;
+  GskBlurKernel kernel;
+  gboolean success = TRUE;
   GTimer *timer;
   double msec;
   int i, j;
-  int size;
 
   timer = g_timer_new ();
 
-  size = 2000;
-
-  surface = cairo_image_surface_create (CAIRO_FORMAT_A8, size, size);
-
+  surface = cairo_image_surface_create (format, size, size);
   cr = cairo_create (surface);
+  reference = cairo_image_surface_create (format, size, size);
+  reference_cr = cairo_create (reference);
 
-  /* We do everything three times, first two as warmup */
-  for (j = 0; j < 2; j++)
+  for (kernel = 0; kernel < GSK_BLUR_KERNEL_N_KERNELS; kernel++)
     {
-      for (i = 1; i < 16; i++)
-	{
-	  init_surface (cr);
-	  g_timer_start (timer);
-	  gsk_cairo_blur_surface (surface, i, GSK_BLUR_X | GSK_BLUR_Y);
-	  msec = g_timer_elapsed (timer, NULL) * 1000;
-	  if (j == 1)
-	    g_print ("Radius %2d: %.2f msec, %.2f kpixels/msec:\n", i, msec, size*size/(msec*1000));
-	}
+      if (!gsk_cairo_blur_kernel_is_supported (kernel))
+        continue;
+
+      g_print ("%s, %s kernel%s:\n", format_name,
+               gsk_cairo_blur_kernel_get_name (kernel),
+               kernel == gsk_cairo_blur_get_default_kernel () ? " (default)" : "");
+
+      /* We do everything three times, first two as warmup */
+      for (j = 0; j < 3; j++)
+        {
+          for (i = 1; i < 16; i++)
+            {
+              gboolean equal;
+
+              init_surface (cr);
+              g_timer_start (timer);
+              gsk_cairo_blur_surface_with_kernel (surface, i, GSK_BLUR_X | GSK_BLUR_Y, kernel);
+              msec = g_timer_elapsed (timer, NULL) * 1000;
+
+              if (j < 2)
+                continue;
+
+              /* Every kernel must produce exactly what the scalar one does */
+              init_surface (reference_cr);
+              gsk_cairo_blur_surface_with_kernel (reference, i, GSK_BLUR_X | GSK_BLUR_Y,
+                                                  GSK_BLUR_KERNEL_SCALAR);
+
+              equal = surfaces_equal (surface, reference);
+              success &= equal;
+
+              g_print ("  Radius %2d: %.2f msec, %.2f Mpixels/sec%s\n",
+                       i, msec, size * size / (msec * 1000),
+                       equal ? "" : " (MISMATCH)");
+            }
+        }
     }
 
+  cairo_destroy (reference_cr);
+  cairo_surface_destroy (reference);
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
+
   g_timer_destroy (timer);
 
-  return 0;
+  return success;
+}
+
+int
+main (int argc, char **argv)
+{
+  gboolean success = TRUE;
+  int size;
+
+  size = 2000;
+
+  success &= run_benchmark (CAIRO_FORMAT_A8, "A8", size);
+  success &= run_benchmark (CAIRO_FORMAT_ARGB32, "ARGB32", size);
+
+  return success ? 0 : 1;
 }
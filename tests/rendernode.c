@@ -1,28 +1,66 @@
 #include <gtk/gtk.h>
 
+#include <string.h>
+
 static gboolean benchmark = FALSE;
 static gboolean dump_variant = FALSE;
 static gboolean fallback = FALSE;
+static char *convert = NULL;
 static int runs = 1;
 
 static GOptionEntry options[] = {
   { "benchmark", 'b', 0, G_OPTION_ARG_NONE, &benchmark, "Time operations", NULL },
   { "dump-variant", 'd', 0, G_OPTION_ARG_NONE, &dump_variant, "Dump GVariant structure", NULL },
   { "fallback", '\0', 0, G_OPTION_ARG_NONE, &fallback, "Draw node without a renderer", NULL },
+  { "convert", 'c', 0, G_OPTION_ARG_FILENAME, &convert, "Save node in the other format", "FILE" },
   { "runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Render the test N times", "N" },
   { NULL }
 };
 
+static gboolean
+is_binary (GBytes *bytes)
+{
+  gsize size;
+  const char *data = g_bytes_get_data (bytes, &size);
+
+  return size >= 8 && memcmp (data, "GSKBNODE", 8) == 0;
+}
+
+static const char *
+format_name (GBytes *bytes)
+{
+  return is_binary (bytes) ? "binary" : "GVariant";
+}
+
+static GskRenderNode *
+load_node (GBytes  *bytes,
+           GError **error)
+{
+  GskRenderNode *node;
+  gint64 start, end;
+
+  start = g_get_monotonic_time ();
+  node = gsk_render_node_deserialize (bytes, error);
+  end = g_get_monotonic_time ();
+  if (benchmark)
+    {
+      char *bytes_string = g_format_size (g_bytes_get_size (bytes));
+      g_print ("Loaded %s in %s format in %.4gs\n", bytes_string, format_name (bytes), (double) (end - start) / G_USEC_PER_SEC);
+      g_free (bytes_string);
+    }
+
+  return node;
+}
+
 int
 main(int argc, char **argv)
 {
   cairo_surface_t *surface;
   GskRenderNode *node;
   GError *error = NULL;
+  GMappedFile *file;
   GBytes *bytes;
   gint64 start, end;
-  char *contents;
-  gsize len;
   int run;
   GOptionContext *context;
 
@@ -41,20 +79,27 @@ main(int argc, char **argv)
       g_printerr ("Number of runs given with -r/--runs must be at least 1 and not %d.\n", runs);
       return 1;
     }
-  if (!(argc == 3 || (argc == 2 && (dump_variant || benchmark))))
+  if (!(argc == 3 || (argc == 2 && (dump_variant || benchmark || convert))))
     {
       g_printerr ("Usage: %s [OPTIONS] NODE-FILE PNG-FILE\n", argv[0]);
       return 1;
     }
 
-  if (!g_file_get_contents (argv[1], &contents, &len, &error))
+  /* Map the file, so the binary format can use the pixel data in place */
+  file = g_mapped_file_new (argv[1], FALSE, &error);
+  if (file == NULL)
     {
       g_printerr ("Could not open node file: %s\n", error->message);
       return 1;
     }
 
-  bytes = g_bytes_new_take (contents, len);
-  if (dump_variant)
+  bytes = g_mapped_file_get_bytes (file);
+  g_mapped_file_unref (file);
+  if (dump_variant && is_binary (bytes))
+    {
+      g_printerr ("Not dumping GVariant structure of a binary node file.\n");
+    }
+  else if (dump_variant)
     {
       GVariant *variant = g_variant_new_from_bytes (G_VARIANT_TYPE ("(suuv)"), bytes, FALSE);
       char *s;
@@ -65,24 +110,59 @@ main(int argc, char **argv)
       g_variant_unref (variant);
     }
 
-  start = g_get_monotonic_time ();
-  node = gsk_render_node_deserialize (bytes, &error);
-  end = g_get_monotonic_time ();
-  if (benchmark)
-    {
-      char *bytes_string = g_format_size (g_bytes_get_size (bytes));
-      g_print ("Loaded %s in %.4gs\n", bytes_string, (double) (end - start) / G_USEC_PER_SEC);
-      g_free (bytes_string);
-    }
-  g_bytes_unref (bytes);
+  node = load_node (bytes, &error);
 
   if (node == NULL)
     {
       g_printerr ("Invalid node file: %s\n", error->message);
       g_clear_error (&error);
+      g_bytes_unref (bytes);
       return 1;
     }
 
+  if (convert)
+    {
+      GBytes *converted;
+
+      if (is_binary (bytes))
+        converted = gsk_render_node_serialize (node);
+      else
+        converted = gsk_render_node_serialize_binary (node);
+
+      if (!g_file_set_contents (convert,
+                                g_bytes_get_data (converted, NULL),
+                                g_bytes_get_size (converted),
+                                &error))
+        {
+          g_printerr ("Could not save node file: %s\n", error->message);
+          g_clear_error (&error);
+          return 1;
+        }
+
+      /* Compare the load times of both formats */
+      if (benchmark)
+        {
+          GskRenderNode *reloaded = load_node (converted, &error);
+
+          if (reloaded == NULL)
+            {
+              g_printerr ("Could not load converted node: %s\n", error->message);
+              g_clear_error (&error);
+              return 1;
+            }
+          gsk_render_node_unref (reloaded);
+        }
+
+      g_bytes_unref (converted);
+
+      if (argc == 2 && !benchmark)
+        {
+          gsk_render_node_unref (node);
+          g_bytes_unref (bytes);
+          return 0;
+        }
+    }
+
   if (fallback)
     {
       graphene_rect_t bounds;
@@ -144,6 +224,7 @@ main(int argc, char **argv)
     }
 
   gsk_render_node_unref (node);
+  g_bytes_unref (bytes);
 
   if (argc > 2)
     {
@@ -0,0 +1,232 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Restyles a tree of 10000 widgets by toggling a style class on its root.
+ * Run with -m perf to get timings, otherwise the tree is only restyled
+ * once to check that it works. Also checks that changing a provider
+ * restyles the right widgets.
+ */
+
+#include <gtk/gtk.h>
+
+#define N_BOXES 100
+#define N_LABELS_PER_BOX 99
+
+static const char *css =
+  "box.row { padding: 1px; }\n"
+  "box.row:nth-child(even) { background-color: gray; }\n"
+  "box label { color: black; }\n"
+  "box.row label.title { font-weight: bold; }\n"
+  "box.row label.subtitle { font-size: smaller; }\n"
+  ".toggled box label { color: red; }\n"
+  ".toggled box.row > label.title { color: blue; }\n"
+  "window .toggled label:first-child { margin: 2px; }\n"
+  "notebook box label { color: green; }\n"
+  "treeview label, list label { color: yellow; }\n";
+
+static void
+create_tree (GtkWidget  *root,
+             GPtrArray  *widgets)
+{
+  int i, j;
+
+  for (i = 0; i < N_BOXES; i++)
+    {
+      GtkWidget *row = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+
+      gtk_style_context_add_class (gtk_widget_get_style_context (row), "row");
+      gtk_container_add (GTK_CONTAINER (root), row);
+      g_ptr_array_add (widgets, row);
+
+      for (j = 0; j < N_LABELS_PER_BOX; j++)
+        {
+          GtkWidget *label = gtk_label_new (NULL);
+
+          gtk_style_context_add_class (gtk_widget_get_style_context (label),
+                                       j % 3 == 0 ? "title" : "subtitle");
+          gtk_container_add (GTK_CONTAINER (row), label);
+          g_ptr_array_add (widgets, label);
+        }
+    }
+}
+
+/* Looking up a style computes it, after the ones of all ancestors */
+static void
+restyle (GPtrArray *widgets)
+{
+  GdkRGBA color;
+  guint i;
+
+  for (i = 0; i < widgets->len; i++)
+    gtk_style_context_get_color (gtk_widget_get_style_context (widgets->pdata[i]), &color);
+}
+
+static void
+test_restyle (void)
+{
+  GtkCssProvider *provider;
+  GtkWidget *window, *root;
+  GtkStyleContext *context;
+  GPtrArray *widgets;
+  GdkRGBA color;
+  int i, runs;
+  double total;
+
+  /* Make sure every node is matched instead of sharing styles with
+   * identical siblings.
+   */
+  gtk_set_debug_flags (gtk_get_debug_flags () | GTK_DEBUG_NO_CSS_CACHE);
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider, css, -1);
+  gtk_style_context_add_provider_for_screen (gdk_screen_get_default (),
+                                             GTK_STYLE_PROVIDER (provider),
+                                             GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  root = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  gtk_container_add (GTK_CONTAINER (window), root);
+  context = gtk_widget_get_style_context (root);
+
+  widgets = g_ptr_array_new ();
+  create_tree (root, widgets);
+  g_assert_cmpint (widgets->len, ==, N_BOXES * (N_LABELS_PER_BOX + 1));
+
+  restyle (widgets);
+
+  runs = g_test_perf () ? 51 : 1;
+  total = 0;
+  for (i = 0; i < runs; i++)
+    {
+      if (i % 2)
+        gtk_style_context_remove_class (context, "toggled");
+      else
+        gtk_style_context_add_class (context, "toggled");
+
+      g_test_timer_start ();
+      restyle (widgets);
+      total += g_test_timer_elapsed ();
+    }
+
+  if (g_test_perf ())
+    g_test_minimized_result (total / runs, "restyling %u widgets took %f seconds",
+                             widgets->len, total / runs);
+
+  /* The last run added the class */
+  gtk_style_context_get_color (gtk_widget_get_style_context (widgets->pdata[2]), &color);
+  g_assert_cmpfloat (color.red, ==, 1.0);
+  g_assert_cmpfloat (color.green, ==, 0.0);
+
+  g_ptr_array_unref (widgets);
+  gtk_widget_destroy (window);
+  gtk_style_context_remove_provider_for_screen (gdk_screen_get_default (),
+                                                GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+}
+
+static void
+assert_color (GtkWidget *widget,
+              double     red,
+              double     green,
+              double     blue)
+{
+  GdkRGBA color;
+
+  gtk_style_context_get_color (gtk_widget_get_style_context (widget), &color);
+  g_assert_cmpfloat (color.red, ==, red);
+  g_assert_cmpfloat (color.green, ==, green);
+  g_assert_cmpfloat (color.blue, ==, blue);
+}
+
+/* Providers that only contain rules restyle the nodes matching them */
+static void
+test_change_provider (void)
+{
+  GtkCssProvider *provider, *row_provider;
+  GtkWidget *window, *root;
+  GPtrArray *widgets;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider, css, -1);
+  gtk_style_context_add_provider_for_screen (gdk_screen_get_default (),
+                                             GTK_STYLE_PROVIDER (provider),
+                                             GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  root = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  gtk_container_add (GTK_CONTAINER (window), root);
+
+  widgets = g_ptr_array_new ();
+  create_tree (root, widgets);
+  restyle (widgets);
+
+  /* The first label of the third and fourth row */
+  assert_color (widgets->pdata[2 * (N_LABELS_PER_BOX + 1) + 1], 0, 0, 0);
+  assert_color (widgets->pdata[3 * (N_LABELS_PER_BOX + 1) + 1], 0, 0, 0);
+
+  row_provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (row_provider, "box.row:nth-child(3) label { color: lime; }", -1);
+  gtk_style_context_add_provider_for_screen (gdk_screen_get_default (),
+                                             GTK_STYLE_PROVIDER (row_provider),
+                                             GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+  assert_color (widgets->pdata[2 * (N_LABELS_PER_BOX + 1) + 1], 0, 1, 0);
+  assert_color (widgets->pdata[3 * (N_LABELS_PER_BOX + 1) + 1], 0, 0, 0);
+
+  /* Nodes matching the old rules must be restyled, too */
+  gtk_css_provider_load_from_data (row_provider, "box.row:nth-child(4) label { color: blue; }", -1);
+
+  assert_color (widgets->pdata[2 * (N_LABELS_PER_BOX + 1) + 1], 0, 0, 0);
+  assert_color (widgets->pdata[3 * (N_LABELS_PER_BOX + 1) + 1], 0, 0, 1);
+
+  gtk_style_context_remove_provider_for_screen (gdk_screen_get_default (),
+                                                GTK_STYLE_PROVIDER (row_provider));
+
+  assert_color (widgets->pdata[3 * (N_LABELS_PER_BOX + 1) + 1], 0, 0, 0);
+
+  /* A rule that only matches after a later state change */
+  gtk_css_provider_load_from_data (row_provider, "box.row:hover label { color: lime; }", -1);
+  gtk_style_context_add_provider_for_screen (gdk_screen_get_default (),
+                                             GTK_STYLE_PROVIDER (row_provider),
+                                             GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+  assert_color (widgets->pdata[2 * (N_LABELS_PER_BOX + 1) + 1], 0, 0, 0);
+
+  gtk_widget_set_state_flags (widgets->pdata[2 * (N_LABELS_PER_BOX + 1)], GTK_STATE_FLAG_PRELIGHT, FALSE);
+
+  assert_color (widgets->pdata[2 * (N_LABELS_PER_BOX + 1) + 1], 0, 1, 0);
+  assert_color (widgets->pdata[3 * (N_LABELS_PER_BOX + 1) + 1], 0, 0, 0);
+
+  gtk_style_context_remove_provider_for_screen (gdk_screen_get_default (),
+                                                GTK_STYLE_PROVIDER (row_provider));
+
+  g_object_unref (row_provider);
+  g_ptr_array_unref (widgets);
+  gtk_widget_destroy (window);
+  gtk_style_context_remove_provider_for_screen (gdk_screen_get_default (),
+                                                GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/css/restyle/10000-widgets", test_restyle);
+  g_test_add_func ("/css/restyle/change-provider", test_change_provider);
+
+  return g_test_run ();
+}
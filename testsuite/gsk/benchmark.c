@@ -0,0 +1,278 @@
+/* Renders node files with every available renderer and prints the frame
+ * times and profiler counters as JSON, so results can be compared between
+ * builds.
+ *
+ * The nodes are rendered to textures using a window that is never shown,
+ * so no compositor is needed. Renderers that cannot be realized, like GL
+ * or Vulkan without a (software) driver, are listed as skipped.
+ */
+
+#include <gtk/gtk.h>
+#include <gsk/gskrendererprivate.h>
+
+#include <math.h>
+#include <string.h>
+
+static int runs = 50;
+static char *output = NULL;
+
+static GOptionEntry options[] = {
+  { "runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Render each node N times", "N" },
+  { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "Write results to FILE instead of stdout", "FILE" },
+  { NULL }
+};
+
+static struct {
+  const char *name;
+  const char *type_name;
+} renderers[] = {
+  { "cairo", "GskCairoRenderer" },
+  { "opengl", "GskGLRenderer" },
+#ifdef HAVE_VULKAN
+  { "vulkan", "GskVulkanRenderer" },
+#endif
+};
+
+static void
+append_json_string (GString    *json,
+                    const char *s)
+{
+  g_string_append_c (json, '"');
+  for (; *s; s++)
+    {
+      if (*s == '"' || *s == '\\')
+        g_string_append_printf (json, "\\%c", *s);
+      else if ((guchar) *s < 0x20)
+        g_string_append_printf (json, "\\u%04x", *s);
+      else
+        g_string_append_c (json, *s);
+    }
+  g_string_append_c (json, '"');
+}
+
+static void
+append_counter (const char *counter_name,
+                const char *description,
+                gint64      value,
+                gpointer    user_data)
+{
+  GString *json = user_data;
+
+  if (json->str[json->len - 1] != '{')
+    g_string_append (json, ", ");
+
+  append_json_string (json, counter_name);
+  g_string_append_printf (json, ": %" G_GINT64_FORMAT, value);
+}
+
+static int
+compare_times (gconstpointer a,
+               gconstpointer b)
+{
+  gint64 t1 = *(const gint64 *) a;
+  gint64 t2 = *(const gint64 *) b;
+
+  return t1 < t2 ? -1 : t1 > t2;
+}
+
+/* Nearest-rank percentile of sorted @times */
+static gint64
+percentile (const gint64 *times,
+            int           n_times,
+            double        p)
+{
+  int rank = ceil (p / 100.0 * n_times);
+
+  return times[CLAMP (rank, 1, n_times) - 1];
+}
+
+static void
+benchmark_node (GString       *json,
+                GskRenderer   *renderer,
+                const char    *renderer_name,
+                const char    *filename,
+                GskRenderNode *node)
+{
+  gint64 *times, total;
+  char *basename;
+  int run;
+
+  times = g_new (gint64, runs);
+  total = 0;
+
+  /* Fill glyph and texture caches before measuring */
+  g_object_unref (gsk_renderer_render_texture (renderer, node, NULL));
+
+  for (run = 0; run < runs; run++)
+    {
+      GskTexture *texture;
+      gint64 start;
+
+      start = g_get_monotonic_time ();
+      texture = gsk_renderer_render_texture (renderer, node, NULL);
+      times[run] = g_get_monotonic_time () - start;
+      total += times[run];
+
+      g_object_unref (texture);
+    }
+
+  qsort (times, runs, sizeof (gint64), compare_times);
+
+  basename = g_path_get_basename (filename);
+
+  g_string_append (json, "    {\n      \"node\": ");
+  append_json_string (json, basename);
+  g_string_append (json, ",\n      \"renderer\": ");
+  append_json_string (json, renderer_name);
+  g_string_append_printf (json, ",\n      \"runs\": %d,\n", runs);
+  g_string_append_printf (json, "      \"frame-time-usec\": { \"min\": %" G_GINT64_FORMAT
+                                ", \"p50\": %" G_GINT64_FORMAT
+                                ", \"p90\": %" G_GINT64_FORMAT
+                                ", \"p99\": %" G_GINT64_FORMAT
+                                ", \"max\": %" G_GINT64_FORMAT
+                                ", \"mean\": %" G_GINT64_FORMAT " },\n",
+                          times[0],
+                          percentile (times, runs, 50),
+                          percentile (times, runs, 90),
+                          percentile (times, runs, 99),
+                          times[runs - 1],
+                          total / runs);
+
+  /* The counters of the last frame. They are only collected in
+   * debug builds.
+   */
+  g_string_append (json, "      \"counters\": {");
+  gsk_profiler_foreach_counter (gsk_renderer_get_profiler (renderer), append_counter, json);
+  g_string_append (json, "}\n    },\n");
+
+  g_free (basename);
+  g_free (times);
+}
+
+static void
+ignore_print (const char *string)
+{
+}
+
+int
+main (int argc, char **argv)
+{
+  GskRenderNode **nodes;
+  GOptionContext *context;
+  GError *error = NULL;
+  GdkDisplay *display;
+  GdkWindow *window;
+  GString *json, *skipped;
+  int i, j;
+
+  context = g_option_context_new ("NODE-FILE...");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  if (runs < 1)
+    {
+      g_printerr ("Number of runs given with -r/--runs must be at least 1 and not %d.\n", runs);
+      return 1;
+    }
+  if (argc < 2)
+    {
+      g_printerr ("Usage: %s [OPTIONS] NODE-FILE...\n", argv[0]);
+      return 1;
+    }
+
+  gtk_init ();
+
+  nodes = g_new (GskRenderNode *, argc);
+  for (i = 1; i < argc; i++)
+    {
+      GMappedFile *file;
+      GBytes *bytes;
+
+      file = g_mapped_file_new (argv[i], FALSE, &error);
+      if (file == NULL)
+        {
+          g_printerr ("Could not open node file: %s\n", error->message);
+          return 1;
+        }
+
+      bytes = g_mapped_file_get_bytes (file);
+      nodes[i] = gsk_render_node_deserialize (bytes, &error);
+      g_bytes_unref (bytes);
+      g_mapped_file_unref (file);
+
+      if (nodes[i] == NULL)
+        {
+          g_printerr ("Invalid node file %s: %s\n", argv[i], error->message);
+          return 1;
+        }
+    }
+
+  display = gdk_display_get_default ();
+  window = gdk_window_new_toplevel (display, 0, 10, 10);
+
+  json = g_string_new ("{\n  \"results\": [\n");
+  skipped = g_string_new (NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (renderers); i++)
+    {
+      GskRenderer *renderer;
+      GPrintFunc old_print;
+
+      /* Selecting a renderer through the display prints which one was
+       * picked, which would end up in the JSON.
+       */
+      g_object_set_data (G_OBJECT (display), "gsk-renderer", (gpointer) renderers[i].name);
+      old_print = g_set_print_handler (ignore_print);
+      renderer = gsk_renderer_new_for_window (window);
+      g_set_print_handler (old_print);
+
+      if (!g_str_equal (G_OBJECT_TYPE_NAME (renderer), renderers[i].type_name))
+        {
+          if (skipped->len > 0)
+            g_string_append (skipped, ", ");
+          append_json_string (skipped, renderers[i].name);
+        }
+      else
+        {
+          for (j = 1; j < argc; j++)
+            benchmark_node (json, renderer, renderers[i].name, argv[j], nodes[j]);
+        }
+
+      gsk_renderer_unrealize (renderer);
+      g_object_unref (renderer);
+    }
+
+  g_object_set_data (G_OBJECT (display), "gsk-renderer", NULL);
+
+  /* Remove the comma after the last result */
+  if (json->str[json->len - 2] == ',')
+    g_string_erase (json, json->len - 2, 1);
+  g_string_append_printf (json, "  ],\n  \"skipped\": [%s]\n}\n", skipped->str);
+
+  if (output)
+    {
+      if (!g_file_set_contents (output, json->str, json->len, &error))
+        {
+          g_printerr ("Could not write results: %s\n", error->message);
+          return 1;
+        }
+    }
+  else
+    {
+      g_print ("%s", json->str);
+    }
+
+  for (i = 1; i < argc; i++)
+    gsk_render_node_unref (nodes[i]);
+  g_free (nodes);
+  g_string_free (json, TRUE);
+  g_string_free (skipped, TRUE);
+  g_object_unref (window);
+
+  return 0;
+}
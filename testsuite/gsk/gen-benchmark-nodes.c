@@ -0,0 +1,286 @@
+/* Creates the node files used by the GSK benchmark. Each file stresses
+ * one kind of node the way typical applications use it.
+ */
+
+#include <gtk/gtk.h>
+
+#include <string.h>
+
+#define WIDTH 1024
+#define HEIGHT 768
+
+static const char *lorem =
+  "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod "
+  "tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, "
+  "quis nostrud exercitation ullamco laboris nisi ut aliquip ex ea commodo "
+  "consequat. Duis aute irure dolor in reprehenderit in voluptate velit esse "
+  "cillum dolore eu fugiat nulla pariatur. Excepteur sint occaecat cupidatat "
+  "non proident, sunt in culpa qui officia deserunt mollit anim id est laborum. ";
+
+static GskRenderNode *
+container_from_array (GPtrArray *nodes)
+{
+  GskRenderNode *container;
+
+  container = gsk_container_node_new ((GskRenderNode **) nodes->pdata, nodes->len);
+  g_ptr_array_unref (nodes);
+
+  return container;
+}
+
+static void
+add_background (GPtrArray *nodes)
+{
+  GdkRGBA white = { 1, 1, 1, 1 };
+
+  g_ptr_array_add (nodes, gsk_color_node_new (&white, &GRAPHENE_RECT_INIT (0, 0, WIDTH, HEIGHT)));
+}
+
+/* A page of text, one text node per glyph run, like a text view */
+static GskRenderNode *
+create_text (void)
+{
+  GdkRGBA colors[] = { { 0, 0, 0, 1 }, { 0.2, 0.2, 0.6, 1 }, { 0.6, 0, 0, 1 } };
+  GPtrArray *nodes = g_ptr_array_new_with_free_func ((GDestroyNotify) gsk_render_node_unref);
+  PangoFontDescription *desc;
+  PangoContext *context;
+  PangoLayout *layout;
+  PangoLayoutIter *iter;
+  GString *text;
+  int i, n_runs = 0;
+
+  add_background (nodes);
+
+  text = g_string_new (NULL);
+  for (i = 0; i < 12; i++)
+    g_string_append (text, lorem);
+
+  context = pango_font_map_create_context (pango_cairo_font_map_get_default ());
+  layout = pango_layout_new (context);
+  desc = pango_font_description_from_string ("Sans 11");
+  pango_layout_set_font_description (layout, desc);
+  pango_font_description_free (desc);
+  pango_layout_set_width (layout, (WIDTH - 20) * PANGO_SCALE);
+  pango_layout_set_text (layout, text->str, text->len);
+
+  iter = pango_layout_get_iter (layout);
+  do
+    {
+      PangoLayoutRun *run = pango_layout_iter_get_run_readonly (iter);
+      GskRenderNode *node;
+      PangoRectangle extents;
+      int baseline;
+
+      if (run == NULL)
+        continue;
+
+      pango_layout_iter_get_run_extents (iter, NULL, &extents);
+      baseline = pango_layout_iter_get_baseline (iter);
+      if (baseline / PANGO_SCALE > HEIGHT)
+        break;
+
+      node = gsk_text_node_new (run->item->analysis.font,
+                                run->glyphs,
+                                &colors[n_runs++ % G_N_ELEMENTS (colors)],
+                                10 + (double) extents.x / PANGO_SCALE,
+                                10 + (double) baseline / PANGO_SCALE);
+      /* runs with only spaces don't get a node */
+      if (node)
+        g_ptr_array_add (nodes, node);
+    }
+  while (pango_layout_iter_next_run (iter));
+
+  pango_layout_iter_free (iter);
+  g_object_unref (layout);
+  g_object_unref (context);
+  g_string_free (text, TRUE);
+
+  return container_from_array (nodes);
+}
+
+/* A grid of cards with blurred drop shadows, like a list of tiles */
+static GskRenderNode *
+create_shadows (void)
+{
+  GPtrArray *nodes = g_ptr_array_new_with_free_func ((GDestroyNotify) gsk_render_node_unref);
+  GdkRGBA shadow = { 0, 0, 0, 0.4 };
+  GdkRGBA inset = { 1, 1, 1, 0.6 };
+  GdkRGBA card = { 0.95, 0.95, 0.97, 1 };
+  GdkRGBA label = { 0.2, 0.4, 0.64, 1 };
+  GskShadow text_shadow = { { 0, 0, 0, 0.5 }, 1, 1, 3 };
+  int x, y;
+
+  add_background (nodes);
+
+  for (y = 0; y < 6; y++)
+    for (x = 0; x < 8; x++)
+      {
+        graphene_rect_t bounds = GRAPHENE_RECT_INIT (16 + x * 126, 16 + y * 124, 100, 96);
+        GskRenderNode *content, *node;
+        GskRoundedRect outline;
+
+        gsk_rounded_rect_init_from_rect (&outline, &bounds, 8);
+
+        g_ptr_array_add (nodes, gsk_outset_shadow_node_new (&outline, &shadow, 0, 4, 0, 4 + (x + y) % 4 * 4));
+
+        content = gsk_color_node_new (&card, &bounds);
+        node = gsk_rounded_clip_node_new (content, &outline);
+        g_ptr_array_add (nodes, node);
+        gsk_render_node_unref (content);
+
+        g_ptr_array_add (nodes, gsk_inset_shadow_node_new (&outline, &inset, 0, 1, 0, 2));
+
+        content = gsk_color_node_new (&label, &GRAPHENE_RECT_INIT (bounds.origin.x + 12, bounds.origin.y + 12, 76, 20));
+        g_ptr_array_add (nodes, gsk_shadow_node_new (content, &text_shadow, 1));
+        gsk_render_node_unref (content);
+      }
+
+  return container_from_array (nodes);
+}
+
+/* Buttons and headerbars drawn with gradients, like a themed window */
+static GskRenderNode *
+create_gradients (void)
+{
+  GPtrArray *nodes = g_ptr_array_new_with_free_func ((GDestroyNotify) gsk_render_node_unref);
+  GskColorStop stops[] = {
+    { 0.0, { 0.93, 0.93, 0.92, 1 } },
+    { 0.5, { 0.88, 0.88, 0.86, 1 } },
+    { 1.0, { 0.80, 0.80, 0.78, 1 } },
+  };
+  GskColorStop stripes[] = {
+    { 0.0, { 0.2, 0.4, 0.7, 1 } },
+    { 0.5, { 0.2, 0.4, 0.7, 1 } },
+    { 0.5, { 0.3, 0.5, 0.8, 1 } },
+    { 1.0, { 0.3, 0.5, 0.8, 1 } },
+  };
+  int x, y;
+
+  g_ptr_array_add (nodes, gsk_linear_gradient_node_new (&GRAPHENE_RECT_INIT (0, 0, WIDTH, HEIGHT),
+                                                        &GRAPHENE_POINT_INIT (0, 0),
+                                                        &GRAPHENE_POINT_INIT (0, HEIGHT),
+                                                        stops, G_N_ELEMENTS (stops)));
+
+  for (y = 0; y < 16; y++)
+    for (x = 0; x < 10; x++)
+      {
+        graphene_rect_t bounds = GRAPHENE_RECT_INIT (12 + x * 100, 12 + y * 46, 88, 34);
+
+        if ((x + y) % 5 == 0)
+          g_ptr_array_add (nodes, gsk_repeating_linear_gradient_node_new (&bounds,
+                                                                          &GRAPHENE_POINT_INIT (bounds.origin.x, bounds.origin.y),
+                                                                          &GRAPHENE_POINT_INIT (bounds.origin.x + 12, bounds.origin.y + 12),
+                                                                          stripes, G_N_ELEMENTS (stripes)));
+        else
+          g_ptr_array_add (nodes, gsk_linear_gradient_node_new (&bounds,
+                                                                &GRAPHENE_POINT_INIT (bounds.origin.x, bounds.origin.y),
+                                                                &GRAPHENE_POINT_INIT (bounds.origin.x, bounds.origin.y + bounds.size.height),
+                                                                stops, G_N_ELEMENTS (stops)));
+      }
+
+  return container_from_array (nodes);
+}
+
+/* Nested transforms, clips and opacity, like deeply nested widgets */
+static GskRenderNode *
+create_transforms (void)
+{
+  GdkRGBA color;
+  GskRenderNode *node;
+  int i;
+
+  node = NULL;
+  for (i = 63; i >= 0; i--)
+    {
+      GskRenderNode *children[2];
+      graphene_matrix_t transform;
+      GskRenderNode *container, *child;
+      guint n_children = 0;
+
+      color = (GdkRGBA) { (i % 8) / 8.0, (i % 5) / 5.0, (i % 3) / 3.0, 1 };
+      children[n_children++] = gsk_color_node_new (&color, &GRAPHENE_RECT_INIT (0, 0, 200, 120));
+      if (node)
+        children[n_children++] = node;
+
+      container = gsk_container_node_new (children, n_children);
+      gsk_render_node_unref (children[0]);
+      g_clear_pointer (&node, gsk_render_node_unref);
+
+      if (i % 4 == 3)
+        {
+          child = gsk_opacity_node_new (container, 0.9);
+          gsk_render_node_unref (container);
+          container = child;
+        }
+      if (i % 8 == 5)
+        {
+          child = gsk_clip_node_new (container, &GRAPHENE_RECT_INIT (-400, -400, 800, 800));
+          gsk_render_node_unref (container);
+          container = child;
+        }
+
+      graphene_matrix_init_rotate (&transform, 5, graphene_vec3_z_axis ());
+      graphene_matrix_translate (&transform, &GRAPHENE_POINT3D_INIT (8, 6, 0));
+      node = gsk_transform_node_new (container, &transform);
+      gsk_render_node_unref (container);
+    }
+
+  return node;
+}
+
+static struct {
+  const char *name;
+  GskRenderNode * (* create) (void);
+} benchmarks[] = {
+  { "text", create_text },
+  { "shadows", create_shadows },
+  { "gradients", create_gradients },
+  { "transforms", create_transforms },
+};
+
+int
+main (int argc, char **argv)
+{
+  GError *error = NULL;
+  int i, j;
+
+  if (argc < 2)
+    {
+      g_printerr ("Usage: %s NODE-FILE...\n", argv[0]);
+      return 1;
+    }
+
+  /* Files are given as NAME.node, in any order */
+  for (i = 1; i < argc; i++)
+    {
+      char *basename = g_path_get_basename (argv[i]);
+
+      for (j = 0; j < G_N_ELEMENTS (benchmarks); j++)
+        {
+          GskRenderNode *node;
+
+          if (!g_str_has_prefix (basename, benchmarks[j].name) ||
+              !g_str_equal (basename + strlen (benchmarks[j].name), ".node"))
+            continue;
+
+          node = benchmarks[j].create ();
+          if (!gsk_render_node_write_to_file (node, argv[i], &error))
+            {
+              g_printerr ("Could not write %s: %s\n", argv[i], error->message);
+              return 1;
+            }
+          gsk_render_node_unref (node);
+          break;
+        }
+
+      if (j == G_N_ELEMENTS (benchmarks))
+        {
+          g_printerr ("Unknown benchmark %s\n", basename);
+          return 1;
+        }
+
+      g_free (basename);
+    }
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Draws containers whose children are partly or fully hidden by an
+ * opaque child above them. Checks that the hidden parts are culled
+ * and that culling them does not change the result.
+ */
+
+#include <gtk/gtk.h>
+#include <gsk/gskrendernodeprivate.h>
+
+#define SIZE 10
+
+static const GdkRGBA red = { 1, 0, 0, 1 };
+static const GdkRGBA blue = { 0, 0, 1, 1 };
+static const GdkRGBA translucent_blue = { 0, 0, 1, 0.5 };
+
+static GskRenderNode *
+container_new (const GdkRGBA         *bottom_color,
+               const graphene_rect_t *bottom_bounds,
+               const GdkRGBA         *top_color,
+               const graphene_rect_t *top_bounds)
+{
+  GskRenderNode *children[2];
+  GskRenderNode *container;
+
+  children[0] = gsk_color_node_new (bottom_color, bottom_bounds);
+  children[1] = gsk_color_node_new (top_color, top_bounds);
+  container = gsk_container_node_new (children, 2);
+  gsk_render_node_unref (children[0]);
+  gsk_render_node_unref (children[1]);
+
+  return container;
+}
+
+static cairo_surface_t *
+draw_node (GskRenderNode *node)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, SIZE, SIZE);
+  cr = cairo_create (surface);
+  gsk_render_node_draw (node, cr);
+  cairo_destroy (cr);
+  cairo_surface_flush (surface);
+
+  return surface;
+}
+
+static void
+assert_visible_bounds (GskRenderNode         *container,
+                       guint                  idx,
+                       const graphene_rect_t *expected)
+{
+  const graphene_rect_t *visible;
+
+  visible = gsk_container_node_peek_visible_bounds (container, idx);
+  g_assert_nonnull (visible);
+  g_assert_cmpfloat (visible->origin.x, ==, expected->origin.x);
+  g_assert_cmpfloat (visible->origin.y, ==, expected->origin.y);
+  g_assert_cmpfloat (visible->size.width, ==, expected->size.width);
+  g_assert_cmpfloat (visible->size.height, ==, expected->size.height);
+}
+
+static guint32
+get_pixel (cairo_surface_t *surface,
+           int              x,
+           int              y)
+{
+  const guchar *data = cairo_image_surface_get_data (surface);
+
+  return *(const guint32 *) (data + y * cairo_image_surface_get_stride (surface) + x * 4);
+}
+
+static void
+test_fully_occluded (void)
+{
+  GskRenderNode *node;
+  const graphene_rect_t *visible;
+  cairo_surface_t *surface;
+  int x, y;
+
+  node = container_new (&red, &GRAPHENE_RECT_INIT (0, 0, SIZE, SIZE),
+                        &blue, &GRAPHENE_RECT_INIT (0, 0, SIZE, SIZE));
+  surface = draw_node (node);
+
+  /* The bottom child is skipped entirely */
+  visible = gsk_container_node_peek_visible_bounds (node, 0);
+  g_assert_true (visible->size.width <= 0 || visible->size.height <= 0);
+  assert_visible_bounds (node, 1, &GRAPHENE_RECT_INIT (0, 0, SIZE, SIZE));
+
+  for (y = 0; y < SIZE; y++)
+    for (x = 0; x < SIZE; x++)
+      g_assert_cmphex (get_pixel (surface, x, y), ==, 0xff0000ff);
+
+  cairo_surface_destroy (surface);
+  gsk_render_node_unref (node);
+}
+
+static void
+test_partially_occluded (void)
+{
+  GskRenderNode *node;
+  cairo_surface_t *surface;
+  int x, y;
+
+  /* The bottom child is only drawn in its right half */
+  node = container_new (&red, &GRAPHENE_RECT_INIT (0, 0, SIZE, SIZE),
+                        &blue, &GRAPHENE_RECT_INIT (0, 0, SIZE / 2, SIZE));
+  surface = draw_node (node);
+
+  assert_visible_bounds (node, 0, &GRAPHENE_RECT_INIT (SIZE / 2, 0, SIZE - SIZE / 2, SIZE));
+
+  for (y = 0; y < SIZE; y++)
+    for (x = 0; x < SIZE; x++)
+      g_assert_cmphex (get_pixel (surface, x, y), ==, x < SIZE / 2 ? 0xff0000ff : 0xffff0000);
+
+  cairo_surface_destroy (surface);
+  gsk_render_node_unref (node);
+}
+
+static void
+test_antialiased_edge (void)
+{
+  GskRenderNode *node;
+  cairo_surface_t *surface;
+  guint32 pixel;
+  int y;
+
+  /* The column that the top child only covers by half is not opaque,
+   * so the bottom child has to show through it
+   */
+  node = container_new (&red, &GRAPHENE_RECT_INIT (0, 0, SIZE, SIZE),
+                        &blue, &GRAPHENE_RECT_INIT (0, 0, 4.5, SIZE));
+  surface = draw_node (node);
+
+  assert_visible_bounds (node, 0, &GRAPHENE_RECT_INIT (4, 0, SIZE - 4, SIZE));
+
+  for (y = 0; y < SIZE; y++)
+    {
+      g_assert_cmphex (get_pixel (surface, 3, y), ==, 0xff0000ff);
+
+      pixel = get_pixel (surface, 4, y);
+      g_assert_cmphex (pixel >> 24, ==, 0xff);
+      g_assert_cmpuint ((pixel >> 16) & 0xff, >, 0);
+      g_assert_cmpuint (pixel & 0xff, >, 0);
+
+      g_assert_cmphex (get_pixel (surface, 5, y), ==, 0xffff0000);
+    }
+
+  cairo_surface_destroy (surface);
+  gsk_render_node_unref (node);
+}
+
+static void
+test_translucent (void)
+{
+  GskRenderNode *node;
+  cairo_surface_t *surface;
+  guint32 pixel;
+
+  /* Translucent children hide nothing */
+  node = container_new (&red, &GRAPHENE_RECT_INIT (0, 0, SIZE, SIZE),
+                        &translucent_blue, &GRAPHENE_RECT_INIT (0, 0, SIZE, SIZE));
+  surface = draw_node (node);
+
+  assert_visible_bounds (node, 0, &GRAPHENE_RECT_INIT (0, 0, SIZE, SIZE));
+
+  pixel = get_pixel (surface, SIZE / 2, SIZE / 2);
+  g_assert_cmphex (pixel >> 24, ==, 0xff);
+  g_assert_cmpuint ((pixel >> 16) & 0xff, >, 0);
+  g_assert_cmpuint (pixel & 0xff, >, 0);
+
+  cairo_surface_destroy (surface);
+  gsk_render_node_unref (node);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/gsk/occlusion/fully-occluded", test_fully_occluded);
+  g_test_add_func ("/gsk/occlusion/partially-occluded", test_partially_occluded);
+  g_test_add_func ("/gsk/occlusion/antialiased-edge", test_antialiased_edge);
+  g_test_add_func ("/gsk/occlusion/translucent", test_translucent);
+
+  return g_test_run ();
+}